@@ -2,43 +2,103 @@
 
 #include <vector>
 #include <string>
+#include <set>
+#include <chrono>
 
 #include <vulkan/vulkan.h>
 #include <GLFW/glfw3.h>
 
+#include "ApplicationSettings.h"
+#include "PipelineCache.h"
+#include "ShaderManager.h"
+#include "PipelineBuilder.h"
+#include "LayoutCache.h"
+#include "BindlessTable.h"
+#include "MemoryAllocator.h"
+#include "UploadManager.h"
+#include "DeletionQueue.h"
+#include "AssetArchive.h"
+#include "HostAllocator.h"
+
 class Application
 {
 public:
-	Application();
-	~Application();
+	Application(const ApplicationSettings& settings);
+	virtual ~Application();
 
 	virtual void Run() = 0;
 protected:
+	//Headless only: copies a rendered offscreen image into host memory as tightly packed RGBA8.
+	std::vector<uint8_t> ReadbackOffscreenImage(uint32_t imageIndex);
+	void SaveOffscreenImage(uint32_t imageIndex, const std::string& filename);
+	bool IsDeviceExtensionEnabled(const std::string& name) const;
+	//Windowed only: replaces swapchain and image views after a resize. Old objects are retired through the
+	//deletion queue and destroyed once the GPU has completed retireValue.
+	void RecreateSwapchain(uint64_t retireValue);
+
+	static const uint32_t apiVersion;
+	//Construction start, time to first frame is measured from here.
+	std::chrono::steady_clock::time_point startTime;
+
+	ApplicationSettings settings;
+	//Host memory of the driver, every create and destroy call of this class and the scenes passes Get of the object type.
+	HostAllocator hostAllocator;
 	VkInstance instance;
 	GLFWwindow* window;
+	bool framebufferResized;
 	bool debugMode;
 	VkDebugUtilsMessengerEXT debugMessenger;
 	VkPhysicalDevice physicalDevice;
 	VkDevice device;
+	//Required extensions plus the optional ones the device supports.
+	std::set<std::string> enabledDeviceExtensions;
+	uint32_t graphicsFamilyIndex;
 	VkQueue gQueue;
 	VkSurfaceKHR surface;
 	VkQueue pQueue;
+	//Dedicated transfer family when the device has one, graphics family otherwise.
+	uint32_t transferFamilyIndex;
+	VkQueue tQueue;
+	//Queue for compute work that overlaps with rendering. Falls back to the graphics queue when the device has no other
+	//compute queue or async compute is disabled, asyncComputeQueue tells the two apart.
+	uint32_t computeFamilyIndex;
+	VkQueue cQueue;
+	bool asyncComputeQueue;
+	MemoryAllocator memoryAllocator;
 	VkSwapchainKHR swapchain;
 	std::vector<VkImage> swapchainImages;
 	VkFormat swapchainImageFormat;
 	VkExtent2D swapchainExtent;
 	std::vector<VkImageView> swapchainImageViews;
-	VkRenderPass renderPass;
+	//Headless only: backing memory of the offscreen images stored in swapchainImages.
+	std::vector<Allocation> offscreenImageAllocations;
+	ShaderManager shaderManager;
+	PipelineCache pipelineCache;
+	LayoutCache layoutCache;
+	//Single descriptor set shared by every bindless pipeline, see BindlessTable.
+	BindlessTable bindlessTable;
+	PipelineBuilder pipelineBuilder;
+	//Attachments of the pass scenes draw their geometry in, pipelines of that pass are built against them.
+	AttachmentFormats mainPassFormats;
 	VkPipelineLayout pipelineLayout;
 	VkPipeline graphicsPipeline;
-	std::vector<VkFramebuffer> swapchainFramebuffers;
 	VkCommandPool commandPool;
+	UploadManager uploadManager;
+	DeletionQueue deletionQueue;
+	//Only open when an archive was given, scenes then load their assets from it instead of loose files.
+	AssetArchive assetArchive;
 private:
 	void Initialise();
 	void Destroy();
 
+	//Every shader source in the shader directory, loaded ahead of pipeline creation.
+	static std::vector<std::string> GetShaderFiles();
+	void PreloadShader(const std::string& filename);
+	void CreateHostAllocator();
+	void DestroyHostAllocator();
 	void CreateWindow();
 	void DestroyWindow();
+	static void FramebufferResizeCallback(GLFWwindow* window, int width, int height);
 	void CreateInstance();
 	void DestroyInstance();
 	std::vector<const char*> GetInstanceLayers();
@@ -56,29 +116,46 @@ private:
 	void DestroySurface();
 	void SelectPhysicalDevice();
 	bool QueryDeviceExtensions(VkPhysicalDevice device, std::string deviceName);
+	bool QueryDeviceFeatures(VkPhysicalDevice device, std::string deviceName);
 	std::vector<VkPhysicalDevice> GetPhysicalDevices();
 	std::vector<VkExtensionProperties> GetSupportedDeviceExtensions(VkPhysicalDevice device);
 	std::vector<const char*> GetRequestedDeviceExtensions();
+	std::vector<const char*> GetOptionalDeviceExtensions();
 	bool QuerySwapchainProperties(VkPhysicalDevice device);
 	void CreateDevice();
 	void DestroyDevice();
 	uint32_t GetQueueFamilyIndex(VkPhysicalDevice device, VkQueueFlagBits bit);
+	uint32_t GetTransferQueueFamilyIndex(VkPhysicalDevice device);
+	//Index of a compute queue no other queue of the application uses, false if there is none.
+	bool GetComputeQueue(VkPhysicalDevice device, const std::set<uint32_t>& usedFamilies, uint32_t& familyIndex, uint32_t& queueIndex);
 	std::vector<VkQueueFamilyProperties> GetQueueFamilies(VkPhysicalDevice device);
+	void CreateMemoryAllocator();
+	void DestroyMemoryAllocator();
 	void CreateSwapchain();
 	void DestroySwapchain();
+	void CreateOffscreenTargets();
+	void DestroyOffscreenTargets();
 	VkSurfaceFormatKHR ChooseSwapchainSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& formats);
 	VkPresentModeKHR ChooseSwapchainPresentationMode(const std::vector<VkPresentModeKHR>& presentModes);
 	VkExtent2D ChooseSwapchainExtend(const VkSurfaceCapabilitiesKHR& capabilities);
 	void CreateImageViews();
 	void DestroyImageViews();
-	void CreateRenderPass();
-	void DestroyRenderPass();
+	void CreateShaderManager();
+	void CreatePipelineCache();
+	void DestroyPipelineCache();
+	void CreateLayoutCache();
+	void DestroyLayoutCache();
+	void CreateBindlessTable();
+	void DestroyBindlessTable();
+	void CreatePipelineBuilder();
+	void DestroyPipelineBuilder();
+	void SelectAttachmentFormats();
 	void CreateGraphicsPipeline();
-	void DestroyGraphicsPipeline();
-	static std::vector<char> ReadFile(std::string filename);
-	VkShaderModule CreateShaderModule(const std::vector<char>& code);
-	void CreateFramebuffers();
-	void DestroyFramebuffers();
 	void CreateCommandPool();
 	void DestroyCommandPool();
+	void CreateUploadManager();
+	void DestroyUploadManager();
+	void CreateAssetArchive();
+	void DestroyAssetArchive();
+	void DestroyDeletionQueue();
 };
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+struct ApplicationSettings
+{
+	//Scene to run: "triangle", "instanced", "gpu-driven", "mesh", "particles" or "pipeline-benchmark".
+	std::string scene = "triangle";
+	//Render into offscreen images without GLFW, surface or swapchain.
+	bool headless = false;
+	uint32_t width = 800u;
+	uint32_t height = 600u;
+	//Number of frames rendered before a headless run exits.
+	uint32_t frameCount = 1000u;
+	//Windowed only: "immediate", "mailbox", "fifo" or "fifo-relaxed". Falls back to fifo when unsupported.
+	std::string presentMode = "mailbox";
+	//Windowed only: requested swapchain images, zero means two above the surface minimum.
+	uint32_t swapchainImageCount = 0u;
+	//Frames per second the frame limiter sleeps down to, zero disables it.
+	double frameRateLimit = 0.0;
+	//Windowed only: block until the previous frame is on screen before sampling input. Needs VK_KHR_present_wait.
+	bool waitForPresent = false;
+	//MSAA samples of the main pass, lowered to the highest count the device supports for color and depth.
+	uint32_t sampleCount = 1u;
+	//Frames the CPU may record ahead of the GPU, 1 to 4. More hides GPU stalls at the cost of latency.
+	uint32_t framesInFlight = 2u;
+	//Run compute work on a queue of its own when the device has one, so it can overlap with rendering.
+	bool asyncCompute = true;
+	//Headless only: last rendered image is written here as binary PPM when not empty.
+	std::string outputPath = "";
+	//Pipeline cache blob, loaded on startup and written back on shutdown.
+	std::string pipelineCachePath = "cache/pipeline.bin";
+	//Compiled SPIR-V keyed by a hash of shader sources, includes, defines, compiler options and the output of a probe
+	//shader, which changes with the glslang generator version.
+	std::string shaderCachePath = "cache/shaders";
+	//Chrome trace of GPU and CPU scopes is written here on exit when not empty.
+	std::string profileOutputPath = "";
+	//Worker threads compiling pipelines, zero means one per hardware thread.
+	uint32_t pipelineThreads = 0u;
+	//Draw calls per frame, recorded in parallel when there are many.
+	uint32_t drawCount = 1u;
+	//Worker threads recording secondary command buffers, zero means one per hardware thread.
+	uint32_t recordThreads = 0u;
+	//Instances drawn by the instanced scene, the upper end of its headless sweep.
+	uint32_t instanceCount = 1u << 20;
+	//Objects culled and drawn by the GPU driven scene.
+	uint32_t objectCount = 1u << 18;
+	//Capacity of the particle pool of the particles scene, emission keeps it about full.
+	uint32_t particleCount = 1u << 20;
+	//Binary PPM textures streamed in by the GPU driven scene, objects cycle through them.
+	std::vector<std::string> texturePaths;
+	//Device memory texture levels may occupy, in MiB.
+	uint32_t textureBudget = 256u;
+	//Mesh written by MeshImport, drawn by the mesh scene. A name inside the archive when one is given.
+	std::string meshPath = "";
+	//Archive written by AssetPack that assets are loaded from, loose files are used when empty.
+	std::string archivePath = "";
+	//Number of pipelines compiled by the pipeline benchmark scene.
+	uint32_t pipelineVariants = 256u;
+
+	static ApplicationSettings FromCommandLine(int argc, char** argv);
+	//Device features only some scenes need, devices without them can still run the other scenes.
+	bool SceneUsesIndirectCount() const;
+	//Scenes that draw through the BindlessTable, which needs descriptor indexing.
+	bool SceneUsesBindless() const;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+
+#include "AssetArchiveFormat.h"
+#include "ThreadPool.h"
+
+//Read only view of an archive written by AssetPack. The whole file is memory mapped, so uncompressed entries are used
+//in place through GetData without a copy and pages are only read from disk when they are touched. Compressed entries
+//are decoded chunk by chunk on a worker pool directly into the caller's memory, typically the staging ring of the
+//upload manager.
+class AssetArchive
+{
+public:
+	AssetArchive();
+	~AssetArchive();
+
+	//Zero threads means one per hardware thread.
+	void Create(const std::string& filename, uint32_t threadCount = 0u);
+	void Destroy();
+	bool IsOpen() const;
+
+	//Null when the archive has no entry with that name.
+	const ArchiveEntry* Find(const std::string& name) const;
+	std::string GetName(const ArchiveEntry& entry) const;
+	//Uncompressed entries only: the entry inside the mapping, valid until Destroy. Null for compressed entries.
+	const void* GetData(const ArchiveEntry& entry) const;
+	//Writes size bytes of the entry starting at offset to destination. Chunks are decoded in parallel when the range
+	//spans several, the call returns once all of them are written.
+	void Read(const ArchiveEntry& entry, uint64_t offset, uint64_t size, void* destination);
+private:
+	void Map(const std::string& filename);
+	void Unmap();
+	void Validate();
+	void ReadChunk(const ArchiveChunk& chunk, uint64_t chunkBegin, uint64_t begin, uint64_t end, char* destination);
+
+	std::string filename;
+	const char* data;
+	uint64_t size;
+#ifdef _WIN32
+	void* file;
+	void* mapping;
+#else
+	int file;
+#endif
+	const ArchiveHeader* header;
+	const ArchiveEntry* entries;
+	const ArchiveChunk* chunks;
+	const char* names;
+	std::unique_ptr<ThreadPool> threadPool;
+
+	std::atomic<uint64_t> readBytes;
+	std::atomic<uint64_t> decompressedBytes;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+
+//Packed asset archive written by AssetPack and read by AssetArchive. The file starts with an ArchiveHeader, followed by
+//payloads, the chunk table, the entry table and the name blob at the offsets the header records. Entries are sorted by
+//name hash so lookups are a binary search. Every entry is split into chunks of chunkSize bytes, the last one shorter,
+//and each chunk is compressed on its own so chunks decompress independently.
+struct ArchiveHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t chunkCount;
+	uint64_t entryOffset;
+	uint64_t chunkOffset;
+	uint64_t nameOffset;
+	uint64_t nameSize;
+};
+
+enum class ArchiveCompression : uint32_t
+{
+	None = 0u,
+	Lz4 = 1u
+};
+
+struct ArchiveEntry
+{
+	//HashString of the name, names compare equal only when the stored name matches as well.
+	uint64_t nameHash;
+	//Name in the name blob, relative path with forward slashes and no terminator.
+	uint64_t nameOffset;
+	uint32_t nameLength;
+	ArchiveCompression compression;
+	uint64_t size;
+	uint32_t firstChunk;
+	uint32_t chunkCount;
+	uint32_t chunkSize;
+	uint32_t reserved;
+};
+
+struct ArchiveChunk
+{
+	//Absolute file offset, aligned to archivePayloadAlignment.
+	uint64_t offset;
+	//Equal to size when the chunk is stored raw because it did not compress.
+	uint32_t storedSize;
+	uint32_t size;
+};
+
+inline constexpr char archiveMagic[4] = { 'V', 'K', 'P', 'K' };
+inline constexpr uint32_t archiveVersion = 1u;
+//Cache line alignment keeps uncompressed payloads usable in place for any element type.
+inline constexpr uint64_t archivePayloadAlignment = 64u;
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "FrameScheduler.h"
+#include "HostAllocator.h"
+
+struct ComputeTiming
+{
+	uint64_t submission = 0u;
+	double gpuBusyMs = 0.0;
+	//Part of the busy time during which a graphics frame was running as well.
+	double overlapMs = 0.0;
+};
+
+//Compute work that runs on its own queue beside rendering. Every frame slot has a command buffer that is recorded
+//between Begin and Submit, the submission signals a timeline semaphore. Buffers the graphics queue consumes are
+//released with Release, the graphics side acquires them with RecordAcquireBarriers and waits for the returned semaphore
+//value in the same submission, like it does for uploads. Graphics never hands the buffers back: compute rewrites them
+//every time and only starts once BeginFrame has freed the slot, so their old contents are not needed.
+//Without a separate compute queue the work goes to the graphics queue and no ownership changes.
+class AsyncCompute
+{
+public:
+	AsyncCompute();
+	~AsyncCompute();
+
+	void Create(VkPhysicalDevice physicalDevice, VkDevice device, HostAllocator* hostAllocator, VkQueue queue, uint32_t computeFamilyIndex, uint32_t graphicsFamilyIndex, uint32_t framesInFlight);
+	void Destroy();
+
+	//Blocks until the previous submission of frameSlot has finished and returns its command buffer in the recording state.
+	VkCommandBuffer Begin(uint32_t frameSlot);
+	//Hands buffer to the graphics queue once the work recorded before has written it. dstStages and dstAccess are the
+	//graphics side's first use.
+	void Release(VkBuffer buffer, VkPipelineStageFlags2 srcStages, VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStages, VkAccessFlags2 dstAccess);
+	//Ends recording and submits after waits. Returns the timeline value signalled once the work is done.
+	uint64_t Submit(const std::vector<VkSemaphoreSubmitInfo>& waits = {});
+
+	//Graphics queue only: records the acquire of every released buffer not acquired yet. The submission of
+	//commandBuffer must wait for the returned semaphore, a value of zero means there is nothing to wait for.
+	VkSemaphoreSubmitInfo RecordAcquireBarriers(VkCommandBuffer commandBuffer);
+	//Graphics frames to measure the overlap against, pass FrameScheduler::GetLastTiming once per frame.
+	void AddGraphicsTiming(const FrameTiming& timing);
+
+	VkSemaphore GetSemaphore() const;
+	//Timing of the most recent submission the GPU has finished.
+	const ComputeTiming& GetLastTiming() const;
+private:
+	//Collects the timing of the finished submission that last used slot.
+	void RetireSubmission(uint32_t slot);
+
+	VkDevice device;
+	HostAllocator* hostAllocator;
+	VkQueue queue;
+	uint32_t computeFamilyIndex;
+	uint32_t graphicsFamilyIndex;
+	uint32_t framesInFlight;
+
+	VkCommandPool commandPool;
+	std::vector<VkCommandBuffer> commandBuffers;
+	VkSemaphore semaphore;
+	uint64_t nextValue;
+	uint32_t frameSlot;
+	//Timeline value of the last submission per slot, zero while the slot is unused.
+	std::vector<uint64_t> slotValues;
+
+	std::vector<VkBufferMemoryBarrier2> releases;
+	std::vector<VkBufferMemoryBarrier2> pendingAcquires;
+	VkPipelineStageFlags2 pendingStages;
+	uint64_t pendingValue;
+
+	VkQueryPool queryPool;
+	double timestampPeriod;
+	uint64_t timestampMask;
+	std::vector<bool> slotTimed;
+	//Recent graphics frames as pairs of begin and end timestamps. Overlap assumes both queues count on the same clock.
+	std::deque<std::pair<uint64_t, uint64_t>> graphicsIntervals;
+
+	ComputeTiming lastTiming;
+	uint64_t submissions;
+	uint64_t timedSubmissions;
+	double totalBusy;
+	double totalOverlap;
+};
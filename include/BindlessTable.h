@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "LayoutCache.h"
+#include "HostAllocator.h"
+
+//One large update after bind descriptor set holding every sampled image, sampler and storage buffer of the renderer.
+//Resources are referred to by index, shaders receive the indices through push constants and select the descriptor
+//themselves, so switching materials never rebinds a set. Every bindless pipeline shares GetPipelineLayout().
+//Handles are allocated and freed without locks. A freed handle may be returned again right away, so resources still
+//used by frames in flight must be freed through the deletion queue.
+class BindlessTable
+{
+public:
+	//Push constant bytes available to bindless pipelines, visible to every stage.
+	static const uint32_t pushConstantSize = 128u;
+	static const uint32_t invalidHandle = UINT32_MAX;
+
+	BindlessTable();
+	~BindlessTable();
+
+	//Capacities are clamped to the update after bind limits of the device.
+	void Create(VkPhysicalDevice physicalDevice, VkDevice device, HostAllocator* hostAllocator, LayoutCache* layoutCache, uint32_t maxImages, uint32_t maxSamplers, uint32_t maxStorageBuffers);
+	void Destroy();
+
+	uint32_t AddImage(VkImageView imageView, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	uint32_t AddSampler(VkSampler sampler);
+	uint32_t AddStorageBuffer(VkBuffer buffer, VkDeviceSize offset = 0u, VkDeviceSize range = VK_WHOLE_SIZE);
+	//Points an existing handle at another view. Draws recorded earlier but not yet submitted see the new view, the
+	//handle must not be used by a submission that is still pending.
+	void UpdateImage(uint32_t handle, VkImageView imageView, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	void FreeImage(uint32_t handle);
+	void FreeSampler(uint32_t handle);
+	void FreeStorageBuffer(uint32_t handle);
+
+	void Bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint) const;
+	VkDescriptorSetLayout GetDescriptorSetLayout() const;
+	VkPipelineLayout GetPipelineLayout() const;
+private:
+	//Lock free free list of indices below capacity. The head carries a version tag in its upper half so a pop racing
+	//with a pop and push of the same index fails its compare exchange instead of corrupting the list.
+	class HandlePool
+	{
+	public:
+		HandlePool();
+
+		void Create(uint32_t capacity);
+		//Returns invalidHandle when every index is in use.
+		uint32_t Allocate();
+		void Free(uint32_t handle);
+		uint32_t GetCapacity() const;
+	private:
+		uint32_t capacity;
+		std::unique_ptr<std::atomic<uint32_t>[]> next;
+		std::atomic<uint64_t> head;
+		//Indices at or above this were never handed out.
+		std::atomic<uint32_t> fresh;
+	};
+
+	void Write(uint32_t binding, uint32_t handle, VkDescriptorType type, const VkDescriptorImageInfo* imageInfo, const VkDescriptorBufferInfo* bufferInfo);
+
+	VkDevice device;
+	HostAllocator* hostAllocator;
+	VkDescriptorSetLayout setLayout;
+	VkPipelineLayout pipelineLayout;
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSet descriptorSet;
+
+	HandlePool images;
+	HandlePool samplers;
+	HandlePool storageBuffers;
+
+	//vkUpdateDescriptorSets needs the set externally synchronised even for update after bind bindings.
+	std::mutex writeMutex;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <memory>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "ThreadPool.h"
+#include "HostAllocator.h"
+
+//Records the draws of a render pass on worker threads. Every worker owns one command pool per frame slot and records its
+//share of the draw list into secondary command buffers, which the caller executes in order from the primary buffer.
+//Pools are reset as a whole with vkResetCommandPool when their frame slot comes around again, buffers are never reset one
+//by one.
+class CommandRecorder
+{
+public:
+	//Records items [begin, end) into commandBuffer, which is already begun inside the inherited render pass.
+	using RecordFunction = std::function<void(VkCommandBuffer commandBuffer, uint32_t begin, uint32_t end)>;
+
+	CommandRecorder();
+	~CommandRecorder();
+
+	//Zero threads means one per hardware thread.
+	void Create(VkDevice device, HostAllocator* hostAllocator, uint32_t queueFamilyIndex, uint32_t framesInFlight, uint32_t threadCount);
+	void Destroy();
+
+	//Resets every pool of frameSlot and returns its primary command buffer. The GPU must be done with the slot.
+	VkCommandBuffer BeginFrame(uint32_t frameSlot);
+	//Splits itemCount items into contiguous ranges of at least minItemsPerTask and records them in parallel. Returned
+	//secondary command buffers are in item order. Blocks until recording is done.
+	std::vector<VkCommandBuffer> Record(const VkCommandBufferInheritanceInfo& inheritance, uint32_t itemCount, const RecordFunction& record, uint32_t minItemsPerTask = 256u);
+
+	uint32_t GetThreadCount() const;
+private:
+	struct ThreadPools
+	{
+		VkCommandPool commandPool = VK_NULL_HANDLE;
+		std::vector<VkCommandBuffer> commandBuffers;
+		//Buffers before this index are in use this frame.
+		size_t used = 0u;
+	};
+
+	struct FramePools
+	{
+		VkCommandPool primaryPool = VK_NULL_HANDLE;
+		VkCommandBuffer primary = VK_NULL_HANDLE;
+		//One per worker task index.
+		std::vector<ThreadPools> threads;
+	};
+
+	VkCommandPool CreatePool();
+	VkCommandBuffer GetSecondary(ThreadPools& pools);
+	void RecordRange(ThreadPools& pools, const VkCommandBufferInheritanceInfo& inheritance, uint32_t begin, uint32_t end, const RecordFunction& record, VkCommandBuffer& commandBuffer);
+
+	VkDevice device;
+	HostAllocator* hostAllocator;
+	uint32_t queueFamilyIndex;
+	uint32_t frameSlot;
+	std::unique_ptr<ThreadPool> threadPool;
+	std::vector<FramePools> frames;
+};
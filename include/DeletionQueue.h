@@ -0,0 +1,32 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <cstdint>
+
+//Defers destruction of GPU objects until the frame that last used them has finished. Entries are keyed by the timeline
+//value of that frame and run once the completed value reaches it, so retiring objects never needs a device idle.
+class DeletionQueue
+{
+public:
+	DeletionQueue();
+	~DeletionQueue();
+
+	//Runs every pending deleter, the GPU must be idle.
+	void Destroy();
+
+	void Push(uint64_t value, std::function<void()> deleter);
+	//Runs the deleters of every value up to completedValue in push order.
+	void Flush(uint64_t completedValue);
+	size_t GetPendingCount();
+private:
+	struct Entry
+	{
+		uint64_t value;
+		std::function<void()> deleter;
+	};
+
+	std::mutex mutex;
+	std::deque<Entry> entries;
+};
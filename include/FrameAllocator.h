@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "MemoryAllocator.h"
+
+//Range of the frame buffer handed out for the current frame. Bind it with dynamicOffset against a descriptor of
+//GetDescriptorInfo, the descriptor itself never changes.
+struct FrameAllocation
+{
+	//Write only, the memory is write combined.
+	void* mapped = nullptr;
+	uint32_t dynamicOffset = 0u;
+	VkDeviceSize size = 0u;
+};
+
+//Linear allocator for data that only lives for one frame: constants, per frame uniforms and storage written by the CPU.
+//One persistently mapped buffer is split into a range per frame in flight. Allocations bump an offset within the range
+//of the current frame, which is reset wholesale once the GPU has finished the frame that used the slot before. Nothing
+//is allocated from Vulkan and no descriptor is written per frame: sets reference the buffer once through a dynamic
+//descriptor and each draw passes the offset of its allocation.
+class FrameAllocator
+{
+public:
+	FrameAllocator();
+	~FrameAllocator();
+
+	void Create(VkPhysicalDevice physicalDevice, MemoryAllocator* memoryAllocator, uint32_t framesInFlight, VkDeviceSize bytesPerFrame = 1ull << 20);
+	void Destroy();
+
+	//Grows the range of every frame to at least bytesPerFrame. Replaces the buffer, so only call it while no frame is in
+	//flight and before descriptors of GetBuffer are written.
+	void Reserve(VkDeviceSize bytesPerFrame);
+	//Frame slot must be free on the GPU, call it after FrameScheduler::BeginFrame.
+	void BeginFrame(uint32_t frameSlot);
+
+	//Thread safe. Uniform allocations are aligned to minUniformBufferOffsetAlignment and bounded by maxUniformBufferRange,
+	//storage allocations are aligned to minStorageBufferOffsetAlignment.
+	FrameAllocation AllocateUniform(VkDeviceSize size);
+	FrameAllocation AllocateStorage(VkDeviceSize size);
+
+	VkBuffer GetBuffer() const;
+	//Descriptor for allocations of up to range bytes. Dynamic offset plus range must stay inside the buffer, so range
+	//must not be larger than the allocations bound through it.
+	VkDescriptorBufferInfo GetDescriptorInfo(VkDeviceSize range) const;
+	//Reflection can not tell dynamic buffers apart. Turns the uniform and storage buffer bindings of a set that is bound
+	//with frame allocations into their dynamic variants.
+	static void MakeDynamic(std::vector<VkDescriptorSetLayoutBinding>& bindings);
+	void PrintStatistics();
+private:
+	FrameAllocation Allocate(VkDeviceSize size, VkDeviceSize alignment);
+	void CreateBuffer();
+	void DestroyBuffer();
+
+	MemoryAllocator* memoryAllocator;
+	uint32_t framesInFlight;
+	VkDeviceSize uniformAlignment;
+	VkDeviceSize storageAlignment;
+	VkDeviceSize maxUniformRange;
+
+	VkBuffer buffer;
+	Allocation allocation;
+	//Size of the range of one frame, a multiple of both alignments.
+	VkDeviceSize frameSize;
+	uint32_t frameSlot;
+	//Bytes used in the range of the current frame.
+	std::atomic<VkDeviceSize> head;
+
+	VkDeviceSize peakBytes;
+	uint64_t frameCount;
+	std::atomic<uint64_t> allocationCount;
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <deque>
+#include <chrono>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "Profiler.h"
+
+//Frame rate limiting and present latency measurement. The limiter sleeps until the next frame is due instead of spinning.
+//With VK_KHR_present_id and VK_KHR_present_wait every present carries an id, and the time it reaches the screen gives
+//the acquire to present and input to present latency of the frame. Latencies are reported as profiler scopes.
+//Completion is polled without blocking once per frame, unless waitForPresent blocks on the previous frame before
+//input is sampled, which both lowers latency and makes the measurement exact.
+class FramePacer
+{
+public:
+	FramePacer();
+	~FramePacer();
+
+	void Create(VkDevice device, bool presentWaitSupported, bool waitForPresent, double frameRateLimit, Profiler* profiler);
+	void Destroy();
+
+	//Call before sampling input.
+	void WaitForNextFrame(VkSwapchainKHR swapchain);
+	void MarkInput();
+	void MarkAcquire();
+	//Returns the VkPresentIdKHR to chain into VkPresentInfoKHR, nullptr without present wait. Valid until the next call.
+	const void* GetPresentNext();
+	//Polls the presents still in flight.
+	void Update(VkSwapchainKHR swapchain);
+	//Ids of a retired swapchain are never waited for again.
+	void ResetSwapchain();
+private:
+	struct PendingPresent
+	{
+		uint64_t presentId;
+		int64_t inputTime;
+		int64_t acquireTime;
+	};
+
+	void CompletePresent(const PendingPresent& present, int64_t presentTime);
+
+	VkDevice device;
+	PFN_vkWaitForPresentKHR waitForPresentKHR;
+	bool waitForPresent;
+	Profiler* profiler;
+
+	std::chrono::steady_clock::duration framePeriod;
+	std::chrono::steady_clock::time_point nextFrame;
+
+	uint64_t nextPresentId;
+	uint64_t presentIdValue;
+	VkPresentIdKHR presentId;
+	int64_t inputTime;
+	int64_t acquireTime;
+	std::deque<PendingPresent> pending;
+};
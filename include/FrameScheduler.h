@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "HostAllocator.h"
+
+struct FrameTiming
+{
+	uint64_t frame = 0u;
+	//Time BeginFrame blocked until the GPU released the frame slot.
+	double cpuWaitMs = 0.0;
+	//Gap between the end of the previous frame and the start of this one on the GPU.
+	double gpuIdleMs = 0.0;
+	double gpuBusyMs = 0.0;
+	//Raw timestamps of the start and end of the frame, zero when the frame was not timed.
+	uint64_t gpuBegin = 0u;
+	uint64_t gpuEnd = 0u;
+};
+
+//Paces frames with one timeline semaphore instead of a fence and semaphore pair per frame. Frame n signals value n + 1,
+//so waiting for a frame slot is waiting for the value of the frame that used the slot last. Submissions go through
+//vkQueueSubmit2. Timestamps written at the start and end of every frame give the GPU idle time between frames.
+class FrameScheduler
+{
+public:
+	FrameScheduler();
+	~FrameScheduler();
+
+	void Create(VkPhysicalDevice physicalDevice, VkDevice device, HostAllocator* hostAllocator, uint32_t queueFamilyIndex, uint32_t framesInFlight);
+	void Destroy();
+
+	//Blocks until the slot of the next frame is free and returns the slot index.
+	uint32_t BeginFrame();
+	//Bracket the work of the frame in its first and last command buffer.
+	void RecordFrameStart(VkCommandBuffer commandBuffer);
+	void RecordFrameEnd(VkCommandBuffer commandBuffer);
+	//Submits the frame and signals its timeline value on top of signals.
+	void Submit(VkQueue queue, const std::vector<VkCommandBuffer>& commandBuffers, const std::vector<VkSemaphoreSubmitInfo>& waits, const std::vector<VkSemaphoreSubmitInfo>& signals);
+	void WaitIdle();
+
+	uint32_t GetFramesInFlight() const;
+	uint32_t GetFrameSlot() const;
+	uint64_t GetFrameNumber() const;
+	//Timeline value the current frame signals on GetSemaphore.
+	uint64_t GetFrameValue() const;
+	//Value of the newest frame the GPU has finished.
+	uint64_t GetCompletedValue() const;
+	VkSemaphore GetSemaphore() const;
+	//Timing of the most recent frame the GPU has finished.
+	const FrameTiming& GetLastTiming() const;
+private:
+	//Collects the timing of the finished frame that last used slot.
+	void RetireFrame(uint32_t slot);
+
+	VkDevice device;
+	HostAllocator* hostAllocator;
+	VkSemaphore semaphore;
+	uint32_t framesInFlight;
+	uint64_t frameNumber;
+	uint32_t frameSlot;
+
+	VkQueryPool queryPool;
+	double timestampPeriod;
+	uint64_t timestampMask;
+	uint64_t lastEndTimestamp;
+	//Frame number, CPU wait and whether timestamps were written, per slot. Frame is UINT64_MAX while the slot is unused.
+	std::vector<uint64_t> slotFrames;
+	std::vector<double> slotCpuWaits;
+	std::vector<bool> slotTimed;
+
+	FrameTiming lastTiming;
+	double totalCpuWait;
+	double totalGpuIdle;
+	double totalGpuBusy;
+	uint64_t retiredFrames;
+	uint64_t timedFrames;
+};
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <vector>
+
+#include "TriangleApplication.h"
+#include "TextureStreamer.h"
+
+//GPU driven scene. A compute pass culls every object's bounding sphere against the view frustum and appends one
+//VkDrawIndexedIndirectCommand per visible object plus a draw count, the main pass consumes them with a single
+//vkCmdDrawIndexedIndirectCount. The CPU only writes the camera each frame, its cost does not depend on object count.
+//Culling runs on the async compute queue into draw buffers of its frame slot, so it overlaps with the previous frame's
+//rendering. Both passes reach their buffers through the bindless table. Optional textures are streamed in by screen size.
+class GpuDrivenApplication : public TriangleApplication
+{
+public:
+	GpuDrivenApplication(const ApplicationSettings& settings);
+	~GpuDrivenApplication();
+protected:
+	void UpdateFrame(uint32_t frameSlot);
+	void AddPasses(uint32_t backbuffer);
+	uint32_t GetDrawCount();
+	void RecordDraws(VkCommandBuffer commandBuffer, uint32_t frameSlot, uint32_t begin, uint32_t end);
+private:
+	//Matches struct Object in gpu_driven.vert and cull.comp.
+	struct ObjectData
+	{
+		//World space bounding sphere: xyz center, w radius.
+		float bounds[4];
+		//xy position, z rotation in radians, w scale.
+		float transform[4];
+		float color[4];
+		uint32_t mesh[4];
+	};
+
+	//Matches struct Mesh in cull.comp.
+	struct MeshData
+	{
+		uint32_t indexCount;
+		uint32_t firstIndex;
+		int32_t vertexOffset;
+		uint32_t padding;
+	};
+
+	//Matches the push constants of cull.comp, buffers are bindless handles.
+	struct CullingConstants
+	{
+		float planes[6][4];
+		uint32_t objectCount;
+		uint32_t objectBuffer;
+		uint32_t meshBuffer;
+		uint32_t drawBuffer;
+		uint32_t drawCountBuffer;
+	};
+
+	//Matches the push constants of gpu_driven.vert and gpu_driven.frag.
+	struct DrawConstants
+	{
+		float viewProjection[16];
+		uint32_t objectBuffer;
+		uint32_t sampler;
+		uint32_t textureCount;
+		//Bindless image handles indexed by the object's texture slot, refreshed every frame as versions change.
+		uint32_t textures[8];
+	};
+
+	void Initialise();
+	void Destroy();
+
+	static void ExtractFrustumPlanes(const float viewProjection[16], float planes[6][4]);
+
+	void CreateGeometry();
+	void DestroyGeometry();
+	void CreateObjects();
+	void DestroyObjects();
+	void CreateDrawBuffers();
+	void DestroyDrawBuffers();
+	void CreateBindlessHandles();
+	void DestroyBindlessHandles();
+	void CreateTextures();
+	void DestroyTextures();
+	void CreatePipelines();
+	void RecordCulling(VkCommandBuffer commandBuffer, uint32_t frameSlot);
+	//Sharing mode for buffers the transfer, compute and graphics queues all use.
+	void SetSharedAcrossQueues(VkBufferCreateInfo& info);
+
+	uint32_t objectCount;
+	float worldSize;
+	DrawConstants drawConstants;
+	CullingConstants cullingConstants;
+
+	VkBuffer vertexBuffer;
+	Allocation vertexAllocation;
+	VkBuffer indexBuffer;
+	Allocation indexAllocation;
+	VkBuffer meshBuffer;
+	Allocation meshAllocation;
+	uint32_t meshCount;
+	VkBuffer objectBuffer;
+	Allocation objectAllocation;
+	//Upload of the objects and meshes, the first culling submission waits for it.
+	uint64_t uploadToken;
+	std::vector<uint32_t> sharingFamilies;
+	//Per frame slot, culling of one frame writes while the graphics queue may still draw from another.
+	std::vector<VkBuffer> drawBuffers;
+	std::vector<Allocation> drawAllocations;
+	std::vector<VkBuffer> drawCountBuffers;
+	std::vector<Allocation> drawCountAllocations;
+	std::vector<uint32_t> drawHandles;
+	std::vector<uint32_t> drawCountHandles;
+
+	TextureStreamer textureStreamer;
+	std::vector<uint32_t> textures;
+	VkSampler sampler;
+
+	VkPipeline cullingPipeline;
+	VkPipeline drawPipeline;
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+//64 bit FNV-1a. Pass the previous result as seed to hash several ranges as one.
+constexpr uint64_t hashSeed = 14695981039346656037ull;
+
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed = hashSeed)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	uint64_t hash = seed;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+inline uint64_t HashString(const std::string& text, uint64_t seed = hashSeed)
+{
+	//Length is mixed in so that consecutive strings cannot shift into each other.
+	uint64_t length = text.size();
+	return HashBytes(text.data(), text.size(), HashBytes(&length, sizeof(length), seed));
+}
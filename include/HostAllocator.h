@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+//VkAllocationCallbacks that keep driver host allocations out of the global heap and make them visible. Command scope
+//allocations only live for the duration of one call and are bumped from an arena of the calling thread, which is
+//rewound once all of them are freed. Longer lived scopes are served from size class pools with one lock per class,
+//anything larger goes to the heap.
+//Every object type gets its own callbacks, so live and peak bytes are tracked per scope and per object type. The
+//callbacks passed to a destroy call must be the ones of the same object type as at creation.
+class HostAllocator
+{
+public:
+	HostAllocator();
+	~HostAllocator();
+
+	void Create();
+	//Prints the statistics. Memory is only released by the destructor, after the instance is gone.
+	void Destroy();
+
+	//Callbacks that account to objectType, valid until the allocator is destroyed.
+	const VkAllocationCallbacks* Get(VkObjectType objectType);
+	void PrintStatistics();
+private:
+	struct Counter
+	{
+		std::atomic<int64_t> liveBytes{ 0 };
+		std::atomic<int64_t> peakBytes{ 0 };
+		std::atomic<uint64_t> allocationCount{ 0u };
+
+		void Add(int64_t bytes);
+		void Remove(int64_t bytes);
+	};
+
+	struct TypeRecord
+	{
+		HostAllocator* owner;
+		VkObjectType objectType;
+		uint16_t index;
+		VkAllocationCallbacks callbacks;
+		Counter counter;
+		//Driver allocations reported through the internal allocation notifications.
+		Counter internalCounter;
+	};
+
+	struct SizeClass
+	{
+		std::mutex mutex;
+		size_t blockSize = 0u;
+		//Freed blocks, linked through their first bytes.
+		void* freeList = nullptr;
+		std::vector<void*> slabs;
+	};
+
+	static VKAPI_ATTR void* VKAPI_CALL Allocation(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope);
+	static VKAPI_ATTR void* VKAPI_CALL Reallocation(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+	static VKAPI_ATTR void VKAPI_CALL Free(void* userData, void* memory);
+	static VKAPI_ATTR void VKAPI_CALL InternalAllocation(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+	static VKAPI_ATTR void VKAPI_CALL InternalFree(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+
+	void* Allocate(TypeRecord& record, size_t size, size_t alignment, VkSystemAllocationScope scope);
+	void Release(void* memory);
+	void* AllocateFromArena(size_t size, size_t alignment);
+	void* AllocateFromPool(uint32_t sizeClass);
+	void ReleaseToPool(uint32_t sizeClass, void* block);
+
+	static const uint32_t scopeCount = 5u;
+	static const uint32_t sizeClassCount = 8u;
+
+	std::mutex recordMutex;
+	std::vector<std::unique_ptr<TypeRecord>> records;
+	SizeClass sizeClasses[sizeClassCount];
+	Counter scopeCounters[scopeCount];
+	Counter internalScopeCounters[scopeCount];
+
+	std::atomic<uint64_t> arenaAllocationCount;
+	//Command scope allocations that did not fit into the arena of their thread.
+	std::atomic<uint64_t> arenaOverflowCount;
+	std::atomic<uint64_t> largeAllocationCount;
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+
+#include "TriangleApplication.h"
+#include "ThreadPool.h"
+
+//Draws a large number of instances with one instanced draw per mesh. Per instance transforms and colors are rewritten
+//every frame by the worker threads into storage from the frame allocator, bound with a dynamic offset. The vertex
+//shader indexes it with gl_InstanceIndex. Headless runs sweep the instance count up to settings.instanceCount.
+class InstancedApplication : public TriangleApplication
+{
+public:
+	InstancedApplication(const ApplicationSettings& settings);
+	~InstancedApplication();
+
+	void Run();
+protected:
+	void UpdateFrame(uint32_t frameSlot);
+	uint32_t GetDrawCount();
+	void RecordDraws(VkCommandBuffer commandBuffer, uint32_t frameSlot, uint32_t begin, uint32_t end);
+private:
+	//Matches struct Instance in instanced.vert.
+	struct InstanceData
+	{
+		//xy position, z rotation in radians, w scale.
+		float transform[4];
+		float color[4];
+	};
+
+	//Animation parameters, only read by the CPU.
+	struct InstanceState
+	{
+		float x;
+		float y;
+		float phase;
+		float spin;
+		float scale;
+		float color[3];
+	};
+
+	struct Mesh
+	{
+		uint32_t firstVertex;
+		uint32_t vertexCount;
+	};
+
+	void Initialise();
+	void Destroy();
+
+	void SetInstanceCount(uint32_t count);
+	void UpdateInstances(InstanceData* instances, float time, uint32_t begin, uint32_t end);
+
+	void CreateMeshes();
+	void DestroyMeshes();
+	void ReserveInstanceMemory();
+	void CreateDescriptorSets();
+	void DestroyDescriptorSets();
+	//Reflected interface of the instanced shaders with the instance buffer made dynamic.
+	ReflectedLayout ReflectInstancedLayout();
+	void CreateInstancedPipeline();
+
+	uint32_t maxInstanceCount;
+	uint32_t instanceCount;
+	std::vector<InstanceState> instanceStates;
+	std::unique_ptr<ThreadPool> updatePool;
+
+	std::vector<Mesh> meshes;
+	VkBuffer vertexBuffer;
+	Allocation vertexAllocation;
+	//Offset of this frame's instances in the frame allocator.
+	uint32_t instanceOffset;
+
+	VkDescriptorSetLayout descriptorSetLayout;
+	VkDescriptorPool descriptorPool;
+	//Single set for every frame, frames differ only in their dynamic offset.
+	VkDescriptorSet descriptorSet;
+	VkPipelineLayout instancedPipelineLayout;
+	VkPipeline instancedPipeline;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+
+#include <vulkan/vulkan.h>
+
+#include "ShaderReflection.h"
+#include "HostAllocator.h"
+
+//Deduplicates descriptor set layouts and pipeline layouts. Identical layouts requested by different pipelines share
+//one handle, which keeps object count down and lets bound sets stay compatible across pipeline switches.
+//Every handle is owned by the cache and destroyed on Destroy.
+class LayoutCache
+{
+public:
+	LayoutCache();
+	~LayoutCache();
+
+	void Create(VkDevice device, HostAllocator* hostAllocator);
+	void Destroy();
+
+	VkDescriptorSetLayout GetDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+	//Sets missing between used set indices get an empty layout.
+	VkPipelineLayout GetPipelineLayout(const ReflectedLayout& layout);
+	VkPipelineLayout GetPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstants);
+private:
+	//Keys are the raw create parameters, so lookups compare exact contents and never alias on a hash collision.
+	struct KeyHash
+	{
+		size_t operator()(const std::string& key) const;
+	};
+
+	VkDevice device;
+	HostAllocator* hostAllocator;
+	std::mutex mutex;
+	std::unordered_map<std::string, VkDescriptorSetLayout, KeyHash> setLayouts;
+	std::unordered_map<std::string, VkPipelineLayout, KeyHash> pipelineLayouts;
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+//LZ4 block format: greedy single pass compression and bounds checked decompression. Blocks carry no sizes or
+//checksums, callers store both sizes next to the block.
+class Lz4
+{
+public:
+	//Worst case output size for size input bytes, incompressible data grows slightly.
+	static size_t GetMaxCompressedSize(size_t size);
+	//Returns the compressed size, or zero when the output would not fit in capacity.
+	static size_t Compress(const void* source, size_t size, void* destination, size_t capacity);
+	//Decodes exactly decompressedSize bytes. Malformed input throws instead of reading or writing out of bounds.
+	static void Decompress(const void* source, size_t size, void* destination, size_t decompressedSize);
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "TlsfAllocator.h"
+#include "HostAllocator.h"
+
+//Intended access pattern of an allocation, decides the memory type.
+enum class MemoryUsage
+{
+	//Only touched by the GPU: render targets, static geometry, textures.
+	GpuOnly,
+	//Written by the CPU and read by the GPU: staging and per frame data. Persistently mapped.
+	Upload,
+	//Written by the GPU and read by the CPU: readback. Persistently mapped, cached where possible.
+	Readback,
+	//Attachments that never leave tile memory. Falls back to GpuOnly without lazily allocated memory.
+	Transient
+};
+
+struct MemoryBlock;
+
+//Range of device memory owned by one resource. Memory and offset are what vkBind*Memory needs.
+struct Allocation
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0u;
+	VkDeviceSize size = 0u;
+	//Host address of offset for mapped usages, nullptr otherwise.
+	void* mapped = nullptr;
+	uint32_t memoryTypeIndex = 0u;
+	//Null for dedicated allocations.
+	MemoryBlock* block = nullptr;
+	TlsfAllocator::Region* region = nullptr;
+};
+
+struct MemoryStatistics
+{
+	//Bytes handed out to resources.
+	VkDeviceSize usedBytes = 0u;
+	//Bytes held in device memory objects, used or not.
+	VkDeviceSize reservedBytes = 0u;
+	uint32_t allocationCount = 0u;
+	uint32_t dedicatedAllocationCount = 0u;
+	uint32_t blockCount = 0u;
+	//Largest free range over all free bytes in blocks, zero means every free byte is usable by one request.
+	float fragmentation = 0.0f;
+};
+
+//Sub-allocates buffers and images from large device memory blocks so that resource count is not bounded by
+//maxMemoryAllocationCount. Every block is carved up by a TLSF allocator. Linear and optimally tiled resources are kept
+//in separate blocks whenever bufferImageGranularity is larger than one, so neighbouring resources never share a page.
+//Large resources, and resources the driver prefers so, get a dedicated allocation.
+class MemoryAllocator
+{
+public:
+	MemoryAllocator();
+	~MemoryAllocator();
+
+	void Create(VkPhysicalDevice physicalDevice, VkDevice device, HostAllocator* hostAllocator, VkDeviceSize preferredBlockSize = 64ull << 20);
+	void Destroy();
+
+	void CreateBuffer(const VkBufferCreateInfo& info, MemoryUsage usage, VkBuffer& buffer, Allocation& allocation);
+	void DestroyBuffer(VkBuffer buffer, Allocation& allocation);
+	void CreateImage(const VkImageCreateInfo& info, MemoryUsage usage, VkImage& image, Allocation& allocation);
+	void DestroyImage(VkImage image, Allocation& allocation);
+
+	//Raw interface for resources created elsewhere. Linear is true for buffers and linearly tiled images.
+	Allocation Allocate(const VkMemoryRequirements& requirements, MemoryUsage usage, bool linear, bool dedicated = false);
+	void Free(Allocation& allocation);
+
+	MemoryStatistics GetStatistics();
+	void PrintStatistics();
+private:
+	//Blocks of one memory type and tiling class.
+	struct Pool
+	{
+		uint32_t memoryTypeIndex;
+		bool linear;
+		std::vector<std::unique_ptr<MemoryBlock>> blocks;
+	};
+
+	std::vector<uint32_t> GetMemoryTypeCandidates(uint32_t typeBits, MemoryUsage usage);
+	bool AllocateFromPool(Pool& pool, const VkMemoryRequirements& requirements, Allocation& allocation);
+	bool AllocateDedicated(uint32_t memoryTypeIndex, const VkMemoryRequirements& requirements, const VkMemoryDedicatedAllocateInfo* dedicatedInfo, Allocation& allocation);
+	Allocation AllocateResource(const VkMemoryRequirements2& requirements, const VkMemoryDedicatedRequirements& dedicatedRequirements, VkMemoryDedicatedAllocateInfo& dedicatedInfo, MemoryUsage usage, bool linear);
+	VkDeviceMemory AllocateMemory(uint32_t memoryTypeIndex, VkDeviceSize size, const void* next, void*& mapped);
+	Pool& GetPool(uint32_t memoryTypeIndex, bool linear);
+	VkDeviceSize GetBlockSize(uint32_t memoryTypeIndex);
+
+	VkDevice device;
+	HostAllocator* hostAllocator;
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	VkDeviceSize bufferImageGranularity;
+	uint32_t maxAllocationCount;
+	VkDeviceSize preferredBlockSize;
+
+	std::mutex mutex;
+	std::vector<Pool> pools;
+	uint32_t deviceMemoryCount;
+	uint32_t dedicatedAllocationCount;
+	VkDeviceSize dedicatedBytes;
+};
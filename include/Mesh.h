@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+#include <vulkan/vulkan.h>
+
+#include "MemoryAllocator.h"
+#include "UploadManager.h"
+#include "MeshFormat.h"
+#include "AssetArchive.h"
+
+//Mesh written by MeshImport, loaded into device local vertex and index buffers through the upload ring. Vertices stay
+//quantised on the GPU; pipelines that draw it take their vertex input state from GetVertexBindings and
+//GetVertexAttributes and dequantise with the header's offsets and scales.
+class Mesh
+{
+public:
+	Mesh();
+	~Mesh();
+
+	//The first frame recorded afterwards acquires the uploads.
+	void Create(const std::string& filename, MemoryAllocator* memoryAllocator, UploadManager* uploadManager);
+	//Same file packed by AssetPack. Vertices and indices are decoded straight into the staging ring.
+	void Create(AssetArchive* archive, const std::string& name, MemoryAllocator* memoryAllocator, UploadManager* uploadManager);
+	void Destroy();
+
+	//Binds both buffers and draws every triangle instanceCount times.
+	void Draw(VkCommandBuffer commandBuffer, uint32_t instanceCount = 1u) const;
+	const MeshFileHeader& GetHeader() const;
+
+	//PackedVertex at binding 0: location 0 position, 1 octahedral normal, 2 uv.
+	static std::vector<VkVertexInputBindingDescription> GetVertexBindings();
+	static std::vector<VkVertexInputAttributeDescription> GetVertexAttributes();
+private:
+	//Checks the header against the size of the whole file and picks the index type.
+	void ValidateHeader(const std::string& name, uint64_t fileSize);
+	void CreateBuffers();
+	VkDeviceSize GetVertexSize() const;
+	VkDeviceSize GetIndexSize() const;
+
+	MemoryAllocator* memoryAllocator;
+	MeshFileHeader header;
+	VkIndexType indexType;
+
+	VkBuffer vertexBuffer;
+	Allocation vertexAllocation;
+	VkBuffer indexBuffer;
+	Allocation indexAllocation;
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "TriangleApplication.h"
+#include "Mesh.h"
+
+//Draws a mesh imported by MeshImport, spinning around its vertical axis. The pipeline's vertex input state comes from
+//the mesh format instead of reflection, since vertices stay quantised in the vertex buffer.
+class MeshApplication : public TriangleApplication
+{
+public:
+	MeshApplication(const ApplicationSettings& settings);
+	~MeshApplication();
+protected:
+	void UpdateFrame(uint32_t frameSlot);
+	void RecordDraws(VkCommandBuffer commandBuffer, uint32_t frameSlot, uint32_t begin, uint32_t end);
+private:
+	//Matches the push constants of mesh.vert.
+	struct MeshConstants
+	{
+		//Cosine and sine of the rotation around y, then x and y scale from the unit cube to clip space.
+		float transform[4];
+	};
+
+	void Initialise();
+	void Destroy();
+
+	void CreateMeshPipeline();
+
+	Mesh mesh;
+	MeshConstants constants;
+	VkPipelineLayout meshPipelineLayout;
+	VkPipeline meshPipeline;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+//Binary mesh written by MeshImport and read by Mesh. The file is a MeshFileHeader followed by vertexCount
+//PackedVertex and indexCount indices, 16 bit wide when every vertex is addressable with 16 bits and 32 bit otherwise.
+//Triangles are ordered for the post transform vertex cache and for overdraw, vertices in the order they are first used.
+struct MeshFileHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	//Object space position = positionOffset + position * positionScale, one scale for all axes keeps proportions.
+	float positionOffset[3];
+	float positionScale;
+	//Texture coordinate = uvOffset + uv * uvScale.
+	float uvOffset[2];
+	float uvScale[2];
+};
+
+//16 bytes instead of 32 for the float vertex.
+struct PackedVertex
+{
+	//R16G16B16A16_SNORM, w is zero.
+	int16_t position[4];
+	//R16G16_SNORM, unit normal in octahedral encoding.
+	int16_t normal[2];
+	//R16G16_UNORM.
+	uint16_t uv[2];
+};
+
+inline constexpr char meshFileMagic[4] = { 'V', 'K', 'M', 'S' };
+inline constexpr uint32_t meshFileVersion = 1u;
+
+inline bool UsesShortIndices(uint32_t vertexCount)
+{
+	return vertexCount <= 65536u;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+struct ImportedVertex
+{
+	float position[3];
+	float normal[3];
+	float uv[2];
+};
+
+//Indexed triangle list, counter clockwise front faces with y up and uv origin in the top left corner.
+struct ImportedMesh
+{
+	std::vector<ImportedVertex> vertices;
+	std::vector<uint32_t> indices;
+};
+
+//Reads source meshes into one indexed triangle list. Only positions, normals and the first set of texture coordinates
+//are kept; identical vertices are merged and missing normals are generated from the faces around each vertex.
+class MeshImporter
+{
+public:
+	//Picks the reader from the extension: .obj, .gltf or .glb.
+	static ImportedMesh Load(const std::string& filename);
+	//Wavefront OBJ, polygons are triangulated as fans. Materials are ignored.
+	static ImportedMesh LoadObj(const std::string& filename);
+	//glTF 2.0 with embedded, external or GLB buffers. Triangle primitives of every node in the default scene are
+	//merged with their node transforms applied.
+	static ImportedMesh LoadGltf(const std::string& filename);
+private:
+	static void GenerateNormals(ImportedMesh& mesh);
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "MeshImporter.h"
+#include "MeshFormat.h"
+
+//CPU side mesh optimisation run at import time. The passes are meant to run in declaration order: triangles for the
+//vertex cache, then for overdraw, then vertices for fetch locality, then quantisation.
+class MeshOptimizer
+{
+public:
+	//Reorders triangles so their vertices are still in the post transform cache when reused (Forsyth, linear speed).
+	static std::vector<uint32_t> OptimizeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount);
+	//Splits cache optimised triangles into clusters where the cache restarts anyway or where splitting costs less than
+	//threshold times the cluster's miss ratio, then draws clusters facing away from the center first so they occlude
+	//the rest (Sander, Nehab and Barczak).
+	static std::vector<uint32_t> OptimizeOverdraw(const std::vector<uint32_t>& indices, const std::vector<ImportedVertex>& vertices, float threshold);
+	//Renumbers vertices in the order the indices first use them and drops unused ones.
+	static void OptimizeVertexFetch(ImportedMesh& mesh);
+	//Positions relative to the bounding box center with one scale, octahedral normals and uvs over their bounds.
+	static void Quantize(const ImportedMesh& mesh, MeshFileHeader& header, std::vector<PackedVertex>& vertices);
+
+	//Vertices transformed per triangle with a FIFO cache of cacheSize entries, from 0.5 for large regular grids to 3.
+	static float GetAverageCacheMissRatio(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize);
+	//Bytes read through a small cache of 64 byte lines over the size of the vertex buffer, 1 is ideal.
+	static float GetOverfetchRatio(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t vertexSize);
+private:
+	static void EncodeOctahedral(const float normal[3], int16_t encoded[2]);
+};
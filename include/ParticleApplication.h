@@ -0,0 +1,112 @@
+#pragma once
+
+#include <vector>
+
+#include "TriangleApplication.h"
+
+//GPU particle system. Particles live in a fixed pool with a dead list of free indices whose length is an atomic counter.
+//Every frame three compute passes emit new particles into free slots, turn the alive count into the size of an
+//indirect dispatch, and simulate the alive particles, returning the dead ones to the dead list and compacting the
+//survivors from one half of a double buffered alive list into the other. The main pass draws the compacted half with a
+//single vkCmdDrawIndirect whose instance count is the alive count, so the CPU never learns how many particles exist.
+//Simulation is timed with timestamps and the particle count read back per frame, the throughput is printed on exit.
+class ParticleApplication : public TriangleApplication
+{
+public:
+	ParticleApplication(const ApplicationSettings& settings);
+	~ParticleApplication();
+protected:
+	void UpdateFrame(uint32_t frameSlot);
+	void AddPasses(uint32_t backbuffer);
+	uint32_t GetDrawCount();
+	void RecordDraws(VkCommandBuffer commandBuffer, uint32_t frameSlot, uint32_t begin, uint32_t end);
+private:
+	//Matches struct Particle in particles.glsl.
+	struct ParticleData
+	{
+		float position[2];
+		float velocity[2];
+		float age;
+		float lifetime;
+		uint32_t color;
+		float size;
+	};
+
+	//Matches CounterBlock in particles.glsl. Both draws count alive particles in their half of the alive list.
+	struct Counters
+	{
+		VkDrawIndirectCommand draws[2];
+		VkDispatchIndirectCommand simulateGroups;
+		int32_t deadCount;
+	};
+
+	//Matches the push constants in particles.glsl, buffers are bindless handles.
+	struct ParticleConstants
+	{
+		uint32_t particleBuffer;
+		uint32_t deadListBuffer;
+		uint32_t aliveBuffer;
+		uint32_t counterBuffer;
+		uint32_t capacity;
+		//Half of the alive list emission appends to, simulation writes the other half.
+		uint32_t current;
+		uint32_t emitCount;
+		uint32_t seed;
+		float deltaTime;
+		float aspect;
+		float prewarm;
+		float size;
+		float emitter[2];
+	};
+
+	void Initialise();
+	void Destroy();
+
+	void RecordEmit(VkCommandBuffer commandBuffer);
+	void RecordPrepare(VkCommandBuffer commandBuffer);
+	void RecordSimulate(VkCommandBuffer commandBuffer);
+	//Copies the counters of the frame into its readback slot.
+	void RecordStatistics(VkCommandBuffer commandBuffer);
+	//Adds the simulation time and particle count of the finished frame that last used frameSlot.
+	void RetireStatistics(uint32_t frameSlot);
+
+	void CreateParticleBuffers();
+	void DestroyParticleBuffers();
+	void CreateBindlessHandles();
+	void DestroyBindlessHandles();
+	void CreateStatistics();
+	void DestroyStatistics();
+	void CreatePipelines();
+
+	uint32_t capacity;
+	ParticleConstants constants;
+	//Slot of the frame being recorded, the graph's record functions do not get it.
+	uint32_t recordSlot;
+
+	VkBuffer particleBuffer;
+	Allocation particleAllocation;
+	VkBuffer deadListBuffer;
+	Allocation deadListAllocation;
+	VkBuffer aliveBuffer;
+	Allocation aliveAllocation;
+	VkBuffer counterBuffer;
+	Allocation counterAllocation;
+
+	//Two timestamps and one copy of the counters per frame slot.
+	VkQueryPool queryPool;
+	double timestampPeriod;
+	uint64_t timestampMask;
+	VkBuffer readbackBuffer;
+	Allocation readbackAllocation;
+	//Half of the alive list simulated per slot, UINT32_MAX while the slot holds no frame.
+	std::vector<uint32_t> slotLists;
+	uint64_t simulatedParticles;
+	double simulationMs;
+	uint64_t timedFrames;
+	uint32_t lastAliveCount;
+
+	VkPipeline emitPipeline;
+	VkPipeline preparePipeline;
+	VkPipeline simulatePipeline;
+	VkPipeline drawPipeline;
+};
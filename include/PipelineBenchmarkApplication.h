@@ -0,0 +1,16 @@
+#pragma once
+
+#include "Application.h"
+
+//Compiles a batch of pipeline variants with growing worker counts and reports how compile time scales.
+class PipelineBenchmarkApplication : public Application
+{
+public:
+	PipelineBenchmarkApplication(const ApplicationSettings& settings);
+	~PipelineBenchmarkApplication();
+
+	void Run();
+private:
+	std::vector<GraphicsPipelineDescription> CreateVariants();
+	double CompileVariants(const std::vector<GraphicsPipelineDescription>& variants, uint32_t threadCount);
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <map>
+#include <mutex>
+#include <future>
+#include <memory>
+
+#include <vulkan/vulkan.h>
+
+#include "ThreadPool.h"
+#include "ShaderManager.h"
+#include "PipelineCache.h"
+#include "LayoutCache.h"
+#include "HostAllocator.h"
+
+enum class BlendMode
+{
+	Opaque,
+	Alpha,
+	Additive
+};
+
+//Attachments a graphics pipeline renders into with dynamic rendering.
+struct AttachmentFormats
+{
+	std::vector<VkFormat> colorFormats;
+	VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+	VkSampleCountFlagBits sampleCount = VK_SAMPLE_COUNT_1_BIT;
+};
+
+//Everything that distinguishes one graphics pipeline variant from another.
+struct GraphicsPipelineDescription
+{
+	std::string vertexShader;
+	std::string fragmentShader;
+	std::vector<ShaderDefine> defines;
+	VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+	VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+	VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+	BlendMode blendMode = BlendMode::Opaque;
+	//Reflection only knows 32 bit inputs packed into binding 0. Set both to feed packed or interleaved vertex formats.
+	std::vector<VkVertexInputBindingDescription> vertexBindings;
+	std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+	//Value i is bound to constant_id i in every stage.
+	std::vector<uint32_t> specializationConstants;
+	//Only used when the attachments have a depth format.
+	bool depthTest = true;
+	bool depthWrite = true;
+	//Derived from shader reflection when left null.
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+	AttachmentFormats attachments;
+};
+
+struct ComputePipelineDescription
+{
+	std::string computeShader;
+	std::vector<ShaderDefine> defines;
+	//Value i is bound to constant_id i.
+	std::vector<uint32_t> specializationConstants;
+	//Derived from shader reflection when left null.
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+};
+
+//Compiles graphics and compute pipelines on a worker pool. All workers share one pipeline cache, which Vulkan synchronises internally.
+//Shader modules are created and reflected once per source and define set and shared between variants. Pipeline layouts
+//and vertex input state come from reflection unless the description says otherwise.
+//Builder owns every pipeline it returns, they are destroyed together on Destroy.
+class PipelineBuilder
+{
+public:
+	PipelineBuilder();
+	~PipelineBuilder();
+
+	//Zero threads means one per hardware thread.
+	void Create(VkDevice device, HostAllocator* hostAllocator, ShaderManager* shaderManager, PipelineCache* pipelineCache, LayoutCache* layoutCache, uint32_t threadCount);
+	void Destroy();
+
+	std::shared_future<VkPipeline> Submit(const GraphicsPipelineDescription& description);
+	std::vector<std::shared_future<VkPipeline>> Submit(const std::vector<GraphicsPipelineDescription>& descriptions);
+	std::shared_future<VkPipeline> Submit(const ComputePipelineDescription& description);
+	//Blocks until every submitted pipeline is built.
+	void WaitIdle();
+	//Merged interface of every stage in description. Compiles the shaders when they are not loaded yet.
+	ReflectedLayout Reflect(const GraphicsPipelineDescription& description);
+	//Deduplicated layout matching the reflected interface, owned by the layout cache.
+	VkPipelineLayout GetPipelineLayout(const GraphicsPipelineDescription& description);
+	ReflectedLayout Reflect(const ComputePipelineDescription& description);
+	VkPipelineLayout GetPipelineLayout(const ComputePipelineDescription& description);
+	uint32_t GetThreadCount() const;
+private:
+	struct CompiledShader
+	{
+		VkShaderModule shaderModule;
+		ReflectedLayout layout;
+	};
+
+	VkPipeline Build(const GraphicsPipelineDescription& description);
+	VkPipeline Build(const ComputePipelineDescription& description);
+	const CompiledShader& GetShader(const std::string& filename, VkShaderStageFlagBits stage, const std::vector<ShaderDefine>& defines);
+
+	VkDevice device;
+	HostAllocator* hostAllocator;
+	ShaderManager* shaderManager;
+	PipelineCache* pipelineCache;
+	LayoutCache* layoutCache;
+	std::unique_ptr<ThreadPool> threadPool;
+
+	std::mutex mutex;
+	std::map<uint64_t, std::shared_future<CompiledShader>> shaders;
+	std::vector<std::shared_future<VkPipeline>> pipelines;
+};
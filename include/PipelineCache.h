@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <mutex>
+
+#include <vulkan/vulkan.h>
+
+#include "HostAllocator.h"
+
+//Owns a VkPipelineCache that persists across runs. The blob is loaded on Create and written back atomically on Destroy.
+class PipelineCache
+{
+public:
+	PipelineCache();
+	~PipelineCache();
+
+	void Create(VkDevice device, HostAllocator* hostAllocator, VkPhysicalDevice physicalDevice, const std::string& filename);
+	void Destroy();
+
+	VkPipelineCache Get() const;
+	//True when a valid blob from an earlier run was loaded.
+	bool IsWarm() const;
+	//Accumulates the creation time of one pipeline, split by the cache hit flag of its creation feedback. Reported as
+	//warm or cold start on Destroy.
+	void RecordCreation(const VkPipelineCreationFeedback& feedback, double milliseconds);
+private:
+	std::vector<char> Load();
+	bool Validate(const std::vector<char>& data);
+	void Save();
+
+	VkDevice device;
+	HostAllocator* hostAllocator;
+	VkPipelineCache cache;
+	VkPhysicalDeviceProperties deviceProperties;
+	std::string filename;
+	bool warm;
+
+	std::mutex statisticsMutex;
+	uint32_t createdPipelines;
+	double creationTime;
+	uint32_t cacheHits;
+	double hitTime;
+	uint32_t cacheMisses;
+	double missTime;
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "HostAllocator.h"
+
+//Collects GPU scopes from timestamp queries and CPU scopes from the steady clock on one timeline. GPU timestamps are
+//mapped to CPU time with VK_EXT_calibrated_timestamps when the device has it, otherwise with one timestamp measured
+//against the CPU clock at startup. Queries of a frame slot are resolved when the slot comes around again, the GPU is done
+//with it by then, so resolving never waits.
+//Every scope feeds rolling percentiles, the whole run can be written as a Chrome trace (chrome://tracing, Perfetto).
+class Profiler
+{
+public:
+	//Measures the enclosing C++ scope on the calling thread.
+	class CpuScope
+	{
+	public:
+		CpuScope(Profiler& profiler, const char* name);
+		~CpuScope();
+	private:
+		Profiler& profiler;
+		const char* name;
+		int64_t start;
+	};
+
+	Profiler();
+	~Profiler();
+
+	void Create(VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice device, HostAllocator* hostAllocator, VkQueue queue, uint32_t queueFamilyIndex, uint32_t framesInFlight, bool calibratedTimestamps, const std::string& traceFilename);
+	//Writes the trace and prints the statistics of every scope.
+	void Destroy();
+
+	//Resolves the queries the slot holds from its previous frame. GPU must be done with the slot.
+	void BeginFrame(uint32_t frameSlot);
+	//GPU scopes nest and are recorded into primary command buffers on the thread that calls BeginFrame.
+	void BeginGpuScope(VkCommandBuffer commandBuffer, const char* name);
+	void EndGpuScope(VkCommandBuffer commandBuffer);
+	//Thread safe.
+	void RecordCpuScope(const char* name, int64_t start, int64_t end);
+
+	static int64_t GetCpuTime();
+	void PrintStatistics();
+private:
+	struct GpuScope
+	{
+		const char* name;
+		uint32_t beginQuery;
+		uint32_t endQuery;
+	};
+
+	struct FrameQueries
+	{
+		VkQueryPool queryPool = VK_NULL_HANDLE;
+		uint32_t queryCount = 0u;
+		std::vector<GpuScope> scopes;
+	};
+
+	struct TraceEvent
+	{
+		std::string name;
+		//Zero is the GPU, CPU threads count up from one.
+		uint32_t thread;
+		int64_t start;
+		int64_t duration;
+	};
+
+	//Fixed size window of the latest samples.
+	struct ScopeStatistics
+	{
+		std::vector<double> samples;
+		size_t next = 0u;
+		uint64_t count = 0u;
+	};
+
+	void Calibrate();
+	void CalibrateWithQueue();
+	int64_t GpuToCpuTime(uint64_t timestamp) const;
+	void AddSample(const std::string& name, uint32_t thread, int64_t start, int64_t end);
+	uint32_t GetThreadIndex(std::thread::id id);
+	void WriteTrace();
+
+	static const uint32_t queriesPerFrame = 256u;
+	static const size_t statisticsWindow = 512u;
+	static const size_t maxTraceEvents = 1u << 20;
+
+	VkPhysicalDevice physicalDevice;
+	VkDevice device;
+	HostAllocator* hostAllocator;
+	VkQueue queue;
+	uint32_t queueFamilyIndex;
+	std::string traceFilename;
+
+	bool supported;
+	double timestampPeriod;
+	uint64_t timestampMask;
+	PFN_vkGetCalibratedTimestampsEXT getCalibratedTimestamps;
+	VkTimeDomainEXT hostTimeDomain;
+	//GPU timestamp and CPU time of the same instant.
+	uint64_t calibrationTimestamp;
+	int64_t calibrationTime;
+	int64_t startTime;
+
+	uint32_t frameSlot;
+	std::vector<FrameQueries> frames;
+	std::vector<uint32_t> openScopes;
+
+	std::mutex mutex;
+	std::map<std::string, ScopeStatistics> statistics;
+	std::vector<TraceEvent> trace;
+	std::map<std::thread::id, uint32_t> threads;
+	bool traceFull;
+};
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "MemoryAllocator.h"
+#include "DeletionQueue.h"
+#include "Profiler.h"
+#include "HostAllocator.h"
+
+//How a pass touches a resource. Decides the pipeline stages, the access and, for images, the layout.
+enum class RenderGraphUsage
+{
+	ColorAttachment,
+	DepthAttachment,
+	SampledFragment,
+	SampledCompute,
+	StorageCompute,
+	//Storage buffers read by vertex shaders, such as pulled vertex data.
+	StorageVertex,
+	IndirectArgument,
+	TransferSource,
+	TransferDestination
+};
+
+//Synchronization state of a resource at the edges of the frame.
+struct RenderGraphState
+{
+	VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_NONE;
+	VkAccessFlags2 access = VK_ACCESS_2_NONE;
+	VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+};
+
+//Image owned by the graph that only lives within a frame.
+struct RenderGraphImageDescription
+{
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	VkExtent2D extent = {};
+	VkSampleCountFlagBits sampleCount = VK_SAMPLE_COUNT_1_BIT;
+	//Usages beyond the ones derived from the passes, TRANSIENT_ATTACHMENT for example.
+	VkImageUsageFlags extraUsage = 0u;
+};
+
+//Frame described as passes that declare which resources they read and write. Compile culls passes whose results are
+//never used, derives one batch of synchronization2 barriers and layout transitions per pass and places transient images
+//whose lifetimes do not overlap in the same memory. Execute then records the compiled frame, beginning dynamic rendering
+//for every pass with attachments.
+//The declaration is static: it is compiled once and recorded every frame. Imported images may change between frames,
+//imported buffers carry their state over from one frame to the next.
+class RenderGraph
+{
+public:
+	using RecordFunction = std::function<void(VkCommandBuffer commandBuffer)>;
+
+	RenderGraph();
+	~RenderGraph();
+
+	//Profiler may be null, otherwise every pass gets a GPU scope named after it.
+	void Create(VkDevice device, HostAllocator* hostAllocator, MemoryAllocator* memoryAllocator, DeletionQueue* deletionQueue, Profiler* profiler);
+	void Destroy();
+
+	//Drops every pass and resource. Transient images are retired once the GPU has completed retireValue.
+	void Reset(uint64_t retireValue);
+
+	//Image provided from outside every frame through SetImportedImage. It enters each frame in initial and is left in final.
+	uint32_t ImportImage(const char* name, VkFormat format, VkExtent2D extent, const RenderGraphState& initial, const RenderGraphState& final);
+	//Buffer that outlives the frame. Its first use in a frame waits for its last use in the previous one.
+	uint32_t ImportBuffer(const char* name, VkBuffer buffer);
+	uint32_t CreateImage(const char* name, const RenderGraphImageDescription& description);
+
+	//Name must outlive the graph. Passes are recorded in the order they are added.
+	uint32_t AddPass(const char* name, RecordFunction record);
+	void Read(uint32_t pass, uint32_t resource, RenderGraphUsage usage);
+	//Attachments are bound in the order they are written.
+	void Write(uint32_t pass, uint32_t resource, RenderGraphUsage usage);
+	//Attachment written by pass starts from value instead of its previous contents.
+	void Clear(uint32_t pass, uint32_t resource, const VkClearValue& value);
+	//Multisampled color attachment source is averaged into the single sampled destination as pass ends rendering.
+	void Resolve(uint32_t pass, uint32_t source, uint32_t destination);
+	//Keeps pass even when nothing reads what it writes, for work with effects outside the graph.
+	void SetSideEffects(uint32_t pass);
+	//Pass records its draws into secondary command buffers executed from record.
+	void SetSecondaryCommandBuffers(uint32_t pass);
+
+	void Compile();
+
+	void SetImportedImage(uint32_t resource, VkImage image, VkImageView view);
+	VkImageView GetImageView(uint32_t resource) const;
+	//Formats of the attachments of pass, for secondary command buffer inheritance.
+	VkCommandBufferInheritanceRenderingInfo GetInheritanceRenderingInfo(uint32_t pass) const;
+	void Execute(VkCommandBuffer commandBuffer);
+private:
+	struct Resource
+	{
+		const char* name;
+		bool imported;
+		bool image;
+		VkFormat format;
+		VkExtent2D extent;
+		VkSampleCountFlagBits sampleCount;
+		VkImageUsageFlags usage;
+		RenderGraphState initial;
+		RenderGraphState final;
+		VkImage imageHandle;
+		VkImageView view;
+		VkBuffer buffer;
+		//Transient images only: memory slot and the span of compiled passes that use it.
+		uint32_t slot;
+		uint32_t firstPass;
+		uint32_t lastPass;
+	};
+
+	struct Access
+	{
+		uint32_t resource;
+		VkPipelineStageFlags2 stages;
+		VkAccessFlags2 access;
+		VkImageLayout layout;
+		bool write;
+	};
+
+	struct Attachment
+	{
+		uint32_t resource;
+		bool depth;
+		bool clear;
+		VkClearValue clearValue;
+		VkAttachmentLoadOp loadOp;
+		VkAttachmentStoreOp storeOp;
+		//Image the attachment is resolved into, UINT32_MAX for none.
+		uint32_t resolve;
+	};
+
+	struct Barrier
+	{
+		uint32_t resource;
+		VkPipelineStageFlags2 srcStages;
+		VkAccessFlags2 srcAccess;
+		VkPipelineStageFlags2 dstStages;
+		VkAccessFlags2 dstAccess;
+		VkImageLayout oldLayout;
+		VkImageLayout newLayout;
+	};
+
+	struct Pass
+	{
+		const char* name;
+		RecordFunction record;
+		std::vector<Access> accesses;
+		std::vector<Attachment> attachments;
+		std::vector<VkFormat> colorFormats;
+		bool sideEffects;
+		bool secondaryCommandBuffers;
+		bool culled;
+		std::vector<Barrier> barriers;
+	};
+
+	//Last write of a resource and the stages that have seen it since, as the barrier derivation tracks them.
+	struct Tracking
+	{
+		VkPipelineStageFlags2 writeStages;
+		VkAccessFlags2 writeAccess;
+		VkPipelineStageFlags2 readStages;
+		VkAccessFlags2 readAccess;
+		VkImageLayout layout;
+	};
+
+	void AddAccess(Pass& pass, const Access& access);
+	//Adds resource to the attachments of pass once.
+	void Bind(Pass& pass, uint32_t resource, bool depth);
+	void Cull();
+	void CreateTransientImages();
+	void DestroyTransientImages();
+	void DeriveBarriers();
+	void Synchronize(std::vector<Barrier>& barriers, uint32_t resource, Tracking& tracking, VkPipelineStageFlags2 stages, VkAccessFlags2 access, VkImageLayout layout, bool write);
+	void RecordBarriers(VkCommandBuffer commandBuffer, const std::vector<Barrier>& barriers);
+	VkImageAspectFlags GetAspect(VkFormat format) const;
+
+	VkDevice device;
+	HostAllocator* hostAllocator;
+	MemoryAllocator* memoryAllocator;
+	DeletionQueue* deletionQueue;
+	Profiler* profiler;
+
+	std::vector<Resource> resources;
+	std::vector<Pass> passes;
+	std::vector<Barrier> finalBarriers;
+	//One allocation per group of transient images that share memory.
+	std::vector<Allocation> slots;
+	bool compiled;
+};
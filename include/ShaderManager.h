@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+
+struct ShaderDefine
+{
+	std::string name;
+	std::string value;
+};
+
+//Compiles GLSL sources to SPIR-V at runtime through shaderc. Results are cached on disk under a hash of the
+//source, every file it includes, the defines, the compiler options and the identity of the compiler, so unchanged
+//shaders are never recompiled and a compiler upgrade does not serve stale SPIR-V.
+//Loaded SPIR-V is also kept in memory, loading a shader again only reads and hashes its source.
+//Load may be called from several threads at once.
+class ShaderManager
+{
+public:
+	ShaderManager();
+	~ShaderManager();
+
+	void Create(const std::string& cacheDirectory, uint32_t apiVersion, bool debug);
+
+	//Stage is derived from the extension: .vert, .frag, .comp, .geom, .tesc or .tese.
+	std::vector<uint32_t> Load(const std::string& filename, const std::vector<ShaderDefine>& defines = {});
+	//Directories searched for #include <file>. Directory of the including file is searched first for #include "file".
+	void AddIncludeDirectory(const std::string& directory);
+private:
+	uint64_t ComputeKey(const std::string& filename, const std::string& source, const std::vector<ShaderDefine>& defines);
+	std::vector<uint32_t> Compile(const std::string& filename, const std::string& source, const std::vector<ShaderDefine>& defines);
+	std::vector<uint32_t> ReadCache(uint64_t key);
+	void WriteCache(uint64_t key, const std::vector<uint32_t>& spirv);
+
+	std::string cacheDirectory;
+	std::vector<std::string> includeDirectories;
+	uint32_t apiVersion;
+	bool debug;
+	//Hash of the SPIR-V a probe shader compiles to with the current compiler and options.
+	uint64_t compilerIdentity;
+
+	std::mutex mutex;
+	std::unordered_map<uint64_t, std::vector<uint32_t>> loaded;
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+//Interface of a set of shader stages as seen by the pipeline.
+struct ReflectedLayout
+{
+	//Descriptor bindings per set index, sorted by binding.
+	std::map<uint32_t, std::vector<VkDescriptorSetLayoutBinding>> sets;
+	//At most one range per stage.
+	std::vector<VkPushConstantRange> pushConstants;
+	//Vertex shader inputs packed into binding 0 in location order.
+	std::vector<VkVertexInputBindingDescription> vertexBindings;
+	std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+};
+
+//Extracts descriptor bindings, push constants and vertex inputs from SPIR-V through spirv_cross.
+class ShaderReflection
+{
+public:
+	//Merges the interface of one stage into layout. Bindings used by several stages get their stage flags combined.
+	static void Reflect(VkShaderStageFlagBits stage, const std::vector<uint32_t>& spirv, ReflectedLayout& layout);
+	//Merges an already reflected stage into layout.
+	static void Merge(const ReflectedLayout& stageLayout, ReflectedLayout& layout);
+private:
+	static void AddBinding(ReflectedLayout& layout, uint32_t set, VkDescriptorSetLayoutBinding binding);
+	static VkFormat GetVertexFormat(uint32_t baseType, uint32_t vectorSize);
+};
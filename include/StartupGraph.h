@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <chrono>
+#include <cstdint>
+
+#include "ThreadPool.h"
+
+//Runs initialisation as a graph of steps instead of a fixed sequence. A step starts as soon as the steps it depends on
+//are done, independent ones run concurrently on a thread pool. Steps that must stay on the main thread, such as GLFW
+//window calls, run on the thread that calls Run. Every step is timed and the timings are printed with the critical path,
+//the chain of steps that decided how long startup took.
+class StartupGraph
+{
+public:
+	using Step = std::function<void()>;
+
+	StartupGraph();
+	~StartupGraph();
+
+	//Dependencies must have been added before, which also keeps the graph free of cycles.
+	uint32_t Add(const std::string& name, Step step, const std::vector<uint32_t>& dependencies = {}, bool mainThread = false);
+	//Blocks until every step has run. Once a step throws no further steps start, the first exception is rethrown after
+	//the running ones have finished. Zero threads means one per hardware thread.
+	void Run(uint32_t threadCount = 0u);
+	void PrintTimings();
+private:
+	struct Node
+	{
+		std::string name;
+		Step step;
+		std::vector<uint32_t> dependencies;
+		std::vector<uint32_t> dependents;
+		bool mainThread;
+		uint32_t pendingCount;
+		//Milliseconds since Run started.
+		double startMs;
+		double endMs;
+	};
+
+	//Caller holds mutex.
+	void Schedule(uint32_t node);
+	void Execute(uint32_t node);
+	double GetMilliseconds() const;
+
+	std::vector<Node> nodes;
+	std::unique_ptr<ThreadPool> threadPool;
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::vector<uint32_t> mainThreadQueue;
+	uint32_t remainingCount;
+	uint32_t runningCount;
+	std::exception_ptr failure;
+
+	std::chrono::steady_clock::time_point start;
+	double elapsedMs;
+};
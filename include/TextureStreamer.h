@@ -0,0 +1,143 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "MemoryAllocator.h"
+#include "UploadManager.h"
+#include "BindlessTable.h"
+#include "DeletionQueue.h"
+#include "ThreadPool.h"
+#include "HostAllocator.h"
+
+//Streams textures from disk on I/O worker threads. A texture first becomes resident with its mip tail, the levels of
+//at most tailSize texels, and then gains one higher level at a time while the renderer reports a screen space size
+//that needs it. Resident levels of all textures stay under a memory budget; when a new level does not fit, the highest
+//level of the least recently used texture is evicted first.
+//Every residency change builds a new image holding exactly the resident levels. Levels both versions share are copied
+//on the GPU, so only new levels are read and uploaded and evictions never touch the disk. Textures are sampled through
+//bindless handles that change with every version, the renderer fetches them with GetHandle every frame.
+//Images are binary RGB PPM files. Everything but the worker threads runs on the render thread.
+class TextureStreamer
+{
+public:
+	TextureStreamer();
+	~TextureStreamer();
+
+	void Create(VkDevice device, HostAllocator* hostAllocator, MemoryAllocator* memoryAllocator, UploadManager* uploadManager, BindlessTable* bindlessTable, DeletionQueue* deletionQueue, VkDeviceSize budget, uint32_t ioThreads);
+	//The GPU must be idle.
+	void Destroy();
+
+	//Returns the texture id, loading starts in the background.
+	uint32_t Load(const std::string& filename);
+	//Texture covers about pixels texels on screen along its larger side this frame. Several calls keep the largest.
+	void RequestSize(uint32_t texture, float pixels);
+	//Bindless image handle of the current version, a white texel while nothing is resident yet.
+	uint32_t GetHandle(uint32_t texture) const;
+
+	//Once per frame before recording. Applies finished loads, enforces the budget and starts new loads. Replaced
+	//versions are retired once the GPU has completed retireValue.
+	void Update(uint64_t retireValue);
+	//Records the GPU copies between versions, before anything samples the textures in commandBuffer.
+	void RecordCommands(VkCommandBuffer commandBuffer);
+
+	VkDeviceSize GetResidentBytes() const;
+	void PrintStatistics() const;
+private:
+	struct Texture
+	{
+		std::string filename;
+		uint32_t width = 0u;
+		uint32_t height = 0u;
+		uint32_t levelCount = 0u;
+		//First level of the mip tail, loaded up front.
+		uint32_t tailLevel = 0u;
+		//Highest resident level, levelCount while nothing is resident.
+		uint32_t residentLevel = 0u;
+		//Largest screen size reported during lastUsedFrame and the level it needs.
+		float requestedPixels = 0.f;
+		uint32_t desiredLevel = 0u;
+		uint64_t lastUsedFrame = 0u;
+		bool loading = false;
+		//Set when the file could not be loaded, no further levels are requested.
+		bool failed = false;
+		VkImage image = VK_NULL_HANDLE;
+		Allocation allocation;
+		VkImageView imageView = VK_NULL_HANDLE;
+		uint32_t handle = BindlessTable::invalidHandle;
+	};
+
+	//Levels are indices into the full chain, firstLevel of the tail load is resolved by the worker.
+	struct LoadResult
+	{
+		uint32_t texture;
+		uint32_t firstLevel;
+		uint32_t width;
+		uint32_t height;
+		std::vector<std::vector<uint8_t>> levels;
+		std::string error;
+	};
+
+	struct PendingCopy
+	{
+		VkImage source;
+		VkImage destination;
+		uint32_t sourceLevel;
+		uint32_t destinationLevel;
+		uint32_t levelCount;
+		//Extent of the copied level in the source image.
+		VkExtent2D extent;
+	};
+
+	static const uint32_t tailSize = 64u;
+	static const uint32_t tailRequest = UINT32_MAX;
+
+	static LoadResult LoadLevels(uint32_t texture, const std::string& filename, uint32_t firstLevel);
+	static std::vector<uint8_t> ReadPpm(const std::string& filename, uint32_t& width, uint32_t& height);
+	static std::vector<uint8_t> Downsample(const std::vector<uint8_t>& source, uint32_t width, uint32_t height);
+
+	void StartLoad(uint32_t texture, uint32_t firstLevel);
+	void ApplyLoad(LoadResult& result, uint64_t retireValue);
+	//Replaces the version of texture with one holding levels [topLevel, levelCount). Levels in uploads are uploaded,
+	//the remaining ones must be resident in the current version and are copied.
+	void ReplaceVersion(Texture& texture, uint32_t topLevel, const std::vector<std::vector<uint8_t>>& uploads, uint64_t retireValue);
+	void RetireVersion(Texture& texture, uint64_t retireValue);
+	//Evicts top levels until required more bytes fit. Victims are textures last used before usedBefore or holding more
+	//levels than they need. Returns false when nothing more can be evicted.
+	bool EvictForBudget(VkDeviceSize required, uint64_t usedBefore, uint64_t retireValue);
+	VkDeviceSize GetLevelSize(const Texture& texture, uint32_t level) const;
+	VkDeviceSize GetVersionSize(const Texture& texture, uint32_t topLevel) const;
+	void CreateFallback();
+
+	VkDevice device;
+	HostAllocator* hostAllocator;
+	MemoryAllocator* memoryAllocator;
+	UploadManager* uploadManager;
+	BindlessTable* bindlessTable;
+	DeletionQueue* deletionQueue;
+	VkDeviceSize budget;
+	VkDeviceSize residentBytes;
+	//Bytes of levels being loaded, counted against the budget before they arrive.
+	VkDeviceSize loadingBytes;
+	uint64_t frame;
+
+	std::vector<Texture> textures;
+	std::vector<PendingCopy> pendingCopies;
+	std::unique_ptr<ThreadPool> ioPool;
+	std::mutex completedMutex;
+	std::vector<LoadResult> completed;
+	bool uploaded;
+
+	VkImage fallbackImage;
+	Allocation fallbackAllocation;
+	VkImageView fallbackView;
+	uint32_t fallbackHandle;
+
+	uint64_t streamedLevels;
+	uint64_t evictedLevels;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <cstdint>
+
+//Fixed set of worker threads that run submitted tasks in submission order.
+class ThreadPool
+{
+public:
+	//Zero threads means one per hardware thread.
+	ThreadPool(uint32_t threadCount = 0u);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	template<typename Function>
+	auto Submit(Function&& function) -> std::future<decltype(function())>;
+
+	uint32_t GetThreadCount() const;
+private:
+	void WorkerLoop();
+
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool stopping;
+};
+
+template<typename Function>
+auto ThreadPool::Submit(Function&& function) -> std::future<decltype(function())>
+{
+	using Result = decltype(function());
+
+	//std::function needs a copyable target, packaged_task is move only.
+	auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+	std::future<Result> future = task->get_future();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		tasks.push([task]() { (*task)(); });
+	}
+	condition.notify_one();
+
+	return future;
+}
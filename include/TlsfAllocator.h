@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+
+//Two level segregated fit allocator over an abstract range of bytes. It only hands out offsets, the caller owns the memory.
+//Allocation and free are constant time. Adjacent free regions are merged immediately, so the range never holds two
+//neighbouring free regions.
+class TlsfAllocator
+{
+public:
+	//Opaque handle of an allocated region, needed to free it.
+	struct Region;
+
+	TlsfAllocator();
+	~TlsfAllocator();
+
+	TlsfAllocator(const TlsfAllocator&) = delete;
+	TlsfAllocator& operator=(const TlsfAllocator&) = delete;
+
+	void Create(uint64_t size);
+	void Destroy();
+
+	//Returns nullptr when no free region can hold size bytes at the requested power of two alignment.
+	Region* Allocate(uint64_t size, uint64_t alignment, uint64_t& offset);
+	void Free(Region* region);
+
+	uint64_t GetSize() const;
+	uint64_t GetUsedBytes() const;
+	uint64_t GetLargestFreeRegion() const;
+	uint32_t GetAllocationCount() const;
+	bool IsEmpty() const;
+private:
+	static const uint32_t secondLevelLog2 = 4u;
+	static const uint32_t secondLevelCount = 1u << secondLevelLog2;
+	static const uint32_t firstLevelCount = 64u;
+	//Every region size and offset is a multiple of this.
+	static const uint64_t minimumSize = 16u;
+
+	static void Mapping(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel);
+	void InsertFree(Region* region);
+	void RemoveFree(Region* region);
+	Region* FindFree(uint64_t size);
+
+	uint64_t size;
+	uint64_t usedBytes;
+	uint32_t allocationCount;
+	Region* first;
+
+	uint64_t firstLevelBitmap;
+	std::array<uint32_t, firstLevelCount> secondLevelBitmaps;
+	std::array<std::array<Region*, secondLevelCount>, firstLevelCount> freeLists;
+};
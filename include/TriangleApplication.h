@@ -1,33 +1,82 @@
 #pragma once
 
 #include "Application.h"
+#include "FrameScheduler.h"
+#include "CommandRecorder.h"
+#include "Profiler.h"
+#include "FramePacer.h"
+#include "RenderGraph.h"
+#include "FrameAllocator.h"
+#include "AsyncCompute.h"
 
+//Frame loop shared by the rendering scenes: pacing, acquire, recording the render graph with parallel recording of the
+//main pass, submit and present. Derived scenes override the hooks to update their data, add passes and record their draws.
 class TriangleApplication : public Application
 {
 public:
-	TriangleApplication();
+	TriangleApplication(const ApplicationSettings& settings);
 	~TriangleApplication();
 
 	void Run();
+protected:
+	void MainLoop();
+	void HeadlessLoop();
+
+	//Called once the GPU is done with frameSlot, before the frame is recorded.
+	virtual void UpdateFrame(uint32_t frameSlot);
+	//Declares the passes of the frame, which ends in backbuffer. Called whenever the swapchain extent changes.
+	virtual void AddPasses(uint32_t backbuffer);
+	//Pass that clears color and depth, executes the secondary command buffers filled by RecordDraws and ends in
+	//backbuffer, through a resolve when multisampled.
+	uint32_t AddMainPass(uint32_t backbuffer);
+	//Number of items split between the recording threads.
+	virtual uint32_t GetDrawCount();
+	//Records items [begin, end) into a secondary command buffer inside the main pass.
+	virtual void RecordDraws(VkCommandBuffer commandBuffer, uint32_t frameSlot, uint32_t begin, uint32_t end);
+	void SetViewportAndScissor(VkCommandBuffer commandBuffer);
+
+	FrameScheduler frameScheduler;
+	CommandRecorder commandRecorder;
+	Profiler profiler;
+	FramePacer framePacer;
+	RenderGraph renderGraph;
+	//Per frame constants and CPU written data, reset at the start of every frame.
+	FrameAllocator frameAllocator;
+	//Compute work of the scenes that runs beside rendering. Its results are acquired and waited for by the frame
+	//recorded after the submission.
+	AsyncCompute asyncCompute;
 private:
 	void Initialise();
 	void Destroy();
 
-	void MainLoop();
-	void RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+	//Adds the semaphore waits the recorded acquires need to waits.
+	void RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t frameSlot, uint32_t imageIndex, std::vector<VkSemaphoreSubmitInfo>& waits);
+	void BuildRenderGraph();
+	void RecordMainPass(VkCommandBuffer commandBuffer);
 	void DrawFrames();
 
-	void CreateCommandBuffers();
+	void CreateCommandRecorder();
+	void DestroyCommandRecorder();
 	void CreateSyncObjects();
 	void DestroySyncObjects();
+	void CreateProfiler();
+	void DestroyProfiler();
+	void CreateFramePacer();
+	void DestroyFramePacer();
+	void CreateRenderGraph();
+	void DestroyRenderGraph();
+	void CreateFrameAllocator();
+	void DestroyFrameAllocator();
+	void CreateAsyncCompute();
+	void DestroyAsyncCompute();
 
-	static const int maxFramesInFlight;
-
-	int currentFrame;
+	uint32_t lastImageIndex;
+	uint32_t backbuffer;
+	uint32_t mainPass;
+	//Extent the graph was compiled for, zero until the first frame.
+	VkExtent2D renderGraphExtent;
 
-	std::vector<VkCommandBuffer> commandBuffers;
+	//Windowed only, presentation still needs binary semaphores.
 	std::vector<VkSemaphore> imageAvailableSemaphores;
 	std::vector<VkSemaphore> renderFinishedSemaphores;
-	std::vector<VkFence> inFlightFences;
 };
-
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <functional>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "MemoryAllocator.h"
+#include "HostAllocator.h"
+
+//Streams buffer and image data to the GPU through a persistently mapped staging ring. Uploads are recorded into one
+//command buffer per batch and submitted together on the transfer queue, which is a dedicated transfer family when the
+//device has one. Every batch signals a timeline semaphore value that serves as its completion token.
+//Resources change queue family ownership after the copy. The graphics side takes ownership back with
+//RecordAcquireBarriers and waits for the returned timeline value in the same submission, so rendering never waits on
+//the CPU for uploads.
+class UploadManager
+{
+public:
+	UploadManager();
+	~UploadManager();
+
+	void Create(VkPhysicalDevice physicalDevice, VkDevice device, HostAllocator* hostAllocator, MemoryAllocator* memoryAllocator, VkQueue transferQueue, uint32_t transferFamilyIndex, uint32_t graphicsFamilyIndex, VkDeviceSize capacity = 32ull << 20);
+	void Destroy();
+
+	//Data is copied into the ring before returning. Blocks only while the ring is full. Buffers created with
+	//VK_SHARING_MODE_CONCURRENT pass concurrent, they are not released and only need the wait for the upload.
+	void UploadBuffer(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size, bool concurrent = false);
+	//Lets the caller produce the data in place, for example by decompressing into the ring. write fills size bytes at
+	//destination with bytes [offset, offset + size) of the upload and is called once per chunk before UploadBuffer returns.
+	void UploadBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, const std::function<void(void* destination, VkDeviceSize offset, VkDeviceSize size)>& write, bool concurrent = false);
+	//Uploads one whole mip level, its previous contents are discarded. Image ends up in finalLayout.
+	void UploadImage(VkImage image, const VkImageSubresourceLayers& subresource, VkExtent3D extent, const void* data, VkDeviceSize size, VkImageLayout finalLayout);
+	//Submits every upload recorded since the last flush. Returns the timeline value signalled once they are done.
+	uint64_t Flush();
+	bool IsComplete(uint64_t token);
+	void Wait(uint64_t token);
+
+	//Graphics queue only: records the ownership acquire of every flushed upload not acquired yet. The submission of
+	//commandBuffer must wait for the returned value on GetSemaphore, zero means there is nothing to wait for.
+	uint64_t RecordAcquireBarriers(VkCommandBuffer commandBuffer);
+	VkSemaphore GetSemaphore() const;
+	//Single image uploads must fit in the ring.
+	VkDeviceSize GetCapacity() const;
+private:
+	struct Batch
+	{
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		uint64_t value = 0u;
+		//Ring bytes consumed including alignment and wrap padding.
+		VkDeviceSize ringBytes = 0u;
+		VkDeviceSize uploadedBytes = 0u;
+		std::vector<VkBufferMemoryBarrier> bufferReleases;
+		std::vector<VkImageMemoryBarrier> imageReleases;
+	};
+
+	struct PendingAcquire
+	{
+		uint64_t value;
+		std::vector<VkBufferMemoryBarrier> bufferAcquires;
+		std::vector<VkImageMemoryBarrier> imageAcquires;
+	};
+
+	VkDeviceSize Reserve(VkDeviceSize size, VkDeviceSize alignment);
+	bool TryReserve(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+	void BeginBatch();
+	uint64_t FlushBatch();
+	void Reclaim();
+
+	VkDevice device;
+	HostAllocator* hostAllocator;
+	MemoryAllocator* memoryAllocator;
+	VkQueue transferQueue;
+	uint32_t transferFamilyIndex;
+	uint32_t graphicsFamilyIndex;
+	VkDeviceSize copyAlignment;
+
+	VkCommandPool commandPool;
+	VkSemaphore semaphore;
+	uint64_t nextValue;
+
+	VkBuffer ringBuffer;
+	Allocation ringAllocation;
+	VkDeviceSize capacity;
+	VkDeviceSize head;
+	VkDeviceSize allocatedBytes;
+
+	std::mutex mutex;
+	bool recording;
+	Batch current;
+	std::deque<Batch> inFlight;
+	std::vector<VkCommandBuffer> freeCommandBuffers;
+	std::vector<PendingAcquire> pendingAcquires;
+	uint64_t pendingValue;
+
+	uint64_t totalBatches;
+	uint64_t totalUploads;
+	VkDeviceSize totalBytes;
+};
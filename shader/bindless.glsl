@@ -0,0 +1,10 @@
+//Declarations matching BindlessTable. Resources are selected by indices passed in push constants, wrap indices that
+//differ between invocations of one draw or dispatch in nonuniformEXT.
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(set = 0, binding = 0) uniform texture2D bindlessTextures[];
+layout(set = 0, binding = 1) uniform sampler bindlessSamplers[];
+
+//Storage buffers of every element type alias binding 2, each type gets its own view of the array:
+//BINDLESS_BUFFER(readonly, Object, objectBuffers); objectBuffers[index].items[i]
+#define BINDLESS_BUFFER(access, Type, name) layout(std430, set = 0, binding = 2) access buffer name##Block { Type items[]; } name[]
\ No newline at end of file
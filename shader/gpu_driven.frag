@@ -0,0 +1,28 @@
+#version 460
+
+#include "bindless.glsl"
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragUv;
+layout(location = 2) flat in uint fragTexture;
+
+layout(location = 0) out vec4 outColor;
+
+//Shared with gpu_driven.vert.
+layout(push_constant) uniform Camera {
+    mat4 viewProjection;
+    uint objectBuffer;
+    uint samplerHandle;
+    uint textureCount;
+    uint textureHandles[8];
+};
+
+void main() {
+    vec3 color = fragColor;
+    if (textureCount != 0) {
+        //Handles change whenever the streamer swaps a texture version, neighbouring objects may use different slots.
+        uint handle = textureHandles[fragTexture];
+        color *= texture(sampler2D(bindlessTextures[nonuniformEXT(handle)], bindlessSamplers[samplerHandle]), fragUv).rgb;
+    }
+    outColor = vec4(color, 1.0);
+}
\ No newline at end of file
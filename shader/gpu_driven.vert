@@ -0,0 +1,43 @@
+#version 460
+
+#include "bindless.glsl"
+
+layout(location = 0) in vec2 inPosition;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragUv;
+layout(location = 2) flat out uint fragTexture;
+
+//bounds is a world space sphere, transform holds xy position, z rotation in radians and w scale.
+struct Object {
+    vec4 bounds;
+    vec4 transform;
+    vec4 color;
+    uvec4 mesh;
+};
+
+BINDLESS_BUFFER(readonly, Object, objectBuffers);
+
+//Shared with gpu_driven.frag.
+layout(push_constant) uniform Camera {
+    mat4 viewProjection;
+    uint objectBuffer;
+    uint samplerHandle;
+    uint textureCount;
+    uint textureHandles[8];
+};
+
+void main() {
+    //Culling stores the object index as firstInstance of its draw.
+    Object object = objectBuffers[objectBuffer].items[gl_InstanceIndex];
+
+    float s = sin(object.transform.z);
+    float c = cos(object.transform.z);
+    vec2 local = inPosition * object.transform.w;
+    vec2 position = vec2(c * local.x - s * local.y, s * local.x + c * local.y) + object.transform.xy;
+
+    fragColor = object.color.rgb;
+    fragUv = inPosition + 0.5;
+    fragTexture = object.mesh.y;
+    gl_Position = viewProjection * vec4(position, 0.0, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,27 @@
+#version 460
+
+layout(location = 0) in vec2 inPosition;
+
+layout(location = 0) out vec3 fragColor;
+
+//xy position, z rotation in radians, w scale.
+struct Instance {
+    vec4 transform;
+    vec4 color;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer Instances {
+    Instance instances[];
+};
+
+void main() {
+    Instance instance = instances[gl_InstanceIndex];
+
+    float s = sin(instance.transform.z);
+    float c = cos(instance.transform.z);
+    vec2 local = inPosition * instance.transform.w;
+    vec2 position = vec2(c * local.x - s * local.y, s * local.x + c * local.y) + instance.transform.xy;
+
+    fragColor = instance.color.rgb;
+    gl_Position = vec4(position, 0.0, 1.0);
+}
\ No newline at end of file
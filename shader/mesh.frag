@@ -0,0 +1,14 @@
+#version 460
+
+layout(location = 0) in vec3 fragNormal;
+layout(location = 1) in vec2 fragUv;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    //Head light with some ambient, a faint checker shows the texture coordinates.
+    float diffuse = max(dot(normalize(fragNormal), vec3(0.0, 0.0, 1.0)), 0.0);
+    float checker = mod(floor(fragUv.x * 16.0) + floor(fragUv.y * 16.0), 2.0);
+    vec3 albedo = mix(vec3(0.8), vec3(0.65), checker);
+    outColor = vec4(albedo * (0.15 + 0.85 * diffuse), 1.0);
+}
\ No newline at end of file
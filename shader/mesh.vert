@@ -0,0 +1,35 @@
+#version 460
+
+layout(location = 0) in vec4 inPosition;
+layout(location = 1) in vec2 inNormal;
+layout(location = 2) in vec2 inUv;
+
+layout(location = 0) out vec3 fragNormal;
+layout(location = 1) out vec2 fragUv;
+
+//xy cosine and sine of the rotation around y, zw scale from the quantised unit cube to clip space.
+layout(push_constant) uniform Transform {
+    vec4 transform;
+};
+
+//Inverse of MeshOptimizer::EncodeOctahedral.
+vec3 DecodeOctahedral(vec2 encoded) {
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-normal.z, 0.0);
+    normal.x += normal.x >= 0.0 ? -fold : fold;
+    normal.y += normal.y >= 0.0 ? -fold : fold;
+    return normalize(normal);
+}
+
+vec3 RotateY(vec3 v) {
+    return vec3(transform.x * v.x + transform.y * v.z, v.y, -transform.y * v.x + transform.x * v.z);
+}
+
+void main() {
+    //Positions are kept quantised relative to the bounding box center, which is all the view needs.
+    vec3 position = RotateY(inPosition.xyz);
+
+    fragNormal = RotateY(DecodeOctahedral(inNormal));
+    fragUv = inUv;
+    gl_Position = vec4(position.x * transform.z, -position.y * transform.w, 0.5, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#version 460
+
+#define PARTICLE_ACCESS readonly
+
+#include "bindless.glsl"
+#include "particles.glsl"
+
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec2 fragOffset;
+
+//Two triangles per particle, expanded from the vertex index without a vertex buffer.
+const vec2 corners[6] = vec2[](
+    vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+    vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0)
+);
+
+void main() {
+    //The draw runs after simulation and reads the list it compacted into.
+    uint index = aliveBuffers[aliveBuffer].items[AliveIndex(1u - current, gl_InstanceIndex)];
+    Particle particle = particleBuffers[particleBuffer].items[index];
+
+    vec2 corner = corners[gl_VertexIndex];
+    float fade = 1.0 - particle.age / particle.lifetime;
+
+    fragColor = unpackUnorm4x8(particle.color) * fade;
+    fragOffset = corner;
+    gl_Position = vec4(particle.position + corner * particle.size * vec2(1.0, aspect), 0.5, 1.0);
+}
@@ -0,0 +1,74 @@
+//Declarations shared by the particle shaders, matching ParticleApplication. Requires bindless.glsl. Vertex shaders
+//define PARTICLE_ACCESS as readonly, the vertex pipeline may not write storage buffers.
+#ifndef PARTICLE_ACCESS
+#define PARTICLE_ACCESS
+#endif
+
+//32 bytes. Age and lifetime are in seconds, color is packed RGBA8.
+struct Particle {
+    vec2 position;
+    vec2 velocity;
+    float age;
+    float lifetime;
+    uint color;
+    float size;
+};
+
+//Matches VkDrawIndirectCommand.
+struct DrawCommand {
+    uint vertexCount;
+    uint instanceCount;
+    uint firstVertex;
+    uint firstInstance;
+};
+
+BINDLESS_BUFFER(PARTICLE_ACCESS, Particle, particleBuffers);
+//Indices of free particles, deadCount of them are valid.
+BINDLESS_BUFFER(PARTICLE_ACCESS, uint, deadListBuffers);
+//Two lists of capacity indices each. Emission appends to the current list, simulation compacts the survivors of the
+//current list into the other one, which is then drawn and becomes the current list of the next frame.
+BINDLESS_BUFFER(PARTICLE_ACCESS, uint, aliveBuffers);
+
+//The instance counts of the draws double as the lengths of the alive lists.
+layout(std430, set = 0, binding = 2) PARTICLE_ACCESS buffer CounterBlock {
+    DrawCommand draws[2];
+    uvec3 simulateGroups;
+    int deadCount;
+} counterBuffers[];
+
+//Shared by every particle shader, buffers are bindless handles.
+layout(push_constant) uniform Particles {
+    uint particleBuffer;
+    uint deadListBuffer;
+    uint aliveBuffer;
+    uint counterBuffer;
+    uint capacity;
+    uint current;
+    uint emitCount;
+    uint seed;
+    float deltaTime;
+    float aspect;
+    //Emitted particles start at a random point of their life instead of at birth, so a full pool dies off evenly.
+    float prewarm;
+    float size;
+    vec2 emitter;
+};
+
+uint AliveIndex(uint list, uint index) {
+    return list * capacity + index;
+}
+
+//Integer hash (Wang), good enough for visual randomness.
+uint Hash(uint value) {
+    value = (value ^ 61u) ^ (value >> 16u);
+    value *= 9u;
+    value ^= value >> 4u;
+    value *= 0x27d4eb2du;
+    value ^= value >> 15u;
+    return value;
+}
+
+float Random(inout uint state) {
+    state = Hash(state);
+    return float(state) * (1.0 / 4294967296.0);
+}
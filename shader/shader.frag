@@ -4,6 +4,9 @@ layout(location = 0) in vec3 fragColor;
 
 layout(location = 0) out vec4 outColor;
 
+//Pipeline variants may specialise this, the default leaves colors unchanged.
+layout(constant_id = 0) const float brightness = 1.0;
+
 void main() {
-    outColor = vec4(fragColor.xyz, 1.0);
+    outColor = vec4(fragColor.xyz * brightness, 1.0);
 }
\ No newline at end of file
@@ -6,23 +6,40 @@
 #include <set>
 #include <algorithm>
 #include <fstream>
+#include <limits>
+#include <chrono>
+#include <filesystem>
 
-Application::Application() :
+#include "StartupGraph.h"
+
+const uint32_t Application::apiVersion = VK_API_VERSION_1_3;
+
+Application::Application(const ApplicationSettings& settings) :
+	startTime(std::chrono::steady_clock::now()),
+	settings(settings),
 	instance(VkInstance{}),
 	window(nullptr),
+	framebufferResized(false),
 	debugMode(false),
 	debugMessenger(VkDebugUtilsMessengerEXT{}),
 	physicalDevice(VK_NULL_HANDLE),
 	device(VK_NULL_HANDLE),
+	graphicsFamilyIndex(0u),
 	gQueue(VK_NULL_HANDLE),
 	surface(VK_NULL_HANDLE),
 	pQueue(VK_NULL_HANDLE),
+	transferFamilyIndex(0u),
+	tQueue(VK_NULL_HANDLE),
+	computeFamilyIndex(0u),
+	cQueue(VK_NULL_HANDLE),
+	asyncComputeQueue(false),
 	swapchain(VK_NULL_HANDLE),
 	swapchainImages({}),
 	swapchainImageFormat(),
 	swapchainExtent(VkExtent2D()),
 	swapchainImageViews({}),
-	renderPass(VK_NULL_HANDLE),
+	offscreenImageAllocations({}),
+	mainPassFormats(),
 	pipelineLayout(VK_NULL_HANDLE),
 	graphicsPipeline(VK_NULL_HANDLE),
 	commandPool(VK_NULL_HANDLE)
@@ -42,46 +59,142 @@ Application::~Application()
 
 void Application::Initialise()
 {
-	CreateWindow();
-	CreateInstance();
-	CreateDebugCallback();
-	CreateSurface();
-	SelectPhysicalDevice();
-	CreateDevice();
-	CreateSwapchain();
-	CreateImageViews();
-	CreateRenderPass();
-	CreateGraphicsPipeline();
-	CreateFramebuffers();
-	CreateCommandPool();
+	//Each step names the steps whose results it uses, everything else runs concurrently. GLFW window calls stay on the
+	//main thread.
+	StartupGraph graph;
+	uint32_t hostAllocatorStep = graph.Add("Host allocator", [this]() { CreateHostAllocator(); });
+	uint32_t windowStep = graph.Add("Window", [this]() { CreateWindow(); }, {}, true);
+	uint32_t instanceStep = graph.Add("Instance", [this]() { CreateInstance(); }, { hostAllocatorStep, windowStep });
+	uint32_t debugCallbackStep = graph.Add("Debug callback", [this]() { CreateDebugCallback(); }, { instanceStep });
+	uint32_t surfaceStep = graph.Add("Surface", [this]() { CreateSurface(); }, { instanceStep, windowStep }, true);
+	uint32_t physicalDeviceStep = graph.Add("Physical device", [this]() { SelectPhysicalDevice(); }, { surfaceStep, debugCallbackStep });
+	uint32_t deviceStep = graph.Add("Device", [this]() { CreateDevice(); }, { physicalDeviceStep });
+	uint32_t memoryAllocatorStep = graph.Add("Memory allocator", [this]() { CreateMemoryAllocator(); }, { deviceStep });
+	uint32_t swapchainStep = graph.Add("Swapchain", [this]() { CreateSwapchain(); }, { deviceStep }, true);
+	uint32_t offscreenTargetsStep = graph.Add("Offscreen targets", [this]() { CreateOffscreenTargets(); }, { swapchainStep, memoryAllocatorStep });
+	graph.Add("Image views", [this]() { CreateImageViews(); }, { offscreenTargetsStep });
+
+	//SPIR-V is compiled or read from the shader cache while the instance and device are created, the pipeline builder
+	//then finds it in memory.
+	uint32_t shaderManagerStep = graph.Add("Shader manager", [this]() { CreateShaderManager(); });
+	std::vector<uint32_t> shaderSteps = { shaderManagerStep };
+	for (const std::string& filename : GetShaderFiles())
+	{
+		shaderSteps.push_back(graph.Add("Load " + filename, [this, filename]() { PreloadShader(filename); }, { shaderManagerStep }));
+	}
+
+	uint32_t pipelineCacheStep = graph.Add("Pipeline cache", [this]() { CreatePipelineCache(); }, { deviceStep });
+	uint32_t layoutCacheStep = graph.Add("Layout cache", [this]() { CreateLayoutCache(); }, { deviceStep });
+	graph.Add("Bindless table", [this]() { CreateBindlessTable(); }, { layoutCacheStep });
+	uint32_t pipelineBuilderStep = graph.Add("Pipeline builder", [this]() { CreatePipelineBuilder(); }, { shaderManagerStep, pipelineCacheStep, layoutCacheStep });
+	//Headless runs set the color format in the offscreen targets instead of the swapchain.
+	uint32_t attachmentFormatsStep = graph.Add("Attachment formats", [this]() { SelectAttachmentFormats(); }, { swapchainStep, offscreenTargetsStep });
+	shaderSteps.push_back(pipelineBuilderStep);
+	shaderSteps.push_back(attachmentFormatsStep);
+	graph.Add("Graphics pipeline", [this]() { CreateGraphicsPipeline(); }, shaderSteps);
+	graph.Add("Command pool", [this]() { CreateCommandPool(); }, { deviceStep });
+	graph.Add("Upload manager", [this]() { CreateUploadManager(); }, { memoryAllocatorStep });
+	graph.Add("Asset archive", [this]() { CreateAssetArchive(); });
+
+	graph.Run();
+	graph.PrintTimings();
+}
+
+void Application::PreloadShader(const std::string& filename)
+{
+	//Scenes that never use the shader should not fail to start because of it, whoever builds a pipeline with it reports the error.
+	try
+	{
+		shaderManager.Load(filename);
+	}
+	catch (const std::exception& exception)
+	{
+		std::cout << "WARNING: Could not preload " << filename << ": " << exception.what();
+	}
+}
+
+std::vector<std::string> Application::GetShaderFiles()
+{
+	const std::set<std::string> stages = { ".vert", ".frag", ".comp", ".geom", ".tesc", ".tese" };
+
+	std::vector<std::string> files;
+	std::error_code error;
+	for (auto& entry : std::filesystem::directory_iterator("shader", error))
+	{
+		if (entry.is_regular_file() && stages.count(entry.path().extension().string()) != 0u)
+		{
+			files.push_back(entry.path().generic_string());
+		}
+	}
+
+	//Directory order is unspecified, sorting keeps the timing output stable between runs.
+	std::sort(files.begin(), files.end());
+	return files;
 }
 
 void Application::Destroy()
 {
+	DestroyAssetArchive();
+	DestroyDeletionQueue();
+	DestroyUploadManager();
 	DestroyCommandPool();
-	DestroyFramebuffers();
-	DestroyGraphicsPipeline();
-	DestroyRenderPass();
+	DestroyPipelineBuilder();
+	DestroyBindlessTable();
+	DestroyLayoutCache();
+	DestroyPipelineCache();
 	DestroyImageViews();
+	DestroyOffscreenTargets();
 	DestroySwapchain();
+	DestroyMemoryAllocator();
 	DestroyDevice();
 	DestroySurface();
 	DestroyDebugCallback();
 	DestroyInstance();
 	DestroyWindow();
+	DestroyHostAllocator();
+}
+
+void Application::CreateHostAllocator()
+{
+	hostAllocator.Create();
+}
+
+void Application::DestroyHostAllocator()
+{
+	hostAllocator.Destroy();
 }
 
 void Application::CreateWindow()
 {
+	if (settings.headless)
+	{
+		return;
+	}
+
 	glfwInit();
 
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
-	window = glfwCreateWindow(800, 600, "Vulkan Application", nullptr, nullptr);
+	glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+	window = glfwCreateWindow(static_cast<int>(settings.width), static_cast<int>(settings.height), "Vulkan Application", nullptr, nullptr);
+
+	glfwSetWindowUserPointer(window, this);
+	glfwSetFramebufferSizeCallback(window, &FramebufferResizeCallback);
+}
+
+void Application::FramebufferResizeCallback(GLFWwindow* window, int width, int height)
+{
+	//Not every platform reports resizes through out of date swapchains, so the size change is tracked here as well.
+	auto application = static_cast<Application*>(glfwGetWindowUserPointer(window));
+	application->framebufferResized = true;
 }
 
 void Application::DestroyWindow()
 {
+	if (settings.headless)
+	{
+		return;
+	}
+
 	glfwDestroyWindow(window);
 	glfwTerminate();
 }
@@ -94,6 +207,7 @@ void Application::CreateInstance()
 	appInfo.applicationVersion = 0u;
 	appInfo.pEngineName = "hpe";
 	appInfo.engineVersion = 0u;
+	appInfo.apiVersion = apiVersion;
 
 	VkInstanceCreateInfo instanceInfo{};
 	instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -113,7 +227,7 @@ void Application::CreateInstance()
 	instanceInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
 	instanceInfo.ppEnabledExtensionNames = extensions.data();
 
-	VkResult result = vkCreateInstance(&instanceInfo, nullptr, &instance);
+	VkResult result = vkCreateInstance(&instanceInfo, hostAllocator.Get(VK_OBJECT_TYPE_INSTANCE), &instance);
 	if (result != VK_SUCCESS)
 	{
 		throw std::runtime_error("ERROR: Failed to create instance.\n");
@@ -122,7 +236,7 @@ void Application::CreateInstance()
 
 void Application::DestroyInstance()
 {
-	vkDestroyInstance(instance, nullptr);
+	vkDestroyInstance(instance, hostAllocator.Get(VK_OBJECT_TYPE_INSTANCE));
 }
 
 std::vector<const char*> Application::GetInstanceLayers()
@@ -209,13 +323,18 @@ std::vector<VkExtensionProperties> Application::GetSupportedInstanceExtensions()
 
 std::vector<const char*> Application::GetRequestedInstanceExtensions()
 {
-	//GLFW requires some extensions.
-	uint32_t glfwExtensionCount = 0u;
-	const char** glfwExtensions = nullptr;
+	std::vector<const char*> extensions;
+
+	//GLFW requires some extensions. Headless mode has no window, so it needs none of them.
+	if (!settings.headless)
+	{
+		uint32_t glfwExtensionCount = 0u;
+		const char** glfwExtensions = nullptr;
 
-	glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
-	std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+		extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+	}
 
 	if (debugMode)
 	{
@@ -290,7 +409,12 @@ void Application::ProxyDestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebu
 
 void Application::CreateSurface()
 {
-	if (glfwCreateWindowSurface(instance,window,nullptr,&surface) != VK_SUCCESS)
+	if (settings.headless)
+	{
+		return;
+	}
+
+	if (glfwCreateWindowSurface(instance,window,hostAllocator.Get(VK_OBJECT_TYPE_SURFACE_KHR),&surface) != VK_SUCCESS)
 	{
 		throw std::runtime_error("ERROR: Could not create surface.\n");
 	}
@@ -298,12 +422,26 @@ void Application::CreateSurface()
 
 void Application::DestroySurface()
 {
-	vkDestroySurfaceKHR(instance, surface, nullptr);
+	if (settings.headless)
+	{
+		return;
+	}
+
+	vkDestroySurfaceKHR(instance, surface, hostAllocator.Get(VK_OBJECT_TYPE_SURFACE_KHR));
 }
 
 void Application::SelectPhysicalDevice()
 {
-	//Select first discrete GPU with adequate extensions and properties that found.
+	//Select first suitable device of the most preferred type. Discrete GPUs come first, CPU implementations such as lavapipe last.
+	const std::map<VkPhysicalDeviceType, int> typeRanks = {
+		{ VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 0 },
+		{ VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU, 1 },
+		{ VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU, 2 },
+		{ VK_PHYSICAL_DEVICE_TYPE_CPU, 3 },
+		{ VK_PHYSICAL_DEVICE_TYPE_OTHER, 4 }
+	};
+	int selectedRank = std::numeric_limits<int>::max();
+
 	std::vector<VkPhysicalDevice> devices = GetPhysicalDevices();
 
 	for (auto& candicateDevice : devices)
@@ -316,8 +454,16 @@ void Application::SelectPhysicalDevice()
 
 		std::cout << "INFO: Checking " << deviceProperties.deviceName << " for suitability.\n";
 		
-		if (!(deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU))
+		auto rank = typeRanks.find(deviceProperties.deviceType);
+		if (rank == typeRanks.end() || rank->second >= selectedRank)
+		{
+			continue;
+		}
+
+		//Core functionality of apiVersion is used without checking for extensions.
+		if (deviceProperties.apiVersion < apiVersion)
 		{
+			std::cout << "INFO: " << deviceProperties.deviceName << " does not support the required Vulkan version.\n";
 			continue;
 		}
 
@@ -327,21 +473,30 @@ void Application::SelectPhysicalDevice()
 			continue;
 		}
 
+		//Device features.
+		if (!QueryDeviceFeatures(candicateDevice, deviceProperties.deviceName))
+		{
+			continue;
+		}
+
 		//Swapchain properties. NOTE: Swapchain support already queried above.
-		if (!QuerySwapchainProperties(candicateDevice))
+		if (!settings.headless && !QuerySwapchainProperties(candicateDevice))
 		{
 			continue;
 		}
 
 		physicalDevice = candicateDevice;
-		std::cout << "INFO: " << deviceProperties.deviceName << " is selected.\n";
-		break;
+		selectedRank = rank->second;
 	}
 
 	if (physicalDevice == VK_NULL_HANDLE)
 	{
-		throw std::runtime_error("ERROR: There is no appropriate physical device found.\n");
+		throw std::runtime_error("ERROR: There is no appropriate physical device found for the " + settings.scene + " scene.\n");
 	}
+
+	VkPhysicalDeviceProperties selectedProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &selectedProperties);
+	std::cout << "INFO: " << selectedProperties.deviceName << " is selected.\n";
 }
 
 bool Application::QueryDeviceExtensions(VkPhysicalDevice device, std::string deviceName)
@@ -373,6 +528,62 @@ bool Application::QueryDeviceExtensions(VkPhysicalDevice device, std::string dev
 	return suitable;
 }
 
+bool Application::QueryDeviceFeatures(VkPhysicalDevice device, std::string deviceName)
+{
+	VkPhysicalDeviceVulkan13Features features13{};
+	features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+
+	VkPhysicalDeviceVulkan12Features features12{};
+	features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	features12.pNext = &features13;
+
+	VkPhysicalDeviceFeatures2 features{};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &features12;
+	vkGetPhysicalDeviceFeatures2(device, &features);
+
+	if (features12.timelineSemaphore != VK_TRUE)
+	{
+		std::cout << "INFO: " << deviceName << " does not support timeline semaphores.\n";
+		return false;
+	}
+
+	if (features12.hostQueryReset != VK_TRUE)
+	{
+		std::cout << "INFO: " << deviceName << " does not support host query reset.\n";
+		return false;
+	}
+
+	if (settings.SceneUsesIndirectCount() && (features12.drawIndirectCount != VK_TRUE || features.features.multiDrawIndirect != VK_TRUE))
+	{
+		std::cout << "INFO: " << deviceName << " does not support indirect draw count, the " << settings.scene << " scene needs it.\n";
+		return false;
+	}
+
+	if (settings.SceneUsesBindless() && (features12.runtimeDescriptorArray != VK_TRUE || features12.descriptorBindingPartiallyBound != VK_TRUE ||
+		features12.shaderSampledImageArrayNonUniformIndexing != VK_TRUE || features12.shaderStorageBufferArrayNonUniformIndexing != VK_TRUE ||
+		features12.descriptorBindingSampledImageUpdateAfterBind != VK_TRUE || features12.descriptorBindingStorageBufferUpdateAfterBind != VK_TRUE ||
+		features12.descriptorBindingUpdateUnusedWhilePending != VK_TRUE))
+	{
+		std::cout << "INFO: " << deviceName << " does not support descriptor indexing, the " << settings.scene << " scene needs it.\n";
+		return false;
+	}
+
+	if (features13.synchronization2 != VK_TRUE)
+	{
+		std::cout << "INFO: " << deviceName << " does not support synchronization2.\n";
+		return false;
+	}
+
+	if (features13.dynamicRendering != VK_TRUE)
+	{
+		std::cout << "INFO: " << deviceName << " does not support dynamic rendering.\n";
+		return false;
+	}
+
+	return true;
+}
+
 std::vector<VkPhysicalDevice> Application::GetPhysicalDevices()
 {
 	uint32_t deviceCount = 0u;
@@ -401,13 +612,38 @@ std::vector<VkExtensionProperties> Application::GetSupportedDeviceExtensions(VkP
 
 std::vector<const char*> Application::GetRequestedDeviceExtensions()
 {
-	std::vector<const char*> requested = {
-		"VK_KHR_swapchain"
-	};
+	std::vector<const char*> requested;
+
+	//Presentation is only needed when there is a window.
+	if (!settings.headless)
+	{
+		requested.push_back("VK_KHR_swapchain");
+	}
 
 	return requested;
 }
 
+std::vector<const char*> Application::GetOptionalDeviceExtensions()
+{
+	//Enabled when supported, features built on them fall back otherwise.
+	std::vector<const char*> optional = {
+		"VK_EXT_calibrated_timestamps"
+	};
+
+	if (!settings.headless)
+	{
+		optional.push_back("VK_KHR_present_id");
+		optional.push_back("VK_KHR_present_wait");
+	}
+
+	return optional;
+}
+
+bool Application::IsDeviceExtensionEnabled(const std::string& name) const
+{
+	return enabledDeviceExtensions.count(name) != 0u;
+}
+
 bool Application::QuerySwapchainProperties(VkPhysicalDevice device)
 {
 	bool suitable = true;
@@ -446,38 +682,122 @@ bool Application::QuerySwapchainProperties(VkPhysicalDevice device)
 
 void Application::CreateDevice()
 {
-	uint32_t graphicsFamilyIndex = GetQueueFamilyIndex(physicalDevice, VK_QUEUE_GRAPHICS_BIT);
-	uint32_t presentationFamilyIndex = GetQueueFamilyIndex(physicalDevice, VK_QUEUE_FLAG_BITS_MAX_ENUM);
+	graphicsFamilyIndex = GetQueueFamilyIndex(physicalDevice, VK_QUEUE_GRAPHICS_BIT);
+	//Headless mode never presents, graphics queue stands in for the presentation queue.
+	uint32_t presentationFamilyIndex = settings.headless ? graphicsFamilyIndex : GetQueueFamilyIndex(physicalDevice, VK_QUEUE_FLAG_BITS_MAX_ENUM);
+	transferFamilyIndex = GetTransferQueueFamilyIndex(physicalDevice);
 	
-	std::set<uint32_t> uniqueQueueFamilies = { graphicsFamilyIndex,presentationFamilyIndex };
+	std::set<uint32_t> uniqueQueueFamilies = { graphicsFamilyIndex,presentationFamilyIndex,transferFamilyIndex };
+
+	//Every other queue is the first of its family, the compute queue may be the second one.
+	std::map<uint32_t, uint32_t> queueCounts;
+	for (auto& queueFamily : uniqueQueueFamilies)
+	{
+		queueCounts[queueFamily] = 1u;
+	}
 
-	float queuePriority = 1.f;
+	uint32_t computeQueueIndex = 0u;
+	asyncComputeQueue = settings.asyncCompute && GetComputeQueue(physicalDevice, uniqueQueueFamilies, computeFamilyIndex, computeQueueIndex);
+	if (asyncComputeQueue)
+	{
+		queueCounts[computeFamilyIndex] = computeQueueIndex + 1u;
+	}
+	else
+	{
+		computeFamilyIndex = graphicsFamilyIndex;
+	}
+
+	const float queuePriorities[] = { 1.f, 1.f };
 
 	std::vector<VkDeviceQueueCreateInfo> queueInfos;
-	for (auto& queueFamily : uniqueQueueFamilies)
+	for (auto& [queueFamily, queueCount] : queueCounts)
 	{
 		VkDeviceQueueCreateInfo info{};
 		info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
 		info.queueFamilyIndex = queueFamily;
-		info.queueCount = 1;
-		info.pQueuePriorities = &queuePriority;
+		info.queueCount = queueCount;
+		info.pQueuePriorities = queuePriorities;
 		
 		queueInfos.push_back(info);
 	}
 
 	VkPhysicalDeviceFeatures features{};
+	features.multiDrawIndirect = settings.SceneUsesIndirectCount() ? VK_TRUE : VK_FALSE;
+
+	//Newer core features are enabled through the pNext chain.
+	VkPhysicalDeviceVulkan13Features features13{};
+	features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+	features13.synchronization2 = VK_TRUE;
+	features13.dynamicRendering = VK_TRUE;
+
+	VkPhysicalDeviceVulkan12Features features12{};
+	features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	features12.pNext = &features13;
+	features12.timelineSemaphore = VK_TRUE;
+	features12.hostQueryReset = VK_TRUE;
+	features12.drawIndirectCount = settings.SceneUsesIndirectCount() ? VK_TRUE : VK_FALSE;
+	//Descriptor indexing for the bindless table.
+	VkBool32 bindless = settings.SceneUsesBindless() ? VK_TRUE : VK_FALSE;
+	features12.runtimeDescriptorArray = bindless;
+	features12.descriptorBindingPartiallyBound = bindless;
+	features12.shaderSampledImageArrayNonUniformIndexing = bindless;
+	features12.shaderStorageBufferArrayNonUniformIndexing = bindless;
+	features12.descriptorBindingSampledImageUpdateAfterBind = bindless;
+	features12.descriptorBindingStorageBufferUpdateAfterBind = bindless;
+	features12.descriptorBindingUpdateUnusedWhilePending = bindless;
 
 	std::vector<const char*> extensions = GetRequestedDeviceExtensions();
+	std::vector<VkExtensionProperties> supportedExtensions = GetSupportedDeviceExtensions(physicalDevice);
+	for (auto& optional : GetOptionalDeviceExtensions())
+	{
+		for (auto& supported : supportedExtensions)
+		{
+			if (std::string(supported.extensionName) == optional)
+			{
+				extensions.push_back(optional);
+				break;
+			}
+		}
+	}
+	enabledDeviceExtensions = std::set<std::string>(extensions.begin(), extensions.end());
+
+	//Present wait is only useful together with present ids, and both need their feature bit.
+	VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+	presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+
+	VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+	presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+	presentIdFeatures.pNext = &presentWaitFeatures;
+
+	if (IsDeviceExtensionEnabled("VK_KHR_present_id") && IsDeviceExtensionEnabled("VK_KHR_present_wait"))
+	{
+		VkPhysicalDeviceFeatures2 supportedFeatures{};
+		supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supportedFeatures.pNext = &presentIdFeatures;
+		vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures);
+	}
+
+	if (presentIdFeatures.presentId == VK_TRUE && presentWaitFeatures.presentWait == VK_TRUE)
+	{
+		features13.pNext = &presentIdFeatures;
+	}
+	else
+	{
+		std::erase_if(extensions, [](const char* name) { return std::string(name) == "VK_KHR_present_id" || std::string(name) == "VK_KHR_present_wait"; });
+		enabledDeviceExtensions.erase("VK_KHR_present_id");
+		enabledDeviceExtensions.erase("VK_KHR_present_wait");
+	}
 
 	VkDeviceCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	createInfo.pNext = &features12;
 	createInfo.pQueueCreateInfos = queueInfos.data();
 	createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueInfos.size());
 	createInfo.pEnabledFeatures = &features;
 	createInfo.ppEnabledExtensionNames = extensions.data();
-	createInfo.enabledExtensionCount = 1u;
+	createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
 
-	VkResult result = vkCreateDevice(physicalDevice, &createInfo, nullptr, &device);
+	VkResult result = vkCreateDevice(physicalDevice, &createInfo, hostAllocator.Get(VK_OBJECT_TYPE_DEVICE), &device);
 	if (result != VK_SUCCESS)
 	{
 		throw std::runtime_error("ERROR: Could not create device.");
@@ -485,11 +805,22 @@ void Application::CreateDevice()
 
 	vkGetDeviceQueue(device, graphicsFamilyIndex, 0, &gQueue);
 	vkGetDeviceQueue(device, presentationFamilyIndex, 0, &pQueue);
+	vkGetDeviceQueue(device, transferFamilyIndex, 0, &tQueue);
+	if (asyncComputeQueue)
+	{
+		vkGetDeviceQueue(device, computeFamilyIndex, computeQueueIndex, &cQueue);
+		std::cout << "INFO: Async compute runs on queue " << computeQueueIndex << " of family " << computeFamilyIndex << ".\n";
+	}
+	else
+	{
+		cQueue = gQueue;
+		std::cout << "INFO: Async compute is not available, compute work runs on the graphics queue.\n";
+	}
 }
 
 void Application::DestroyDevice()
 {
-	vkDestroyDevice(device, nullptr);
+	vkDestroyDevice(device, hostAllocator.Get(VK_OBJECT_TYPE_DEVICE));
 }
 
 uint32_t Application::GetQueueFamilyIndex(VkPhysicalDevice device, VkQueueFlagBits bit)
@@ -528,6 +859,57 @@ uint32_t Application::GetQueueFamilyIndex(VkPhysicalDevice device, VkQueueFlagBi
 	throw std::runtime_error("ERROR: Queue family could not found.\n");
 }
 
+uint32_t Application::GetTransferQueueFamilyIndex(VkPhysicalDevice device)
+{
+	std::vector<VkQueueFamilyProperties> families = GetQueueFamilies(device);
+
+	//Transfer only families map to copy engines that run beside rendering. Compute families without graphics come second.
+	const VkQueueFlags excludedFlags[] = { VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT };
+	for (VkQueueFlags excluded : excludedFlags)
+	{
+		for (uint32_t index = 0; index < static_cast<uint32_t>(families.size()); index++)
+		{
+			if ((families[index].queueFlags & VK_QUEUE_TRANSFER_BIT) && !(families[index].queueFlags & excluded))
+			{
+				return index;
+			}
+		}
+	}
+
+	//Graphics queues always support transfers.
+	return graphicsFamilyIndex;
+}
+
+bool Application::GetComputeQueue(VkPhysicalDevice device, const std::set<uint32_t>& usedFamilies, uint32_t& familyIndex, uint32_t& queueIndex)
+{
+	std::vector<VkQueueFamilyProperties> families = GetQueueFamilies(device);
+
+	//Compute only families map to the asynchronous compute engines. A second queue of a graphics family comes second,
+	//it still gets its own submissions scheduled beside the graphics queue.
+	const bool graphicsFamily[] = { false, true };
+	for (bool graphics : graphicsFamily)
+	{
+		for (uint32_t index = 0; index < static_cast<uint32_t>(families.size()); index++)
+		{
+			const VkQueueFamilyProperties& family = families[index];
+			if (!(family.queueFlags & VK_QUEUE_COMPUTE_BIT) || static_cast<bool>(family.queueFlags & VK_QUEUE_GRAPHICS_BIT) != graphics)
+			{
+				continue;
+			}
+
+			uint32_t firstFree = usedFamilies.count(index) ? 1u : 0u;
+			if (firstFree < family.queueCount)
+			{
+				familyIndex = index;
+				queueIndex = firstFree;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
 std::vector<VkQueueFamilyProperties> Application::GetQueueFamilies(VkPhysicalDevice device)
 {
 	uint32_t queueFamilyCount = 0u;
@@ -539,8 +921,23 @@ std::vector<VkQueueFamilyProperties> Application::GetQueueFamilies(VkPhysicalDev
 	return queueFamilies;
 }
 
+void Application::CreateMemoryAllocator()
+{
+	memoryAllocator.Create(physicalDevice, device, &hostAllocator);
+}
+
+void Application::DestroyMemoryAllocator()
+{
+	memoryAllocator.Destroy();
+}
+
 void Application::CreateSwapchain()
 {
+	if (settings.headless)
+	{
+		return;
+	}
+
 	VkSurfaceCapabilitiesKHR capabilities{};
 	std::vector<VkSurfaceFormatKHR> formats;
 	std::vector<VkPresentModeKHR> presentModes;
@@ -559,7 +956,7 @@ void Application::CreateSwapchain()
 	uint32_t presentModeCount = 0u;
 	vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &presentModeCount, nullptr);
 
-	if (formatCount != 0u)
+	if (presentModeCount != 0u)
 	{
 		presentModes.resize(presentModeCount);
 		vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &presentModeCount, presentModes.data());
@@ -569,7 +966,15 @@ void Application::CreateSwapchain()
 	VkPresentModeKHR presentMode = ChooseSwapchainPresentationMode(presentModes);
 	VkExtent2D extent = ChooseSwapchainExtend(capabilities);
 
-	uint32_t desiredImageCount = capabilities.minImageCount + 2;
+	//Fewer images lower latency, more images absorb frame time spikes.
+	uint32_t desiredImageCount = settings.swapchainImageCount != 0u ? settings.swapchainImageCount : capabilities.minImageCount + 2;
+	uint32_t maxImageCount = capabilities.maxImageCount != 0u ? capabilities.maxImageCount : std::numeric_limits<uint32_t>::max();
+	uint32_t clampedImageCount = std::clamp(desiredImageCount, capabilities.minImageCount, maxImageCount);
+	if (settings.swapchainImageCount != 0u && clampedImageCount != desiredImageCount)
+	{
+		std::cout << "WARNING: Surface supports " << capabilities.minImageCount << " to " << maxImageCount << " swapchain images, using " << clampedImageCount << ".\n";
+	}
+	desiredImageCount = clampedImageCount;
 
 	VkSwapchainCreateInfoKHR info{};
 	info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -590,9 +995,10 @@ void Application::CreateSwapchain()
 	info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 	info.presentMode = presentMode;
 	info.clipped = VK_TRUE;
-	info.oldSwapchain = VK_NULL_HANDLE;
+	//Current swapchain, if any, hands its resources over to the new one.
+	info.oldSwapchain = swapchain;
 
-	if (vkCreateSwapchainKHR(device,&info,nullptr,&swapchain) != VK_SUCCESS)
+	if (vkCreateSwapchainKHR(device,&info,hostAllocator.Get(VK_OBJECT_TYPE_SWAPCHAIN_KHR),&swapchain) != VK_SUCCESS)
 	{
 		throw std::runtime_error("ERROR: Failed to create swapchain.\n");
 	}
@@ -610,7 +1016,195 @@ void Application::CreateSwapchain()
 
 void Application::DestroySwapchain()
 {
-	vkDestroySwapchainKHR(device, swapchain, nullptr);
+	if (settings.headless)
+	{
+		return;
+	}
+
+	vkDestroySwapchainKHR(device, swapchain, hostAllocator.Get(VK_OBJECT_TYPE_SWAPCHAIN_KHR));
+}
+
+void Application::RecreateSwapchain(uint64_t retireValue)
+{
+	//Minimised windows have no area to present to, wait until the window is restored.
+	int width = 0;
+	int height = 0;
+	glfwGetFramebufferSize(window, &width, &height);
+	while ((width == 0 || height == 0) && !glfwWindowShouldClose(window))
+	{
+		glfwWaitEvents();
+		glfwGetFramebufferSize(window, &width, &height);
+	}
+	framebufferResized = false;
+
+	VkSwapchainKHR oldSwapchain = swapchain;
+	VkFormat oldFormat = swapchainImageFormat;
+	std::vector<VkImageView> oldImageViews;
+	oldImageViews.swap(swapchainImageViews);
+
+	CreateSwapchain();
+
+	//Pipelines are kept, the surface format must not change underneath them.
+	if (swapchainImageFormat != oldFormat)
+	{
+		throw std::runtime_error("ERROR: Swapchain format changed during recreation.\n");
+	}
+
+	CreateImageViews();
+
+	//Frames up to retireValue may still render into or present the old images.
+	VkDevice device = this->device;
+	const VkAllocationCallbacks* swapchainCallbacks = hostAllocator.Get(VK_OBJECT_TYPE_SWAPCHAIN_KHR);
+	const VkAllocationCallbacks* imageViewCallbacks = hostAllocator.Get(VK_OBJECT_TYPE_IMAGE_VIEW);
+	deletionQueue.Push(retireValue, [device, oldSwapchain, oldImageViews, swapchainCallbacks, imageViewCallbacks]()
+	{
+		for (auto imageView : oldImageViews)
+		{
+			vkDestroyImageView(device, imageView, imageViewCallbacks);
+		}
+		vkDestroySwapchainKHR(device, oldSwapchain, swapchainCallbacks);
+	});
+}
+
+void Application::CreateOffscreenTargets()
+{
+	if (!settings.headless)
+	{
+		return;
+	}
+
+	//Offscreen images take the place of swapchain images so that image views and recording are shared with windowed mode.
+	const uint32_t imageCount = 3u;
+
+	swapchainImageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+	swapchainExtent = { settings.width, settings.height };
+	swapchainImages.resize(imageCount);
+	offscreenImageAllocations.resize(imageCount);
+
+	for (uint32_t i = 0; i < imageCount; i++)
+	{
+		VkImageCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		info.imageType = VK_IMAGE_TYPE_2D;
+		info.format = swapchainImageFormat;
+		info.extent = { swapchainExtent.width, swapchainExtent.height, 1u };
+		info.mipLevels = 1;
+		info.arrayLayers = 1;
+		info.samples = VK_SAMPLE_COUNT_1_BIT;
+		info.tiling = VK_IMAGE_TILING_OPTIMAL;
+		info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		memoryAllocator.CreateImage(info, MemoryUsage::GpuOnly, swapchainImages[i], offscreenImageAllocations[i]);
+	}
+}
+
+void Application::DestroyOffscreenTargets()
+{
+	if (!settings.headless)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < swapchainImages.size(); i++)
+	{
+		memoryAllocator.DestroyImage(swapchainImages[i], offscreenImageAllocations[i]);
+	}
+}
+
+std::vector<uint8_t> Application::ReadbackOffscreenImage(uint32_t imageIndex)
+{
+	if (!settings.headless)
+	{
+		throw std::runtime_error("ERROR: Offscreen images only exist in headless mode.\n");
+	}
+
+	VkDeviceSize size = static_cast<VkDeviceSize>(swapchainExtent.width) * swapchainExtent.height * 4u;
+
+	//Host visible staging buffer that receives the image.
+	VkBuffer buffer = VK_NULL_HANDLE;
+	Allocation allocation{};
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	memoryAllocator.CreateBuffer(bufferInfo, MemoryUsage::Readback, buffer, allocation);
+
+	//Final state of the backbuffer in the headless render graph leaves offscreen images in TRANSFER_SRC_OPTIMAL.
+	VkCommandBufferAllocateInfo commandBufferInfo{};
+	commandBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	commandBufferInfo.commandPool = commandPool;
+	commandBufferInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	commandBufferInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	if (vkAllocateCommandBuffers(device, &commandBufferInfo, &commandBuffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not allocate readback command buffer.\n");
+	}
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+	VkBufferImageCopy region{};
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.layerCount = 1;
+	region.imageExtent = { swapchainExtent.width, swapchainExtent.height, 1u };
+	vkCmdCopyImageToBuffer(commandBuffer, swapchainImages[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1, &region);
+
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	vkEndCommandBuffer(commandBuffer);
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+
+	if (vkQueueSubmit(gQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not submit readback.\n");
+	}
+	vkQueueWaitIdle(gQueue);
+
+	std::vector<uint8_t> pixels(static_cast<size_t>(size));
+
+	std::copy_n(static_cast<const uint8_t*>(allocation.mapped), pixels.size(), pixels.data());
+
+	vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+	memoryAllocator.DestroyBuffer(buffer, allocation);
+
+	return pixels;
+}
+
+void Application::SaveOffscreenImage(uint32_t imageIndex, const std::string& filename)
+{
+	std::vector<uint8_t> pixels = ReadbackOffscreenImage(imageIndex);
+
+	std::ofstream file(filename, std::ios::binary);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("ERROR: Failed to open file: " + filename + "\n");
+	}
+
+	//Binary PPM, alpha channel is dropped.
+	file << "P6\n" << swapchainExtent.width << " " << swapchainExtent.height << "\n255\n";
+	for (size_t i = 0; i < pixels.size(); i += 4)
+	{
+		file.write(reinterpret_cast<const char*>(&pixels[i]), 3);
+	}
+
+	std::cout << "INFO: Saved offscreen image to " << filename << ".\n";
 }
 
 VkSurfaceFormatKHR Application::ChooseSwapchainSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& formats)
@@ -628,14 +1222,26 @@ VkSurfaceFormatKHR Application::ChooseSwapchainSurfaceFormat(const std::vector<V
 
 VkPresentModeKHR Application::ChooseSwapchainPresentationMode(const std::vector<VkPresentModeKHR>& presentModes)
 {
-	for (auto& presentMode : presentModes)
+	const std::map<std::string, VkPresentModeKHR> modes = {
+		{ "immediate", VK_PRESENT_MODE_IMMEDIATE_KHR },
+		{ "mailbox", VK_PRESENT_MODE_MAILBOX_KHR },
+		{ "fifo", VK_PRESENT_MODE_FIFO_KHR },
+		{ "fifo-relaxed", VK_PRESENT_MODE_FIFO_RELAXED_KHR }
+	};
+
+	auto requested = modes.find(settings.presentMode);
+	if (requested == modes.end())
 	{
-		if (presentMode == VK_PRESENT_MODE_MAILBOX_KHR)
-		{
-			return presentMode;
-		}
+		throw std::runtime_error("ERROR: Unknown present mode: " + settings.presentMode + "\n");
 	}
 
+	if (std::find(presentModes.begin(), presentModes.end(), requested->second) != presentModes.end())
+	{
+		return requested->second;
+	}
+
+	//FIFO is the only mode every surface supports.
+	std::cout << "WARNING: Present mode " << settings.presentMode << " is not supported, using fifo.\n";
 	return VK_PRESENT_MODE_FIFO_KHR;
 }
 
@@ -683,7 +1289,7 @@ void Application::CreateImageViews()
 		info.subresourceRange.baseArrayLayer = 0;
 		info.subresourceRange.layerCount = 1;
 
-		VkResult result = vkCreateImageView(device, &info, nullptr, &swapchainImageViews[i]);
+		VkResult result = vkCreateImageView(device, &info, hostAllocator.Get(VK_OBJECT_TYPE_IMAGE_VIEW), &swapchainImageViews[i]);
 		if (result != VK_SUCCESS)
 		{
 			throw std::runtime_error("ERROR: Could not create ImageView.\n");
@@ -695,260 +1301,162 @@ void Application::DestroyImageViews()
 {
 	for (size_t i = 0; i < swapchainImageViews.size(); i++)
 	{
-		vkDestroyImageView(device, swapchainImageViews[i], nullptr);
+		vkDestroyImageView(device, swapchainImageViews[i], hostAllocator.Get(VK_OBJECT_TYPE_IMAGE_VIEW));
 	}
 }
 
-void Application::CreateRenderPass()
+void Application::CreateShaderManager()
 {
-	VkAttachmentDescription colorAttachment{};
-	colorAttachment.format = swapchainImageFormat;
-	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-	VkAttachmentReference colorAttachmentRef{};
-	colorAttachmentRef.attachment = 0;
-	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VkSubpassDescription subpass{};
-	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass.colorAttachmentCount = 1;
-	subpass.pColorAttachments = &colorAttachmentRef;
-
-	VkRenderPassCreateInfo renderPassCreateInfo{};
-	renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassCreateInfo.attachmentCount = 1;
-	renderPassCreateInfo.pAttachments = &colorAttachment;
-	renderPassCreateInfo.subpassCount = 1;
-	renderPassCreateInfo.pSubpasses = &subpass;
-
-	if (vkCreateRenderPass(device,&renderPassCreateInfo,nullptr,&renderPass) != VK_SUCCESS)
-	{
-		throw std::runtime_error("ERROR: Could not create render pass.\n");
-	}
+	shaderManager.Create(settings.shaderCachePath, apiVersion, debugMode);
+	shaderManager.AddIncludeDirectory("shader");
 }
 
-void Application::DestroyRenderPass()
+void Application::CreatePipelineCache()
 {
-	vkDestroyRenderPass(device, renderPass, nullptr);
+	pipelineCache.Create(device, &hostAllocator, physicalDevice, settings.pipelineCachePath);
 }
 
-void Application::CreateGraphicsPipeline()
+void Application::DestroyPipelineCache()
 {
-	auto vertexShaderCode = ReadFile("shader/vert.spv");
-	auto fragmentShaderCode = ReadFile("shader/frag.spv");
-
-	VkShaderModule vShaderModule = CreateShaderModule(vertexShaderCode);
-	VkShaderModule fShaderModule = CreateShaderModule(fragmentShaderCode);
-
-	VkPipelineShaderStageCreateInfo vShaderStage{};
-	vShaderStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	vShaderStage.stage = VK_SHADER_STAGE_VERTEX_BIT;
-	vShaderStage.module = vShaderModule;
-	vShaderStage.pName = "main";
-
-	VkPipelineShaderStageCreateInfo fShaderStage{};
-	fShaderStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	fShaderStage.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	fShaderStage.module = fShaderModule;
-	fShaderStage.pName = "main";
+	pipelineCache.Destroy();
+}
 
-	VkPipelineShaderStageCreateInfo shaderStages[2] = { vShaderStage,fShaderStage };
+void Application::CreateLayoutCache()
+{
+	layoutCache.Create(device, &hostAllocator);
+}
 
-	std::vector<VkDynamicState> dynamicStates = {
-		VK_DYNAMIC_STATE_VIEWPORT,
-		VK_DYNAMIC_STATE_SCISSOR
-	};
+void Application::DestroyLayoutCache()
+{
+	layoutCache.Destroy();
+}
 
-	VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo{};
-	dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-	dynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
-	dynamicStateCreateInfo.pDynamicStates = dynamicStates.data();
-
-	VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo{};
-	vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputCreateInfo.vertexBindingDescriptionCount = 0;
-	vertexInputCreateInfo.vertexAttributeDescriptionCount = 0;
-
-	VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo{};
-	inputAssemblyCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	inputAssemblyCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-	inputAssemblyCreateInfo.primitiveRestartEnable = VK_FALSE;
-
-	VkPipelineViewportStateCreateInfo viewportState{};
-	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-	viewportState.viewportCount = 1;
-	viewportState.scissorCount = 1;
-
-	VkPipelineRasterizationStateCreateInfo rasterizerCreateInfo{};
-	rasterizerCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-	rasterizerCreateInfo.depthClampEnable = VK_FALSE;
-	rasterizerCreateInfo.rasterizerDiscardEnable = VK_FALSE;
-	rasterizerCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;
-	rasterizerCreateInfo.lineWidth = 1.f;
-	rasterizerCreateInfo.cullMode = VK_CULL_MODE_BACK_BIT;
-	rasterizerCreateInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
-	rasterizerCreateInfo.depthBiasEnable = VK_FALSE;
-
-	VkPipelineMultisampleStateCreateInfo multisamplingCreateInfo{};
-	multisamplingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-	multisamplingCreateInfo.sampleShadingEnable = VK_FALSE;
-	multisamplingCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-
-	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-	colorBlendAttachment.blendEnable = VK_FALSE;
-
-	VkPipelineColorBlendStateCreateInfo colorBlending{};
-	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-	colorBlending.logicOpEnable = VK_FALSE;
-	colorBlending.logicOp = VK_LOGIC_OP_COPY;
-	colorBlending.attachmentCount = 1;
-	colorBlending.pAttachments = &colorBlendAttachment;
-	colorBlending.blendConstants[0] = 0.0f;
-	colorBlending.blendConstants[1] = 0.0f;
-	colorBlending.blendConstants[2] = 0.0f;
-	colorBlending.blendConstants[3] = 0.0f;
-
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 0;
-	pipelineLayoutInfo.pushConstantRangeCount = 0;
-
-	VkResult result = vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout);
-	if (result != VK_SUCCESS)
+void Application::CreateBindlessTable()
+{
+	//Without descriptor indexing enabled the table cannot be created, scenes that use it require the features.
+	if (!settings.SceneUsesBindless())
 	{
-		throw std::runtime_error("ERROR: Could not create pipeline layout.\n");
+		return;
 	}
 
-	VkGraphicsPipelineCreateInfo pipelineCreateInfo{};
-	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	pipelineCreateInfo.stageCount = 2;
-	pipelineCreateInfo.pStages = shaderStages;
+	bindlessTable.Create(physicalDevice, device, &hostAllocator, &layoutCache, 1u << 16, 1u << 8, 1u << 16);
+}
 
-	pipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;
-	pipelineCreateInfo.pInputAssemblyState = &inputAssemblyCreateInfo;
-	pipelineCreateInfo.pViewportState = &viewportState;
-	pipelineCreateInfo.pRasterizationState = &rasterizerCreateInfo;
-	pipelineCreateInfo.pMultisampleState = &multisamplingCreateInfo;
-	pipelineCreateInfo.pColorBlendState = &colorBlending;
-	pipelineCreateInfo.pDynamicState = &dynamicStateCreateInfo;
+void Application::DestroyBindlessTable()
+{
+	bindlessTable.Destroy();
+}
 
-	pipelineCreateInfo.layout = pipelineLayout;
+void Application::CreatePipelineBuilder()
+{
+	pipelineBuilder.Create(device, &hostAllocator, &shaderManager, &pipelineCache, &layoutCache, settings.pipelineThreads);
+}
 
-	pipelineCreateInfo.renderPass = renderPass;
-	pipelineCreateInfo.subpass = 0;
+void Application::DestroyPipelineBuilder()
+{
+	pipelineBuilder.Destroy();
+}
 
-	pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+void Application::SelectAttachmentFormats()
+{
+	//Multisampled color has the swapchain format so that it resolves straight into the swapchain image.
+	mainPassFormats.colorFormats = { swapchainImageFormat };
+	mainPassFormats.depthFormat = VK_FORMAT_UNDEFINED;
 
-	result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &graphicsPipeline);
-	if (result != VK_SUCCESS)
+	//Depth is never read back, any precision the device can render to will do, most precise first.
+	for (VkFormat format : { VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D16_UNORM })
 	{
-		throw std::runtime_error("ERROR: Could not create graphics pipeline.\n");
+		VkFormatProperties properties{};
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+		if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+		{
+			mainPassFormats.depthFormat = format;
+			break;
+		}
 	}
 
-	vkDestroyShaderModule(device, fShaderModule, nullptr);
-	vkDestroyShaderModule(device, vShaderModule, nullptr);
-}
+	if (mainPassFormats.depthFormat == VK_FORMAT_UNDEFINED)
+	{
+		throw std::runtime_error("ERROR: Could not find a depth attachment format.\n");
+	}
 
-void Application::DestroyGraphicsPipeline()
-{
-	vkDestroyPipeline(device, graphicsPipeline, nullptr);
-	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-}
+	VkPhysicalDeviceProperties properties{};
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	VkSampleCountFlags supportedCounts = properties.limits.framebufferColorSampleCounts & properties.limits.framebufferDepthSampleCounts;
 
-std::vector<char> Application::ReadFile(std::string filename)
-{
-	std::ifstream file(filename, std::ios::ate | std::ios::binary);
+	//Highest supported count that does not exceed the requested one, one sample is always supported.
+	uint32_t sampleCount = settings.sampleCount;
+	while (sampleCount > 1u && (supportedCounts & sampleCount) == 0u)
+	{
+		sampleCount >>= 1;
+	}
 
-	if (!file.is_open())
+	if (sampleCount != settings.sampleCount)
 	{
-		throw std::runtime_error("ERROR: Failed to open file.\n");
+		std::cout << "WARNING: " << settings.sampleCount << " samples are not supported, using " << sampleCount << ".\n";
 	}
+	mainPassFormats.sampleCount = static_cast<VkSampleCountFlagBits>(sampleCount);
+}
 
-	size_t fileSize = (size_t)file.tellg();
-	std::vector<char> buffer(fileSize);
+void Application::CreateGraphicsPipeline()
+{
+	GraphicsPipelineDescription description{};
+	description.vertexShader = "shader/shader.vert";
+	description.fragmentShader = "shader/shader.frag";
+	description.attachments = mainPassFormats;
 
-	file.seekg(std::ios::beg);
-	file.read(buffer.data(), fileSize);
-	file.close();
+	//Layout is reflected from the shaders and owned by layoutCache.
+	pipelineLayout = pipelineBuilder.GetPipelineLayout(description);
+	description.layout = pipelineLayout;
 
-	return buffer;
+	//Only this pipeline is waited for, variants submitted elsewhere keep compiling in the background.
+	graphicsPipeline = pipelineBuilder.Submit(description).get();
 }
 
-VkShaderModule Application::CreateShaderModule(const std::vector<char>& code)
+void Application::CreateCommandPool()
 {
-	VkShaderModuleCreateInfo info{};
-	info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	info.codeSize = code.size();
-	info.pCode = reinterpret_cast<const uint32_t*>(code.data());
+	VkCommandPoolCreateInfo commandPoolCreateInfo{};
+	commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	commandPoolCreateInfo.queueFamilyIndex = graphicsFamilyIndex;
 
-	VkShaderModule shaderModule{};
-	VkResult result = vkCreateShaderModule(device, &info, nullptr, &shaderModule);
-	if (result != VK_SUCCESS)
+	if (vkCreateCommandPool(device,&commandPoolCreateInfo,hostAllocator.Get(VK_OBJECT_TYPE_COMMAND_POOL),&commandPool) != VK_SUCCESS)
 	{
-		throw std::runtime_error("ERROR: Could not create shader module.\n");
+		throw std::runtime_error("ERROR: Could not create command pool.\n");
 	}
-
-	return shaderModule;
 }
 
-void Application::CreateFramebuffers()
+void Application::DestroyCommandPool()
 {
-	swapchainFramebuffers.resize(swapchainImageViews.size());
-
-	for (size_t i = 0; i < swapchainImageViews.size(); i++) {
-		VkImageView attachments[] = {
-			swapchainImageViews[i]
-		};
-
-		VkFramebufferCreateInfo framebufferInfo{};
-		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		framebufferInfo.renderPass = renderPass;
-		framebufferInfo.attachmentCount = 1;
-		framebufferInfo.pAttachments = attachments;
-		framebufferInfo.width = swapchainExtent.width;
-		framebufferInfo.height = swapchainExtent.height;
-		framebufferInfo.layers = 1;
-
-		if (vkCreateFramebuffer(device,&framebufferInfo,nullptr,&swapchainFramebuffers[i]) != VK_SUCCESS)
-		{
-			throw std::runtime_error("ERROR: Failed to create framebuffer.\n");
-		}
-	}
+	vkDestroyCommandPool(device, commandPool, hostAllocator.Get(VK_OBJECT_TYPE_COMMAND_POOL));
 }
 
-void Application::DestroyFramebuffers()
+void Application::DestroyDeletionQueue()
 {
-	for (auto& framebuffer : swapchainFramebuffers)
-	{
-		vkDestroyFramebuffer(device, framebuffer, nullptr);
-	}
+	deletionQueue.Destroy();
 }
 
-void Application::CreateCommandPool()
+void Application::CreateUploadManager()
 {
-	uint32_t graphicsIndex = GetQueueFamilyIndex(physicalDevice, VK_QUEUE_GRAPHICS_BIT);
+	uploadManager.Create(physicalDevice, device, &hostAllocator, &memoryAllocator, tQueue, transferFamilyIndex, graphicsFamilyIndex);
+}
 
-	VkCommandPoolCreateInfo commandPoolCreateInfo{};
-	commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-	commandPoolCreateInfo.queueFamilyIndex = graphicsIndex;
+void Application::DestroyUploadManager()
+{
+	uploadManager.Destroy();
+}
 
-	if (vkCreateCommandPool(device,&commandPoolCreateInfo,nullptr,&commandPool) != VK_SUCCESS)
+void Application::CreateAssetArchive()
+{
+	if (!settings.archivePath.empty())
 	{
-		throw std::runtime_error("ERROR: Could not create command pool.\n");
+		assetArchive.Create(settings.archivePath);
 	}
 }
 
-void Application::DestroyCommandPool()
+void Application::DestroyAssetArchive()
 {
-	vkDestroyCommandPool(device, commandPool, nullptr);
+	assetArchive.Destroy();
 }
 
 void Application::CreateDebugCallback()
@@ -965,7 +1473,7 @@ void Application::CreateDebugCallback()
 	messengerInfo.pfnUserCallback = &DebugCallback;
 	messengerInfo.pUserData = nullptr;
 
-	VkResult result = ProxyCreateDebugUtilsMessengerEXT(instance, &messengerInfo, nullptr, &debugMessenger);
+	VkResult result = ProxyCreateDebugUtilsMessengerEXT(instance, &messengerInfo, hostAllocator.Get(VK_OBJECT_TYPE_DEBUG_UTILS_MESSENGER_EXT), &debugMessenger);
 	if (result != VK_SUCCESS)
 	{
 		throw std::runtime_error("ERROR: Could not create debug messenger.\n");
@@ -979,6 +1487,6 @@ void Application::DestroyDebugCallback()
 		return;
 	}
 
-	ProxyDestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
+	ProxyDestroyDebugUtilsMessengerEXT(instance, debugMessenger, hostAllocator.Get(VK_OBJECT_TYPE_DEBUG_UTILS_MESSENGER_EXT));
 }
 
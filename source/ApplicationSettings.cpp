@@ -0,0 +1,178 @@
+#include "ApplicationSettings.h"
+
+#include <stdexcept>
+
+ApplicationSettings ApplicationSettings::FromCommandLine(int argc, char** argv)
+{
+	ApplicationSettings settings;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+
+		//Arguments that take a value.
+		auto next = [&]() -> std::string
+		{
+			if (i + 1 >= argc)
+			{
+				throw std::runtime_error("ERROR: Missing value for command line argument: " + argument + "\n");
+			}
+			return std::string(argv[++i]);
+		};
+
+		if (argument == "--scene")
+		{
+			settings.scene = next();
+		}
+		else if (argument == "--headless")
+		{
+			settings.headless = true;
+		}
+		else if (argument == "--width")
+		{
+			settings.width = static_cast<uint32_t>(std::stoul(next()));
+		}
+		else if (argument == "--height")
+		{
+			settings.height = static_cast<uint32_t>(std::stoul(next()));
+		}
+		else if (argument == "--frames")
+		{
+			settings.frameCount = static_cast<uint32_t>(std::stoul(next()));
+		}
+		else if (argument == "--present-mode")
+		{
+			settings.presentMode = next();
+		}
+		else if (argument == "--swapchain-images")
+		{
+			settings.swapchainImageCount = static_cast<uint32_t>(std::stoul(next()));
+		}
+		else if (argument == "--fps-limit")
+		{
+			settings.frameRateLimit = std::stod(next());
+		}
+		else if (argument == "--wait-for-present")
+		{
+			settings.waitForPresent = true;
+		}
+		else if (argument == "--frames-in-flight")
+		{
+			settings.framesInFlight = static_cast<uint32_t>(std::stoul(next()));
+		}
+		else if (argument == "--no-async-compute")
+		{
+			settings.asyncCompute = false;
+		}
+		else if (argument == "--samples")
+		{
+			settings.sampleCount = static_cast<uint32_t>(std::stoul(next()));
+		}
+		else if (argument == "--output")
+		{
+			settings.outputPath = next();
+		}
+		else if (argument == "--pipeline-cache")
+		{
+			settings.pipelineCachePath = next();
+		}
+		else if (argument == "--shader-cache")
+		{
+			settings.shaderCachePath = next();
+		}
+		else if (argument == "--profile")
+		{
+			settings.profileOutputPath = next();
+		}
+		else if (argument == "--pipeline-threads")
+		{
+			settings.pipelineThreads = static_cast<uint32_t>(std::stoul(next()));
+		}
+		else if (argument == "--draws")
+		{
+			settings.drawCount = static_cast<uint32_t>(std::stoul(next()));
+		}
+		else if (argument == "--record-threads")
+		{
+			settings.recordThreads = static_cast<uint32_t>(std::stoul(next()));
+		}
+		else if (argument == "--instances")
+		{
+			settings.instanceCount = static_cast<uint32_t>(std::stoul(next()));
+		}
+		else if (argument == "--objects")
+		{
+			settings.objectCount = static_cast<uint32_t>(std::stoul(next()));
+		}
+		else if (argument == "--particles")
+		{
+			settings.particleCount = static_cast<uint32_t>(std::stoul(next()));
+		}
+		else if (argument == "--texture")
+		{
+			settings.texturePaths.push_back(next());
+		}
+		else if (argument == "--texture-budget")
+		{
+			settings.textureBudget = static_cast<uint32_t>(std::stoul(next()));
+		}
+		else if (argument == "--mesh")
+		{
+			settings.meshPath = next();
+		}
+		else if (argument == "--archive")
+		{
+			settings.archivePath = next();
+		}
+		else if (argument == "--pipeline-variants")
+		{
+			settings.pipelineVariants = static_cast<uint32_t>(std::stoul(next()));
+		}
+		else
+		{
+			throw std::runtime_error("ERROR: Unknown command line argument: " + argument + "\n");
+		}
+	}
+
+	if (settings.width == 0u || settings.height == 0u)
+	{
+		throw std::runtime_error("ERROR: Render size must be greater than zero.\n");
+	}
+
+	if (settings.instanceCount == 0u)
+	{
+		throw std::runtime_error("ERROR: Instance count must be greater than zero.\n");
+	}
+
+	if (settings.objectCount == 0u)
+	{
+		throw std::runtime_error("ERROR: Object count must be greater than zero.\n");
+	}
+
+	if (settings.frameRateLimit < 0.0)
+	{
+		throw std::runtime_error("ERROR: Frame rate limit must not be negative.\n");
+	}
+
+	if (settings.sampleCount == 0u || settings.sampleCount > 64u || (settings.sampleCount & (settings.sampleCount - 1u)) != 0u)
+	{
+		throw std::runtime_error("ERROR: Sample count must be a power of two between 1 and 64.\n");
+	}
+
+	if (settings.framesInFlight < 1u || settings.framesInFlight > 4u)
+	{
+		throw std::runtime_error("ERROR: Frames in flight must be between 1 and 4.\n");
+	}
+
+	return settings;
+}
+
+bool ApplicationSettings::SceneUsesIndirectCount() const
+{
+	return scene == "gpu-driven";
+}
+
+bool ApplicationSettings::SceneUsesBindless() const
+{
+	return scene == "gpu-driven" || scene == "particles";
+}
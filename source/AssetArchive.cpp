@@ -0,0 +1,357 @@
+#include "AssetArchive.h"
+#include "Lz4.h"
+#include "Hash.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <future>
+#include <exception>
+#include <cstring>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+AssetArchive::AssetArchive() :
+	filename(""),
+	data(nullptr),
+	size(0u),
+#ifdef _WIN32
+	file(nullptr),
+	mapping(nullptr),
+#else
+	file(-1),
+#endif
+	header(nullptr),
+	entries(nullptr),
+	chunks(nullptr),
+	names(nullptr),
+	threadPool(),
+	readBytes(0u),
+	decompressedBytes(0u)
+{
+}
+
+AssetArchive::~AssetArchive()
+{
+}
+
+void AssetArchive::Create(const std::string& filename, uint32_t threadCount)
+{
+	this->filename = filename;
+
+	Map(filename);
+	try
+	{
+		Validate();
+	}
+	catch (...)
+	{
+		Unmap();
+		throw;
+	}
+
+	threadPool = std::make_unique<ThreadPool>(threadCount);
+
+	std::cout << "INFO: Mapped archive " << filename << " with " << header->entryCount << " entries.\n";
+}
+
+void AssetArchive::Destroy()
+{
+	if (data == nullptr)
+	{
+		return;
+	}
+
+	//Workers finish their chunks before the mapping they read from goes away.
+	threadPool.reset();
+
+	if (readBytes != 0u)
+	{
+		std::cout << "INFO: Read " << (readBytes >> 10) << " KiB from archive " << filename << ", " << (decompressedBytes >> 10) << " KiB of it decompressed.\n";
+	}
+
+	Unmap();
+}
+
+bool AssetArchive::IsOpen() const
+{
+	return data != nullptr;
+}
+
+const ArchiveEntry* AssetArchive::Find(const std::string& name) const
+{
+	if (data == nullptr)
+	{
+		return nullptr;
+	}
+
+	uint64_t hash = HashString(name);
+	const ArchiveEntry* end = entries + header->entryCount;
+	const ArchiveEntry* entry = std::lower_bound(entries, end, hash, [](const ArchiveEntry& entry, uint64_t hash) { return entry.nameHash < hash; });
+
+	//Colliding hashes are adjacent, the stored name decides.
+	for (; entry != end && entry->nameHash == hash; entry++)
+	{
+		if (entry->nameLength == name.size() && std::memcmp(names + entry->nameOffset, name.data(), name.size()) == 0)
+		{
+			return entry;
+		}
+	}
+	return nullptr;
+}
+
+std::string AssetArchive::GetName(const ArchiveEntry& entry) const
+{
+	return std::string(names + entry.nameOffset, entry.nameLength);
+}
+
+const void* AssetArchive::GetData(const ArchiveEntry& entry) const
+{
+	if (entry.compression != ArchiveCompression::None)
+	{
+		return nullptr;
+	}
+
+	//Validate made sure the chunks of uncompressed entries are stored back to back.
+	return entry.chunkCount == 0u ? data : data + chunks[entry.firstChunk].offset;
+}
+
+void AssetArchive::Read(const ArchiveEntry& entry, uint64_t offset, uint64_t size, void* destination)
+{
+	if (offset > entry.size || size > entry.size - offset)
+	{
+		throw std::runtime_error("ERROR: Read past the end of " + GetName(entry) + " in archive " + filename + "\n");
+	}
+
+	if (size == 0u)
+	{
+		return;
+	}
+
+	char* output = static_cast<char*>(destination);
+	uint64_t end = offset + size;
+	uint32_t first = static_cast<uint32_t>(offset / entry.chunkSize);
+	uint32_t last = static_cast<uint32_t>((end - 1u) / entry.chunkSize);
+
+	//A single chunk is not worth the round trip through the pool.
+	if (first == last)
+	{
+		uint64_t chunkBegin = static_cast<uint64_t>(first) * entry.chunkSize;
+		ReadChunk(chunks[entry.firstChunk + first], chunkBegin, offset, end, output);
+		readBytes += size;
+		return;
+	}
+
+	std::vector<std::future<void>> pending;
+	pending.reserve(last - first + 1u);
+	for (uint32_t i = first; i <= last; i++)
+	{
+		const ArchiveChunk& chunk = chunks[entry.firstChunk + i];
+		uint64_t chunkBegin = static_cast<uint64_t>(i) * entry.chunkSize;
+		uint64_t begin = std::max(offset, chunkBegin);
+		uint64_t chunkEnd = std::min(end, chunkBegin + chunk.size);
+		char* chunkOutput = output + (begin - offset);
+
+		pending.push_back(threadPool->Submit([this, &chunk, chunkBegin, begin, chunkEnd, chunkOutput]()
+		{
+			ReadChunk(chunk, chunkBegin, begin, chunkEnd, chunkOutput);
+		}));
+	}
+
+	//Every chunk is waited for before an error is passed on, no worker may write to destination after the call returns.
+	std::exception_ptr error;
+	for (auto& future : pending)
+	{
+		try
+		{
+			future.get();
+		}
+		catch (...)
+		{
+			if (!error)
+			{
+				error = std::current_exception();
+			}
+		}
+	}
+
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+	readBytes += size;
+}
+
+void AssetArchive::Map(const std::string& filename)
+{
+#ifdef _WIN32
+	HANDLE fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		throw std::runtime_error("ERROR: Could not open archive " + filename + "\n");
+	}
+	file = fileHandle;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize) || static_cast<uint64_t>(fileSize.QuadPart) < sizeof(ArchiveHeader))
+	{
+		Unmap();
+		throw std::runtime_error("ERROR: Archive " + filename + " is truncated.\n");
+	}
+	size = static_cast<uint64_t>(fileSize.QuadPart);
+
+	mapping = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	void* view = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (view == nullptr)
+	{
+		Unmap();
+		throw std::runtime_error("ERROR: Could not map archive " + filename + "\n");
+	}
+	data = static_cast<const char*>(view);
+#else
+	file = open(filename.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		throw std::runtime_error("ERROR: Could not open archive " + filename + "\n");
+	}
+
+	struct stat status;
+	if (fstat(file, &status) != 0 || static_cast<uint64_t>(status.st_size) < sizeof(ArchiveHeader))
+	{
+		Unmap();
+		throw std::runtime_error("ERROR: Archive " + filename + " is truncated.\n");
+	}
+	size = static_cast<uint64_t>(status.st_size);
+
+	void* view = mmap(nullptr, static_cast<size_t>(size), PROT_READ, MAP_PRIVATE, file, 0);
+	if (view == MAP_FAILED)
+	{
+		Unmap();
+		throw std::runtime_error("ERROR: Could not map archive " + filename + "\n");
+	}
+	data = static_cast<const char*>(view);
+#endif
+
+	header = reinterpret_cast<const ArchiveHeader*>(data);
+}
+
+void AssetArchive::Unmap()
+{
+#ifdef _WIN32
+	if (data != nullptr)
+	{
+		UnmapViewOfFile(data);
+	}
+	if (mapping != nullptr)
+	{
+		CloseHandle(mapping);
+	}
+	if (file != nullptr)
+	{
+		CloseHandle(file);
+	}
+	mapping = nullptr;
+	file = nullptr;
+#else
+	if (data != nullptr)
+	{
+		munmap(const_cast<char*>(data), static_cast<size_t>(size));
+	}
+	if (file >= 0)
+	{
+		close(file);
+	}
+	file = -1;
+#endif
+
+	data = nullptr;
+	size = 0u;
+	header = nullptr;
+	entries = nullptr;
+	chunks = nullptr;
+	names = nullptr;
+}
+
+void AssetArchive::Validate()
+{
+	//Everything Read and Find rely on is checked once here, a corrupt archive never leads to reads outside the mapping.
+	auto fail = [this]() { throw std::runtime_error("ERROR: Archive " + filename + " is corrupt.\n"); };
+	auto inFile = [this](uint64_t offset, uint64_t length) { return offset <= size && length <= size - offset; };
+
+	if (std::memcmp(header->magic, archiveMagic, sizeof(archiveMagic)) != 0 || header->version != archiveVersion)
+	{
+		throw std::runtime_error("ERROR: " + filename + " is not an archive written by this version of AssetPack.\n");
+	}
+
+	if (!inFile(header->entryOffset, static_cast<uint64_t>(header->entryCount) * sizeof(ArchiveEntry)) || header->entryOffset % alignof(ArchiveEntry) != 0u ||
+		!inFile(header->chunkOffset, static_cast<uint64_t>(header->chunkCount) * sizeof(ArchiveChunk)) || header->chunkOffset % alignof(ArchiveChunk) != 0u ||
+		!inFile(header->nameOffset, header->nameSize))
+	{
+		fail();
+	}
+
+	entries = reinterpret_cast<const ArchiveEntry*>(data + header->entryOffset);
+	chunks = reinterpret_cast<const ArchiveChunk*>(data + header->chunkOffset);
+	names = data + header->nameOffset;
+
+	for (uint32_t i = 0; i < header->entryCount; i++)
+	{
+		const ArchiveEntry& entry = entries[i];
+		if ((i != 0u && entries[i - 1u].nameHash > entry.nameHash) ||
+			entry.nameOffset > header->nameSize || entry.nameLength > header->nameSize - entry.nameOffset ||
+			static_cast<uint64_t>(entry.firstChunk) + entry.chunkCount > header->chunkCount ||
+			(entry.compression != ArchiveCompression::None && entry.compression != ArchiveCompression::Lz4) ||
+			entry.chunkSize == 0u || entry.chunkCount != (entry.size + entry.chunkSize - 1u) / entry.chunkSize)
+		{
+			fail();
+		}
+
+		for (uint32_t j = 0; j < entry.chunkCount; j++)
+		{
+			const ArchiveChunk& chunk = chunks[entry.firstChunk + j];
+			uint64_t expectedSize = std::min<uint64_t>(entry.chunkSize, entry.size - static_cast<uint64_t>(j) * entry.chunkSize);
+			if (chunk.size != expectedSize || chunk.storedSize > chunk.size || !inFile(chunk.offset, chunk.storedSize))
+			{
+				fail();
+			}
+
+			if (entry.compression == ArchiveCompression::None &&
+				(chunk.storedSize != chunk.size || chunk.offset != chunks[entry.firstChunk].offset + static_cast<uint64_t>(j) * entry.chunkSize))
+			{
+				fail();
+			}
+		}
+	}
+}
+
+void AssetArchive::ReadChunk(const ArchiveChunk& chunk, uint64_t chunkBegin, uint64_t begin, uint64_t end, char* destination)
+{
+	const char* source = data + chunk.offset;
+	if (chunk.storedSize == chunk.size)
+	{
+		std::memcpy(destination, source + (begin - chunkBegin), static_cast<size_t>(end - begin));
+		return;
+	}
+
+	decompressedBytes += chunk.size;
+	if (begin == chunkBegin && end == chunkBegin + chunk.size)
+	{
+		Lz4::Decompress(source, chunk.storedSize, destination, chunk.size);
+		return;
+	}
+
+	//LZ4 blocks only decode from their start, partly covered chunks go through a temporary.
+	std::vector<char> temporary(chunk.size);
+	Lz4::Decompress(source, chunk.storedSize, temporary.data(), temporary.size());
+	std::memcpy(destination, temporary.data() + (begin - chunkBegin), static_cast<size_t>(end - begin));
+}
@@ -0,0 +1,400 @@
+#include "AsyncCompute.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <algorithm>
+
+namespace
+{
+	//Graphics frames kept for the overlap, enough to cover every frame in flight beside a submission.
+	const size_t graphicsIntervalCount = 8u;
+}
+
+AsyncCompute::AsyncCompute() :
+	device(VK_NULL_HANDLE),
+	hostAllocator(nullptr),
+	queue(VK_NULL_HANDLE),
+	computeFamilyIndex(0u),
+	graphicsFamilyIndex(0u),
+	framesInFlight(0u),
+	commandPool(VK_NULL_HANDLE),
+	commandBuffers({}),
+	semaphore(VK_NULL_HANDLE),
+	nextValue(1u),
+	frameSlot(0u),
+	slotValues({}),
+	releases({}),
+	pendingAcquires({}),
+	pendingStages(0u),
+	pendingValue(0u),
+	queryPool(VK_NULL_HANDLE),
+	timestampPeriod(0.0),
+	timestampMask(0u),
+	slotTimed({}),
+	graphicsIntervals({}),
+	lastTiming(),
+	submissions(0u),
+	timedSubmissions(0u),
+	totalBusy(0.0),
+	totalOverlap(0.0)
+{
+}
+
+AsyncCompute::~AsyncCompute()
+{
+}
+
+void AsyncCompute::Create(VkPhysicalDevice physicalDevice, VkDevice device, HostAllocator* hostAllocator, VkQueue queue, uint32_t computeFamilyIndex, uint32_t graphicsFamilyIndex, uint32_t framesInFlight)
+{
+	this->device = device;
+	this->hostAllocator = hostAllocator;
+	this->queue = queue;
+	this->computeFamilyIndex = computeFamilyIndex;
+	this->graphicsFamilyIndex = graphicsFamilyIndex;
+	this->framesInFlight = framesInFlight;
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = computeFamilyIndex;
+
+	if (vkCreateCommandPool(device, &poolInfo, hostAllocator->Get(VK_OBJECT_TYPE_COMMAND_POOL), &commandPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not create compute command pool.\n");
+	}
+
+	commandBuffers.resize(framesInFlight);
+
+	VkCommandBufferAllocateInfo allocateInfo{};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocateInfo.commandPool = commandPool;
+	allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocateInfo.commandBufferCount = framesInFlight;
+
+	if (vkAllocateCommandBuffers(device, &allocateInfo, commandBuffers.data()) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not allocate compute command buffers.\n");
+	}
+
+	VkSemaphoreTypeCreateInfo typeInfo{};
+	typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	typeInfo.initialValue = 0u;
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreInfo.pNext = &typeInfo;
+
+	if (vkCreateSemaphore(device, &semaphoreInfo, hostAllocator->Get(VK_OBJECT_TYPE_SEMAPHORE), &semaphore) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not create compute semaphore.\n");
+	}
+
+	slotValues.assign(framesInFlight, 0u);
+	slotTimed.assign(framesInFlight, false);
+
+	//Timing is optional like in FrameScheduler, the compute family has to support timestamps.
+	uint32_t familyCount = 0u;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+
+	uint32_t validBits = families[computeFamilyIndex].timestampValidBits;
+	if (validBits != 0u)
+	{
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		timestampPeriod = properties.limits.timestampPeriod;
+		timestampMask = validBits >= 64u ? UINT64_MAX : (1ull << validBits) - 1u;
+
+		VkQueryPoolCreateInfo queryInfo{};
+		queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryInfo.queryCount = 2u * framesInFlight;
+
+		if (vkCreateQueryPool(device, &queryInfo, hostAllocator->Get(VK_OBJECT_TYPE_QUERY_POOL), &queryPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("ERROR: Could not create compute query pool.\n");
+		}
+	}
+	else
+	{
+		std::cout << "WARNING: Queue family " << computeFamilyIndex << " does not support timestamps, compute overlap is not measured.\n";
+	}
+}
+
+void AsyncCompute::Destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	uint64_t value = nextValue - 1u;
+
+	VkSemaphoreWaitInfo waitInfo{};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &semaphore;
+	waitInfo.pValues = &value;
+	vkWaitSemaphores(device, &waitInfo, UINT64_MAX);
+
+	//Submissions still in the slots have finished now, oldest first.
+	std::vector<uint32_t> order(framesInFlight);
+	for (uint32_t i = 0; i < framesInFlight; i++)
+	{
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return slotValues[a] < slotValues[b]; });
+	for (uint32_t slot : order)
+	{
+		RetireSubmission(slot);
+	}
+
+	if (submissions != 0u)
+	{
+		std::cout << "INFO: Async compute ran " << submissions << " submission(s)";
+		if (timedSubmissions != 0u)
+		{
+			std::cout << ", GPU busy " << totalBusy / timedSubmissions << " ms on average, "
+				<< (totalBusy > 0.0 ? totalOverlap / totalBusy * 100.0 : 0.0) << "% of it overlapped with graphics";
+		}
+		std::cout << ".\n";
+	}
+
+	if (queryPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(device, queryPool, hostAllocator->Get(VK_OBJECT_TYPE_QUERY_POOL));
+		queryPool = VK_NULL_HANDLE;
+	}
+	vkDestroySemaphore(device, semaphore, hostAllocator->Get(VK_OBJECT_TYPE_SEMAPHORE));
+	vkDestroyCommandPool(device, commandPool, hostAllocator->Get(VK_OBJECT_TYPE_COMMAND_POOL));
+	commandBuffers.clear();
+	releases.clear();
+	pendingAcquires.clear();
+	device = VK_NULL_HANDLE;
+}
+
+VkCommandBuffer AsyncCompute::Begin(uint32_t frameSlot)
+{
+	this->frameSlot = frameSlot;
+
+	if (slotValues[frameSlot] != 0u)
+	{
+		VkSemaphoreWaitInfo waitInfo{};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &semaphore;
+		waitInfo.pValues = &slotValues[frameSlot];
+
+		if (vkWaitSemaphores(device, &waitInfo, UINT64_MAX) != VK_SUCCESS)
+		{
+			throw std::runtime_error("ERROR: Could not wait for compute submission.\n");
+		}
+
+		RetireSubmission(frameSlot);
+	}
+
+	VkCommandBuffer commandBuffer = commandBuffers[frameSlot];
+	vkResetCommandBuffer(commandBuffer, 0);
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not begin recording compute command buffer.\n");
+	}
+
+	if (queryPool != VK_NULL_HANDLE)
+	{
+		vkCmdResetQueryPool(commandBuffer, queryPool, 2u * frameSlot, 2u);
+		vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, queryPool, 2u * frameSlot);
+	}
+
+	return commandBuffer;
+}
+
+void AsyncCompute::Release(VkBuffer buffer, VkPipelineStageFlags2 srcStages, VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStages, VkAccessFlags2 dstAccess)
+{
+	//Same family needs no barrier, the semaphore wait makes the writes available and visible.
+	VkBufferMemoryBarrier2 release{};
+	release.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+	release.srcStageMask = srcStages;
+	release.srcAccessMask = srcAccess;
+	release.dstStageMask = dstStages;
+	release.dstAccessMask = dstAccess;
+	release.srcQueueFamilyIndex = computeFamilyIndex;
+	release.dstQueueFamilyIndex = graphicsFamilyIndex;
+	release.buffer = buffer;
+	release.offset = 0u;
+	release.size = VK_WHOLE_SIZE;
+	releases.push_back(release);
+}
+
+uint64_t AsyncCompute::Submit(const std::vector<VkSemaphoreSubmitInfo>& waits)
+{
+	VkCommandBuffer commandBuffer = commandBuffers[frameSlot];
+
+	//Destination scope of a release is ignored, it is kept in the acquire that mirrors it.
+	std::vector<VkBufferMemoryBarrier2> acquires = releases;
+	for (auto& barrier : releases)
+	{
+		pendingStages |= barrier.dstStageMask;
+		barrier.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+		barrier.dstAccessMask = 0u;
+	}
+
+	if (computeFamilyIndex != graphicsFamilyIndex && !releases.empty())
+	{
+		VkDependencyInfo dependency{};
+		dependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+		dependency.bufferMemoryBarrierCount = static_cast<uint32_t>(releases.size());
+		dependency.pBufferMemoryBarriers = releases.data();
+		vkCmdPipelineBarrier2(commandBuffer, &dependency);
+
+		//The acquire is ordered after the semaphore wait, which waits at the same stages the acquire starts at.
+		for (auto& barrier : acquires)
+		{
+			barrier.srcStageMask = barrier.dstStageMask;
+			barrier.srcAccessMask = 0u;
+		}
+		pendingAcquires.insert(pendingAcquires.end(), acquires.begin(), acquires.end());
+	}
+	releases.clear();
+
+	if (queryPool != VK_NULL_HANDLE)
+	{
+		vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, queryPool, 2u * frameSlot + 1u);
+	}
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not record compute command buffer.\n");
+	}
+
+	uint64_t value = nextValue++;
+
+	VkCommandBufferSubmitInfo commandBufferInfo{};
+	commandBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+	commandBufferInfo.commandBuffer = commandBuffer;
+
+	VkSemaphoreSubmitInfo signal{};
+	signal.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+	signal.semaphore = semaphore;
+	signal.value = value;
+	signal.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+	VkSubmitInfo2 submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+	submitInfo.waitSemaphoreInfoCount = static_cast<uint32_t>(waits.size());
+	submitInfo.pWaitSemaphoreInfos = waits.data();
+	submitInfo.commandBufferInfoCount = 1;
+	submitInfo.pCommandBufferInfos = &commandBufferInfo;
+	submitInfo.signalSemaphoreInfoCount = 1;
+	submitInfo.pSignalSemaphoreInfos = &signal;
+
+	if (vkQueueSubmit2(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not submit compute work.\n");
+	}
+
+	slotValues[frameSlot] = value;
+	slotTimed[frameSlot] = queryPool != VK_NULL_HANDLE;
+	pendingValue = value;
+	submissions++;
+
+	return value;
+}
+
+VkSemaphoreSubmitInfo AsyncCompute::RecordAcquireBarriers(VkCommandBuffer commandBuffer)
+{
+	if (!pendingAcquires.empty())
+	{
+		VkDependencyInfo dependency{};
+		dependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+		dependency.bufferMemoryBarrierCount = static_cast<uint32_t>(pendingAcquires.size());
+		dependency.pBufferMemoryBarriers = pendingAcquires.data();
+		vkCmdPipelineBarrier2(commandBuffer, &dependency);
+		pendingAcquires.clear();
+	}
+
+	//Only the stages that consume compute results wait, everything before them overlaps with the compute work.
+	VkSemaphoreSubmitInfo wait{};
+	wait.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+	wait.semaphore = semaphore;
+	wait.value = pendingValue;
+	wait.stageMask = pendingStages != 0u ? pendingStages : VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+	pendingValue = 0u;
+	pendingStages = 0u;
+	return wait;
+}
+
+void AsyncCompute::AddGraphicsTiming(const FrameTiming& timing)
+{
+	if (timing.gpuEnd == 0u || (!graphicsIntervals.empty() && graphicsIntervals.back().second == timing.gpuEnd))
+	{
+		return;
+	}
+
+	graphicsIntervals.emplace_back(timing.gpuBegin, timing.gpuEnd);
+	if (graphicsIntervals.size() > graphicsIntervalCount)
+	{
+		graphicsIntervals.pop_front();
+	}
+}
+
+VkSemaphore AsyncCompute::GetSemaphore() const
+{
+	return semaphore;
+}
+
+const ComputeTiming& AsyncCompute::GetLastTiming() const
+{
+	return lastTiming;
+}
+
+void AsyncCompute::RetireSubmission(uint32_t slot)
+{
+	if (slotValues[slot] == 0u)
+	{
+		return;
+	}
+
+	lastTiming = ComputeTiming{};
+	lastTiming.submission = slotValues[slot];
+	slotValues[slot] = 0u;
+
+	if (!slotTimed[slot])
+	{
+		return;
+	}
+
+	uint64_t timestamps[2] = {};
+	if (vkGetQueryPoolResults(device, queryPool, 2u * slot, 2u, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+	{
+		return;
+	}
+
+	//Graphics frames run one after another on their queue, so the intersections add up without counting any time twice.
+	uint64_t overlapTicks = 0u;
+	for (auto& [begin, end] : graphicsIntervals)
+	{
+		uint64_t first = std::max(begin, timestamps[0]);
+		uint64_t last = std::min(end, timestamps[1]);
+		if (last > first)
+		{
+			overlapTicks += last - first;
+		}
+	}
+
+	double ticksToMs = timestampPeriod * 1e-6;
+	lastTiming.gpuBusyMs = ((timestamps[1] - timestamps[0]) & timestampMask) * ticksToMs;
+	lastTiming.overlapMs = std::min(overlapTicks * ticksToMs, lastTiming.gpuBusyMs);
+
+	totalBusy += lastTiming.gpuBusyMs;
+	totalOverlap += lastTiming.overlapMs;
+	timedSubmissions++;
+}
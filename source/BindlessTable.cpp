@@ -0,0 +1,298 @@
+#include "BindlessTable.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <algorithm>
+
+namespace
+{
+	//Binding numbers, must match shader/bindless.glsl.
+	const uint32_t imageBinding = 0u;
+	const uint32_t samplerBinding = 1u;
+	const uint32_t storageBufferBinding = 2u;
+}
+
+BindlessTable::HandlePool::HandlePool() :
+	capacity(0u),
+	next(nullptr),
+	head(invalidHandle),
+	fresh(0u)
+{
+}
+
+void BindlessTable::HandlePool::Create(uint32_t capacity)
+{
+	this->capacity = capacity;
+	next = std::make_unique<std::atomic<uint32_t>[]>(capacity);
+	head.store(invalidHandle);
+	fresh.store(0u);
+}
+
+uint32_t BindlessTable::HandlePool::Allocate()
+{
+	//Recycled indices first, their descriptors are already written once.
+	uint64_t current = head.load(std::memory_order_acquire);
+	while (static_cast<uint32_t>(current) != invalidHandle)
+	{
+		uint32_t handle = static_cast<uint32_t>(current);
+		uint64_t tag = (current >> 32) + 1u;
+		uint64_t replacement = (tag << 32) | next[handle].load(std::memory_order_relaxed);
+		if (head.compare_exchange_weak(current, replacement, std::memory_order_acquire, std::memory_order_acquire))
+		{
+			return handle;
+		}
+	}
+
+	uint32_t handle = fresh.load(std::memory_order_relaxed);
+	while (handle < capacity)
+	{
+		if (fresh.compare_exchange_weak(handle, handle + 1u, std::memory_order_relaxed))
+		{
+			return handle;
+		}
+	}
+
+	return invalidHandle;
+}
+
+void BindlessTable::HandlePool::Free(uint32_t handle)
+{
+	uint64_t current = head.load(std::memory_order_relaxed);
+	uint64_t replacement = 0u;
+	do
+	{
+		next[handle].store(static_cast<uint32_t>(current), std::memory_order_relaxed);
+		replacement = (((current >> 32) + 1u) << 32) | handle;
+	} while (!head.compare_exchange_weak(current, replacement, std::memory_order_release, std::memory_order_relaxed));
+}
+
+uint32_t BindlessTable::HandlePool::GetCapacity() const
+{
+	return capacity;
+}
+
+BindlessTable::BindlessTable() :
+	device(VK_NULL_HANDLE),
+	hostAllocator(nullptr),
+	setLayout(VK_NULL_HANDLE),
+	pipelineLayout(VK_NULL_HANDLE),
+	descriptorPool(VK_NULL_HANDLE),
+	descriptorSet(VK_NULL_HANDLE)
+{
+}
+
+BindlessTable::~BindlessTable()
+{
+}
+
+void BindlessTable::Create(VkPhysicalDevice physicalDevice, VkDevice device, HostAllocator* hostAllocator, LayoutCache* layoutCache, uint32_t maxImages, uint32_t maxSamplers, uint32_t maxStorageBuffers)
+{
+	this->device = device;
+	this->hostAllocator = hostAllocator;
+
+	VkPhysicalDeviceVulkan12Properties properties12{};
+	properties12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+
+	VkPhysicalDeviceProperties2 properties{};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties.pNext = &properties12;
+	vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+	//Every binding is visible to all stages, so the per stage limits apply to the whole set.
+	maxImages = std::min({ maxImages, properties12.maxDescriptorSetUpdateAfterBindSampledImages, properties12.maxPerStageDescriptorUpdateAfterBindSampledImages });
+	maxSamplers = std::min({ maxSamplers, properties12.maxDescriptorSetUpdateAfterBindSamplers, properties12.maxPerStageDescriptorUpdateAfterBindSamplers });
+	maxStorageBuffers = std::min({ maxStorageBuffers, properties12.maxDescriptorSetUpdateAfterBindStorageBuffers, properties12.maxPerStageDescriptorUpdateAfterBindStorageBuffers });
+
+	VkDescriptorSetLayoutBinding bindings[3]{};
+	bindings[0].binding = imageBinding;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	bindings[0].descriptorCount = maxImages;
+	bindings[0].stageFlags = VK_SHADER_STAGE_ALL;
+	bindings[1].binding = samplerBinding;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+	bindings[1].descriptorCount = maxSamplers;
+	bindings[1].stageFlags = VK_SHADER_STAGE_ALL;
+	bindings[2].binding = storageBufferBinding;
+	bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	bindings[2].descriptorCount = maxStorageBuffers;
+	bindings[2].stageFlags = VK_SHADER_STAGE_ALL;
+
+	//Partially bound lets unused and freed slots hold stale or no descriptors at all. Unused while pending allows
+	//writing new slots while earlier frames that never touch them are still executing.
+	VkDescriptorBindingFlags flags = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+	VkDescriptorBindingFlags bindingFlags[3] = { flags, flags, flags };
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+	bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsInfo.bindingCount = 3;
+	bindingFlagsInfo.pBindingFlags = bindingFlags;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.pNext = &bindingFlagsInfo;
+	layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	layoutInfo.bindingCount = 3;
+	layoutInfo.pBindings = bindings;
+
+	//Owned here rather than by layoutCache, which has no way to express binding flags.
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, hostAllocator->Get(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT), &setLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not create bindless descriptor set layout.\n");
+	}
+
+	VkPushConstantRange pushConstants{};
+	pushConstants.stageFlags = VK_SHADER_STAGE_ALL;
+	pushConstants.offset = 0u;
+	pushConstants.size = pushConstantSize;
+	pipelineLayout = layoutCache->GetPipelineLayout({ setLayout }, { pushConstants });
+
+	VkDescriptorPoolSize poolSizes[3]{};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	poolSizes[0].descriptorCount = maxImages;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_SAMPLER;
+	poolSizes[1].descriptorCount = maxSamplers;
+	poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[2].descriptorCount = maxStorageBuffers;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 3;
+	poolInfo.pPoolSizes = poolSizes;
+
+	if (vkCreateDescriptorPool(device, &poolInfo, hostAllocator->Get(VK_OBJECT_TYPE_DESCRIPTOR_POOL), &descriptorPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not create bindless descriptor pool.\n");
+	}
+
+	VkDescriptorSetAllocateInfo allocateInfo{};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocateInfo.descriptorPool = descriptorPool;
+	allocateInfo.descriptorSetCount = 1;
+	allocateInfo.pSetLayouts = &setLayout;
+
+	if (vkAllocateDescriptorSets(device, &allocateInfo, &descriptorSet) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not allocate bindless descriptor set.\n");
+	}
+
+	images.Create(maxImages);
+	samplers.Create(maxSamplers);
+	storageBuffers.Create(maxStorageBuffers);
+
+	std::cout << "INFO: Bindless table holds " << maxImages << " images, " << maxSamplers << " samplers and " << maxStorageBuffers << " storage buffers.\n";
+}
+
+void BindlessTable::Destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	//The set is freed with its pool, the pipeline layout belongs to layoutCache.
+	vkDestroyDescriptorPool(device, descriptorPool, hostAllocator->Get(VK_OBJECT_TYPE_DESCRIPTOR_POOL));
+	vkDestroyDescriptorSetLayout(device, setLayout, hostAllocator->Get(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT));
+	descriptorPool = VK_NULL_HANDLE;
+	descriptorSet = VK_NULL_HANDLE;
+	setLayout = VK_NULL_HANDLE;
+	pipelineLayout = VK_NULL_HANDLE;
+	device = VK_NULL_HANDLE;
+}
+
+uint32_t BindlessTable::AddImage(VkImageView imageView, VkImageLayout layout)
+{
+	uint32_t handle = images.Allocate();
+	if (handle == invalidHandle)
+	{
+		throw std::runtime_error("ERROR: Bindless table is out of image slots.\n");
+	}
+
+	UpdateImage(handle, imageView, layout);
+	return handle;
+}
+
+uint32_t BindlessTable::AddSampler(VkSampler sampler)
+{
+	uint32_t handle = samplers.Allocate();
+	if (handle == invalidHandle)
+	{
+		throw std::runtime_error("ERROR: Bindless table is out of sampler slots.\n");
+	}
+
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.sampler = sampler;
+	Write(samplerBinding, handle, VK_DESCRIPTOR_TYPE_SAMPLER, &imageInfo, nullptr);
+	return handle;
+}
+
+uint32_t BindlessTable::AddStorageBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	uint32_t handle = storageBuffers.Allocate();
+	if (handle == invalidHandle)
+	{
+		throw std::runtime_error("ERROR: Bindless table is out of storage buffer slots.\n");
+	}
+
+	VkDescriptorBufferInfo bufferInfo{};
+	bufferInfo.buffer = buffer;
+	bufferInfo.offset = offset;
+	bufferInfo.range = range;
+	Write(storageBufferBinding, handle, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr, &bufferInfo);
+	return handle;
+}
+
+void BindlessTable::UpdateImage(uint32_t handle, VkImageView imageView, VkImageLayout layout)
+{
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.imageView = imageView;
+	imageInfo.imageLayout = layout;
+	Write(imageBinding, handle, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, &imageInfo, nullptr);
+}
+
+void BindlessTable::FreeImage(uint32_t handle)
+{
+	images.Free(handle);
+}
+
+void BindlessTable::FreeSampler(uint32_t handle)
+{
+	samplers.Free(handle);
+}
+
+void BindlessTable::FreeStorageBuffer(uint32_t handle)
+{
+	storageBuffers.Free(handle);
+}
+
+void BindlessTable::Bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint) const
+{
+	vkCmdBindDescriptorSets(commandBuffer, bindPoint, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+}
+
+VkDescriptorSetLayout BindlessTable::GetDescriptorSetLayout() const
+{
+	return setLayout;
+}
+
+VkPipelineLayout BindlessTable::GetPipelineLayout() const
+{
+	return pipelineLayout;
+}
+
+void BindlessTable::Write(uint32_t binding, uint32_t handle, VkDescriptorType type, const VkDescriptorImageInfo* imageInfo, const VkDescriptorBufferInfo* bufferInfo)
+{
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = descriptorSet;
+	write.dstBinding = binding;
+	write.dstArrayElement = handle;
+	write.descriptorCount = 1;
+	write.descriptorType = type;
+	write.pImageInfo = imageInfo;
+	write.pBufferInfo = bufferInfo;
+
+	std::lock_guard<std::mutex> lock(writeMutex);
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+}
@@ -0,0 +1,195 @@
+#include "CommandRecorder.h"
+
+#include <stdexcept>
+#include <future>
+#include <algorithm>
+
+CommandRecorder::CommandRecorder() :
+	device(VK_NULL_HANDLE),
+	hostAllocator(nullptr),
+	queueFamilyIndex(0u),
+	frameSlot(0u),
+	threadPool(nullptr),
+	frames({})
+{
+}
+
+CommandRecorder::~CommandRecorder()
+{
+}
+
+void CommandRecorder::Create(VkDevice device, HostAllocator* hostAllocator, uint32_t queueFamilyIndex, uint32_t framesInFlight, uint32_t threadCount)
+{
+	this->device = device;
+	this->hostAllocator = hostAllocator;
+	this->queueFamilyIndex = queueFamilyIndex;
+	threadPool = std::make_unique<ThreadPool>(threadCount);
+
+	frames.resize(framesInFlight);
+	for (auto& frame : frames)
+	{
+		frame.primaryPool = CreatePool();
+
+		VkCommandBufferAllocateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		info.commandPool = frame.primaryPool;
+		info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		info.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(device, &info, &frame.primary) != VK_SUCCESS)
+		{
+			throw std::runtime_error("ERROR: Could not allocate primary command buffer.\n");
+		}
+
+		frame.threads.resize(threadPool->GetThreadCount());
+		for (auto& thread : frame.threads)
+		{
+			thread.commandPool = CreatePool();
+		}
+	}
+}
+
+void CommandRecorder::Destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	threadPool.reset();
+
+	//Destroying a pool frees its command buffers.
+	for (auto& frame : frames)
+	{
+		for (auto& thread : frame.threads)
+		{
+			vkDestroyCommandPool(device, thread.commandPool, hostAllocator->Get(VK_OBJECT_TYPE_COMMAND_POOL));
+		}
+		vkDestroyCommandPool(device, frame.primaryPool, hostAllocator->Get(VK_OBJECT_TYPE_COMMAND_POOL));
+	}
+	frames.clear();
+
+	device = VK_NULL_HANDLE;
+}
+
+VkCommandBuffer CommandRecorder::BeginFrame(uint32_t frameSlot)
+{
+	this->frameSlot = frameSlot;
+	FramePools& frame = frames[frameSlot];
+
+	vkResetCommandPool(device, frame.primaryPool, 0);
+	for (auto& thread : frame.threads)
+	{
+		vkResetCommandPool(device, thread.commandPool, 0);
+		thread.used = 0u;
+	}
+
+	return frame.primary;
+}
+
+std::vector<VkCommandBuffer> CommandRecorder::Record(const VkCommandBufferInheritanceInfo& inheritance, uint32_t itemCount, const RecordFunction& record, uint32_t minItemsPerTask)
+{
+	FramePools& frame = frames[frameSlot];
+
+	//Few items are not worth the hand off to workers.
+	uint32_t taskCount = std::max(1u, std::min(static_cast<uint32_t>(frame.threads.size()), itemCount / std::max(1u, minItemsPerTask)));
+	std::vector<VkCommandBuffer> commandBuffers(taskCount, VK_NULL_HANDLE);
+
+	if (taskCount == 1u)
+	{
+		RecordRange(frame.threads[0], inheritance, 0u, itemCount, record, commandBuffers[0]);
+		return commandBuffers;
+	}
+
+	//Task i always uses pool i, so no pool is touched by two threads at once.
+	std::vector<std::future<void>> tasks;
+	tasks.reserve(taskCount);
+	for (uint32_t i = 0; i < taskCount; i++)
+	{
+		uint32_t begin = static_cast<uint32_t>(static_cast<uint64_t>(itemCount) * i / taskCount);
+		uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(itemCount) * (i + 1u) / taskCount);
+		ThreadPools* pools = &frame.threads[i];
+		VkCommandBuffer* commandBuffer = &commandBuffers[i];
+
+		tasks.push_back(threadPool->Submit([this, pools, &inheritance, begin, end, &record, commandBuffer]()
+		{
+			RecordRange(*pools, inheritance, begin, end, record, *commandBuffer);
+		}));
+	}
+
+	//Every task is waited for before the first exception is rethrown, workers still use the captured references.
+	for (auto& task : tasks)
+	{
+		task.wait();
+	}
+	for (auto& task : tasks)
+	{
+		task.get();
+	}
+
+	return commandBuffers;
+}
+
+uint32_t CommandRecorder::GetThreadCount() const
+{
+	return threadPool != nullptr ? threadPool->GetThreadCount() : 0u;
+}
+
+VkCommandPool CommandRecorder::CreatePool()
+{
+	VkCommandPoolCreateInfo info{};
+	info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	info.queueFamilyIndex = queueFamilyIndex;
+
+	VkCommandPool pool = VK_NULL_HANDLE;
+	if (vkCreateCommandPool(device, &info, hostAllocator->Get(VK_OBJECT_TYPE_COMMAND_POOL), &pool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not create command pool.\n");
+	}
+	return pool;
+}
+
+VkCommandBuffer CommandRecorder::GetSecondary(ThreadPools& pools)
+{
+	//Buffers survive pool resets, they are reused in allocation order every frame.
+	if (pools.used == pools.commandBuffers.size())
+	{
+		VkCommandBufferAllocateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		info.commandPool = pools.commandPool;
+		info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		info.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		if (vkAllocateCommandBuffers(device, &info, &commandBuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("ERROR: Could not allocate secondary command buffer.\n");
+		}
+		pools.commandBuffers.push_back(commandBuffer);
+	}
+
+	return pools.commandBuffers[pools.used++];
+}
+
+void CommandRecorder::RecordRange(ThreadPools& pools, const VkCommandBufferInheritanceInfo& inheritance, uint32_t begin, uint32_t end, const RecordFunction& record, VkCommandBuffer& commandBuffer)
+{
+	commandBuffer = GetSecondary(pools);
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	beginInfo.pInheritanceInfo = &inheritance;
+
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not begin recording secondary command buffer.\n");
+	}
+
+	record(commandBuffer, begin, end);
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Failed to record secondary command buffer.\n");
+	}
+}
@@ -0,0 +1,55 @@
+#include "DeletionQueue.h"
+
+#include <vector>
+
+DeletionQueue::DeletionQueue()
+{
+}
+
+DeletionQueue::~DeletionQueue()
+{
+}
+
+void DeletionQueue::Destroy()
+{
+	Flush(UINT64_MAX);
+}
+
+void DeletionQueue::Push(uint64_t value, std::function<void()> deleter)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	entries.push_back(Entry{ value, std::move(deleter) });
+}
+
+void DeletionQueue::Flush(uint64_t completedValue)
+{
+	//Deleters run outside the lock, they may push follow up work.
+	std::vector<std::function<void()>> ready;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (auto entry = entries.begin(); entry != entries.end();)
+		{
+			if (entry->value <= completedValue)
+			{
+				ready.push_back(std::move(entry->deleter));
+				entry = entries.erase(entry);
+			}
+			else
+			{
+				++entry;
+			}
+		}
+	}
+
+	for (auto& deleter : ready)
+	{
+		deleter();
+	}
+}
+
+size_t DeletionQueue::GetPendingCount()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return entries.size();
+}
@@ -0,0 +1,177 @@
+#include "FrameAllocator.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <algorithm>
+#include <string>
+
+FrameAllocator::FrameAllocator() :
+	memoryAllocator(nullptr),
+	framesInFlight(0u),
+	uniformAlignment(1u),
+	storageAlignment(1u),
+	maxUniformRange(0u),
+	buffer(VK_NULL_HANDLE),
+	allocation(),
+	frameSize(0u),
+	frameSlot(0u),
+	head(0u),
+	peakBytes(0u),
+	frameCount(0u),
+	allocationCount(0u)
+{
+}
+
+FrameAllocator::~FrameAllocator()
+{
+}
+
+void FrameAllocator::Create(VkPhysicalDevice physicalDevice, MemoryAllocator* memoryAllocator, uint32_t framesInFlight, VkDeviceSize bytesPerFrame)
+{
+	this->memoryAllocator = memoryAllocator;
+	this->framesInFlight = framesInFlight;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	uniformAlignment = std::max<VkDeviceSize>(1u, properties.limits.minUniformBufferOffsetAlignment);
+	storageAlignment = std::max<VkDeviceSize>(1u, properties.limits.minStorageBufferOffsetAlignment);
+	maxUniformRange = properties.limits.maxUniformBufferRange;
+
+	Reserve(bytesPerFrame);
+}
+
+void FrameAllocator::Destroy()
+{
+	PrintStatistics();
+	DestroyBuffer();
+}
+
+void FrameAllocator::Reserve(VkDeviceSize bytesPerFrame)
+{
+	//Both alignments are powers of two, so the larger one is a multiple of the smaller.
+	VkDeviceSize alignment = std::max(uniformAlignment, storageAlignment);
+	VkDeviceSize size = (bytesPerFrame + alignment - 1u) & ~(alignment - 1u);
+	if (buffer != VK_NULL_HANDLE && size <= frameSize)
+	{
+		return;
+	}
+
+	DestroyBuffer();
+	frameSize = size;
+	CreateBuffer();
+}
+
+void FrameAllocator::BeginFrame(uint32_t frameSlot)
+{
+	peakBytes = std::max(peakBytes, head.load());
+	this->frameSlot = frameSlot;
+	head.store(0u);
+	frameCount++;
+}
+
+FrameAllocation FrameAllocator::AllocateUniform(VkDeviceSize size)
+{
+	if (size > maxUniformRange)
+	{
+		throw std::runtime_error("ERROR: Uniform frame allocation of " + std::to_string(size) + " bytes exceeds maxUniformBufferRange.\n");
+	}
+
+	return Allocate(size, uniformAlignment);
+}
+
+FrameAllocation FrameAllocator::AllocateStorage(VkDeviceSize size)
+{
+	return Allocate(size, storageAlignment);
+}
+
+VkBuffer FrameAllocator::GetBuffer() const
+{
+	return buffer;
+}
+
+VkDescriptorBufferInfo FrameAllocator::GetDescriptorInfo(VkDeviceSize range) const
+{
+	VkDescriptorBufferInfo info{};
+	info.buffer = buffer;
+	info.offset = 0u;
+	info.range = range;
+	return info;
+}
+
+void FrameAllocator::MakeDynamic(std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+	for (auto& binding : bindings)
+	{
+		if (binding.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+		{
+			binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		}
+		else if (binding.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+		{
+			binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		}
+	}
+}
+
+void FrameAllocator::PrintStatistics()
+{
+	VkDeviceSize peak = std::max(peakBytes, head.load());
+	std::cout << "INFO: Frame allocator used up to " << (peak >> 10) << " of " << (frameSize >> 10) << " KiB per frame, "
+		<< allocationCount.load() << " allocation(s) over " << frameCount << " frame(s).\n";
+}
+
+FrameAllocation FrameAllocator::Allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+	//Lock free bump, recording threads allocate concurrently.
+	VkDeviceSize offset = head.load(std::memory_order_relaxed);
+	VkDeviceSize begin = 0u;
+	VkDeviceSize end = 0u;
+	do
+	{
+		begin = (offset + alignment - 1u) & ~(alignment - 1u);
+		end = begin + size;
+		if (end > frameSize)
+		{
+			throw std::runtime_error("ERROR: Frame allocator is out of memory, " + std::to_string(frameSize) + " bytes per frame are reserved.\n");
+		}
+	} while (!head.compare_exchange_weak(offset, end, std::memory_order_relaxed));
+
+	allocationCount.fetch_add(1u, std::memory_order_relaxed);
+
+	VkDeviceSize bufferOffset = static_cast<VkDeviceSize>(frameSlot) * frameSize + begin;
+
+	FrameAllocation result;
+	result.mapped = static_cast<char*>(allocation.mapped) + bufferOffset;
+	result.dynamicOffset = static_cast<uint32_t>(bufferOffset);
+	result.size = size;
+	return result;
+}
+
+void FrameAllocator::CreateBuffer()
+{
+	VkBufferCreateInfo info{};
+	info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	info.size = frameSize * framesInFlight;
+	info.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+	info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	//Dynamic offsets are 32 bit.
+	if (info.size > UINT32_MAX)
+	{
+		throw std::runtime_error("ERROR: Frame allocator of " + std::to_string(info.size) + " bytes can not be addressed with dynamic offsets.\n");
+	}
+
+	memoryAllocator->CreateBuffer(info, MemoryUsage::Upload, buffer, allocation);
+	head.store(0u);
+}
+
+void FrameAllocator::DestroyBuffer()
+{
+	if (buffer == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	memoryAllocator->DestroyBuffer(buffer, allocation);
+	buffer = VK_NULL_HANDLE;
+}
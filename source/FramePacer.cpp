@@ -0,0 +1,169 @@
+#include "FramePacer.h"
+
+#include <iostream>
+#include <thread>
+
+FramePacer::FramePacer() :
+	device(VK_NULL_HANDLE),
+	waitForPresentKHR(nullptr),
+	waitForPresent(false),
+	profiler(nullptr),
+	framePeriod(0),
+	nextFrame(),
+	nextPresentId(1u),
+	presentIdValue(0u),
+	presentId(),
+	inputTime(0),
+	acquireTime(0),
+	pending({})
+{
+}
+
+FramePacer::~FramePacer()
+{
+}
+
+void FramePacer::Create(VkDevice device, bool presentWaitSupported, bool waitForPresent, double frameRateLimit, Profiler* profiler)
+{
+	this->device = device;
+	this->profiler = profiler;
+	nextFrame = std::chrono::steady_clock::now();
+
+	if (frameRateLimit > 0.0)
+	{
+		framePeriod = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / frameRateLimit));
+	}
+
+	if (presentWaitSupported)
+	{
+		waitForPresentKHR = reinterpret_cast<PFN_vkWaitForPresentKHR>(vkGetDeviceProcAddr(device, "vkWaitForPresentKHR"));
+	}
+
+	this->waitForPresent = waitForPresent && waitForPresentKHR != nullptr;
+	if (waitForPresent && waitForPresentKHR == nullptr)
+	{
+		std::cout << "WARNING: VK_KHR_present_wait is not supported, frames do not wait for the previous present.\n";
+	}
+	if (waitForPresentKHR == nullptr && presentWaitSupported)
+	{
+		std::cout << "WARNING: Could not load vkWaitForPresentKHR, present latency is not measured.\n";
+	}
+}
+
+void FramePacer::Destroy()
+{
+	pending.clear();
+	device = VK_NULL_HANDLE;
+}
+
+void FramePacer::WaitForNextFrame(VkSwapchainKHR swapchain)
+{
+	if (framePeriod.count() != 0)
+	{
+		//Sleep to the deadline. A frame that ran late starts a new schedule instead of rushing to catch up.
+		auto now = std::chrono::steady_clock::now();
+		if (nextFrame > now)
+		{
+			std::this_thread::sleep_until(nextFrame);
+			nextFrame += framePeriod;
+		}
+		else
+		{
+			nextFrame = now + framePeriod;
+		}
+	}
+
+	if (!waitForPresent || swapchain == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	//Presents that already completed are timed by the poll, only the newest one is blocked on.
+	Update(swapchain);
+	if (!pending.empty())
+	{
+		//One second timeout keeps a lost present from hanging the loop.
+		VkResult result = waitForPresentKHR(device, swapchain, pending.back().presentId, 1000000000ull);
+		if (result == VK_SUCCESS)
+		{
+			//Presents complete in order, whatever is left finished just now.
+			int64_t now = Profiler::GetCpuTime();
+			for (auto& older : pending)
+			{
+				CompletePresent(older, now);
+			}
+			pending.clear();
+		}
+		else if (result != VK_TIMEOUT)
+		{
+			pending.clear();
+		}
+	}
+}
+
+void FramePacer::MarkInput()
+{
+	inputTime = Profiler::GetCpuTime();
+}
+
+void FramePacer::MarkAcquire()
+{
+	acquireTime = Profiler::GetCpuTime();
+}
+
+const void* FramePacer::GetPresentNext()
+{
+	if (waitForPresentKHR == nullptr)
+	{
+		return nullptr;
+	}
+
+	presentIdValue = nextPresentId++;
+	pending.push_back(PendingPresent{ presentIdValue, inputTime, acquireTime });
+
+	presentId = VkPresentIdKHR{};
+	presentId.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+	presentId.swapchainCount = 1;
+	presentId.pPresentIds = &presentIdValue;
+	return &presentId;
+}
+
+void FramePacer::Update(VkSwapchainKHR swapchain)
+{
+	if (waitForPresentKHR == nullptr)
+	{
+		return;
+	}
+
+	//Zero timeout only polls. Presents complete in order, so the first one still pending ends the scan.
+	while (!pending.empty())
+	{
+		VkResult result = waitForPresentKHR(device, swapchain, pending.front().presentId, 0u);
+		if (result == VK_TIMEOUT)
+		{
+			break;
+		}
+
+		if (result == VK_SUCCESS)
+		{
+			CompletePresent(pending.front(), Profiler::GetCpuTime());
+		}
+		pending.pop_front();
+	}
+}
+
+void FramePacer::ResetSwapchain()
+{
+	pending.clear();
+}
+
+void FramePacer::CompletePresent(const PendingPresent& present, int64_t presentTime)
+{
+	if (profiler == nullptr)
+	{
+		return;
+	}
+
+	profiler->RecordCpuScope("Acquire to present", present.acquireTime, presentTime);
+	profiler->RecordCpuScope("Input to present", present.inputTime, presentTime);
+}
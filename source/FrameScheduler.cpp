@@ -0,0 +1,305 @@
+#include "FrameScheduler.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <chrono>
+
+FrameScheduler::FrameScheduler() :
+	device(VK_NULL_HANDLE),
+	hostAllocator(nullptr),
+	semaphore(VK_NULL_HANDLE),
+	framesInFlight(0u),
+	frameNumber(0u),
+	frameSlot(0u),
+	queryPool(VK_NULL_HANDLE),
+	timestampPeriod(0.0),
+	timestampMask(0u),
+	lastEndTimestamp(0u),
+	slotFrames({}),
+	slotCpuWaits({}),
+	slotTimed({}),
+	lastTiming(),
+	totalCpuWait(0.0),
+	totalGpuIdle(0.0),
+	totalGpuBusy(0.0),
+	retiredFrames(0u),
+	timedFrames(0u)
+{
+}
+
+FrameScheduler::~FrameScheduler()
+{
+}
+
+void FrameScheduler::Create(VkPhysicalDevice physicalDevice, VkDevice device, HostAllocator* hostAllocator, uint32_t queueFamilyIndex, uint32_t framesInFlight)
+{
+	this->device = device;
+	this->hostAllocator = hostAllocator;
+	this->framesInFlight = framesInFlight;
+	frameNumber = 0u;
+	frameSlot = 0u;
+
+	VkSemaphoreTypeCreateInfo typeInfo{};
+	typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	typeInfo.initialValue = 0u;
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreInfo.pNext = &typeInfo;
+
+	if (vkCreateSemaphore(device, &semaphoreInfo, hostAllocator->Get(VK_OBJECT_TYPE_SEMAPHORE), &semaphore) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not create frame semaphore.\n");
+	}
+
+	//GPU timing is optional, the queue family has to support timestamps.
+	uint32_t familyCount = 0u;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+
+	uint32_t validBits = families[queueFamilyIndex].timestampValidBits;
+	slotFrames.assign(framesInFlight, UINT64_MAX);
+	slotCpuWaits.assign(framesInFlight, 0.0);
+	slotTimed.assign(framesInFlight, false);
+
+	if (validBits != 0u)
+	{
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		timestampPeriod = properties.limits.timestampPeriod;
+		timestampMask = validBits >= 64u ? UINT64_MAX : (1ull << validBits) - 1u;
+
+		VkQueryPoolCreateInfo queryInfo{};
+		queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryInfo.queryCount = 2u * framesInFlight;
+
+		if (vkCreateQueryPool(device, &queryInfo, hostAllocator->Get(VK_OBJECT_TYPE_QUERY_POOL), &queryPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("ERROR: Could not create frame query pool.\n");
+		}
+	}
+	else
+	{
+		std::cout << "WARNING: Queue family " << queueFamilyIndex << " does not support timestamps, GPU idle time is not measured.\n";
+	}
+}
+
+void FrameScheduler::Destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	WaitIdle();
+
+	//Frames still in the slots have finished now, oldest first.
+	for (uint64_t frame = frameNumber > framesInFlight ? frameNumber - framesInFlight : 0u; frame < frameNumber; frame++)
+	{
+		RetireFrame(static_cast<uint32_t>(frame % framesInFlight));
+	}
+
+	if (retiredFrames != 0u)
+	{
+		std::cout << "INFO: " << framesInFlight << " frame(s) in flight, per frame average: CPU wait " << totalCpuWait / retiredFrames << " ms";
+		if (timedFrames != 0u)
+		{
+			std::cout << ", GPU idle " << totalGpuIdle / timedFrames << " ms, GPU busy " << totalGpuBusy / timedFrames << " ms";
+		}
+		std::cout << ".\n";
+	}
+
+	if (queryPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(device, queryPool, hostAllocator->Get(VK_OBJECT_TYPE_QUERY_POOL));
+		queryPool = VK_NULL_HANDLE;
+	}
+	vkDestroySemaphore(device, semaphore, hostAllocator->Get(VK_OBJECT_TYPE_SEMAPHORE));
+	device = VK_NULL_HANDLE;
+}
+
+uint32_t FrameScheduler::BeginFrame()
+{
+	frameSlot = static_cast<uint32_t>(frameNumber % framesInFlight);
+
+	auto start = std::chrono::steady_clock::now();
+
+	//Slot was last used by frame (frameNumber - framesInFlight), which signals the value one above its number.
+	if (frameNumber >= framesInFlight)
+	{
+		uint64_t value = frameNumber - framesInFlight + 1u;
+
+		VkSemaphoreWaitInfo waitInfo{};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &semaphore;
+		waitInfo.pValues = &value;
+
+		if (vkWaitSemaphores(device, &waitInfo, UINT64_MAX) != VK_SUCCESS)
+		{
+			throw std::runtime_error("ERROR: Could not wait for frame semaphore.\n");
+		}
+	}
+
+	double cpuWait = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	RetireFrame(frameSlot);
+	slotFrames[frameSlot] = frameNumber;
+	slotCpuWaits[frameSlot] = cpuWait;
+	slotTimed[frameSlot] = false;
+
+	return frameSlot;
+}
+
+void FrameScheduler::RecordFrameStart(VkCommandBuffer commandBuffer)
+{
+	if (queryPool == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	vkCmdResetQueryPool(commandBuffer, queryPool, 2u * frameSlot, 2u);
+	vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, queryPool, 2u * frameSlot);
+}
+
+void FrameScheduler::RecordFrameEnd(VkCommandBuffer commandBuffer)
+{
+	if (queryPool == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, queryPool, 2u * frameSlot + 1u);
+	slotTimed[frameSlot] = true;
+}
+
+void FrameScheduler::Submit(VkQueue queue, const std::vector<VkCommandBuffer>& commandBuffers, const std::vector<VkSemaphoreSubmitInfo>& waits, const std::vector<VkSemaphoreSubmitInfo>& signals)
+{
+	std::vector<VkCommandBufferSubmitInfo> commandBufferInfos;
+	for (auto commandBuffer : commandBuffers)
+	{
+		VkCommandBufferSubmitInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+		info.commandBuffer = commandBuffer;
+		commandBufferInfos.push_back(info);
+	}
+
+	std::vector<VkSemaphoreSubmitInfo> signalInfos = signals;
+
+	VkSemaphoreSubmitInfo frameSignal{};
+	frameSignal.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+	frameSignal.semaphore = semaphore;
+	frameSignal.value = GetFrameValue();
+	frameSignal.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	signalInfos.push_back(frameSignal);
+
+	VkSubmitInfo2 submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+	submitInfo.waitSemaphoreInfoCount = static_cast<uint32_t>(waits.size());
+	submitInfo.pWaitSemaphoreInfos = waits.data();
+	submitInfo.commandBufferInfoCount = static_cast<uint32_t>(commandBufferInfos.size());
+	submitInfo.pCommandBufferInfos = commandBufferInfos.data();
+	submitInfo.signalSemaphoreInfoCount = static_cast<uint32_t>(signalInfos.size());
+	submitInfo.pSignalSemaphoreInfos = signalInfos.data();
+
+	if (vkQueueSubmit2(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not submit to queue.\n");
+	}
+
+	frameNumber++;
+}
+
+void FrameScheduler::WaitIdle()
+{
+	if (frameNumber == 0u)
+	{
+		return;
+	}
+
+	VkSemaphoreWaitInfo waitInfo{};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &semaphore;
+	waitInfo.pValues = &frameNumber;
+
+	vkWaitSemaphores(device, &waitInfo, UINT64_MAX);
+}
+
+uint32_t FrameScheduler::GetFramesInFlight() const
+{
+	return framesInFlight;
+}
+
+uint32_t FrameScheduler::GetFrameSlot() const
+{
+	return frameSlot;
+}
+
+uint64_t FrameScheduler::GetFrameNumber() const
+{
+	return frameNumber;
+}
+
+uint64_t FrameScheduler::GetFrameValue() const
+{
+	return frameNumber + 1u;
+}
+
+uint64_t FrameScheduler::GetCompletedValue() const
+{
+	uint64_t value = 0u;
+	vkGetSemaphoreCounterValue(device, semaphore, &value);
+	return value;
+}
+
+VkSemaphore FrameScheduler::GetSemaphore() const
+{
+	return semaphore;
+}
+
+const FrameTiming& FrameScheduler::GetLastTiming() const
+{
+	return lastTiming;
+}
+
+void FrameScheduler::RetireFrame(uint32_t slot)
+{
+	if (slotFrames[slot] == UINT64_MAX)
+	{
+		return;
+	}
+
+	lastTiming = FrameTiming{};
+	lastTiming.frame = slotFrames[slot];
+	lastTiming.cpuWaitMs = slotCpuWaits[slot];
+	totalCpuWait += lastTiming.cpuWaitMs;
+	retiredFrames++;
+	slotFrames[slot] = UINT64_MAX;
+
+	if (!slotTimed[slot])
+	{
+		return;
+	}
+
+	uint64_t timestamps[2] = {};
+	if (vkGetQueryPoolResults(device, queryPool, 2u * slot, 2u, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+	{
+		return;
+	}
+
+	//Frames finish in submission order, so the previous end timestamp belongs to the frame right before this one.
+	double ticksToMs = timestampPeriod * 1e-6;
+	lastTiming.gpuBusyMs = ((timestamps[1] - timestamps[0]) & timestampMask) * ticksToMs;
+	lastTiming.gpuIdleMs = lastEndTimestamp != 0u && timestamps[0] > lastEndTimestamp ? (timestamps[0] - lastEndTimestamp) * ticksToMs : 0.0;
+	lastEndTimestamp = timestamps[1];
+	lastTiming.gpuBegin = timestamps[0];
+	lastTiming.gpuEnd = timestamps[1];
+
+	totalGpuIdle += lastTiming.gpuIdleMs;
+	totalGpuBusy += lastTiming.gpuBusyMs;
+	timedFrames++;
+}
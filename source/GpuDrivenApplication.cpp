@@ -0,0 +1,491 @@
+#include "GpuDrivenApplication.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <algorithm>
+#include <random>
+#include <cmath>
+#include <iterator>
+#include <set>
+
+namespace
+{
+	//Must match local_size_x in cull.comp.
+	const uint32_t cullingGroupSize = 64u;
+	//Objects sit on a grid with this spacing in world units.
+	const float objectSpacing = 1.f;
+}
+
+GpuDrivenApplication::GpuDrivenApplication(const ApplicationSettings& settings) :
+	TriangleApplication(settings),
+	objectCount(0u),
+	worldSize(0.f),
+	drawConstants(),
+	cullingConstants(),
+	vertexBuffer(VK_NULL_HANDLE),
+	vertexAllocation(),
+	indexBuffer(VK_NULL_HANDLE),
+	indexAllocation(),
+	meshBuffer(VK_NULL_HANDLE),
+	meshAllocation(),
+	meshCount(0u),
+	objectBuffer(VK_NULL_HANDLE),
+	objectAllocation(),
+	uploadToken(0u),
+	sharingFamilies({}),
+	drawBuffers({}),
+	drawAllocations({}),
+	drawCountBuffers({}),
+	drawCountAllocations({}),
+	drawHandles({}),
+	drawCountHandles({}),
+	textureStreamer(),
+	textures({}),
+	sampler(VK_NULL_HANDLE),
+	cullingPipeline(VK_NULL_HANDLE),
+	drawPipeline(VK_NULL_HANDLE)
+{
+	Initialise();
+}
+
+GpuDrivenApplication::~GpuDrivenApplication()
+{
+	Destroy();
+}
+
+void GpuDrivenApplication::Initialise()
+{
+	std::set<uint32_t> families = { graphicsFamilyIndex, computeFamilyIndex, transferFamilyIndex };
+	sharingFamilies.assign(families.begin(), families.end());
+
+	CreateGeometry();
+	CreateObjects();
+	CreateDrawBuffers();
+	CreateBindlessHandles();
+	CreateTextures();
+	CreatePipelines();
+
+	std::cout << "INFO: " << objectCount << " objects culled on the GPU.\n";
+}
+
+void GpuDrivenApplication::Destroy()
+{
+	frameScheduler.WaitIdle();
+
+	DestroyTextures();
+	DestroyBindlessHandles();
+	DestroyDrawBuffers();
+	DestroyObjects();
+	DestroyGeometry();
+}
+
+void GpuDrivenApplication::UpdateFrame(uint32_t frameSlot)
+{
+	//Camera orbits the world and zooms in and out, so the visible object count changes every frame.
+	float time = static_cast<float>(frameScheduler.GetFrameNumber()) / 60.f;
+	float centerX = worldSize * 0.3f * std::cos(time * 0.2f);
+	float centerY = worldSize * 0.3f * std::sin(time * 0.2f);
+	float viewWidth = 16.f + worldSize * 0.5f * (0.5f + 0.5f * std::sin(time * 0.5f));
+
+	float scaleX = 2.f / viewWidth;
+	float scaleY = scaleX * static_cast<float>(swapchainExtent.width) / static_cast<float>(swapchainExtent.height);
+
+	//Column major orthographic projection, objects lie in the z = 0 plane and land halfway into the depth range.
+	float* viewProjection = drawConstants.viewProjection;
+	std::fill(viewProjection, viewProjection + 16, 0.f);
+	viewProjection[0] = scaleX;
+	viewProjection[5] = scaleY;
+	viewProjection[12] = -scaleX * centerX;
+	viewProjection[13] = -scaleY * centerY;
+	viewProjection[14] = 0.5f;
+	viewProjection[15] = 1.f;
+
+	ExtractFrustumPlanes(viewProjection, cullingConstants.planes);
+	cullingConstants.objectCount = objectCount;
+
+	//BeginFrame freed the slot, so the graphics queue is done with its draw buffers and culling can start right away.
+	//Ownership is not handed back, culling rewrites the buffers from scratch.
+	VkCommandBuffer computeBuffer = asyncCompute.Begin(frameSlot);
+	RecordCulling(computeBuffer, frameSlot);
+	asyncCompute.Release(drawBuffers[frameSlot], VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+		VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+	asyncCompute.Release(drawCountBuffers[frameSlot], VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+		VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+
+	std::vector<VkSemaphoreSubmitInfo> computeWaits;
+	if (uploadToken != 0u)
+	{
+		VkSemaphoreSubmitInfo uploadWait{};
+		uploadWait.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+		uploadWait.semaphore = uploadManager.GetSemaphore();
+		uploadWait.value = uploadToken;
+		uploadWait.stageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+		computeWaits.push_back(uploadWait);
+		uploadToken = 0u;
+	}
+	asyncCompute.Submit(computeWaits);
+
+	//Every object has the same size on screen, so each texture asks for the width of one object in pixels.
+	float objectPixels = objectSpacing * 0.8f * scaleX * static_cast<float>(swapchainExtent.width) * 0.5f;
+	for (auto texture : textures)
+	{
+		textureStreamer.RequestSize(texture, objectPixels);
+	}
+
+	//Uploads are flushed here so this frame's acquire barriers pick them up.
+	textureStreamer.Update(frameScheduler.GetFrameValue());
+	for (uint32_t i = 0; i < textures.size(); i++)
+	{
+		drawConstants.textures[i] = textureStreamer.GetHandle(textures[i]);
+	}
+}
+
+void GpuDrivenApplication::AddPasses(uint32_t backbuffer)
+{
+	//Draw buffers come from the compute queue, the frame acquires them and waits for culling before the graph runs.
+	uint32_t streaming = renderGraph.AddPass("Texture streaming", [this](VkCommandBuffer commandBuffer) { textureStreamer.RecordCommands(commandBuffer); });
+	renderGraph.SetSideEffects(streaming);
+
+	AddMainPass(backbuffer);
+}
+
+void GpuDrivenApplication::RecordCulling(VkCommandBuffer commandBuffer, uint32_t frameSlot)
+{
+	vkCmdFillBuffer(commandBuffer, drawCountBuffers[frameSlot], 0u, sizeof(uint32_t), 0u);
+
+	//Culling is recorded outside the render graph, the clear is ordered before the dispatch by hand.
+	VkMemoryBarrier2 clearBarrier{};
+	clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+	clearBarrier.srcStageMask = VK_PIPELINE_STAGE_2_CLEAR_BIT;
+	clearBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	clearBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	clearBarrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+
+	VkDependencyInfo clearDependency{};
+	clearDependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	clearDependency.memoryBarrierCount = 1;
+	clearDependency.pMemoryBarriers = &clearBarrier;
+	vkCmdPipelineBarrier2(commandBuffer, &clearDependency);
+
+	cullingConstants.drawBuffer = drawHandles[frameSlot];
+	cullingConstants.drawCountBuffer = drawCountHandles[frameSlot];
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullingPipeline);
+	bindlessTable.Bind(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE);
+	vkCmdPushConstants(commandBuffer, bindlessTable.GetPipelineLayout(), VK_SHADER_STAGE_ALL, 0, sizeof(CullingConstants), &cullingConstants);
+	vkCmdDispatch(commandBuffer, (objectCount + cullingGroupSize - 1u) / cullingGroupSize, 1, 1);
+}
+
+uint32_t GpuDrivenApplication::GetDrawCount()
+{
+	//Everything is one indirect draw, there is nothing to split between threads.
+	return 1u;
+}
+
+void GpuDrivenApplication::RecordDraws(VkCommandBuffer commandBuffer, uint32_t frameSlot, uint32_t begin, uint32_t end)
+{
+	Profiler::CpuScope scope(profiler, "RecordDraws");
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, drawPipeline);
+	SetViewportAndScissor(commandBuffer);
+	bindlessTable.Bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS);
+	vkCmdPushConstants(commandBuffer, bindlessTable.GetPipelineLayout(), VK_SHADER_STAGE_ALL, 0, sizeof(DrawConstants), &drawConstants);
+
+	VkDeviceSize offset = 0u;
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, &offset);
+	vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0u, VK_INDEX_TYPE_UINT16);
+
+	vkCmdDrawIndexedIndirectCount(commandBuffer, drawBuffers[frameSlot], 0u, drawCountBuffers[frameSlot], 0u, objectCount, sizeof(VkDrawIndexedIndirectCommand));
+}
+
+void GpuDrivenApplication::ExtractFrustumPlanes(const float viewProjection[16], float planes[6][4])
+{
+	//Gribb and Hartmann: each plane is the last row of the column major matrix plus or minus another row. Vulkan clip
+	//space depth runs from 0 to w, so the near plane is the third row on its own.
+	auto row = [&](uint32_t index, uint32_t component) { return viewProjection[component * 4u + index]; };
+
+	for (uint32_t component = 0; component < 4u; component++)
+	{
+		planes[0][component] = row(3u, component) + row(0u, component);
+		planes[1][component] = row(3u, component) - row(0u, component);
+		planes[2][component] = row(3u, component) + row(1u, component);
+		planes[3][component] = row(3u, component) - row(1u, component);
+		planes[4][component] = row(2u, component);
+		planes[5][component] = row(3u, component) - row(2u, component);
+	}
+
+	//Normalised planes give signed distances that compare directly against sphere radii. Planes without a normal, such
+	//as the depth planes of a flat scene, are constant and left untouched.
+	for (uint32_t i = 0; i < 6u; i++)
+	{
+		float length = std::sqrt(planes[i][0] * planes[i][0] + planes[i][1] * planes[i][1] + planes[i][2] * planes[i][2]);
+		if (length > 0.f)
+		{
+			for (uint32_t component = 0; component < 4u; component++)
+			{
+				planes[i][component] /= length;
+			}
+		}
+	}
+}
+
+void GpuDrivenApplication::CreateGeometry()
+{
+	//Triangle followed by a quad, wound clockwise like the triangle scene.
+	const float vertices[] = {
+		0.f, -0.5f, 0.5f, 0.5f, -0.5f, 0.5f,
+		-0.5f, -0.5f, 0.5f, -0.5f, 0.5f, 0.5f, -0.5f, 0.5f
+	};
+	const uint16_t indices[] = { 0, 1, 2, 0, 1, 2, 0, 2, 3 };
+	const MeshData meshes[] = {
+		{ 3u, 0u, 0, 0u },
+		{ 6u, 3u, 3, 0u }
+	};
+	meshCount = static_cast<uint32_t>(std::size(meshes));
+
+	VkBufferCreateInfo info{};
+	info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	info.size = sizeof(vertices);
+	info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	memoryAllocator.CreateBuffer(info, MemoryUsage::GpuOnly, vertexBuffer, vertexAllocation);
+	uploadManager.UploadBuffer(vertexBuffer, 0u, vertices, sizeof(vertices));
+
+	info.size = sizeof(indices);
+	info.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	memoryAllocator.CreateBuffer(info, MemoryUsage::GpuOnly, indexBuffer, indexAllocation);
+	uploadManager.UploadBuffer(indexBuffer, 0u, indices, sizeof(indices));
+
+	//Only culling reads the meshes.
+	info.size = sizeof(meshes);
+	info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	SetSharedAcrossQueues(info);
+	memoryAllocator.CreateBuffer(info, MemoryUsage::GpuOnly, meshBuffer, meshAllocation);
+	uploadManager.UploadBuffer(meshBuffer, 0u, meshes, sizeof(meshes), info.sharingMode == VK_SHARING_MODE_CONCURRENT);
+}
+
+void GpuDrivenApplication::DestroyGeometry()
+{
+	memoryAllocator.DestroyBuffer(meshBuffer, meshAllocation);
+	memoryAllocator.DestroyBuffer(indexBuffer, indexAllocation);
+	memoryAllocator.DestroyBuffer(vertexBuffer, vertexAllocation);
+	meshBuffer = VK_NULL_HANDLE;
+	indexBuffer = VK_NULL_HANDLE;
+	vertexBuffer = VK_NULL_HANDLE;
+}
+
+void GpuDrivenApplication::CreateObjects()
+{
+	VkPhysicalDeviceProperties properties{};
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	uint32_t limit = std::min(properties.limits.maxStorageBufferRange / static_cast<uint32_t>(sizeof(ObjectData)), properties.limits.maxDrawIndirectCount);
+	objectCount = std::min(settings.objectCount, limit);
+	if (objectCount != settings.objectCount)
+	{
+		std::cout << "WARNING: Device limits allow " << limit << " objects, using " << objectCount << ".\n";
+	}
+
+	//Static square grid centered on the origin, every object gets a random mesh, rotation and color.
+	uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(objectCount))));
+	worldSize = static_cast<float>(side) * objectSpacing;
+
+	std::mt19937 random(1234u);
+	std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+	std::vector<ObjectData> objects(objectCount);
+	for (uint32_t i = 0; i < objectCount; i++)
+	{
+		ObjectData& object = objects[i];
+		float scale = objectSpacing * 0.8f;
+		object.transform[0] = (static_cast<float>(i % side) + 0.5f) * objectSpacing - worldSize * 0.5f;
+		object.transform[1] = (static_cast<float>(i / side) + 0.5f) * objectSpacing - worldSize * 0.5f;
+		object.transform[2] = unit(random) * 6.2831853f;
+		object.transform[3] = scale;
+
+		//Both meshes fit in a circle of radius sqrt(0.5) around their origin.
+		object.bounds[0] = object.transform[0];
+		object.bounds[1] = object.transform[1];
+		object.bounds[2] = 0.f;
+		object.bounds[3] = 0.7072f * scale;
+
+		object.color[0] = 0.2f + 0.8f * unit(random);
+		object.color[1] = 0.2f + 0.8f * unit(random);
+		object.color[2] = 0.2f + 0.8f * unit(random);
+		object.color[3] = 1.f;
+
+		object.mesh[0] = static_cast<uint32_t>(random() % meshCount);
+		object.mesh[1] = static_cast<uint32_t>(i % std::max<size_t>(settings.texturePaths.size(), 1u));
+		object.mesh[2] = 0u;
+		object.mesh[3] = 0u;
+	}
+
+	VkBufferCreateInfo info{};
+	info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	info.size = objects.size() * sizeof(ObjectData);
+	info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	SetSharedAcrossQueues(info);
+	memoryAllocator.CreateBuffer(info, MemoryUsage::GpuOnly, objectBuffer, objectAllocation);
+
+	//Culling and drawing both read the objects, concurrent sharing saves releasing them to each queue. The first culling
+	//submission waits for the upload, the first frame acquires the exclusive geometry buffers.
+	uploadManager.UploadBuffer(objectBuffer, 0u, objects.data(), info.size, info.sharingMode == VK_SHARING_MODE_CONCURRENT);
+	uploadToken = uploadManager.Flush();
+}
+
+void GpuDrivenApplication::DestroyObjects()
+{
+	memoryAllocator.DestroyBuffer(objectBuffer, objectAllocation);
+	objectBuffer = VK_NULL_HANDLE;
+}
+
+void GpuDrivenApplication::CreateDrawBuffers()
+{
+	//Worst case every object is visible. Draw buffers stay exclusive and are released to the graphics queue after
+	//culling, concurrent access can cost bandwidth on buffers this large.
+	uint32_t framesInFlight = settings.framesInFlight;
+	drawBuffers.assign(framesInFlight, VK_NULL_HANDLE);
+	drawAllocations.assign(framesInFlight, Allocation{});
+	drawCountBuffers.assign(framesInFlight, VK_NULL_HANDLE);
+	drawCountAllocations.assign(framesInFlight, Allocation{});
+
+	VkBufferCreateInfo info{};
+	info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	for (uint32_t i = 0; i < framesInFlight; i++)
+	{
+		info.size = static_cast<VkDeviceSize>(objectCount) * sizeof(VkDrawIndexedIndirectCommand);
+		info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+		memoryAllocator.CreateBuffer(info, MemoryUsage::GpuOnly, drawBuffers[i], drawAllocations[i]);
+
+		info.size = sizeof(uint32_t);
+		info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		memoryAllocator.CreateBuffer(info, MemoryUsage::GpuOnly, drawCountBuffers[i], drawCountAllocations[i]);
+	}
+}
+
+void GpuDrivenApplication::DestroyDrawBuffers()
+{
+	for (uint32_t i = 0; i < drawBuffers.size(); i++)
+	{
+		memoryAllocator.DestroyBuffer(drawCountBuffers[i], drawCountAllocations[i]);
+		memoryAllocator.DestroyBuffer(drawBuffers[i], drawAllocations[i]);
+	}
+	drawCountBuffers.clear();
+	drawCountAllocations.clear();
+	drawBuffers.clear();
+	drawAllocations.clear();
+}
+
+void GpuDrivenApplication::SetSharedAcrossQueues(VkBufferCreateInfo& info)
+{
+	if (sharingFamilies.size() > 1u)
+	{
+		info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		info.queueFamilyIndexCount = static_cast<uint32_t>(sharingFamilies.size());
+		info.pQueueFamilyIndices = sharingFamilies.data();
+	}
+	else
+	{
+		info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		info.queueFamilyIndexCount = 0u;
+		info.pQueueFamilyIndices = nullptr;
+	}
+}
+
+void GpuDrivenApplication::CreateBindlessHandles()
+{
+	cullingConstants.objectBuffer = bindlessTable.AddStorageBuffer(objectBuffer);
+	cullingConstants.meshBuffer = bindlessTable.AddStorageBuffer(meshBuffer);
+	for (uint32_t i = 0; i < drawBuffers.size(); i++)
+	{
+		drawHandles.push_back(bindlessTable.AddStorageBuffer(drawBuffers[i]));
+		drawCountHandles.push_back(bindlessTable.AddStorageBuffer(drawCountBuffers[i]));
+	}
+	drawConstants.objectBuffer = cullingConstants.objectBuffer;
+}
+
+void GpuDrivenApplication::DestroyBindlessHandles()
+{
+	//The GPU is idle, handles can go back to the table right away.
+	bindlessTable.FreeStorageBuffer(cullingConstants.objectBuffer);
+	bindlessTable.FreeStorageBuffer(cullingConstants.meshBuffer);
+	for (uint32_t i = 0; i < drawHandles.size(); i++)
+	{
+		bindlessTable.FreeStorageBuffer(drawHandles[i]);
+		bindlessTable.FreeStorageBuffer(drawCountHandles[i]);
+	}
+	drawHandles.clear();
+	drawCountHandles.clear();
+}
+
+void GpuDrivenApplication::CreateTextures()
+{
+	if (settings.texturePaths.size() > std::size(drawConstants.textures))
+	{
+		throw std::runtime_error("ERROR: The GPU driven scene takes at most " + std::to_string(std::size(drawConstants.textures)) + " textures.\n");
+	}
+
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+	if (vkCreateSampler(device, &samplerInfo, hostAllocator.Get(VK_OBJECT_TYPE_SAMPLER), &sampler) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not create sampler.\n");
+	}
+
+	//Two I/O workers keep decoding off the main thread without competing with the recording workers.
+	textureStreamer.Create(device, &hostAllocator, &memoryAllocator, &uploadManager, &bindlessTable, &deletionQueue,
+		static_cast<VkDeviceSize>(settings.textureBudget) << 20, 2u);
+
+	for (auto& path : settings.texturePaths)
+	{
+		textures.push_back(textureStreamer.Load(path));
+	}
+
+	drawConstants.sampler = bindlessTable.AddSampler(sampler);
+	drawConstants.textureCount = static_cast<uint32_t>(textures.size());
+	for (uint32_t i = 0; i < textures.size(); i++)
+	{
+		drawConstants.textures[i] = textureStreamer.GetHandle(textures[i]);
+	}
+}
+
+void GpuDrivenApplication::DestroyTextures()
+{
+	textureStreamer.Destroy();
+	textures.clear();
+
+	bindlessTable.FreeSampler(drawConstants.sampler);
+	vkDestroySampler(device, sampler, hostAllocator.Get(VK_OBJECT_TYPE_SAMPLER));
+	sampler = VK_NULL_HANDLE;
+}
+
+void GpuDrivenApplication::CreatePipelines()
+{
+	//Runtime descriptor arrays can not be sized by reflection, bindless pipelines always use the table's layout.
+	ComputePipelineDescription cullingDescription{};
+	cullingDescription.computeShader = "shader/cull.comp";
+	cullingDescription.layout = bindlessTable.GetPipelineLayout();
+
+	GraphicsPipelineDescription drawDescription{};
+	drawDescription.vertexShader = "shader/gpu_driven.vert";
+	drawDescription.fragmentShader = "shader/gpu_driven.frag";
+	drawDescription.attachments = mainPassFormats;
+	drawDescription.layout = bindlessTable.GetPipelineLayout();
+
+	//Both compile in parallel on the builder's workers.
+	std::shared_future<VkPipeline> culling = pipelineBuilder.Submit(cullingDescription);
+	std::shared_future<VkPipeline> draw = pipelineBuilder.Submit(drawDescription);
+	cullingPipeline = culling.get();
+	drawPipeline = draw.get();
+}
@@ -0,0 +1,413 @@
+#include "HostAllocator.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <algorithm>
+#include <new>
+#include <cstring>
+
+#include <vulkan/vk_enum_string_helper.h>
+
+namespace
+{
+	//Stored in the 16 bytes in front of every allocation.
+	struct BlockHeader
+	{
+		uint64_t size;
+		//Distance from the start of the block to the allocation.
+		uint32_t offset;
+		uint8_t source;
+		uint8_t scope;
+		uint16_t type;
+	};
+	static_assert(sizeof(BlockHeader) == 16u);
+
+	const size_t headerSize = sizeof(BlockHeader);
+	const uint8_t arenaSource = 0xFEu;
+	const uint8_t largeSource = 0xFFu;
+	//Smallest class holds 32 bytes including the header, every further class doubles.
+	const size_t minimumBlockSize = 32u;
+	const size_t slabSize = 64u << 10;
+	const size_t slabAlignment = 64u;
+	const size_t arenaSize = 256u << 10;
+	const size_t maxRecordCount = 256u;
+
+	//Command scope allocations are freed before the call that made them returns, always on the calling thread.
+	struct Arena
+	{
+		char* data = nullptr;
+		size_t offset = 0u;
+		uint32_t liveCount = 0u;
+
+		~Arena()
+		{
+			if (data != nullptr)
+			{
+				::operator delete(data, std::align_val_t(slabAlignment));
+			}
+		}
+	};
+
+	thread_local Arena arena;
+
+	BlockHeader* GetHeader(void* memory)
+	{
+		return reinterpret_cast<BlockHeader*>(static_cast<char*>(memory) - headerSize);
+	}
+
+	char* AlignUp(char* pointer, size_t alignment)
+	{
+		uintptr_t value = reinterpret_cast<uintptr_t>(pointer);
+		return pointer + (((value + alignment - 1u) & ~(static_cast<uintptr_t>(alignment) - 1u)) - value);
+	}
+}
+
+void HostAllocator::Counter::Add(int64_t bytes)
+{
+	int64_t live = liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+	int64_t peak = peakBytes.load(std::memory_order_relaxed);
+	while (live > peak && !peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+	{
+	}
+	allocationCount.fetch_add(1u, std::memory_order_relaxed);
+}
+
+void HostAllocator::Counter::Remove(int64_t bytes)
+{
+	liveBytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+HostAllocator::HostAllocator() :
+	recordMutex(),
+	records(),
+	sizeClasses(),
+	scopeCounters(),
+	internalScopeCounters(),
+	arenaAllocationCount(0u),
+	arenaOverflowCount(0u),
+	largeAllocationCount(0u)
+{
+	//Allocations find their type record by index without a lock, so the records never move.
+	records.reserve(maxRecordCount);
+
+	for (uint32_t i = 0; i < sizeClassCount; i++)
+	{
+		sizeClasses[i].blockSize = minimumBlockSize << i;
+	}
+}
+
+HostAllocator::~HostAllocator()
+{
+	//Drivers that leak keep pointing into the slabs, those are left alone.
+	for (auto& counter : scopeCounters)
+	{
+		if (counter.liveBytes.load() != 0)
+		{
+			return;
+		}
+	}
+
+	for (auto& sizeClass : sizeClasses)
+	{
+		for (void* slab : sizeClass.slabs)
+		{
+			::operator delete(slab, std::align_val_t(slabAlignment));
+		}
+	}
+}
+
+void HostAllocator::Create()
+{
+}
+
+void HostAllocator::Destroy()
+{
+	PrintStatistics();
+
+	int64_t liveBytes = 0;
+	for (auto& counter : scopeCounters)
+	{
+		liveBytes += counter.liveBytes.load();
+	}
+
+	if (liveBytes != 0)
+	{
+		std::cout << "WARNING: " << liveBytes << " bytes of host memory are still allocated after the instance was destroyed.\n";
+	}
+}
+
+const VkAllocationCallbacks* HostAllocator::Get(VkObjectType objectType)
+{
+	std::lock_guard<std::mutex> lock(recordMutex);
+
+	for (auto& record : records)
+	{
+		if (record->objectType == objectType)
+		{
+			return &record->callbacks;
+		}
+	}
+
+	if (records.size() == maxRecordCount)
+	{
+		throw std::runtime_error("ERROR: Too many object types for the host allocator.\n");
+	}
+
+	auto record = std::make_unique<TypeRecord>();
+	record->owner = this;
+	record->objectType = objectType;
+	record->index = static_cast<uint16_t>(records.size());
+	record->callbacks.pUserData = record.get();
+	record->callbacks.pfnAllocation = &HostAllocator::Allocation;
+	record->callbacks.pfnReallocation = &HostAllocator::Reallocation;
+	record->callbacks.pfnFree = &HostAllocator::Free;
+	record->callbacks.pfnInternalAllocation = &HostAllocator::InternalAllocation;
+	record->callbacks.pfnInternalFree = &HostAllocator::InternalFree;
+	records.push_back(std::move(record));
+	return &records.back()->callbacks;
+}
+
+void HostAllocator::PrintStatistics()
+{
+	const char* scopeNames[scopeCount] = { "command", "object", "cache", "device", "instance" };
+
+	std::cout << "INFO: Host memory by scope, live and peak bytes:";
+	for (uint32_t i = 0; i < scopeCount; i++)
+	{
+		std::cout << (i == 0u ? " " : ", ") << scopeNames[i] << " " << scopeCounters[i].liveBytes.load() << "/" << scopeCounters[i].peakBytes.load()
+			<< " in " << scopeCounters[i].allocationCount.load() << " allocation(s)";
+	}
+	std::cout << ".\n";
+
+	std::cout << "INFO: Command scope allocations: " << arenaAllocationCount.load() << " from thread arenas, " << arenaOverflowCount.load()
+		<< " overflowed. " << largeAllocationCount.load() << " allocation(s) too large for the size classes.\n";
+
+	std::vector<TypeRecord*> sorted;
+	{
+		std::lock_guard<std::mutex> lock(recordMutex);
+		for (auto& record : records)
+		{
+			sorted.push_back(record.get());
+		}
+	}
+
+	//Biggest peaks first, those are where driver side bloat shows.
+	std::sort(sorted.begin(), sorted.end(), [](const TypeRecord* a, const TypeRecord* b) { return a->counter.peakBytes.load() > b->counter.peakBytes.load(); });
+	for (TypeRecord* record : sorted)
+	{
+		std::cout << "INFO: " << string_VkObjectType(record->objectType) << ": " << record->counter.liveBytes.load() << " bytes live, "
+			<< record->counter.peakBytes.load() << " peak in " << record->counter.allocationCount.load() << " allocation(s)";
+		if (record->internalCounter.allocationCount.load() != 0u)
+		{
+			std::cout << ", " << record->internalCounter.peakBytes.load() << " bytes peak allocated internally";
+		}
+		std::cout << ".\n";
+	}
+}
+
+VKAPI_ATTR void* VKAPI_CALL HostAllocator::Allocation(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	TypeRecord& record = *static_cast<TypeRecord*>(userData);
+	return record.owner->Allocate(record, size, alignment, scope);
+}
+
+VKAPI_ATTR void* VKAPI_CALL HostAllocator::Reallocation(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	TypeRecord& record = *static_cast<TypeRecord*>(userData);
+	if (original == nullptr)
+	{
+		return record.owner->Allocate(record, size, alignment, scope);
+	}
+
+	if (size == 0u)
+	{
+		record.owner->Release(original);
+		return nullptr;
+	}
+
+	//Original stays valid when the new allocation fails.
+	void* memory = record.owner->Allocate(record, size, alignment, scope);
+	if (memory == nullptr)
+	{
+		return nullptr;
+	}
+
+	std::memcpy(memory, original, std::min<size_t>(size, static_cast<size_t>(GetHeader(original)->size)));
+	record.owner->Release(original);
+	return memory;
+}
+
+VKAPI_ATTR void VKAPI_CALL HostAllocator::Free(void* userData, void* memory)
+{
+	if (memory != nullptr)
+	{
+		static_cast<TypeRecord*>(userData)->owner->Release(memory);
+	}
+}
+
+VKAPI_ATTR void VKAPI_CALL HostAllocator::InternalAllocation(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope)
+{
+	TypeRecord& record = *static_cast<TypeRecord*>(userData);
+	record.internalCounter.Add(static_cast<int64_t>(size));
+	record.owner->internalScopeCounters[scope].Add(static_cast<int64_t>(size));
+}
+
+VKAPI_ATTR void VKAPI_CALL HostAllocator::InternalFree(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope)
+{
+	TypeRecord& record = *static_cast<TypeRecord*>(userData);
+	record.internalCounter.Remove(static_cast<int64_t>(size));
+	record.owner->internalScopeCounters[scope].Remove(static_cast<int64_t>(size));
+}
+
+void* HostAllocator::Allocate(TypeRecord& record, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	if (size == 0u || static_cast<uint32_t>(scope) >= scopeCount)
+	{
+		return nullptr;
+	}
+
+	//Blocks start 16 byte aligned, stricter alignments need room to move the allocation forward.
+	alignment = std::max(alignment, headerSize);
+	size_t required = headerSize + size + (alignment - headerSize);
+
+	char* block = nullptr;
+	uint8_t source = largeSource;
+
+	if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND)
+	{
+		block = static_cast<char*>(AllocateFromArena(size, alignment));
+		source = arenaSource;
+		if (block == nullptr)
+		{
+			arenaOverflowCount.fetch_add(1u, std::memory_order_relaxed);
+		}
+		else
+		{
+			arenaAllocationCount.fetch_add(1u, std::memory_order_relaxed);
+		}
+	}
+
+	if (block == nullptr)
+	{
+		uint32_t sizeClass = 0u;
+		while (sizeClass < sizeClassCount && sizeClasses[sizeClass].blockSize < required)
+		{
+			sizeClass++;
+		}
+
+		if (sizeClass < sizeClassCount)
+		{
+			block = static_cast<char*>(AllocateFromPool(sizeClass));
+			source = static_cast<uint8_t>(sizeClass);
+		}
+		else
+		{
+			block = static_cast<char*>(::operator new(required, std::align_val_t(headerSize), std::nothrow));
+			source = largeSource;
+			largeAllocationCount.fetch_add(1u, std::memory_order_relaxed);
+		}
+	}
+
+	if (block == nullptr)
+	{
+		return nullptr;
+	}
+
+	char* memory = AlignUp(block + headerSize, alignment);
+	BlockHeader* header = GetHeader(memory);
+	header->size = size;
+	header->offset = static_cast<uint32_t>(memory - block);
+	header->source = source;
+	header->scope = static_cast<uint8_t>(scope);
+	header->type = record.index;
+
+	record.counter.Add(static_cast<int64_t>(size));
+	scopeCounters[scope].Add(static_cast<int64_t>(size));
+	return memory;
+}
+
+void HostAllocator::Release(void* memory)
+{
+	BlockHeader* header = GetHeader(memory);
+	char* block = static_cast<char*>(memory) - header->offset;
+
+	records[header->type]->counter.Remove(static_cast<int64_t>(header->size));
+	scopeCounters[header->scope].Remove(static_cast<int64_t>(header->size));
+
+	if (header->source == arenaSource)
+	{
+		//Nothing is freed one by one, the arena rewinds once the call that filled it has freed everything.
+		if (--arena.liveCount == 0u)
+		{
+			arena.offset = 0u;
+		}
+	}
+	else if (header->source == largeSource)
+	{
+		::operator delete(block, std::align_val_t(headerSize));
+	}
+	else
+	{
+		ReleaseToPool(header->source, block);
+	}
+}
+
+void* HostAllocator::AllocateFromArena(size_t size, size_t alignment)
+{
+	if (arena.data == nullptr)
+	{
+		arena.data = static_cast<char*>(::operator new(arenaSize, std::align_val_t(slabAlignment), std::nothrow));
+		if (arena.data == nullptr)
+		{
+			return nullptr;
+		}
+	}
+
+	char* block = arena.data + arena.offset;
+	char* memory = AlignUp(block + headerSize, alignment);
+	if (memory + size > arena.data + arenaSize)
+	{
+		return nullptr;
+	}
+
+	arena.offset = static_cast<size_t>(memory + size - arena.data);
+	arena.liveCount++;
+	return block;
+}
+
+void* HostAllocator::AllocateFromPool(uint32_t sizeClass)
+{
+	SizeClass& pool = sizeClasses[sizeClass];
+	std::lock_guard<std::mutex> lock(pool.mutex);
+
+	if (pool.freeList == nullptr)
+	{
+		char* slab = static_cast<char*>(::operator new(slabSize, std::align_val_t(slabAlignment), std::nothrow));
+		if (slab == nullptr)
+		{
+			return nullptr;
+		}
+		pool.slabs.push_back(slab);
+
+		//Blocks are linked back to front so that they are handed out in address order.
+		for (size_t offset = slabSize; offset >= pool.blockSize; offset -= pool.blockSize)
+		{
+			char* block = slab + offset - pool.blockSize;
+			*reinterpret_cast<void**>(block) = pool.freeList;
+			pool.freeList = block;
+		}
+	}
+
+	void* block = pool.freeList;
+	pool.freeList = *reinterpret_cast<void**>(block);
+	return block;
+}
+
+void HostAllocator::ReleaseToPool(uint32_t sizeClass, void* block)
+{
+	SizeClass& pool = sizeClasses[sizeClass];
+	std::lock_guard<std::mutex> lock(pool.mutex);
+
+	*reinterpret_cast<void**>(block) = pool.freeList;
+	pool.freeList = block;
+}
@@ -0,0 +1,324 @@
+#include "InstancedApplication.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <algorithm>
+#include <random>
+#include <cmath>
+#include <future>
+
+namespace
+{
+	//Fewer instances than this are updated on the calling thread.
+	const uint32_t instancesPerTask = 16384u;
+	//Smallest instance count of the headless sweep.
+	const uint32_t minimumSweepCount = 1024u;
+}
+
+InstancedApplication::InstancedApplication(const ApplicationSettings& settings) :
+	TriangleApplication(settings),
+	maxInstanceCount(0u),
+	instanceCount(0u),
+	instanceStates({}),
+	updatePool(nullptr),
+	meshes({}),
+	vertexBuffer(VK_NULL_HANDLE),
+	vertexAllocation(),
+	instanceOffset(0u),
+	descriptorSetLayout(VK_NULL_HANDLE),
+	descriptorPool(VK_NULL_HANDLE),
+	descriptorSet(VK_NULL_HANDLE),
+	instancedPipelineLayout(VK_NULL_HANDLE),
+	instancedPipeline(VK_NULL_HANDLE)
+{
+	Initialise();
+}
+
+InstancedApplication::~InstancedApplication()
+{
+	Destroy();
+}
+
+void InstancedApplication::Run()
+{
+	if (!settings.headless)
+	{
+		SetInstanceCount(maxInstanceCount);
+		MainLoop();
+		return;
+	}
+
+	//Quadruple the count per run so the frame rate can be plotted against instance count.
+	std::vector<uint32_t> counts;
+	for (uint32_t count = maxInstanceCount; count >= minimumSweepCount; count /= 4u)
+	{
+		counts.push_back(count);
+	}
+	if (counts.empty())
+	{
+		counts.push_back(maxInstanceCount);
+	}
+	std::reverse(counts.begin(), counts.end());
+
+	for (auto count : counts)
+	{
+		SetInstanceCount(count);
+		std::cout << "INFO: " << count << " instances in " << meshes.size() << " draws.\n";
+		HeadlessLoop();
+	}
+}
+
+void InstancedApplication::Initialise()
+{
+	updatePool = std::make_unique<ThreadPool>(settings.recordThreads);
+
+	CreateMeshes();
+	ReserveInstanceMemory();
+	CreateDescriptorSets();
+	CreateInstancedPipeline();
+}
+
+void InstancedApplication::Destroy()
+{
+	//Instance data may still be read by frames in flight.
+	frameScheduler.WaitIdle();
+
+	DestroyDescriptorSets();
+	DestroyMeshes();
+
+	updatePool.reset();
+}
+
+void InstancedApplication::UpdateFrame(uint32_t frameSlot)
+{
+	Profiler::CpuScope scope(profiler, "UpdateInstances");
+
+	//Frame number rather than wall clock time keeps headless output reproducible.
+	float time = static_cast<float>(frameScheduler.GetFrameNumber()) / 60.f;
+	//Always the full range, the descriptor covers maxInstanceCount instances.
+	FrameAllocation allocation = frameAllocator.AllocateStorage(static_cast<VkDeviceSize>(maxInstanceCount) * sizeof(InstanceData));
+	instanceOffset = allocation.dynamicOffset;
+	InstanceData* instances = static_cast<InstanceData*>(allocation.mapped);
+
+	if (instanceCount <= instancesPerTask || updatePool->GetThreadCount() == 1u)
+	{
+		UpdateInstances(instances, time, 0u, instanceCount);
+		return;
+	}
+
+	uint32_t taskCount = std::min(updatePool->GetThreadCount(), (instanceCount + instancesPerTask - 1u) / instancesPerTask);
+	std::vector<std::future<void>> tasks;
+	tasks.reserve(taskCount);
+	for (uint32_t task = 0; task < taskCount; task++)
+	{
+		uint32_t begin = static_cast<uint32_t>(static_cast<uint64_t>(instanceCount) * task / taskCount);
+		uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(instanceCount) * (task + 1u) / taskCount);
+		tasks.push_back(updatePool->Submit([this, instances, time, begin, end]() { UpdateInstances(instances, time, begin, end); }));
+	}
+
+	for (auto& task : tasks)
+	{
+		task.get();
+	}
+}
+
+uint32_t InstancedApplication::GetDrawCount()
+{
+	return static_cast<uint32_t>(meshes.size());
+}
+
+void InstancedApplication::RecordDraws(VkCommandBuffer commandBuffer, uint32_t frameSlot, uint32_t begin, uint32_t end)
+{
+	Profiler::CpuScope scope(profiler, "RecordDraws");
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, instancedPipeline);
+	SetViewportAndScissor(commandBuffer);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, instancedPipelineLayout, 0, 1, &descriptorSet, 1, &instanceOffset);
+
+	VkDeviceSize offset = 0u;
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, &offset);
+
+	//Instances are split evenly between meshes, each mesh draws its contiguous range.
+	uint32_t meshCount = static_cast<uint32_t>(meshes.size());
+	for (uint32_t i = begin; i < end; i++)
+	{
+		uint32_t firstInstance = static_cast<uint32_t>(static_cast<uint64_t>(instanceCount) * i / meshCount);
+		uint32_t lastInstance = static_cast<uint32_t>(static_cast<uint64_t>(instanceCount) * (i + 1u) / meshCount);
+		if (lastInstance > firstInstance)
+		{
+			vkCmdDraw(commandBuffer, meshes[i].vertexCount, lastInstance - firstInstance, meshes[i].firstVertex, firstInstance);
+		}
+	}
+}
+
+void InstancedApplication::SetInstanceCount(uint32_t count)
+{
+	instanceCount = std::min(count, maxInstanceCount);
+
+	//Instances fill a square grid covering the render target, each one orbits its cell and spins in place.
+	uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(instanceCount))));
+	float cell = 2.f / static_cast<float>(side);
+
+	std::mt19937 random(1234u);
+	std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+	instanceStates.resize(instanceCount);
+	for (uint32_t i = 0; i < instanceCount; i++)
+	{
+		InstanceState& state = instanceStates[i];
+		state.x = -1.f + cell * (static_cast<float>(i % side) + 0.5f);
+		state.y = -1.f + cell * (static_cast<float>(i / side) + 0.5f);
+		state.phase = unit(random) * 6.2831853f;
+		state.spin = 0.5f + unit(random) * 2.f;
+		state.scale = cell * 0.9f;
+		state.color[0] = 0.2f + 0.8f * unit(random);
+		state.color[1] = 0.2f + 0.8f * unit(random);
+		state.color[2] = 0.2f + 0.8f * unit(random);
+	}
+}
+
+void InstancedApplication::UpdateInstances(InstanceData* instances, float time, uint32_t begin, uint32_t end)
+{
+	float orbit = instanceStates.empty() ? 0.f : instanceStates[0].scale * 0.1f;
+
+	//Every field is written in order, the mapped memory may be write combined and must never be read back.
+	for (uint32_t i = begin; i < end; i++)
+	{
+		const InstanceState& state = instanceStates[i];
+		float angle = state.phase + time * state.spin;
+
+		InstanceData data;
+		data.transform[0] = state.x + orbit * std::cos(angle);
+		data.transform[1] = state.y + orbit * std::sin(angle);
+		data.transform[2] = angle;
+		data.transform[3] = state.scale;
+		data.color[0] = state.color[0];
+		data.color[1] = state.color[1];
+		data.color[2] = state.color[2];
+		data.color[3] = 1.f;
+		instances[i] = data;
+	}
+}
+
+void InstancedApplication::CreateMeshes()
+{
+	//Triangle followed by a quad made of two triangles, both wound clockwise like the triangle scene.
+	const float vertices[] = {
+		0.f, -0.5f, 0.5f, 0.5f, -0.5f, 0.5f,
+		-0.5f, -0.5f, 0.5f, -0.5f, 0.5f, 0.5f,
+		-0.5f, -0.5f, 0.5f, 0.5f, -0.5f, 0.5f
+	};
+	meshes = { { 0u, 3u }, { 3u, 6u } };
+
+	VkBufferCreateInfo info{};
+	info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	info.size = sizeof(vertices);
+	info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	memoryAllocator.CreateBuffer(info, MemoryUsage::GpuOnly, vertexBuffer, vertexAllocation);
+
+	//The first frame acquires the upload and waits for it on the GPU.
+	uploadManager.UploadBuffer(vertexBuffer, 0u, vertices, sizeof(vertices));
+	uploadManager.Flush();
+}
+
+void InstancedApplication::DestroyMeshes()
+{
+	memoryAllocator.DestroyBuffer(vertexBuffer, vertexAllocation);
+	vertexBuffer = VK_NULL_HANDLE;
+	meshes.clear();
+}
+
+void InstancedApplication::ReserveInstanceMemory()
+{
+	VkPhysicalDeviceProperties properties{};
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	uint32_t limit = properties.limits.maxStorageBufferRange / static_cast<uint32_t>(sizeof(InstanceData));
+	maxInstanceCount = std::min(settings.instanceCount, limit);
+	if (maxInstanceCount != settings.instanceCount)
+	{
+		std::cout << "WARNING: maxStorageBufferRange allows " << limit << " instances, using " << maxInstanceCount << ".\n";
+	}
+
+	//No frame is in flight yet. The CPU writes the range of one frame while the GPU reads the others.
+	VkDeviceSize size = static_cast<VkDeviceSize>(maxInstanceCount) * sizeof(InstanceData);
+	frameAllocator.Reserve(size);
+
+	std::cout << "INFO: " << settings.framesInFlight << " frame(s) of " << (size >> 20) << " MiB instance data.\n";
+}
+
+ReflectedLayout InstancedApplication::ReflectInstancedLayout()
+{
+	GraphicsPipelineDescription description{};
+	description.vertexShader = "shader/instanced.vert";
+	description.fragmentShader = "shader/shader.frag";
+
+	ReflectedLayout reflected = pipelineBuilder.Reflect(description);
+	FrameAllocator::MakeDynamic(reflected.sets[0]);
+	return reflected;
+}
+
+void InstancedApplication::CreateDescriptorSets()
+{
+	descriptorSetLayout = layoutCache.GetDescriptorSetLayout(ReflectInstancedLayout().sets[0]);
+
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	poolSize.descriptorCount = 1;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+
+	if (vkCreateDescriptorPool(device, &poolInfo, hostAllocator.Get(VK_OBJECT_TYPE_DESCRIPTOR_POOL), &descriptorPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not create descriptor pool.\n");
+	}
+
+	VkDescriptorSetAllocateInfo allocateInfo{};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocateInfo.descriptorPool = descriptorPool;
+	allocateInfo.descriptorSetCount = 1;
+	allocateInfo.pSetLayouts = &descriptorSetLayout;
+
+	if (vkAllocateDescriptorSets(device, &allocateInfo, &descriptorSet) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not allocate descriptor sets.\n");
+	}
+
+	//Written once, every frame only passes the offset of its instances.
+	VkDescriptorBufferInfo bufferInfo = frameAllocator.GetDescriptorInfo(static_cast<VkDeviceSize>(maxInstanceCount) * sizeof(InstanceData));
+
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = descriptorSet;
+	write.dstBinding = 0;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	write.pBufferInfo = &bufferInfo;
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+}
+
+void InstancedApplication::DestroyDescriptorSets()
+{
+	//Sets are freed with their pool, the layout belongs to layoutCache.
+	vkDestroyDescriptorPool(device, descriptorPool, hostAllocator.Get(VK_OBJECT_TYPE_DESCRIPTOR_POOL));
+	descriptorPool = VK_NULL_HANDLE;
+	descriptorSet = VK_NULL_HANDLE;
+}
+
+void InstancedApplication::CreateInstancedPipeline()
+{
+	GraphicsPipelineDescription description{};
+	description.vertexShader = "shader/instanced.vert";
+	description.fragmentShader = "shader/shader.frag";
+	description.attachments = mainPassFormats;
+
+	instancedPipelineLayout = layoutCache.GetPipelineLayout(ReflectInstancedLayout());
+	description.layout = instancedPipelineLayout;
+
+	instancedPipeline = pipelineBuilder.Submit(description).get();
+}
@@ -0,0 +1,137 @@
+#include "LayoutCache.h"
+#include "Hash.h"
+
+#include <stdexcept>
+
+namespace
+{
+	template<typename T>
+	void AppendKey(std::string& key, const T& value)
+	{
+		key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+}
+
+LayoutCache::LayoutCache() :
+	device(VK_NULL_HANDLE),
+	hostAllocator(nullptr)
+{
+}
+
+LayoutCache::~LayoutCache()
+{
+}
+
+size_t LayoutCache::KeyHash::operator()(const std::string& key) const
+{
+	return static_cast<size_t>(HashBytes(key.data(), key.size()));
+}
+
+void LayoutCache::Create(VkDevice device, HostAllocator* hostAllocator)
+{
+	this->device = device;
+	this->hostAllocator = hostAllocator;
+}
+
+void LayoutCache::Destroy()
+{
+	for (auto& pipelineLayout : pipelineLayouts)
+	{
+		vkDestroyPipelineLayout(device, pipelineLayout.second, hostAllocator->Get(VK_OBJECT_TYPE_PIPELINE_LAYOUT));
+	}
+	pipelineLayouts.clear();
+
+	for (auto& setLayout : setLayouts)
+	{
+		vkDestroyDescriptorSetLayout(device, setLayout.second, hostAllocator->Get(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT));
+	}
+	setLayouts.clear();
+}
+
+VkDescriptorSetLayout LayoutCache::GetDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+	//Immutable samplers are not supported, so the key is just the plain binding fields.
+	std::string key;
+	for (auto& binding : bindings)
+	{
+		AppendKey(key, binding.binding);
+		AppendKey(key, binding.descriptorType);
+		AppendKey(key, binding.descriptorCount);
+		AppendKey(key, binding.stageFlags);
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto found = setLayouts.find(key);
+	if (found != setLayouts.end())
+	{
+		return found->second;
+	}
+
+	VkDescriptorSetLayoutCreateInfo info{};
+	info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	info.bindingCount = static_cast<uint32_t>(bindings.size());
+	info.pBindings = bindings.data();
+
+	VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+	if (vkCreateDescriptorSetLayout(device, &info, hostAllocator->Get(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT), &setLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not create descriptor set layout.\n");
+	}
+
+	setLayouts[key] = setLayout;
+	return setLayout;
+}
+
+VkPipelineLayout LayoutCache::GetPipelineLayout(const ReflectedLayout& layout)
+{
+	std::vector<VkDescriptorSetLayout> sets;
+
+	uint32_t setCount = layout.sets.empty() ? 0u : layout.sets.rbegin()->first + 1u;
+	for (uint32_t set = 0; set < setCount; set++)
+	{
+		auto found = layout.sets.find(set);
+		sets.push_back(GetDescriptorSetLayout(found != layout.sets.end() ? found->second : std::vector<VkDescriptorSetLayoutBinding>{}));
+	}
+
+	return GetPipelineLayout(sets, layout.pushConstants);
+}
+
+VkPipelineLayout LayoutCache::GetPipelineLayout(const std::vector<VkDescriptorSetLayout>& sets, const std::vector<VkPushConstantRange>& pushConstants)
+{
+	std::string key;
+	for (auto& set : sets)
+	{
+		AppendKey(key, set);
+	}
+	for (auto& pushConstant : pushConstants)
+	{
+		AppendKey(key, pushConstant.stageFlags);
+		AppendKey(key, pushConstant.offset);
+		AppendKey(key, pushConstant.size);
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto found = pipelineLayouts.find(key);
+	if (found != pipelineLayouts.end())
+	{
+		return found->second;
+	}
+
+	VkPipelineLayoutCreateInfo info{};
+	info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	info.setLayoutCount = static_cast<uint32_t>(sets.size());
+	info.pSetLayouts = sets.data();
+	info.pushConstantRangeCount = static_cast<uint32_t>(pushConstants.size());
+	info.pPushConstantRanges = pushConstants.data();
+
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	if (vkCreatePipelineLayout(device, &info, hostAllocator->Get(VK_OBJECT_TYPE_PIPELINE_LAYOUT), &pipelineLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not create pipeline layout.\n");
+	}
+
+	pipelineLayouts[key] = pipelineLayout;
+	return pipelineLayout;
+}
@@ -0,0 +1,226 @@
+#include "Lz4.h"
+
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	const size_t minimumMatch = 4u;
+	//The last match must start this far from the end and the last bytes are always literals, as the format requires.
+	const size_t matchStartLimit = 12u;
+	const size_t lastLiterals = 5u;
+	const size_t maximumOffset = 65535u;
+	const uint32_t hashBits = 16u;
+
+	uint32_t Read32(const uint8_t* data)
+	{
+		uint32_t value;
+		std::memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	uint32_t Hash(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32u - hashBits);
+	}
+
+	//Lengths above 15 continue in bytes of 255 and a final remainder.
+	bool WriteLength(uint8_t*& output, const uint8_t* end, size_t length)
+	{
+		for (; length >= 255u; length -= 255u)
+		{
+			if (output == end)
+			{
+				return false;
+			}
+			*output++ = 255u;
+		}
+		if (output == end)
+		{
+			return false;
+		}
+		*output++ = static_cast<uint8_t>(length);
+		return true;
+	}
+
+	bool WriteSequence(uint8_t*& output, const uint8_t* end, const uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength)
+	{
+		if (output == end)
+		{
+			return false;
+		}
+
+		uint8_t* token = output++;
+		*token = static_cast<uint8_t>(std::min<size_t>(literalLength, 15u) << 4u);
+		if (literalLength >= 15u && !WriteLength(output, end, literalLength - 15u))
+		{
+			return false;
+		}
+
+		if (static_cast<size_t>(end - output) < literalLength)
+		{
+			return false;
+		}
+		std::copy_n(literals, literalLength, output);
+		output += literalLength;
+
+		//The final sequence has no match.
+		if (matchLength == 0u)
+		{
+			return true;
+		}
+
+		if (end - output < 2)
+		{
+			return false;
+		}
+		*output++ = static_cast<uint8_t>(offset);
+		*output++ = static_cast<uint8_t>(offset >> 8u);
+
+		size_t storedLength = matchLength - minimumMatch;
+		*token |= static_cast<uint8_t>(std::min<size_t>(storedLength, 15u));
+		return storedLength < 15u || WriteLength(output, end, storedLength - 15u);
+	}
+}
+
+size_t Lz4::GetMaxCompressedSize(size_t size)
+{
+	return size + size / 255u + 16u;
+}
+
+size_t Lz4::Compress(const void* source, size_t size, void* destination, size_t capacity)
+{
+	const uint8_t* input = static_cast<const uint8_t*>(source);
+	uint8_t* output = static_cast<uint8_t*>(destination);
+	const uint8_t* outputEnd = output + capacity;
+
+	//Most recent position of every hashed 4 byte sequence.
+	std::vector<uint32_t> table(size_t(1) << hashBits, UINT32_MAX);
+
+	size_t position = 0u;
+	size_t anchor = 0u;
+	while (size > matchStartLimit && position + matchStartLimit < size)
+	{
+		uint32_t sequence = Read32(input + position);
+		uint32_t& entry = table[Hash(sequence)];
+		size_t candidate = entry;
+		entry = static_cast<uint32_t>(position);
+
+		if (candidate == UINT32_MAX || position - candidate > maximumOffset || Read32(input + candidate) != sequence)
+		{
+			position++;
+			continue;
+		}
+
+		size_t length = minimumMatch;
+		size_t limit = size - lastLiterals;
+		while (position + length < limit && input[candidate + length] == input[position + length])
+		{
+			length++;
+		}
+
+		if (!WriteSequence(output, outputEnd, input + anchor, position - anchor, position - candidate, length))
+		{
+			return 0u;
+		}
+
+		position += length;
+		anchor = position;
+	}
+
+	if (!WriteSequence(output, outputEnd, input + anchor, size - anchor, 0u, 0u))
+	{
+		return 0u;
+	}
+	return static_cast<size_t>(output - static_cast<uint8_t*>(destination));
+}
+
+void Lz4::Decompress(const void* source, size_t size, void* destination, size_t decompressedSize)
+{
+	const uint8_t* input = static_cast<const uint8_t*>(source);
+	const uint8_t* inputEnd = input + size;
+	uint8_t* output = static_cast<uint8_t*>(destination);
+	uint8_t* outputBegin = output;
+	uint8_t* outputEnd = output + decompressedSize;
+
+	auto fail = []() { throw std::runtime_error("ERROR: LZ4 block is corrupt.\n"); };
+	auto readLength = [&](size_t length)
+	{
+		if (length == 15u)
+		{
+			uint8_t byte = 255u;
+			while (byte == 255u)
+			{
+				if (input == inputEnd)
+				{
+					fail();
+				}
+				byte = *input++;
+				length += byte;
+			}
+		}
+		return length;
+	};
+
+	while (true)
+	{
+		if (input == inputEnd)
+		{
+			fail();
+		}
+
+		uint8_t token = *input++;
+		size_t literalLength = readLength(token >> 4u);
+		if (static_cast<size_t>(inputEnd - input) < literalLength || static_cast<size_t>(outputEnd - output) < literalLength)
+		{
+			fail();
+		}
+		std::copy_n(input, literalLength, output);
+		input += literalLength;
+		output += literalLength;
+
+		if (input == inputEnd)
+		{
+			break;
+		}
+
+		if (inputEnd - input < 2)
+		{
+			fail();
+		}
+		size_t offset = input[0] | (static_cast<size_t>(input[1]) << 8u);
+		input += 2;
+		if (offset == 0u || offset > static_cast<size_t>(output - outputBegin))
+		{
+			fail();
+		}
+
+		size_t matchLength = readLength(token & 15u) + minimumMatch;
+		if (static_cast<size_t>(outputEnd - output) < matchLength)
+		{
+			fail();
+		}
+
+		//Overlapping matches repeat the last offset bytes, they have to be copied front to back.
+		const uint8_t* match = output - offset;
+		if (offset >= matchLength)
+		{
+			std::memcpy(output, match, matchLength);
+			output += matchLength;
+		}
+		else
+		{
+			for (size_t i = 0; i < matchLength; i++)
+			{
+				*output++ = match[i];
+			}
+		}
+	}
+
+	if (output != outputEnd)
+	{
+		fail();
+	}
+}
@@ -1,13 +1,50 @@
 #include <iostream>
+#include <memory>
 
 #include "TriangleApplication.h"
+#include "InstancedApplication.h"
+#include "GpuDrivenApplication.h"
+#include "MeshApplication.h"
+#include "ParticleApplication.h"
+#include "PipelineBenchmarkApplication.h"
 
-int main()
+int main(int argc, char** argv)
 {
 	try
 	{
-		TriangleApplication app;
-		app.Run();
+		ApplicationSettings settings = ApplicationSettings::FromCommandLine(argc, argv);
+
+		std::unique_ptr<Application> app;
+		if (settings.scene == "triangle")
+		{
+			app = std::make_unique<TriangleApplication>(settings);
+		}
+		else if (settings.scene == "instanced")
+		{
+			app = std::make_unique<InstancedApplication>(settings);
+		}
+		else if (settings.scene == "gpu-driven")
+		{
+			app = std::make_unique<GpuDrivenApplication>(settings);
+		}
+		else if (settings.scene == "mesh")
+		{
+			app = std::make_unique<MeshApplication>(settings);
+		}
+		else if (settings.scene == "particles")
+		{
+			app = std::make_unique<ParticleApplication>(settings);
+		}
+		else if (settings.scene == "pipeline-benchmark")
+		{
+			app = std::make_unique<PipelineBenchmarkApplication>(settings);
+		}
+		else
+		{
+			throw std::runtime_error("ERROR: Unknown scene: " + settings.scene + "\n");
+		}
+
+		app->Run();
 	}
 	catch (const std::exception& e)
 	{
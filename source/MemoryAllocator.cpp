@@ -0,0 +1,492 @@
+#include "MemoryAllocator.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <algorithm>
+#include <bit>
+
+//One device memory object carved up by a TLSF allocator.
+struct MemoryBlock
+{
+	VkDeviceMemory memory;
+	void* mapped;
+	TlsfAllocator allocator;
+};
+
+MemoryAllocator::MemoryAllocator() :
+	device(VK_NULL_HANDLE),
+	hostAllocator(nullptr),
+	memoryProperties(),
+	bufferImageGranularity(1u),
+	maxAllocationCount(0u),
+	preferredBlockSize(0u),
+	deviceMemoryCount(0u),
+	dedicatedAllocationCount(0u),
+	dedicatedBytes(0u)
+{
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+}
+
+void MemoryAllocator::Create(VkPhysicalDevice physicalDevice, VkDevice device, HostAllocator* hostAllocator, VkDeviceSize preferredBlockSize)
+{
+	this->device = device;
+	this->hostAllocator = hostAllocator;
+	this->preferredBlockSize = preferredBlockSize;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	bufferImageGranularity = properties.limits.bufferImageGranularity;
+	maxAllocationCount = properties.limits.maxMemoryAllocationCount;
+
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+}
+
+void MemoryAllocator::Destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	PrintStatistics();
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	uint32_t leaked = dedicatedAllocationCount;
+	for (auto& pool : pools)
+	{
+		for (auto& block : pool.blocks)
+		{
+			leaked += block->allocator.GetAllocationCount();
+			vkFreeMemory(device, block->memory, hostAllocator->Get(VK_OBJECT_TYPE_DEVICE_MEMORY));
+		}
+	}
+	pools.clear();
+
+	if (leaked != 0u)
+	{
+		std::cout << "WARNING: " << leaked << " device memory allocation(s) were not freed.\n";
+	}
+
+	deviceMemoryCount = 0u;
+	dedicatedAllocationCount = 0u;
+	dedicatedBytes = 0u;
+	device = VK_NULL_HANDLE;
+}
+
+void MemoryAllocator::CreateBuffer(const VkBufferCreateInfo& info, MemoryUsage usage, VkBuffer& buffer, Allocation& allocation)
+{
+	if (vkCreateBuffer(device, &info, hostAllocator->Get(VK_OBJECT_TYPE_BUFFER), &buffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not create buffer.\n");
+	}
+
+	VkBufferMemoryRequirementsInfo2 requirementsInfo{};
+	requirementsInfo.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+	requirementsInfo.buffer = buffer;
+
+	VkMemoryDedicatedRequirements dedicatedRequirements{};
+	dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+	VkMemoryRequirements2 requirements{};
+	requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+	requirements.pNext = &dedicatedRequirements;
+	vkGetBufferMemoryRequirements2(device, &requirementsInfo, &requirements);
+
+	VkMemoryDedicatedAllocateInfo dedicatedInfo{};
+	dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+	dedicatedInfo.buffer = buffer;
+
+	allocation = AllocateResource(requirements, dedicatedRequirements, dedicatedInfo, usage, true);
+
+	if (vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not bind buffer memory.\n");
+	}
+}
+
+void MemoryAllocator::DestroyBuffer(VkBuffer buffer, Allocation& allocation)
+{
+	vkDestroyBuffer(device, buffer, hostAllocator->Get(VK_OBJECT_TYPE_BUFFER));
+	Free(allocation);
+}
+
+void MemoryAllocator::CreateImage(const VkImageCreateInfo& info, MemoryUsage usage, VkImage& image, Allocation& allocation)
+{
+	if (vkCreateImage(device, &info, hostAllocator->Get(VK_OBJECT_TYPE_IMAGE), &image) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not create image.\n");
+	}
+
+	VkImageMemoryRequirementsInfo2 requirementsInfo{};
+	requirementsInfo.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+	requirementsInfo.image = image;
+
+	VkMemoryDedicatedRequirements dedicatedRequirements{};
+	dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+	VkMemoryRequirements2 requirements{};
+	requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+	requirements.pNext = &dedicatedRequirements;
+	vkGetImageMemoryRequirements2(device, &requirementsInfo, &requirements);
+
+	VkMemoryDedicatedAllocateInfo dedicatedInfo{};
+	dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+	dedicatedInfo.image = image;
+
+	allocation = AllocateResource(requirements, dedicatedRequirements, dedicatedInfo, usage, info.tiling == VK_IMAGE_TILING_LINEAR);
+
+	if (vkBindImageMemory(device, image, allocation.memory, allocation.offset) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not bind image memory.\n");
+	}
+}
+
+void MemoryAllocator::DestroyImage(VkImage image, Allocation& allocation)
+{
+	vkDestroyImage(device, image, hostAllocator->Get(VK_OBJECT_TYPE_IMAGE));
+	Free(allocation);
+}
+
+Allocation MemoryAllocator::Allocate(const VkMemoryRequirements& requirements, MemoryUsage usage, bool linear, bool dedicated)
+{
+	VkMemoryRequirements2 requirements2{};
+	requirements2.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+	requirements2.memoryRequirements = requirements;
+
+	VkMemoryDedicatedRequirements dedicatedRequirements{};
+	dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+	dedicatedRequirements.prefersDedicatedAllocation = dedicated ? VK_TRUE : VK_FALSE;
+
+	//Without a resource handle the driver cannot be told what the memory is dedicated to, it is simply a private block.
+	VkMemoryDedicatedAllocateInfo dedicatedInfo{};
+	dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+
+	return AllocateResource(requirements2, dedicatedRequirements, dedicatedInfo, usage, linear);
+}
+
+void MemoryAllocator::Free(Allocation& allocation)
+{
+	if (allocation.memory == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (allocation.block == nullptr)
+	{
+		vkFreeMemory(device, allocation.memory, hostAllocator->Get(VK_OBJECT_TYPE_DEVICE_MEMORY));
+		deviceMemoryCount--;
+		dedicatedAllocationCount--;
+		dedicatedBytes -= allocation.size;
+		allocation = Allocation{};
+		return;
+	}
+
+	MemoryBlock* block = allocation.block;
+	block->allocator.Free(allocation.region);
+
+	if (block->allocator.IsEmpty())
+	{
+		//Keep one empty block per pool around so a free followed by an allocate does not hit the driver.
+		for (auto& pool : pools)
+		{
+			auto found = std::find_if(pool.blocks.begin(), pool.blocks.end(), [block](const auto& b) { return b.get() == block; });
+			if (found == pool.blocks.end())
+			{
+				continue;
+			}
+
+			bool spare = std::any_of(pool.blocks.begin(), pool.blocks.end(), [block](const auto& b) { return b.get() != block && b->allocator.IsEmpty(); });
+			if (spare)
+			{
+				vkFreeMemory(device, block->memory, hostAllocator->Get(VK_OBJECT_TYPE_DEVICE_MEMORY));
+				deviceMemoryCount--;
+				pool.blocks.erase(found);
+			}
+			break;
+		}
+	}
+
+	allocation = Allocation{};
+}
+
+MemoryStatistics MemoryAllocator::GetStatistics()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	MemoryStatistics statistics{};
+	statistics.usedBytes = dedicatedBytes;
+	statistics.reservedBytes = dedicatedBytes;
+	statistics.allocationCount = dedicatedAllocationCount;
+	statistics.dedicatedAllocationCount = dedicatedAllocationCount;
+
+	VkDeviceSize freeBytes = 0u;
+	VkDeviceSize largestFree = 0u;
+	for (auto& pool : pools)
+	{
+		for (auto& block : pool.blocks)
+		{
+			statistics.usedBytes += block->allocator.GetUsedBytes();
+			statistics.reservedBytes += block->allocator.GetSize();
+			statistics.allocationCount += block->allocator.GetAllocationCount();
+			statistics.blockCount++;
+			freeBytes += block->allocator.GetSize() - block->allocator.GetUsedBytes();
+			largestFree = std::max(largestFree, block->allocator.GetLargestFreeRegion());
+		}
+	}
+
+	statistics.fragmentation = freeBytes == 0u ? 0.0f : 1.0f - static_cast<float>(largestFree) / static_cast<float>(freeBytes);
+	return statistics;
+}
+
+void MemoryAllocator::PrintStatistics()
+{
+	MemoryStatistics statistics = GetStatistics();
+
+	std::cout << "INFO: Device memory: " << (statistics.usedBytes >> 10) << " KiB used of " << (statistics.reservedBytes >> 10) << " KiB reserved, "
+		<< statistics.allocationCount << " allocation(s) (" << statistics.dedicatedAllocationCount << " dedicated) in " << statistics.blockCount << " block(s), "
+		<< static_cast<int>(statistics.fragmentation * 100.0f) << "% fragmented.\n";
+}
+
+std::vector<uint32_t> MemoryAllocator::GetMemoryTypeCandidates(uint32_t typeBits, MemoryUsage usage)
+{
+	VkMemoryPropertyFlags required = 0u;
+	VkMemoryPropertyFlags preferred = 0u;
+	VkMemoryPropertyFlags avoided = 0u;
+
+	switch (usage)
+	{
+	case MemoryUsage::GpuOnly:
+		preferred = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		avoided = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+		break;
+	case MemoryUsage::Upload:
+		//Write combined memory is fastest for sequential CPU writes, cached memory is wasted on it.
+		required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		avoided = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+		break;
+	case MemoryUsage::Readback:
+		required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		preferred = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+		break;
+	case MemoryUsage::Transient:
+		preferred = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+		avoided = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+		break;
+	}
+
+	//Lazily allocated memory is only valid for transient attachments, protected memory needs a protected queue.
+	VkMemoryPropertyFlags excluded = VK_MEMORY_PROPERTY_PROTECTED_BIT;
+	if (usage != MemoryUsage::Transient)
+	{
+		excluded |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+	}
+
+	std::vector<std::pair<int, uint32_t>> candidates;
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+	{
+		VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[i].propertyFlags;
+		if ((typeBits & (1u << i)) == 0u || (flags & required) != required || (flags & excluded) != 0u)
+		{
+			continue;
+		}
+
+		int cost = std::popcount(preferred & ~flags) + std::popcount(avoided & flags);
+		candidates.push_back({ cost, i });
+	}
+
+	//Cheapest first, ties keep the driver's order, which lists faster types first.
+	std::stable_sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+	std::vector<uint32_t> memoryTypes;
+	for (auto& candidate : candidates)
+	{
+		memoryTypes.push_back(candidate.second);
+	}
+	return memoryTypes;
+}
+
+Allocation MemoryAllocator::AllocateResource(const VkMemoryRequirements2& requirements, const VkMemoryDedicatedRequirements& dedicatedRequirements, VkMemoryDedicatedAllocateInfo& dedicatedInfo, MemoryUsage usage, bool linear)
+{
+	const VkMemoryRequirements& memoryRequirements = requirements.memoryRequirements;
+
+	std::vector<uint32_t> memoryTypes = GetMemoryTypeCandidates(memoryRequirements.memoryTypeBits, usage);
+	if (memoryTypes.empty())
+	{
+		throw std::runtime_error("ERROR: Could not find suitable memory type.\n");
+	}
+
+	bool hasResource = dedicatedInfo.image != VK_NULL_HANDLE || dedicatedInfo.buffer != VK_NULL_HANDLE;
+	const VkMemoryDedicatedAllocateInfo* dedicatedNext = hasResource ? &dedicatedInfo : nullptr;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	Allocation allocation{};
+	for (uint32_t memoryTypeIndex : memoryTypes)
+	{
+		//Anything bigger than half a block would waste most of a fresh block, give it its own memory instead.
+		bool dedicated = dedicatedRequirements.requiresDedicatedAllocation || dedicatedRequirements.prefersDedicatedAllocation || memoryRequirements.size > GetBlockSize(memoryTypeIndex) / 2u;
+
+		if (dedicated)
+		{
+			if (AllocateDedicated(memoryTypeIndex, memoryRequirements, dedicatedNext, allocation))
+			{
+				return allocation;
+			}
+			continue;
+		}
+
+		if (AllocateFromPool(GetPool(memoryTypeIndex, linear), memoryRequirements, allocation))
+		{
+			return allocation;
+		}
+
+		//Heap may still fit the resource on its own when it cannot fit another block.
+		if (AllocateDedicated(memoryTypeIndex, memoryRequirements, dedicatedNext, allocation))
+		{
+			return allocation;
+		}
+	}
+
+	throw std::runtime_error("ERROR: Out of device memory.\n");
+}
+
+bool MemoryAllocator::AllocateFromPool(Pool& pool, const VkMemoryRequirements& requirements, Allocation& allocation)
+{
+	for (auto& block : pool.blocks)
+	{
+		uint64_t offset = 0u;
+		TlsfAllocator::Region* region = block->allocator.Allocate(requirements.size, requirements.alignment, offset);
+		if (region != nullptr)
+		{
+			allocation.memory = block->memory;
+			allocation.offset = offset;
+			allocation.size = requirements.size;
+			allocation.mapped = block->mapped != nullptr ? static_cast<char*>(block->mapped) + offset : nullptr;
+			allocation.memoryTypeIndex = pool.memoryTypeIndex;
+			allocation.block = block.get();
+			allocation.region = region;
+			return true;
+		}
+	}
+
+	VkDeviceSize blockSize = GetBlockSize(pool.memoryTypeIndex);
+	void* mapped = nullptr;
+	VkDeviceMemory memory = AllocateMemory(pool.memoryTypeIndex, blockSize, nullptr, mapped);
+	if (memory == VK_NULL_HANDLE)
+	{
+		return false;
+	}
+
+	auto block = std::make_unique<MemoryBlock>();
+	block->memory = memory;
+	block->mapped = mapped;
+	block->allocator.Create(blockSize);
+	pool.blocks.push_back(std::move(block));
+
+	uint64_t offset = 0u;
+	TlsfAllocator::Region* region = pool.blocks.back()->allocator.Allocate(requirements.size, requirements.alignment, offset);
+	if (region == nullptr)
+	{
+		return false;
+	}
+
+	allocation.memory = memory;
+	allocation.offset = offset;
+	allocation.size = requirements.size;
+	allocation.mapped = mapped != nullptr ? static_cast<char*>(mapped) + offset : nullptr;
+	allocation.memoryTypeIndex = pool.memoryTypeIndex;
+	allocation.block = pool.blocks.back().get();
+	allocation.region = region;
+	return true;
+}
+
+bool MemoryAllocator::AllocateDedicated(uint32_t memoryTypeIndex, const VkMemoryRequirements& requirements, const VkMemoryDedicatedAllocateInfo* dedicatedInfo, Allocation& allocation)
+{
+	void* mapped = nullptr;
+	VkDeviceMemory memory = AllocateMemory(memoryTypeIndex, requirements.size, dedicatedInfo, mapped);
+	if (memory == VK_NULL_HANDLE)
+	{
+		return false;
+	}
+
+	dedicatedAllocationCount++;
+	dedicatedBytes += requirements.size;
+
+	allocation.memory = memory;
+	allocation.offset = 0u;
+	allocation.size = requirements.size;
+	allocation.mapped = mapped;
+	allocation.memoryTypeIndex = memoryTypeIndex;
+	allocation.block = nullptr;
+	allocation.region = nullptr;
+	return true;
+}
+
+VkDeviceMemory MemoryAllocator::AllocateMemory(uint32_t memoryTypeIndex, VkDeviceSize size, const void* next, void*& mapped)
+{
+	if (deviceMemoryCount >= maxAllocationCount)
+	{
+		std::cout << "WARNING: Reached maxMemoryAllocationCount (" << maxAllocationCount << ").\n";
+		return VK_NULL_HANDLE;
+	}
+
+	VkMemoryAllocateInfo info{};
+	info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	info.pNext = next;
+	info.allocationSize = size;
+	info.memoryTypeIndex = memoryTypeIndex;
+
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	if (vkAllocateMemory(device, &info, hostAllocator->Get(VK_OBJECT_TYPE_DEVICE_MEMORY), &memory) != VK_SUCCESS)
+	{
+		return VK_NULL_HANDLE;
+	}
+
+	//Host visible memory stays mapped for its whole lifetime, mapping is not free on every driver.
+	mapped = nullptr;
+	if (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+		{
+			vkFreeMemory(device, memory, hostAllocator->Get(VK_OBJECT_TYPE_DEVICE_MEMORY));
+			return VK_NULL_HANDLE;
+		}
+	}
+
+	deviceMemoryCount++;
+	return memory;
+}
+
+MemoryAllocator::Pool& MemoryAllocator::GetPool(uint32_t memoryTypeIndex, bool linear)
+{
+	//With a granularity of one, linear and optimal resources may be neighbours and share pools.
+	if (bufferImageGranularity <= 1u)
+	{
+		linear = false;
+	}
+
+	for (auto& pool : pools)
+	{
+		if (pool.memoryTypeIndex == memoryTypeIndex && pool.linear == linear)
+		{
+			return pool;
+		}
+	}
+
+	pools.push_back(Pool{ memoryTypeIndex, linear, {} });
+	return pools.back();
+}
+
+VkDeviceSize MemoryAllocator::GetBlockSize(uint32_t memoryTypeIndex)
+{
+	//Small heaps, such as the 256 MiB BAR window of discrete GPUs, get proportionally smaller blocks.
+	VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+	VkDeviceSize blockSize = std::min(preferredBlockSize, heapSize / 8u);
+	return std::max<VkDeviceSize>((blockSize + 0xFFFFu) & ~VkDeviceSize(0xFFFFu), 1ull << 20);
+}
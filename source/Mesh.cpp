@@ -0,0 +1,177 @@
+#include "Mesh.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstddef>
+
+Mesh::Mesh() :
+	memoryAllocator(nullptr),
+	header(),
+	indexType(VK_INDEX_TYPE_UINT16),
+	vertexBuffer(VK_NULL_HANDLE),
+	vertexAllocation(),
+	indexBuffer(VK_NULL_HANDLE),
+	indexAllocation()
+{
+}
+
+Mesh::~Mesh()
+{
+}
+
+void Mesh::Create(const std::string& filename, MemoryAllocator* memoryAllocator, UploadManager* uploadManager)
+{
+	this->memoryAllocator = memoryAllocator;
+
+	std::ifstream file(filename, std::ios::ate | std::ios::binary);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("ERROR: Could not open mesh " + filename + "\n");
+	}
+
+	size_t fileSize = static_cast<size_t>(file.tellg());
+	if (fileSize < sizeof(MeshFileHeader))
+	{
+		throw std::runtime_error("ERROR: Mesh " + filename + " is truncated.\n");
+	}
+
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	ValidateHeader(filename, fileSize);
+
+	std::vector<char> data(static_cast<size_t>(GetVertexSize() + GetIndexSize()));
+	file.read(data.data(), data.size());
+	if (!file)
+	{
+		throw std::runtime_error("ERROR: Could not read mesh " + filename + "\n");
+	}
+
+	CreateBuffers();
+	uploadManager->UploadBuffer(vertexBuffer, 0u, data.data(), GetVertexSize());
+	uploadManager->UploadBuffer(indexBuffer, 0u, data.data() + GetVertexSize(), GetIndexSize());
+	uploadManager->Flush();
+
+	std::cout << "INFO: Loaded mesh " << filename << " with " << header.vertexCount << " vertices and " << header.indexCount / 3u << " triangles.\n";
+}
+
+void Mesh::Create(AssetArchive* archive, const std::string& name, MemoryAllocator* memoryAllocator, UploadManager* uploadManager)
+{
+	this->memoryAllocator = memoryAllocator;
+
+	const ArchiveEntry* entry = archive->Find(name);
+	if (entry == nullptr)
+	{
+		throw std::runtime_error("ERROR: Archive has no mesh " + name + "\n");
+	}
+
+	if (entry->size < sizeof(MeshFileHeader))
+	{
+		throw std::runtime_error("ERROR: Mesh " + name + " is truncated.\n");
+	}
+
+	archive->Read(*entry, 0u, sizeof(header), &header);
+	ValidateHeader(name, entry->size);
+	CreateBuffers();
+
+	//No intermediate copy: every ring chunk is filled by decoding the archive chunks it covers on the archive's workers.
+	VkDeviceSize vertexBegin = sizeof(MeshFileHeader);
+	VkDeviceSize indexBegin = vertexBegin + GetVertexSize();
+	uploadManager->UploadBuffer(vertexBuffer, 0u, GetVertexSize(), [archive, entry, vertexBegin](void* destination, VkDeviceSize offset, VkDeviceSize size)
+	{
+		archive->Read(*entry, vertexBegin + offset, size, destination);
+	});
+	uploadManager->UploadBuffer(indexBuffer, 0u, GetIndexSize(), [archive, entry, indexBegin](void* destination, VkDeviceSize offset, VkDeviceSize size)
+	{
+		archive->Read(*entry, indexBegin + offset, size, destination);
+	});
+	uploadManager->Flush();
+
+	std::cout << "INFO: Loaded mesh " << name << " from archive with " << header.vertexCount << " vertices and " << header.indexCount / 3u << " triangles.\n";
+}
+
+void Mesh::Destroy()
+{
+	if (memoryAllocator == nullptr)
+	{
+		return;
+	}
+
+	memoryAllocator->DestroyBuffer(indexBuffer, indexAllocation);
+	memoryAllocator->DestroyBuffer(vertexBuffer, vertexAllocation);
+	indexBuffer = VK_NULL_HANDLE;
+	vertexBuffer = VK_NULL_HANDLE;
+	memoryAllocator = nullptr;
+}
+
+void Mesh::Draw(VkCommandBuffer commandBuffer, uint32_t instanceCount) const
+{
+	VkDeviceSize offset = 0u;
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, &offset);
+	vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0u, indexType);
+	vkCmdDrawIndexed(commandBuffer, header.indexCount, instanceCount, 0, 0, 0);
+}
+
+const MeshFileHeader& Mesh::GetHeader() const
+{
+	return header;
+}
+
+std::vector<VkVertexInputBindingDescription> Mesh::GetVertexBindings()
+{
+	VkVertexInputBindingDescription binding{};
+	binding.binding = 0;
+	binding.stride = sizeof(PackedVertex);
+	binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	return { binding };
+}
+
+std::vector<VkVertexInputAttributeDescription> Mesh::GetVertexAttributes()
+{
+	//All three formats are mandatory for vertex buffers, no format query is needed.
+	return {
+		{ 0u, 0u, VK_FORMAT_R16G16B16A16_SNORM, static_cast<uint32_t>(offsetof(PackedVertex, position)) },
+		{ 1u, 0u, VK_FORMAT_R16G16_SNORM, static_cast<uint32_t>(offsetof(PackedVertex, normal)) },
+		{ 2u, 0u, VK_FORMAT_R16G16_UNORM, static_cast<uint32_t>(offsetof(PackedVertex, uv)) }
+	};
+}
+
+void Mesh::ValidateHeader(const std::string& name, uint64_t fileSize)
+{
+	if (std::memcmp(header.magic, meshFileMagic, sizeof(meshFileMagic)) != 0 || header.version != meshFileVersion)
+	{
+		throw std::runtime_error("ERROR: " + name + " is not a mesh written by this version of MeshImport.\n");
+	}
+
+	indexType = UsesShortIndices(header.vertexCount) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	if (header.vertexCount == 0u || header.indexCount == 0u || header.indexCount % 3u != 0u || fileSize != sizeof(MeshFileHeader) + GetVertexSize() + GetIndexSize())
+	{
+		throw std::runtime_error("ERROR: Mesh " + name + " is corrupt.\n");
+	}
+}
+
+void Mesh::CreateBuffers()
+{
+	VkBufferCreateInfo info{};
+	info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	info.size = GetVertexSize();
+	info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	memoryAllocator->CreateBuffer(info, MemoryUsage::GpuOnly, vertexBuffer, vertexAllocation);
+
+	info.size = GetIndexSize();
+	info.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	memoryAllocator->CreateBuffer(info, MemoryUsage::GpuOnly, indexBuffer, indexAllocation);
+}
+
+VkDeviceSize Mesh::GetVertexSize() const
+{
+	return static_cast<VkDeviceSize>(header.vertexCount) * sizeof(PackedVertex);
+}
+
+VkDeviceSize Mesh::GetIndexSize() const
+{
+	return static_cast<VkDeviceSize>(header.indexCount) * (indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t));
+}
@@ -0,0 +1,88 @@
+#include "MeshApplication.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+
+MeshApplication::MeshApplication(const ApplicationSettings& settings) :
+	TriangleApplication(settings),
+	mesh(),
+	constants(),
+	meshPipelineLayout(VK_NULL_HANDLE),
+	meshPipeline(VK_NULL_HANDLE)
+{
+	Initialise();
+}
+
+MeshApplication::~MeshApplication()
+{
+	Destroy();
+}
+
+void MeshApplication::Initialise()
+{
+	if (settings.meshPath.empty())
+	{
+		throw std::runtime_error("ERROR: The mesh scene needs --mesh with a file written by MeshImport.\n");
+	}
+
+	if (assetArchive.IsOpen())
+	{
+		mesh.Create(&assetArchive, settings.meshPath, &memoryAllocator, &uploadManager);
+	}
+	else
+	{
+		mesh.Create(settings.meshPath, &memoryAllocator, &uploadManager);
+	}
+	CreateMeshPipeline();
+}
+
+void MeshApplication::Destroy()
+{
+	frameScheduler.WaitIdle();
+
+	mesh.Destroy();
+}
+
+void MeshApplication::UpdateFrame(uint32_t frameSlot)
+{
+	float angle = static_cast<float>(frameScheduler.GetFrameNumber()) / 120.f;
+
+	//Quantised positions span [-1, 1] along the longest axis, which rotated stays within sqrt(2) of the center.
+	float scale = 0.9f / std::sqrt(2.f);
+	float aspect = static_cast<float>(swapchainExtent.width) / static_cast<float>(swapchainExtent.height);
+	constants.transform[0] = std::cos(angle);
+	constants.transform[1] = std::sin(angle);
+	constants.transform[2] = scale / std::max(aspect, 1.f);
+	constants.transform[3] = scale * std::min(aspect, 1.f);
+}
+
+void MeshApplication::RecordDraws(VkCommandBuffer commandBuffer, uint32_t frameSlot, uint32_t begin, uint32_t end)
+{
+	Profiler::CpuScope scope(profiler, "RecordDraws");
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, meshPipeline);
+	SetViewportAndScissor(commandBuffer);
+	vkCmdPushConstants(commandBuffer, meshPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(MeshConstants), &constants);
+
+	for (uint32_t i = begin; i < end; i++)
+	{
+		mesh.Draw(commandBuffer);
+	}
+}
+
+void MeshApplication::CreateMeshPipeline()
+{
+	GraphicsPipelineDescription description{};
+	description.vertexShader = "shader/mesh.vert";
+	description.fragmentShader = "shader/mesh.frag";
+	description.attachments = mainPassFormats;
+	description.vertexBindings = Mesh::GetVertexBindings();
+	description.vertexAttributes = Mesh::GetVertexAttributes();
+	//Imported meshes wind counter clockwise with y up, mesh.vert flips y into Vulkan's clip space.
+	description.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+	meshPipelineLayout = pipelineBuilder.GetPipelineLayout(description);
+	description.layout = meshPipelineLayout;
+	meshPipeline = pipelineBuilder.Submit(description).get();
+}
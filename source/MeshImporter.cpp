@@ -0,0 +1,921 @@
+#include "MeshImporter.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <unordered_map>
+#include <map>
+#include <array>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+namespace
+{
+	//Just enough JSON for glTF. Objects keep their members in file order.
+	struct JsonValue
+	{
+		enum class Type
+		{
+			Null,
+			Boolean,
+			Number,
+			String,
+			Array,
+			Object
+		};
+
+		Type type = Type::Null;
+		bool boolean = false;
+		double number = 0.0;
+		std::string string;
+		std::vector<JsonValue> array;
+		std::vector<std::pair<std::string, JsonValue>> object;
+
+		const JsonValue* Find(const std::string& key) const
+		{
+			for (auto& member : object)
+			{
+				if (member.first == key)
+				{
+					return &member.second;
+				}
+			}
+			return nullptr;
+		}
+
+		const JsonValue& Get(const std::string& key) const
+		{
+			const JsonValue* value = Find(key);
+			if (value == nullptr)
+			{
+				throw std::runtime_error("ERROR: glTF member " + key + " is missing.\n");
+			}
+			return *value;
+		}
+
+		double GetNumber(const std::string& key, double fallback) const
+		{
+			const JsonValue* value = Find(key);
+			return value != nullptr && value->type == Type::Number ? value->number : fallback;
+		}
+
+		uint32_t GetIndex(const std::string& key) const
+		{
+			return static_cast<uint32_t>(Get(key).number);
+		}
+	};
+
+	class JsonParser
+	{
+	public:
+		JsonParser(const char* begin, const char* end) :
+			cursor(begin),
+			end(end)
+		{
+		}
+
+		JsonValue Parse()
+		{
+			JsonValue value = ParseValue();
+			SkipWhitespace();
+			if (cursor != end)
+			{
+				Fail();
+			}
+			return value;
+		}
+	private:
+		[[noreturn]] void Fail()
+		{
+			throw std::runtime_error("ERROR: glTF JSON is malformed.\n");
+		}
+
+		void SkipWhitespace()
+		{
+			while (cursor != end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r'))
+			{
+				cursor++;
+			}
+		}
+
+		void Expect(char c)
+		{
+			SkipWhitespace();
+			if (cursor == end || *cursor != c)
+			{
+				Fail();
+			}
+			cursor++;
+		}
+
+		bool Consume(const char* literal)
+		{
+			size_t length = std::strlen(literal);
+			if (static_cast<size_t>(end - cursor) >= length && std::memcmp(cursor, literal, length) == 0)
+			{
+				cursor += length;
+				return true;
+			}
+			return false;
+		}
+
+		bool ConsumeSeparator()
+		{
+			SkipWhitespace();
+			if (cursor != end && *cursor == ',')
+			{
+				cursor++;
+				return true;
+			}
+			return false;
+		}
+
+		JsonValue ParseValue()
+		{
+			SkipWhitespace();
+			if (cursor == end)
+			{
+				Fail();
+			}
+
+			JsonValue value;
+			if (*cursor == '{')
+			{
+				value.type = JsonValue::Type::Object;
+				cursor++;
+				SkipWhitespace();
+				if (cursor != end && *cursor == '}')
+				{
+					cursor++;
+					return value;
+				}
+				while (true)
+				{
+					SkipWhitespace();
+					std::string key = ParseString();
+					Expect(':');
+					value.object.emplace_back(std::move(key), ParseValue());
+					if (!ConsumeSeparator())
+					{
+						break;
+					}
+				}
+				Expect('}');
+			}
+			else if (*cursor == '[')
+			{
+				value.type = JsonValue::Type::Array;
+				cursor++;
+				SkipWhitespace();
+				if (cursor != end && *cursor == ']')
+				{
+					cursor++;
+					return value;
+				}
+				while (true)
+				{
+					value.array.push_back(ParseValue());
+					if (!ConsumeSeparator())
+					{
+						break;
+					}
+				}
+				Expect(']');
+			}
+			else if (*cursor == '"')
+			{
+				value.type = JsonValue::Type::String;
+				value.string = ParseString();
+			}
+			else if (Consume("true"))
+			{
+				value.type = JsonValue::Type::Boolean;
+				value.boolean = true;
+			}
+			else if (Consume("false"))
+			{
+				value.type = JsonValue::Type::Boolean;
+			}
+			else if (Consume("null"))
+			{
+				value.type = JsonValue::Type::Null;
+			}
+			else
+			{
+				//strtod stops at the first character that does not belong to the number.
+				std::string text(cursor, std::min<size_t>(end - cursor, 64u));
+				char* numberEnd = nullptr;
+				value.type = JsonValue::Type::Number;
+				value.number = std::strtod(text.c_str(), &numberEnd);
+				if (numberEnd == text.c_str())
+				{
+					Fail();
+				}
+				cursor += numberEnd - text.c_str();
+			}
+			return value;
+		}
+
+		std::string ParseString()
+		{
+			if (cursor == end || *cursor != '"')
+			{
+				Fail();
+			}
+			cursor++;
+
+			//Escapes are kept as ASCII, glTF only needs them in names and URIs.
+			std::string string;
+			while (cursor != end && *cursor != '"')
+			{
+				char c = *cursor++;
+				if (c == '\\' && cursor != end)
+				{
+					char escaped = *cursor++;
+					switch (escaped)
+					{
+					case 'n': string += '\n'; break;
+					case 't': string += '\t'; break;
+					case 'r': string += '\r'; break;
+					case 'b': string += '\b'; break;
+					case 'f': string += '\f'; break;
+					case 'u':
+						if (end - cursor < 4)
+						{
+							Fail();
+						}
+						string += static_cast<char>(std::strtol(std::string(cursor, 4).c_str(), nullptr, 16) & 0x7f);
+						cursor += 4;
+						break;
+					default: string += escaped; break;
+					}
+				}
+				else
+				{
+					string += c;
+				}
+			}
+			Expect('"');
+			return string;
+		}
+
+		const char* cursor;
+		const char* end;
+	};
+
+	std::vector<uint8_t> DecodeBase64(const std::string& text)
+	{
+		std::vector<uint8_t> data;
+		data.reserve(text.size() * 3u / 4u);
+
+		uint32_t bits = 0u;
+		uint32_t bitCount = 0u;
+		for (char c : text)
+		{
+			uint32_t value = 0u;
+			if (c >= 'A' && c <= 'Z') value = c - 'A';
+			else if (c >= 'a' && c <= 'z') value = c - 'a' + 26u;
+			else if (c >= '0' && c <= '9') value = c - '0' + 52u;
+			else if (c == '+') value = 62u;
+			else if (c == '/') value = 63u;
+			else continue;
+
+			bits = (bits << 6u) | value;
+			bitCount += 6u;
+			if (bitCount >= 8u)
+			{
+				bitCount -= 8u;
+				data.push_back(static_cast<uint8_t>(bits >> bitCount));
+			}
+		}
+		return data;
+	}
+
+	std::vector<char> ReadBinaryFile(const std::filesystem::path& path)
+	{
+		std::ifstream file(path, std::ios::ate | std::ios::binary);
+		if (!file.is_open())
+		{
+			throw std::runtime_error("ERROR: Could not open " + path.string() + "\n");
+		}
+
+		std::vector<char> data(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(data.data(), data.size());
+		return data;
+	}
+
+	//Column major 4x4 matrices as glTF stores them.
+	using Matrix = std::array<float, 16>;
+
+	Matrix Multiply(const Matrix& a, const Matrix& b)
+	{
+		Matrix result{};
+		for (uint32_t column = 0; column < 4u; column++)
+		{
+			for (uint32_t row = 0; row < 4u; row++)
+			{
+				float sum = 0.f;
+				for (uint32_t k = 0; k < 4u; k++)
+				{
+					sum += a[k * 4u + row] * b[column * 4u + k];
+				}
+				result[column * 4u + row] = sum;
+			}
+		}
+		return result;
+	}
+
+	Matrix GetNodeMatrix(const JsonValue& node)
+	{
+		Matrix matrix = { 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f };
+		if (const JsonValue* values = node.Find("matrix"))
+		{
+			for (uint32_t i = 0; i < 16u && i < values->array.size(); i++)
+			{
+				matrix[i] = static_cast<float>(values->array[i].number);
+			}
+			return matrix;
+		}
+
+		float t[3] = { 0.f, 0.f, 0.f };
+		float r[4] = { 0.f, 0.f, 0.f, 1.f };
+		float s[3] = { 1.f, 1.f, 1.f };
+		if (const JsonValue* values = node.Find("translation"))
+		{
+			for (uint32_t i = 0; i < 3u && i < values->array.size(); i++) t[i] = static_cast<float>(values->array[i].number);
+		}
+		if (const JsonValue* values = node.Find("rotation"))
+		{
+			for (uint32_t i = 0; i < 4u && i < values->array.size(); i++) r[i] = static_cast<float>(values->array[i].number);
+		}
+		if (const JsonValue* values = node.Find("scale"))
+		{
+			for (uint32_t i = 0; i < 3u && i < values->array.size(); i++) s[i] = static_cast<float>(values->array[i].number);
+		}
+
+		//T * R * S with R from the unit quaternion xyzw.
+		float x = r[0], y = r[1], z = r[2], w = r[3];
+		matrix[0] = (1.f - 2.f * (y * y + z * z)) * s[0];
+		matrix[1] = (2.f * (x * y + z * w)) * s[0];
+		matrix[2] = (2.f * (x * z - y * w)) * s[0];
+		matrix[4] = (2.f * (x * y - z * w)) * s[1];
+		matrix[5] = (1.f - 2.f * (x * x + z * z)) * s[1];
+		matrix[6] = (2.f * (y * z + x * w)) * s[1];
+		matrix[8] = (2.f * (x * z + y * w)) * s[2];
+		matrix[9] = (2.f * (y * z - x * w)) * s[2];
+		matrix[10] = (1.f - 2.f * (x * x + y * y)) * s[2];
+		matrix[12] = t[0];
+		matrix[13] = t[1];
+		matrix[14] = t[2];
+		return matrix;
+	}
+
+	class GltfDocument
+	{
+	public:
+		GltfDocument(const std::string& filename)
+		{
+			std::filesystem::path path(filename);
+			std::vector<char> file = ReadBinaryFile(path);
+
+			const char* jsonBegin = file.data();
+			const char* jsonEnd = file.data() + file.size();
+			std::vector<uint8_t> binaryChunk;
+
+			//GLB: 12 byte header, then a JSON chunk and an optional binary chunk, each with length and type.
+			if (file.size() >= 12u && std::memcmp(file.data(), "glTF", 4) == 0)
+			{
+				size_t offset = 12u;
+				bool json = false;
+				while (offset + 8u <= file.size())
+				{
+					uint32_t length = 0u;
+					uint32_t type = 0u;
+					std::memcpy(&length, file.data() + offset, 4u);
+					std::memcpy(&type, file.data() + offset + 4u, 4u);
+					offset += 8u;
+					if (offset + length > file.size())
+					{
+						throw std::runtime_error("ERROR: GLB file " + filename + " is truncated.\n");
+					}
+
+					if (type == 0x4E4F534Au && !json)
+					{
+						jsonBegin = file.data() + offset;
+						jsonEnd = jsonBegin + length;
+						json = true;
+					}
+					else if (type == 0x004E4942u && binaryChunk.empty())
+					{
+						binaryChunk.assign(file.data() + offset, file.data() + offset + length);
+					}
+					offset += (length + 3u) & ~3u;
+				}
+
+				if (!json)
+				{
+					throw std::runtime_error("ERROR: GLB file " + filename + " has no JSON chunk.\n");
+				}
+			}
+
+			root = JsonParser(jsonBegin, jsonEnd).Parse();
+
+			if (const JsonValue* bufferList = root.Find("buffers"))
+			{
+				for (auto& buffer : bufferList->array)
+				{
+					const JsonValue* uri = buffer.Find("uri");
+					if (uri == nullptr)
+					{
+						buffers.push_back(binaryChunk);
+					}
+					else if (uri->string.rfind("data:", 0) == 0)
+					{
+						buffers.push_back(DecodeBase64(uri->string.substr(uri->string.find(',') + 1u)));
+					}
+					else
+					{
+						std::vector<char> data = ReadBinaryFile(path.parent_path() / uri->string);
+						buffers.emplace_back(data.begin(), data.end());
+					}
+				}
+			}
+		}
+
+		const JsonValue& GetArray(const std::string& key, uint32_t index) const
+		{
+			const JsonValue& array = root.Get(key);
+			if (index >= array.array.size())
+			{
+				throw std::runtime_error("ERROR: glTF " + key + " index is out of range.\n");
+			}
+			return array.array[index];
+		}
+
+		//Reads components values per element as floats, normalized integers are converted to [0, 1] or [-1, 1].
+		std::vector<float> ReadFloats(uint32_t accessorIndex, uint32_t components) const
+		{
+			const JsonValue& accessor = GetArray("accessors", accessorIndex);
+			uint32_t count = accessor.GetIndex("count");
+			uint32_t componentType = accessor.GetIndex("componentType");
+			bool normalized = accessor.Find("normalized") != nullptr && accessor.Get("normalized").boolean;
+
+			std::vector<float> values(static_cast<size_t>(count) * components, 0.f);
+			Read(accessor, components, [&](const uint8_t* element, uint32_t i, uint32_t c)
+			{
+				float value = 0.f;
+				switch (componentType)
+				{
+				case 5126: std::memcpy(&value, element + c * 4u, 4u); break;
+				case 5121: value = element[c] / (normalized ? 255.f : 1.f); break;
+				case 5120: value = std::max(static_cast<int8_t>(element[c]) / (normalized ? 127.f : 1.f), -1.f); break;
+				case 5123: { uint16_t v; std::memcpy(&v, element + c * 2u, 2u); value = v / (normalized ? 65535.f : 1.f); } break;
+				case 5122: { int16_t v; std::memcpy(&v, element + c * 2u, 2u); value = std::max(v / (normalized ? 32767.f : 1.f), -1.f); } break;
+				default: throw std::runtime_error("ERROR: Unsupported glTF vertex component type.\n");
+				}
+				values[static_cast<size_t>(i) * components + c] = value;
+			});
+			return values;
+		}
+
+		std::vector<uint32_t> ReadIndices(uint32_t accessorIndex) const
+		{
+			const JsonValue& accessor = GetArray("accessors", accessorIndex);
+			uint32_t componentType = accessor.GetIndex("componentType");
+
+			std::vector<uint32_t> indices(accessor.GetIndex("count"));
+			Read(accessor, 1u, [&](const uint8_t* element, uint32_t i, uint32_t c)
+			{
+				switch (componentType)
+				{
+				case 5121: indices[i] = element[0]; break;
+				case 5123: { uint16_t v; std::memcpy(&v, element, 2u); indices[i] = v; } break;
+				case 5125: std::memcpy(&indices[i], element, 4u); break;
+				default: throw std::runtime_error("ERROR: Unsupported glTF index component type.\n");
+				}
+			});
+			return indices;
+		}
+
+		JsonValue root;
+	private:
+		template<typename Function>
+		void Read(const JsonValue& accessor, uint32_t components, Function function) const
+		{
+			if (accessor.Find("sparse") != nullptr)
+			{
+				throw std::runtime_error("ERROR: Sparse glTF accessors are not supported.\n");
+			}
+
+			//Accessors without a buffer view are all zeros.
+			if (accessor.Find("bufferView") == nullptr)
+			{
+				return;
+			}
+
+			const JsonValue& view = GetArray("bufferViews", accessor.GetIndex("bufferView"));
+			uint32_t bufferIndex = view.GetIndex("buffer");
+			if (bufferIndex >= buffers.size())
+			{
+				throw std::runtime_error("ERROR: glTF buffer index is out of range.\n");
+			}
+
+			uint32_t componentSize = 0u;
+			switch (accessor.GetIndex("componentType"))
+			{
+			case 5120: case 5121: componentSize = 1u; break;
+			case 5122: case 5123: componentSize = 2u; break;
+			default: componentSize = 4u; break;
+			}
+
+			const std::vector<uint8_t>& buffer = buffers[bufferIndex];
+			size_t offset = static_cast<size_t>(view.GetNumber("byteOffset", 0.0) + accessor.GetNumber("byteOffset", 0.0));
+			size_t elementSize = static_cast<size_t>(componentSize) * components;
+			size_t stride = static_cast<size_t>(view.GetNumber("byteStride", static_cast<double>(elementSize)));
+			uint32_t count = accessor.GetIndex("count");
+
+			if (count != 0u && offset + stride * (count - 1u) + elementSize > buffer.size())
+			{
+				throw std::runtime_error("ERROR: glTF accessor reads past the end of its buffer.\n");
+			}
+
+			for (uint32_t i = 0; i < count; i++)
+			{
+				for (uint32_t c = 0; c < components; c++)
+				{
+					function(buffer.data() + offset + stride * i, i, c);
+				}
+			}
+		}
+
+		std::vector<std::vector<uint8_t>> buffers;
+	};
+}
+
+ImportedMesh MeshImporter::Load(const std::string& filename)
+{
+	std::string extension = std::filesystem::path(filename).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+	if (extension == ".obj")
+	{
+		return LoadObj(filename);
+	}
+	if (extension == ".gltf" || extension == ".glb")
+	{
+		return LoadGltf(filename);
+	}
+
+	throw std::runtime_error("ERROR: Unknown mesh format " + extension + ", expected .obj, .gltf or .glb.\n");
+}
+
+ImportedMesh MeshImporter::LoadObj(const std::string& filename)
+{
+	std::ifstream file(filename);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("ERROR: Could not open " + filename + "\n");
+	}
+
+	std::vector<std::array<float, 3>> positions;
+	std::vector<std::array<float, 3>> normals;
+	std::vector<std::array<float, 2>> uvs;
+
+	//Every distinct position/uv/normal triple becomes one vertex.
+	ImportedMesh mesh;
+	std::map<std::array<int64_t, 3>, uint32_t> vertexIds;
+	bool missingNormals = false;
+
+	//OBJ indices are 1 based, negative ones count back from the last element read so far.
+	auto resolve = [](int64_t index, size_t count) -> int64_t
+	{
+		int64_t resolved = index < 0 ? static_cast<int64_t>(count) + index : index - 1;
+		if (resolved < 0 || resolved >= static_cast<int64_t>(count))
+		{
+			throw std::runtime_error("ERROR: OBJ face index is out of range.\n");
+		}
+		return resolved;
+	};
+
+	std::string line;
+	std::vector<uint32_t> polygon;
+	while (std::getline(file, line))
+	{
+		std::istringstream stream(line);
+		std::string keyword;
+		stream >> keyword;
+
+		if (keyword == "v")
+		{
+			std::array<float, 3> position{};
+			stream >> position[0] >> position[1] >> position[2];
+			positions.push_back(position);
+		}
+		else if (keyword == "vn")
+		{
+			std::array<float, 3> normal{};
+			stream >> normal[0] >> normal[1] >> normal[2];
+			normals.push_back(normal);
+		}
+		else if (keyword == "vt")
+		{
+			std::array<float, 2> uv{};
+			stream >> uv[0] >> uv[1];
+			uvs.push_back(uv);
+		}
+		else if (keyword == "f")
+		{
+			polygon.clear();
+			std::string corner;
+			while (stream >> corner)
+			{
+				//v, v/vt, v//vn or v/vt/vn.
+				std::array<int64_t, 3> key = { 0, -1, -1 };
+				size_t first = corner.find('/');
+				size_t second = first == std::string::npos ? std::string::npos : corner.find('/', first + 1u);
+				key[0] = resolve(std::stoll(corner.substr(0, first)), positions.size());
+				if (first != std::string::npos && second != first + 1u)
+				{
+					key[1] = resolve(std::stoll(corner.substr(first + 1u, second - first - 1u)), uvs.size());
+				}
+				if (second != std::string::npos)
+				{
+					key[2] = resolve(std::stoll(corner.substr(second + 1u)), normals.size());
+				}
+
+				auto found = vertexIds.find(key);
+				if (found == vertexIds.end())
+				{
+					ImportedVertex vertex{};
+					std::memcpy(vertex.position, positions[key[0]].data(), sizeof(vertex.position));
+					if (key[1] >= 0)
+					{
+						//OBJ puts the uv origin in the bottom left corner.
+						vertex.uv[0] = uvs[key[1]][0];
+						vertex.uv[1] = 1.f - uvs[key[1]][1];
+					}
+					if (key[2] >= 0)
+					{
+						std::memcpy(vertex.normal, normals[key[2]].data(), sizeof(vertex.normal));
+					}
+					missingNormals = missingNormals || key[2] < 0;
+
+					found = vertexIds.emplace(key, static_cast<uint32_t>(mesh.vertices.size())).first;
+					mesh.vertices.push_back(vertex);
+				}
+				polygon.push_back(found->second);
+			}
+
+			for (size_t i = 2; i < polygon.size(); i++)
+			{
+				mesh.indices.push_back(polygon[0]);
+				mesh.indices.push_back(polygon[i - 1u]);
+				mesh.indices.push_back(polygon[i]);
+			}
+		}
+	}
+
+	if (mesh.indices.empty())
+	{
+		throw std::runtime_error("ERROR: " + filename + " contains no faces.\n");
+	}
+
+	if (missingNormals)
+	{
+		GenerateNormals(mesh);
+	}
+
+	return mesh;
+}
+
+ImportedMesh MeshImporter::LoadGltf(const std::string& filename)
+{
+	GltfDocument document(filename);
+	const JsonValue& root = document.root;
+
+	ImportedMesh mesh;
+	bool missingNormals = false;
+
+	auto addMesh = [&](uint32_t meshIndex, const Matrix& matrix)
+	{
+		//Normals use the inverse transpose, the cofactor matrix is the same up to a scale normalization removes.
+		float normalMatrix[9] = {
+			matrix[5] * matrix[10] - matrix[6] * matrix[9], matrix[6] * matrix[8] - matrix[4] * matrix[10], matrix[4] * matrix[9] - matrix[5] * matrix[8],
+			matrix[9] * matrix[2] - matrix[10] * matrix[1], matrix[10] * matrix[0] - matrix[8] * matrix[2], matrix[8] * matrix[1] - matrix[9] * matrix[0],
+			matrix[1] * matrix[6] - matrix[2] * matrix[5], matrix[2] * matrix[4] - matrix[0] * matrix[6], matrix[0] * matrix[5] - matrix[1] * matrix[4]
+		};
+		float determinant = matrix[0] * normalMatrix[0] + matrix[4] * normalMatrix[1] + matrix[8] * normalMatrix[2];
+
+		for (auto& primitive : document.GetArray("meshes", meshIndex).Get("primitives").array)
+		{
+			if (primitive.GetNumber("mode", 4.0) != 4.0)
+			{
+				std::cout << "WARNING: Skipping glTF primitive that is not a triangle list.\n";
+				continue;
+			}
+
+			const JsonValue& attributes = primitive.Get("attributes");
+			std::vector<float> positions = document.ReadFloats(attributes.GetIndex("POSITION"), 3u);
+			std::vector<float> normals = attributes.Find("NORMAL") ? document.ReadFloats(attributes.GetIndex("NORMAL"), 3u) : std::vector<float>();
+			std::vector<float> uvs = attributes.Find("TEXCOORD_0") ? document.ReadFloats(attributes.GetIndex("TEXCOORD_0"), 2u) : std::vector<float>();
+			missingNormals = missingNormals || normals.empty();
+
+			uint32_t base = static_cast<uint32_t>(mesh.vertices.size());
+			uint32_t count = static_cast<uint32_t>(positions.size() / 3u);
+			for (uint32_t i = 0; i < count; i++)
+			{
+				ImportedVertex vertex{};
+				const float* p = &positions[i * 3u];
+				for (uint32_t row = 0; row < 3u; row++)
+				{
+					vertex.position[row] = matrix[row] * p[0] + matrix[4u + row] * p[1] + matrix[8u + row] * p[2] + matrix[12u + row];
+				}
+
+				if (!normals.empty())
+				{
+					const float* n = &normals[i * 3u];
+					float length = 0.f;
+					for (uint32_t row = 0; row < 3u; row++)
+					{
+						vertex.normal[row] = normalMatrix[row * 3u] * n[0] + normalMatrix[row * 3u + 1u] * n[1] + normalMatrix[row * 3u + 2u] * n[2];
+						length += vertex.normal[row] * vertex.normal[row];
+					}
+					length = std::sqrt(length);
+					for (uint32_t row = 0; row < 3u && length > 0.f; row++)
+					{
+						vertex.normal[row] /= length;
+					}
+				}
+
+				if (!uvs.empty())
+				{
+					vertex.uv[0] = uvs[i * 2u];
+					vertex.uv[1] = uvs[i * 2u + 1u];
+				}
+
+				mesh.vertices.push_back(vertex);
+			}
+
+			std::vector<uint32_t> indices;
+			if (primitive.Find("indices"))
+			{
+				indices = document.ReadIndices(primitive.GetIndex("indices"));
+			}
+			else
+			{
+				indices.resize(count);
+				for (uint32_t i = 0; i < count; i++)
+				{
+					indices[i] = i;
+				}
+			}
+
+			//Mirroring transforms turn the winding around.
+			for (size_t i = 0; i + 2u < indices.size(); i += 3u)
+			{
+				if (indices[i] >= count || indices[i + 1u] >= count || indices[i + 2u] >= count)
+				{
+					throw std::runtime_error("ERROR: glTF index is out of range.\n");
+				}
+				mesh.indices.push_back(base + indices[i]);
+				mesh.indices.push_back(base + indices[determinant < 0.f ? i + 2u : i + 1u]);
+				mesh.indices.push_back(base + indices[determinant < 0.f ? i + 1u : i + 2u]);
+			}
+		}
+	};
+
+	//Walks the node hierarchy of the default scene, files without scenes have their meshes taken as they are.
+	const JsonValue* scenes = root.Find("scenes");
+	if (scenes != nullptr && !scenes->array.empty())
+	{
+		uint32_t sceneIndex = static_cast<uint32_t>(root.GetNumber("scene", 0.0));
+		const JsonValue& scene = document.GetArray("scenes", sceneIndex);
+
+		std::vector<std::pair<uint32_t, Matrix>> stack;
+		Matrix identity = { 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f };
+		if (const JsonValue* nodes = scene.Find("nodes"))
+		{
+			for (auto& node : nodes->array)
+			{
+				stack.emplace_back(static_cast<uint32_t>(node.number), identity);
+			}
+		}
+
+		//Node graphs are trees, the depth limit only guards against malformed files.
+		size_t visited = 0u;
+		while (!stack.empty())
+		{
+			auto [nodeIndex, parent] = stack.back();
+			stack.pop_back();
+			if (++visited > root.Get("nodes").array.size())
+			{
+				throw std::runtime_error("ERROR: glTF node hierarchy contains a cycle.\n");
+			}
+
+			const JsonValue& node = document.GetArray("nodes", nodeIndex);
+			Matrix matrix = Multiply(parent, GetNodeMatrix(node));
+			if (node.Find("mesh"))
+			{
+				addMesh(node.GetIndex("mesh"), matrix);
+			}
+			if (const JsonValue* children = node.Find("children"))
+			{
+				for (auto& child : children->array)
+				{
+					stack.emplace_back(static_cast<uint32_t>(child.number), matrix);
+				}
+			}
+		}
+	}
+	else if (const JsonValue* meshes = root.Find("meshes"))
+	{
+		Matrix identity = { 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f };
+		for (uint32_t i = 0; i < meshes->array.size(); i++)
+		{
+			addMesh(i, identity);
+		}
+	}
+
+	if (mesh.indices.empty())
+	{
+		throw std::runtime_error("ERROR: " + filename + " contains no triangles.\n");
+	}
+
+	if (missingNormals)
+	{
+		GenerateNormals(mesh);
+	}
+
+	//Primitives duplicate vertices on their borders, merge what is identical.
+	std::unordered_map<std::string, uint32_t> unique;
+	std::vector<uint32_t> remap(mesh.vertices.size());
+	std::vector<ImportedVertex> vertices;
+	for (uint32_t i = 0; i < mesh.vertices.size(); i++)
+	{
+		std::string key(reinterpret_cast<const char*>(&mesh.vertices[i]), sizeof(ImportedVertex));
+		auto inserted = unique.emplace(key, static_cast<uint32_t>(vertices.size()));
+		if (inserted.second)
+		{
+			vertices.push_back(mesh.vertices[i]);
+		}
+		remap[i] = inserted.first->second;
+	}
+	for (auto& index : mesh.indices)
+	{
+		index = remap[index];
+	}
+	mesh.vertices.swap(vertices);
+
+	return mesh;
+}
+
+void MeshImporter::GenerateNormals(ImportedMesh& mesh)
+{
+	//Area weighted face normals summed per position, so vertices split by uv seams still shade smoothly.
+	std::map<std::array<float, 3>, std::array<float, 3>> sums;
+	auto position = [&](uint32_t index) { const float* p = mesh.vertices[index].position; return std::array<float, 3>{ p[0], p[1], p[2] }; };
+
+	for (size_t i = 0; i + 2u < mesh.indices.size(); i += 3u)
+	{
+		std::array<float, 3> a = position(mesh.indices[i]);
+		std::array<float, 3> b = position(mesh.indices[i + 1u]);
+		std::array<float, 3> c = position(mesh.indices[i + 2u]);
+		float e0[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		float e1[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+		float normal[3] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+
+		for (auto& corner : { a, b, c })
+		{
+			std::array<float, 3>& sum = sums[corner];
+			sum[0] += normal[0];
+			sum[1] += normal[1];
+			sum[2] += normal[2];
+		}
+	}
+
+	//Vertices that came with a normal keep it.
+	for (auto& vertex : mesh.vertices)
+	{
+		if (vertex.normal[0] != 0.f || vertex.normal[1] != 0.f || vertex.normal[2] != 0.f)
+		{
+			continue;
+		}
+
+		std::array<float, 3> sum = sums[{ vertex.position[0], vertex.position[1], vertex.position[2] }];
+		float length = std::sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+		if (length > 0.f)
+		{
+			vertex.normal[0] = sum[0] / length;
+			vertex.normal[1] = sum[1] / length;
+			vertex.normal[2] = sum[2] / length;
+		}
+		else
+		{
+			vertex.normal[2] = 1.f;
+		}
+	}
+}
@@ -0,0 +1,468 @@
+#include "MeshOptimizer.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+namespace
+{
+	//Forsyth's tuning. The simulated cache is larger than the FIFO most hardware has, which works well in practice.
+	const uint32_t forsythCacheSize = 32u;
+	const float lastTriangleScore = 0.75f;
+	const float cacheDecayPower = 1.5f;
+	const float valenceBoostScale = 2.f;
+	const float valenceBoostPower = 0.5f;
+
+	//Cache size used to find cluster boundaries for overdraw ordering.
+	const uint32_t clusterCacheSize = 16u;
+
+	float GetVertexScore(int32_t cachePosition, uint32_t remainingTriangles)
+	{
+		if (remainingTriangles == 0u)
+		{
+			return -1.f;
+		}
+
+		float score = 0.f;
+		if (cachePosition >= 0)
+		{
+			//The three vertices of the last triangle get a fixed score so no order among them is preferred.
+			if (cachePosition < 3)
+			{
+				score = lastTriangleScore;
+			}
+			else
+			{
+				float scaler = 1.f / static_cast<float>(forsythCacheSize - 3u);
+				score = std::pow(1.f - static_cast<float>(cachePosition - 3) * scaler, cacheDecayPower);
+			}
+		}
+
+		//Vertices with few triangles left are finished first, so they do not linger as lone triangles.
+		score += valenceBoostScale * std::pow(static_cast<float>(remainingTriangles), -valenceBoostPower);
+		return score;
+	}
+
+	//FIFO cache simulated with timestamps: a vertex is cached when fewer than cacheSize misses happened since its own.
+	uint32_t CountMisses(const uint32_t* indices, size_t indexCount, std::vector<uint32_t>& timestamps, uint32_t& time, uint32_t cacheSize)
+	{
+		uint32_t misses = 0u;
+		for (size_t i = 0; i < indexCount; i++)
+		{
+			uint32_t vertex = indices[i];
+			if (time - timestamps[vertex] > cacheSize)
+			{
+				timestamps[vertex] = time++;
+				misses++;
+			}
+		}
+		return misses;
+	}
+}
+
+std::vector<uint32_t> MeshOptimizer::OptimizeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount)
+{
+	size_t triangleCount = indices.size() / 3u;
+
+	//Triangles around each vertex, removed as they are emitted.
+	std::vector<uint32_t> remaining(vertexCount, 0u);
+	for (auto index : indices)
+	{
+		if (index >= vertexCount)
+		{
+			throw std::runtime_error("ERROR: Mesh index is out of range.\n");
+		}
+		remaining[index]++;
+	}
+
+	std::vector<uint32_t> offsets(vertexCount + 1u, 0u);
+	std::partial_sum(remaining.begin(), remaining.end(), offsets.begin() + 1);
+	std::vector<uint32_t> adjacency(indices.size());
+	{
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3u);
+		}
+	}
+
+	std::vector<float> vertexScores(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; i++)
+	{
+		vertexScores[i] = GetVertexScore(-1, remaining[i]);
+	}
+
+	auto getTriangleScore = [&](size_t triangle)
+	{
+		return vertexScores[indices[triangle * 3u]] + vertexScores[indices[triangle * 3u + 1u]] + vertexScores[indices[triangle * 3u + 2u]];
+	};
+
+	//Start with the best triangle overall, afterwards only triangles around cached vertices are considered.
+	size_t best = SIZE_MAX;
+	float bestScore = -1.f;
+	for (size_t i = 0; i < triangleCount; i++)
+	{
+		if (getTriangleScore(i) > bestScore)
+		{
+			bestScore = getTriangleScore(i);
+			best = i;
+		}
+	}
+	std::vector<bool> emitted(triangleCount, false);
+
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> nextCache;
+	cache.reserve(forsythCacheSize + 3u);
+	nextCache.reserve(forsythCacheSize + 3u);
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+
+	size_t cursor = 0u;
+
+	for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+	{
+		//Nothing in the cache touches a triangle that is left, continue with the next unemitted one in input order.
+		if (best == SIZE_MAX)
+		{
+			while (emitted[cursor])
+			{
+				cursor++;
+			}
+			best = cursor;
+		}
+
+		emitted[best] = true;
+		const uint32_t* triangle = &indices[best * 3u];
+		result.insert(result.end(), triangle, triangle + 3);
+
+		nextCache.assign(triangle, triangle + 3);
+		for (uint32_t corner = 0; corner < 3u; corner++)
+		{
+			uint32_t vertex = triangle[corner];
+			uint32_t* begin = &adjacency[offsets[vertex]];
+			uint32_t* end = begin + remaining[vertex];
+			*std::find(begin, end, static_cast<uint32_t>(best)) = end[-1];
+			remaining[vertex]--;
+		}
+
+		for (auto vertex : cache)
+		{
+			if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+			{
+				nextCache.push_back(vertex);
+			}
+		}
+
+		//Vertices pushed out of the cache lose their cache score.
+		for (size_t i = forsythCacheSize; i < nextCache.size(); i++)
+		{
+			vertexScores[nextCache[i]] = GetVertexScore(-1, remaining[nextCache[i]]);
+		}
+		nextCache.resize(std::min<size_t>(nextCache.size(), forsythCacheSize));
+
+		for (uint32_t i = 0; i < nextCache.size(); i++)
+		{
+			vertexScores[nextCache[i]] = GetVertexScore(static_cast<int32_t>(i), remaining[nextCache[i]]);
+		}
+		cache.swap(nextCache);
+
+		best = SIZE_MAX;
+		bestScore = -1.f;
+		for (auto vertex : cache)
+		{
+			for (uint32_t i = 0; i < remaining[vertex]; i++)
+			{
+				uint32_t neighbour = adjacency[offsets[vertex] + i];
+				float score = getTriangleScore(neighbour);
+				if (score > bestScore)
+				{
+					bestScore = score;
+					best = neighbour;
+				}
+			}
+		}
+	}
+
+	return result;
+}
+
+std::vector<uint32_t> MeshOptimizer::OptimizeOverdraw(const std::vector<uint32_t>& indices, const std::vector<ImportedVertex>& vertices, float threshold)
+{
+	size_t triangleCount = indices.size() / 3u;
+	if (triangleCount == 0u)
+	{
+		return indices;
+	}
+
+	//Hard boundaries: triangles whose three vertices all miss, the cache starts over there regardless of order.
+	std::vector<size_t> hardClusters;
+	{
+		std::vector<uint32_t> timestamps(vertices.size(), 0u);
+		uint32_t time = clusterCacheSize + 1u;
+		for (size_t i = 0; i < triangleCount; i++)
+		{
+			if (CountMisses(&indices[i * 3u], 3u, timestamps, time, clusterCacheSize) == 3u)
+			{
+				hardClusters.push_back(i);
+			}
+		}
+	}
+	hardClusters.push_back(triangleCount);
+
+	//Soft boundaries: inside a hard cluster, start a new one wherever the miss ratio since the last start has dropped
+	//to within threshold of the whole cluster's, so restarting the cache there costs at most that much.
+	std::vector<size_t> clusters;
+	for (size_t c = 0; c + 1u < hardClusters.size(); c++)
+	{
+		size_t begin = hardClusters[c];
+		size_t end = hardClusters[c + 1u];
+
+		std::vector<uint32_t> timestamps(vertices.size(), 0u);
+		uint32_t time = clusterCacheSize + 1u;
+		float clusterRatio = static_cast<float>(CountMisses(&indices[begin * 3u], (end - begin) * 3u, timestamps, time, clusterCacheSize)) / static_cast<float>(end - begin);
+
+		std::fill(timestamps.begin(), timestamps.end(), 0u);
+		time = clusterCacheSize + 1u;
+		clusters.push_back(begin);
+		uint32_t misses = 0u;
+		size_t start = begin;
+		for (size_t i = begin; i < end; i++)
+		{
+			misses += CountMisses(&indices[i * 3u], 3u, timestamps, time, clusterCacheSize);
+			float ratio = static_cast<float>(misses) / static_cast<float>(i + 1u - start);
+			if (ratio <= clusterRatio * threshold && i + 1u < end)
+			{
+				clusters.push_back(i + 1u);
+				start = i + 1u;
+				misses = 0u;
+				//Starting over is what the split costs, the new cluster sees an empty cache.
+				time += clusterCacheSize + 1u;
+			}
+		}
+	}
+	clusters.push_back(triangleCount);
+
+	//Area weighted centroid of the whole mesh and of each cluster, with the cluster's summed face normal.
+	auto corner = [&](size_t triangle, uint32_t index) { return vertices[indices[triangle * 3u + index]].position; };
+	auto faceNormal = [&](size_t triangle, float normal[3])
+	{
+		const float* a = corner(triangle, 0u);
+		const float* b = corner(triangle, 1u);
+		const float* c = corner(triangle, 2u);
+		float e0[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		float e1[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+		normal[0] = e0[1] * e1[2] - e0[2] * e1[1];
+		normal[1] = e0[2] * e1[0] - e0[0] * e1[2];
+		normal[2] = e0[0] * e1[1] - e0[1] * e1[0];
+		return std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+	};
+
+	size_t clusterCount = clusters.size() - 1u;
+	std::vector<float> centroids(clusterCount * 3u, 0.f);
+	std::vector<float> normals(clusterCount * 3u, 0.f);
+	float meshCentroid[3] = { 0.f, 0.f, 0.f };
+	float meshArea = 0.f;
+
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		float clusterArea = 0.f;
+		for (size_t i = clusters[c]; i < clusters[c + 1u]; i++)
+		{
+			float normal[3];
+			float area = faceNormal(i, normal);
+			for (uint32_t axis = 0; axis < 3u; axis++)
+			{
+				float center = (corner(i, 0u)[axis] + corner(i, 1u)[axis] + corner(i, 2u)[axis]) / 3.f;
+				centroids[c * 3u + axis] += center * area;
+				normals[c * 3u + axis] += normal[axis];
+				meshCentroid[axis] += center * area;
+			}
+			clusterArea += area;
+		}
+
+		for (uint32_t axis = 0; axis < 3u && clusterArea > 0.f; axis++)
+		{
+			centroids[c * 3u + axis] /= clusterArea;
+		}
+		meshArea += clusterArea;
+	}
+
+	for (uint32_t axis = 0; axis < 3u && meshArea > 0.f; axis++)
+	{
+		meshCentroid[axis] /= meshArea;
+	}
+
+	//Clusters that face outward, away from the center, tend to occlude the others and are drawn first.
+	std::vector<float> sortKeys(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		const float* normal = &normals[c * 3u];
+		float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		float dot = 0.f;
+		for (uint32_t axis = 0; axis < 3u; axis++)
+		{
+			dot += (centroids[c * 3u + axis] - meshCentroid[axis]) * normal[axis];
+		}
+		sortKeys[c] = length > 0.f ? dot / length : 0.f;
+	}
+
+	std::vector<size_t> order(clusterCount);
+	std::iota(order.begin(), order.end(), size_t(0));
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	for (auto c : order)
+	{
+		result.insert(result.end(), indices.begin() + clusters[c] * 3u, indices.begin() + clusters[c + 1u] * 3u);
+	}
+	return result;
+}
+
+void MeshOptimizer::OptimizeVertexFetch(ImportedMesh& mesh)
+{
+	std::vector<uint32_t> remap(mesh.vertices.size(), UINT32_MAX);
+	std::vector<ImportedVertex> vertices;
+	vertices.reserve(mesh.vertices.size());
+
+	for (auto& index : mesh.indices)
+	{
+		if (remap[index] == UINT32_MAX)
+		{
+			remap[index] = static_cast<uint32_t>(vertices.size());
+			vertices.push_back(mesh.vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	mesh.vertices.swap(vertices);
+}
+
+void MeshOptimizer::Quantize(const ImportedMesh& mesh, MeshFileHeader& header, std::vector<PackedVertex>& vertices)
+{
+	float minimum[3] = { INFINITY, INFINITY, INFINITY };
+	float maximum[3] = { -INFINITY, -INFINITY, -INFINITY };
+	float uvMinimum[2] = { INFINITY, INFINITY };
+	float uvMaximum[2] = { -INFINITY, -INFINITY };
+	for (auto& vertex : mesh.vertices)
+	{
+		for (uint32_t axis = 0; axis < 3u; axis++)
+		{
+			minimum[axis] = std::min(minimum[axis], vertex.position[axis]);
+			maximum[axis] = std::max(maximum[axis], vertex.position[axis]);
+		}
+		for (uint32_t axis = 0; axis < 2u; axis++)
+		{
+			uvMinimum[axis] = std::min(uvMinimum[axis], vertex.uv[axis]);
+			uvMaximum[axis] = std::max(uvMaximum[axis], vertex.uv[axis]);
+		}
+	}
+
+	header = MeshFileHeader{};
+	std::copy(std::begin(meshFileMagic), std::end(meshFileMagic), header.magic);
+	header.version = meshFileVersion;
+	header.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+	header.indexCount = static_cast<uint32_t>(mesh.indices.size());
+
+	float halfExtent = 0.f;
+	for (uint32_t axis = 0; axis < 3u; axis++)
+	{
+		header.positionOffset[axis] = (minimum[axis] + maximum[axis]) * 0.5f;
+		halfExtent = std::max(halfExtent, (maximum[axis] - minimum[axis]) * 0.5f);
+	}
+	header.positionScale = halfExtent > 0.f ? halfExtent : 1.f;
+
+	for (uint32_t axis = 0; axis < 2u; axis++)
+	{
+		header.uvOffset[axis] = uvMinimum[axis];
+		header.uvScale[axis] = uvMaximum[axis] > uvMinimum[axis] ? uvMaximum[axis] - uvMinimum[axis] : 1.f;
+	}
+
+	vertices.resize(mesh.vertices.size());
+	for (size_t i = 0; i < mesh.vertices.size(); i++)
+	{
+		const ImportedVertex& vertex = mesh.vertices[i];
+		PackedVertex& packed = vertices[i];
+
+		for (uint32_t axis = 0; axis < 3u; axis++)
+		{
+			float value = std::clamp((vertex.position[axis] - header.positionOffset[axis]) / header.positionScale, -1.f, 1.f);
+			packed.position[axis] = static_cast<int16_t>(std::lround(value * 32767.f));
+		}
+		packed.position[3] = 0;
+
+		EncodeOctahedral(vertex.normal, packed.normal);
+
+		for (uint32_t axis = 0; axis < 2u; axis++)
+		{
+			float value = std::clamp((vertex.uv[axis] - header.uvOffset[axis]) / header.uvScale[axis], 0.f, 1.f);
+			packed.uv[axis] = static_cast<uint16_t>(std::lround(value * 65535.f));
+		}
+	}
+}
+
+float MeshOptimizer::GetAverageCacheMissRatio(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize)
+{
+	if (indices.empty())
+	{
+		return 0.f;
+	}
+
+	std::vector<uint32_t> timestamps(vertexCount, 0u);
+	uint32_t time = cacheSize + 1u;
+	uint32_t misses = CountMisses(indices.data(), indices.size(), timestamps, time, cacheSize);
+	return static_cast<float>(misses) / static_cast<float>(indices.size() / 3u);
+}
+
+float MeshOptimizer::GetOverfetchRatio(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t vertexSize)
+{
+	if (vertexCount == 0u)
+	{
+		return 0.f;
+	}
+
+	//Small FIFO of cache lines in front of memory, enough to show whether neighbouring fetches share lines.
+	const uint32_t lineSize = 64u;
+	const uint32_t lineCount = 64u;
+
+	size_t lines = (static_cast<size_t>(vertexCount) * vertexSize + lineSize - 1u) / lineSize;
+	std::vector<uint32_t> timestamps(lines, 0u);
+	uint32_t time = lineCount + 1u;
+	uint64_t fetchedLines = 0u;
+
+	for (auto index : indices)
+	{
+		size_t first = static_cast<size_t>(index) * vertexSize / lineSize;
+		size_t last = (static_cast<size_t>(index) * vertexSize + vertexSize - 1u) / lineSize;
+		for (size_t line = first; line <= last; line++)
+		{
+			if (time - timestamps[line] > lineCount)
+			{
+				timestamps[line] = time++;
+				fetchedLines++;
+			}
+		}
+	}
+
+	return static_cast<float>(fetchedLines * lineSize) / static_cast<float>(static_cast<uint64_t>(vertexCount) * vertexSize);
+}
+
+void MeshOptimizer::EncodeOctahedral(const float normal[3], int16_t encoded[2])
+{
+	//Project onto the octahedron |x| + |y| + |z| = 1 and fold the lower half over the diagonals.
+	float sum = std::abs(normal[0]) + std::abs(normal[1]) + std::abs(normal[2]);
+	float x = sum > 0.f ? normal[0] / sum : 0.f;
+	float y = sum > 0.f ? normal[1] / sum : 0.f;
+	if (normal[2] < 0.f)
+	{
+		float foldedX = (1.f - std::abs(y)) * (x >= 0.f ? 1.f : -1.f);
+		float foldedY = (1.f - std::abs(x)) * (y >= 0.f ? 1.f : -1.f);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	encoded[0] = static_cast<int16_t>(std::lround(std::clamp(x, -1.f, 1.f) * 32767.f));
+	encoded[1] = static_cast<int16_t>(std::lround(std::clamp(y, -1.f, 1.f) * 32767.f));
+}
@@ -0,0 +1,429 @@
+#include "ParticleApplication.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace
+{
+	//Must match local_size_x in particle_emit.comp and particle_simulate.comp.
+	const uint32_t particleGroupSize = 64u;
+	//Simulation steps a fixed amount per frame, like the animation of the other scenes.
+	const float particleDeltaTime = 1.f / 60.f;
+	//Shortest lifetime in particle_emit.comp. Emitting at the rate the shortest lived particles die keeps the pool full,
+	//emissions that find no free particle are dropped on the GPU.
+	const float minimumLifetime = 1.5f;
+}
+
+ParticleApplication::ParticleApplication(const ApplicationSettings& settings) :
+	TriangleApplication(settings),
+	capacity(0u),
+	constants(),
+	recordSlot(0u),
+	particleBuffer(VK_NULL_HANDLE),
+	particleAllocation(),
+	deadListBuffer(VK_NULL_HANDLE),
+	deadListAllocation(),
+	aliveBuffer(VK_NULL_HANDLE),
+	aliveAllocation(),
+	counterBuffer(VK_NULL_HANDLE),
+	counterAllocation(),
+	queryPool(VK_NULL_HANDLE),
+	timestampPeriod(0.0),
+	timestampMask(0u),
+	readbackBuffer(VK_NULL_HANDLE),
+	readbackAllocation(),
+	slotLists({}),
+	simulatedParticles(0u),
+	simulationMs(0.0),
+	timedFrames(0u),
+	lastAliveCount(0u),
+	emitPipeline(VK_NULL_HANDLE),
+	preparePipeline(VK_NULL_HANDLE),
+	simulatePipeline(VK_NULL_HANDLE),
+	drawPipeline(VK_NULL_HANDLE)
+{
+	Initialise();
+}
+
+ParticleApplication::~ParticleApplication()
+{
+	Destroy();
+}
+
+void ParticleApplication::Initialise()
+{
+	CreateParticleBuffers();
+	CreateBindlessHandles();
+	CreateStatistics();
+	CreatePipelines();
+
+	std::cout << "INFO: " << capacity << " particles simulated on the GPU.\n";
+}
+
+void ParticleApplication::Destroy()
+{
+	frameScheduler.WaitIdle();
+
+	DestroyStatistics();
+	DestroyBindlessHandles();
+	DestroyParticleBuffers();
+}
+
+void ParticleApplication::UpdateFrame(uint32_t frameSlot)
+{
+	RetireStatistics(frameSlot);
+
+	uint64_t frame = frameScheduler.GetFrameNumber();
+	float time = static_cast<float>(frame) * particleDeltaTime;
+
+	//The first frame fills the whole pool at random ages, so the simulation runs at full load from the start.
+	bool prewarm = frame == 0u;
+	constants.current = static_cast<uint32_t>(frame & 1u);
+	constants.emitCount = prewarm ? capacity : std::min(capacity, static_cast<uint32_t>(std::ceil(capacity * particleDeltaTime / minimumLifetime)));
+	constants.seed = static_cast<uint32_t>(frame * 0x9e3779b9ull);
+	constants.deltaTime = particleDeltaTime;
+	constants.aspect = static_cast<float>(swapchainExtent.width) / static_cast<float>(swapchainExtent.height);
+	constants.prewarm = prewarm ? 1.f : 0.f;
+	constants.emitter[0] = 0.5f * std::sin(time * 0.7f);
+	constants.emitter[1] = -0.6f;
+
+	recordSlot = frameSlot;
+	slotLists[frameSlot] = constants.current;
+}
+
+void ParticleApplication::AddPasses(uint32_t backbuffer)
+{
+	//Particles carry over from frame to frame, the graph orders each frame's compute passes after the previous draw.
+	uint32_t particles = renderGraph.ImportBuffer("Particles", particleBuffer);
+	uint32_t deadList = renderGraph.ImportBuffer("Dead list", deadListBuffer);
+	uint32_t alive = renderGraph.ImportBuffer("Alive lists", aliveBuffer);
+	uint32_t counters = renderGraph.ImportBuffer("Particle counters", counterBuffer);
+
+	uint32_t emit = renderGraph.AddPass("Particle emit", [this](VkCommandBuffer commandBuffer) { RecordEmit(commandBuffer); });
+	renderGraph.Write(emit, particles, RenderGraphUsage::StorageCompute);
+	renderGraph.Write(emit, deadList, RenderGraphUsage::StorageCompute);
+	renderGraph.Write(emit, alive, RenderGraphUsage::StorageCompute);
+	renderGraph.Write(emit, counters, RenderGraphUsage::StorageCompute);
+
+	uint32_t prepare = renderGraph.AddPass("Particle prepare", [this](VkCommandBuffer commandBuffer) { RecordPrepare(commandBuffer); });
+	renderGraph.Write(prepare, counters, RenderGraphUsage::StorageCompute);
+
+	uint32_t simulate = renderGraph.AddPass("Particle simulate", [this](VkCommandBuffer commandBuffer) { RecordSimulate(commandBuffer); });
+	renderGraph.Read(simulate, counters, RenderGraphUsage::IndirectArgument);
+	renderGraph.Write(simulate, counters, RenderGraphUsage::StorageCompute);
+	renderGraph.Write(simulate, particles, RenderGraphUsage::StorageCompute);
+	renderGraph.Write(simulate, deadList, RenderGraphUsage::StorageCompute);
+	renderGraph.Write(simulate, alive, RenderGraphUsage::StorageCompute);
+
+	//Readback buffer is outside the graph, the pass is kept for the copy into it.
+	uint32_t statistics = renderGraph.AddPass("Particle statistics", [this](VkCommandBuffer commandBuffer) { RecordStatistics(commandBuffer); });
+	renderGraph.Read(statistics, counters, RenderGraphUsage::TransferSource);
+	renderGraph.SetSideEffects(statistics);
+
+	uint32_t main = AddMainPass(backbuffer);
+	renderGraph.Read(main, counters, RenderGraphUsage::IndirectArgument);
+	renderGraph.Read(main, particles, RenderGraphUsage::StorageVertex);
+	renderGraph.Read(main, alive, RenderGraphUsage::StorageVertex);
+}
+
+void ParticleApplication::RecordEmit(VkCommandBuffer commandBuffer)
+{
+	//Timestamps on all commands bracket the particle passes alone, work recorded before them has finished.
+	if (queryPool != VK_NULL_HANDLE)
+	{
+		vkCmdResetQueryPool(commandBuffer, queryPool, 2u * recordSlot, 2u);
+		vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, queryPool, 2u * recordSlot);
+	}
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, emitPipeline);
+	bindlessTable.Bind(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE);
+	vkCmdPushConstants(commandBuffer, bindlessTable.GetPipelineLayout(), VK_SHADER_STAGE_ALL, 0, sizeof(ParticleConstants), &constants);
+	vkCmdDispatch(commandBuffer, (constants.emitCount + particleGroupSize - 1u) / particleGroupSize, 1, 1);
+}
+
+void ParticleApplication::RecordPrepare(VkCommandBuffer commandBuffer)
+{
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, preparePipeline);
+	bindlessTable.Bind(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE);
+	vkCmdPushConstants(commandBuffer, bindlessTable.GetPipelineLayout(), VK_SHADER_STAGE_ALL, 0, sizeof(ParticleConstants), &constants);
+	vkCmdDispatch(commandBuffer, 1, 1, 1);
+}
+
+void ParticleApplication::RecordSimulate(VkCommandBuffer commandBuffer)
+{
+	//Only as many groups as there are alive particles, the count never reaches the CPU.
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, simulatePipeline);
+	bindlessTable.Bind(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE);
+	vkCmdPushConstants(commandBuffer, bindlessTable.GetPipelineLayout(), VK_SHADER_STAGE_ALL, 0, sizeof(ParticleConstants), &constants);
+	vkCmdDispatchIndirect(commandBuffer, counterBuffer, offsetof(Counters, simulateGroups));
+
+	if (queryPool != VK_NULL_HANDLE)
+	{
+		vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, queryPool, 2u * recordSlot + 1u);
+	}
+}
+
+void ParticleApplication::RecordStatistics(VkCommandBuffer commandBuffer)
+{
+	VkBufferCopy region{};
+	region.srcOffset = 0u;
+	region.dstOffset = static_cast<VkDeviceSize>(recordSlot) * sizeof(Counters);
+	region.size = sizeof(Counters);
+	vkCmdCopyBuffer(commandBuffer, counterBuffer, readbackBuffer, 1, &region);
+
+	//Read on the CPU once the frame slot comes around again.
+	VkMemoryBarrier2 barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+	barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+	barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	barrier.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+	barrier.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+
+	VkDependencyInfo dependency{};
+	dependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependency.memoryBarrierCount = 1;
+	dependency.pMemoryBarriers = &barrier;
+	vkCmdPipelineBarrier2(commandBuffer, &dependency);
+}
+
+void ParticleApplication::RetireStatistics(uint32_t frameSlot)
+{
+	uint32_t list = slotLists[frameSlot];
+	if (list == UINT32_MAX)
+	{
+		return;
+	}
+	slotLists[frameSlot] = UINT32_MAX;
+
+	const Counters& counters = static_cast<const Counters*>(readbackAllocation.mapped)[frameSlot];
+	lastAliveCount = counters.draws[1u - list].instanceCount;
+
+	if (queryPool == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	uint64_t timestamps[2] = {};
+	if (vkGetQueryPoolResults(device, queryPool, 2u * frameSlot, 2u, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+	{
+		return;
+	}
+
+	//Emitted particles are simulated in the same frame, the list holds both.
+	simulatedParticles += counters.draws[list].instanceCount;
+	simulationMs += ((timestamps[1] - timestamps[0]) & timestampMask) * timestampPeriod * 1e-6;
+	timedFrames++;
+}
+
+uint32_t ParticleApplication::GetDrawCount()
+{
+	//One indirect draw, there is nothing to split between threads.
+	return 1u;
+}
+
+void ParticleApplication::RecordDraws(VkCommandBuffer commandBuffer, uint32_t frameSlot, uint32_t begin, uint32_t end)
+{
+	Profiler::CpuScope scope(profiler, "RecordDraws");
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, drawPipeline);
+	SetViewportAndScissor(commandBuffer);
+	bindlessTable.Bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS);
+	vkCmdPushConstants(commandBuffer, bindlessTable.GetPipelineLayout(), VK_SHADER_STAGE_ALL, 0, sizeof(ParticleConstants), &constants);
+
+	//Simulation compacted the survivors into the other half, its draw carries their count.
+	VkDeviceSize offset = offsetof(Counters, draws) + (1u - constants.current) * sizeof(VkDrawIndirectCommand);
+	vkCmdDrawIndirect(commandBuffer, counterBuffer, offset, 1, sizeof(VkDrawIndirectCommand));
+}
+
+void ParticleApplication::CreateParticleBuffers()
+{
+	VkPhysicalDeviceProperties properties{};
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	//Particles are the largest buffer, every particle must also fit in one indirect dispatch.
+	uint64_t groupLimit = static_cast<uint64_t>(properties.limits.maxComputeWorkGroupCount[0]) * particleGroupSize;
+	uint32_t limit = static_cast<uint32_t>(std::min<uint64_t>(properties.limits.maxStorageBufferRange / sizeof(ParticleData), groupLimit));
+	capacity = std::max(std::min(settings.particleCount, limit), 1u);
+	if (capacity != settings.particleCount)
+	{
+		std::cout << "WARNING: Device limits allow " << limit << " particles, using " << capacity << ".\n";
+	}
+
+	VkBufferCreateInfo info{};
+	info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	info.size = static_cast<VkDeviceSize>(capacity) * sizeof(ParticleData);
+	info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+	memoryAllocator.CreateBuffer(info, MemoryUsage::GpuOnly, particleBuffer, particleAllocation);
+
+	info.size = static_cast<VkDeviceSize>(capacity) * 2u * sizeof(uint32_t);
+	memoryAllocator.CreateBuffer(info, MemoryUsage::GpuOnly, aliveBuffer, aliveAllocation);
+
+	info.size = static_cast<VkDeviceSize>(capacity) * sizeof(uint32_t);
+	info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	memoryAllocator.CreateBuffer(info, MemoryUsage::GpuOnly, deadListBuffer, deadListAllocation);
+
+	info.size = sizeof(Counters);
+	info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	memoryAllocator.CreateBuffer(info, MemoryUsage::GpuOnly, counterBuffer, counterAllocation);
+
+	//Every particle starts out dead. Indices are written straight into the staging ring.
+	uploadManager.UploadBuffer(deadListBuffer, 0u, static_cast<VkDeviceSize>(capacity) * sizeof(uint32_t), [](void* destination, VkDeviceSize offset, VkDeviceSize size)
+	{
+		uint32_t* indices = static_cast<uint32_t*>(destination);
+		uint32_t first = static_cast<uint32_t>(offset / sizeof(uint32_t));
+		for (uint32_t i = 0; i < size / sizeof(uint32_t); i++)
+		{
+			indices[i] = first + i;
+		}
+	});
+
+	//Draws expand six vertices per particle, both start with no instances.
+	Counters counters{};
+	counters.draws[0] = { 6u, 0u, 0u, 0u };
+	counters.draws[1] = { 6u, 0u, 0u, 0u };
+	counters.simulateGroups = { 0u, 1u, 1u };
+	counters.deadCount = static_cast<int32_t>(capacity);
+	uploadManager.UploadBuffer(counterBuffer, 0u, &counters, sizeof(counters));
+
+	//The first frame acquires the uploads and waits for them on the GPU.
+	uploadManager.Flush();
+}
+
+void ParticleApplication::DestroyParticleBuffers()
+{
+	memoryAllocator.DestroyBuffer(counterBuffer, counterAllocation);
+	memoryAllocator.DestroyBuffer(deadListBuffer, deadListAllocation);
+	memoryAllocator.DestroyBuffer(aliveBuffer, aliveAllocation);
+	memoryAllocator.DestroyBuffer(particleBuffer, particleAllocation);
+	counterBuffer = VK_NULL_HANDLE;
+	deadListBuffer = VK_NULL_HANDLE;
+	aliveBuffer = VK_NULL_HANDLE;
+	particleBuffer = VK_NULL_HANDLE;
+}
+
+void ParticleApplication::CreateBindlessHandles()
+{
+	constants.particleBuffer = bindlessTable.AddStorageBuffer(particleBuffer);
+	constants.deadListBuffer = bindlessTable.AddStorageBuffer(deadListBuffer);
+	constants.aliveBuffer = bindlessTable.AddStorageBuffer(aliveBuffer);
+	constants.counterBuffer = bindlessTable.AddStorageBuffer(counterBuffer);
+	constants.capacity = capacity;
+	//Sprite radius in clip space, smaller as the pool grows so the fountain does not saturate.
+	constants.size = std::clamp(2.f / std::sqrt(static_cast<float>(capacity)), 0.001f, 0.02f);
+}
+
+void ParticleApplication::DestroyBindlessHandles()
+{
+	//The GPU is idle, handles can go back to the table right away.
+	bindlessTable.FreeStorageBuffer(constants.particleBuffer);
+	bindlessTable.FreeStorageBuffer(constants.deadListBuffer);
+	bindlessTable.FreeStorageBuffer(constants.aliveBuffer);
+	bindlessTable.FreeStorageBuffer(constants.counterBuffer);
+}
+
+void ParticleApplication::CreateStatistics()
+{
+	slotLists.assign(settings.framesInFlight, UINT32_MAX);
+
+	VkBufferCreateInfo info{};
+	info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	info.size = static_cast<VkDeviceSize>(settings.framesInFlight) * sizeof(Counters);
+	info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	memoryAllocator.CreateBuffer(info, MemoryUsage::Readback, readbackBuffer, readbackAllocation);
+
+	//Particle counts are read back regardless, timing needs timestamps on the graphics family.
+	std::vector<VkQueueFamilyProperties> families;
+	uint32_t familyCount = 0u;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+	families.resize(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+
+	uint32_t validBits = families[graphicsFamilyIndex].timestampValidBits;
+	if (validBits == 0u)
+	{
+		std::cout << "WARNING: Queue family " << graphicsFamilyIndex << " does not support timestamps, particle throughput is not measured.\n";
+		return;
+	}
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	timestampPeriod = properties.limits.timestampPeriod;
+	timestampMask = validBits >= 64u ? UINT64_MAX : (1ull << validBits) - 1u;
+
+	VkQueryPoolCreateInfo queryInfo{};
+	queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryInfo.queryCount = 2u * settings.framesInFlight;
+
+	if (vkCreateQueryPool(device, &queryInfo, hostAllocator.Get(VK_OBJECT_TYPE_QUERY_POOL), &queryPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not create particle query pool.\n");
+	}
+}
+
+void ParticleApplication::DestroyStatistics()
+{
+	//Frames still in the slots have finished now, oldest first so the last alive count is the newest.
+	uint32_t framesInFlight = static_cast<uint32_t>(slotLists.size());
+	for (uint32_t i = 0; i < framesInFlight; i++)
+	{
+		RetireStatistics(static_cast<uint32_t>((frameScheduler.GetFrameNumber() + i) % framesInFlight));
+	}
+
+	if (timedFrames != 0u && simulationMs > 0.0)
+	{
+		std::cout << "INFO: Simulated " << simulatedParticles << " particles in " << simulationMs << " ms of GPU time over " << timedFrames << " frames, "
+			<< static_cast<uint64_t>(simulatedParticles / simulationMs) << " particles per ms. " << lastAliveCount << " particles alive at the end.\n";
+	}
+
+	if (queryPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(device, queryPool, hostAllocator.Get(VK_OBJECT_TYPE_QUERY_POOL));
+		queryPool = VK_NULL_HANDLE;
+	}
+	memoryAllocator.DestroyBuffer(readbackBuffer, readbackAllocation);
+	readbackBuffer = VK_NULL_HANDLE;
+}
+
+void ParticleApplication::CreatePipelines()
+{
+	//Runtime descriptor arrays can not be sized by reflection, bindless pipelines always use the table's layout.
+	ComputePipelineDescription emitDescription{};
+	emitDescription.computeShader = "shader/particle_emit.comp";
+	emitDescription.layout = bindlessTable.GetPipelineLayout();
+
+	ComputePipelineDescription prepareDescription{};
+	prepareDescription.computeShader = "shader/particle_prepare.comp";
+	prepareDescription.layout = bindlessTable.GetPipelineLayout();
+
+	ComputePipelineDescription simulateDescription{};
+	simulateDescription.computeShader = "shader/particle_simulate.comp";
+	simulateDescription.layout = bindlessTable.GetPipelineLayout();
+
+	//Additive sprites need no sorting and no depth.
+	GraphicsPipelineDescription drawDescription{};
+	drawDescription.vertexShader = "shader/particle.vert";
+	drawDescription.fragmentShader = "shader/particle.frag";
+	drawDescription.cullMode = VK_CULL_MODE_NONE;
+	drawDescription.blendMode = BlendMode::Additive;
+	drawDescription.depthTest = false;
+	drawDescription.depthWrite = false;
+	drawDescription.attachments = mainPassFormats;
+	drawDescription.layout = bindlessTable.GetPipelineLayout();
+
+	//All four compile in parallel on the builder's workers.
+	std::shared_future<VkPipeline> emit = pipelineBuilder.Submit(emitDescription);
+	std::shared_future<VkPipeline> prepare = pipelineBuilder.Submit(prepareDescription);
+	std::shared_future<VkPipeline> simulate = pipelineBuilder.Submit(simulateDescription);
+	std::shared_future<VkPipeline> draw = pipelineBuilder.Submit(drawDescription);
+	emitPipeline = emit.get();
+	preparePipeline = prepare.get();
+	simulatePipeline = simulate.get();
+	drawPipeline = draw.get();
+}
@@ -0,0 +1,92 @@
+#include "PipelineBenchmarkApplication.h"
+
+#include <iostream>
+#include <chrono>
+#include <bit>
+#include <algorithm>
+
+PipelineBenchmarkApplication::PipelineBenchmarkApplication(const ApplicationSettings& settings) :
+	Application(settings)
+{
+}
+
+PipelineBenchmarkApplication::~PipelineBenchmarkApplication()
+{
+}
+
+void PipelineBenchmarkApplication::Run()
+{
+	std::vector<GraphicsPipelineDescription> variants = CreateVariants();
+
+	//Powers of two up to the hardware thread count, plus the thread count itself.
+	uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<uint32_t> threadCounts;
+	for (uint32_t count = 1u; count < hardwareThreads; count *= 2u)
+	{
+		threadCounts.push_back(count);
+	}
+	threadCounts.push_back(hardwareThreads);
+
+	std::cout << "INFO: Compiling " << variants.size() << " pipeline variants with up to " << hardwareThreads << " threads.\n";
+
+	double baseline = 0.0;
+	for (auto threadCount : threadCounts)
+	{
+		double elapsed = CompileVariants(variants, threadCount);
+		if (threadCount == 1u)
+		{
+			baseline = elapsed;
+		}
+
+		std::cout << "INFO: " << threadCount << " thread(s): " << elapsed << " ms, " << (variants.size() * 1000.0 / elapsed) << " pipelines/s, speedup " << (baseline / elapsed) << "x.\n";
+	}
+}
+
+std::vector<GraphicsPipelineDescription> PipelineBenchmarkApplication::CreateVariants()
+{
+	const BlendMode blendModes[] = { BlendMode::Opaque, BlendMode::Alpha, BlendMode::Additive };
+	const VkCullModeFlags cullModes[] = { VK_CULL_MODE_NONE, VK_CULL_MODE_BACK_BIT, VK_CULL_MODE_FRONT_BIT };
+	const VkPrimitiveTopology topologies[] = { VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP, VK_PRIMITIVE_TOPOLOGY_LINE_LIST };
+
+	std::vector<GraphicsPipelineDescription> variants(settings.pipelineVariants);
+	for (uint32_t i = 0; i < settings.pipelineVariants; i++)
+	{
+		GraphicsPipelineDescription& description = variants[i];
+		description.vertexShader = "shader/shader.vert";
+		description.fragmentShader = "shader/shader.frag";
+		description.layout = pipelineLayout;
+		description.attachments = mainPassFormats;
+		description.blendMode = blendModes[i % 3];
+		description.cullMode = cullModes[(i / 3) % 3];
+		description.topology = topologies[(i / 9) % 3];
+		//Distinct specialization per variant so no two variants share a driver side cache entry.
+		description.specializationConstants = { std::bit_cast<uint32_t>(0.5f + static_cast<float>(i) / settings.pipelineVariants) };
+	}
+
+	return variants;
+}
+
+double PipelineBenchmarkApplication::CompileVariants(const std::vector<GraphicsPipelineDescription>& variants, uint32_t threadCount)
+{
+	//Fresh in-memory cache for each run so that every run compiles from scratch.
+	PipelineCache cache;
+	cache.Create(device, &hostAllocator, physicalDevice, "");
+
+	PipelineBuilder builder;
+	builder.Create(device, &hostAllocator, &shaderManager, &cache, &layoutCache, threadCount);
+
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<std::shared_future<VkPipeline>> pipelines = builder.Submit(variants);
+	for (auto& pipeline : pipelines)
+	{
+		pipeline.get();
+	}
+
+	double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	builder.Destroy();
+	cache.Destroy();
+
+	return elapsed;
+}
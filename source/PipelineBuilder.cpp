@@ -0,0 +1,422 @@
+#include "PipelineBuilder.h"
+#include "Hash.h"
+
+#include <stdexcept>
+#include <chrono>
+
+PipelineBuilder::PipelineBuilder() :
+	device(VK_NULL_HANDLE),
+	hostAllocator(nullptr),
+	shaderManager(nullptr),
+	pipelineCache(nullptr),
+	layoutCache(nullptr),
+	threadPool(nullptr)
+{
+}
+
+PipelineBuilder::~PipelineBuilder()
+{
+}
+
+void PipelineBuilder::Create(VkDevice device, HostAllocator* hostAllocator, ShaderManager* shaderManager, PipelineCache* pipelineCache, LayoutCache* layoutCache, uint32_t threadCount)
+{
+	this->device = device;
+	this->hostAllocator = hostAllocator;
+	this->shaderManager = shaderManager;
+	this->pipelineCache = pipelineCache;
+	this->layoutCache = layoutCache;
+	threadPool = std::make_unique<ThreadPool>(threadCount);
+}
+
+void PipelineBuilder::Destroy()
+{
+	if (!threadPool)
+	{
+		return;
+	}
+
+	WaitIdle();
+	threadPool.reset();
+
+	for (auto& pipeline : pipelines)
+	{
+		try
+		{
+			vkDestroyPipeline(device, pipeline.get(), hostAllocator->Get(VK_OBJECT_TYPE_PIPELINE));
+		}
+		catch (const std::exception&)
+		{
+			//Failed builds have nothing to destroy, their error already reached whoever waited on them.
+		}
+	}
+	pipelines.clear();
+
+	for (auto& shader : shaders)
+	{
+		try
+		{
+			vkDestroyShaderModule(device, shader.second.get().shaderModule, hostAllocator->Get(VK_OBJECT_TYPE_SHADER_MODULE));
+		}
+		catch (const std::exception&)
+		{
+		}
+	}
+	shaders.clear();
+}
+
+std::shared_future<VkPipeline> PipelineBuilder::Submit(const GraphicsPipelineDescription& description)
+{
+	std::shared_future<VkPipeline> pipeline = threadPool->Submit([this, description]() { return Build(description); }).share();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	pipelines.push_back(pipeline);
+	return pipeline;
+}
+
+std::vector<std::shared_future<VkPipeline>> PipelineBuilder::Submit(const std::vector<GraphicsPipelineDescription>& descriptions)
+{
+	std::vector<std::shared_future<VkPipeline>> result;
+	result.reserve(descriptions.size());
+
+	for (auto& description : descriptions)
+	{
+		result.push_back(Submit(description));
+	}
+
+	return result;
+}
+
+std::shared_future<VkPipeline> PipelineBuilder::Submit(const ComputePipelineDescription& description)
+{
+	std::shared_future<VkPipeline> pipeline = threadPool->Submit([this, description]() { return Build(description); }).share();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	pipelines.push_back(pipeline);
+	return pipeline;
+}
+
+void PipelineBuilder::WaitIdle()
+{
+	std::vector<std::shared_future<VkPipeline>> pending;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pending = pipelines;
+	}
+
+	for (auto& pipeline : pending)
+	{
+		pipeline.wait();
+	}
+}
+
+uint32_t PipelineBuilder::GetThreadCount() const
+{
+	return threadPool ? threadPool->GetThreadCount() : 0u;
+}
+
+ReflectedLayout PipelineBuilder::Reflect(const GraphicsPipelineDescription& description)
+{
+	ReflectedLayout layout;
+	ShaderReflection::Merge(GetShader(description.vertexShader, VK_SHADER_STAGE_VERTEX_BIT, description.defines).layout, layout);
+	ShaderReflection::Merge(GetShader(description.fragmentShader, VK_SHADER_STAGE_FRAGMENT_BIT, description.defines).layout, layout);
+	return layout;
+}
+
+VkPipelineLayout PipelineBuilder::GetPipelineLayout(const GraphicsPipelineDescription& description)
+{
+	return layoutCache->GetPipelineLayout(Reflect(description));
+}
+
+ReflectedLayout PipelineBuilder::Reflect(const ComputePipelineDescription& description)
+{
+	return GetShader(description.computeShader, VK_SHADER_STAGE_COMPUTE_BIT, description.defines).layout;
+}
+
+VkPipelineLayout PipelineBuilder::GetPipelineLayout(const ComputePipelineDescription& description)
+{
+	return layoutCache->GetPipelineLayout(Reflect(description));
+}
+
+VkPipeline PipelineBuilder::Build(const GraphicsPipelineDescription& description)
+{
+	VkShaderModule vShaderModule = GetShader(description.vertexShader, VK_SHADER_STAGE_VERTEX_BIT, description.defines).shaderModule;
+	VkShaderModule fShaderModule = GetShader(description.fragmentShader, VK_SHADER_STAGE_FRAGMENT_BIT, description.defines).shaderModule;
+	ReflectedLayout reflected = Reflect(description);
+
+	//Specialization constants are laid out as consecutive 32 bit values.
+	std::vector<VkSpecializationMapEntry> specializationEntries(description.specializationConstants.size());
+	for (uint32_t i = 0; i < specializationEntries.size(); i++)
+	{
+		specializationEntries[i].constantID = i;
+		specializationEntries[i].offset = i * sizeof(uint32_t);
+		specializationEntries[i].size = sizeof(uint32_t);
+	}
+
+	VkSpecializationInfo specializationInfo{};
+	specializationInfo.mapEntryCount = static_cast<uint32_t>(specializationEntries.size());
+	specializationInfo.pMapEntries = specializationEntries.data();
+	specializationInfo.dataSize = description.specializationConstants.size() * sizeof(uint32_t);
+	specializationInfo.pData = description.specializationConstants.data();
+
+	VkPipelineShaderStageCreateInfo vShaderStage{};
+	vShaderStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	vShaderStage.stage = VK_SHADER_STAGE_VERTEX_BIT;
+	vShaderStage.module = vShaderModule;
+	vShaderStage.pName = "main";
+	vShaderStage.pSpecializationInfo = specializationEntries.empty() ? nullptr : &specializationInfo;
+
+	VkPipelineShaderStageCreateInfo fShaderStage{};
+	fShaderStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	fShaderStage.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	fShaderStage.module = fShaderModule;
+	fShaderStage.pName = "main";
+	fShaderStage.pSpecializationInfo = specializationEntries.empty() ? nullptr : &specializationInfo;
+
+	VkPipelineShaderStageCreateInfo shaderStages[2] = { vShaderStage,fShaderStage };
+
+	std::vector<VkDynamicState> dynamicStates = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR
+	};
+
+	VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo{};
+	dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicStateCreateInfo.pDynamicStates = dynamicStates.data();
+
+	bool explicitVertexInput = !description.vertexAttributes.empty();
+	const auto& vertexBindings = explicitVertexInput ? description.vertexBindings : reflected.vertexBindings;
+	const auto& vertexAttributes = explicitVertexInput ? description.vertexAttributes : reflected.vertexAttributes;
+
+	VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo{};
+	vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputCreateInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(vertexBindings.size());
+	vertexInputCreateInfo.pVertexBindingDescriptions = vertexBindings.data();
+	vertexInputCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexAttributes.size());
+	vertexInputCreateInfo.pVertexAttributeDescriptions = vertexAttributes.data();
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo{};
+	inputAssemblyCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssemblyCreateInfo.topology = description.topology;
+	inputAssemblyCreateInfo.primitiveRestartEnable = VK_FALSE;
+
+	VkPipelineViewportStateCreateInfo viewportState{};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+
+	VkPipelineRasterizationStateCreateInfo rasterizerCreateInfo{};
+	rasterizerCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizerCreateInfo.depthClampEnable = VK_FALSE;
+	rasterizerCreateInfo.rasterizerDiscardEnable = VK_FALSE;
+	rasterizerCreateInfo.polygonMode = description.polygonMode;
+	rasterizerCreateInfo.lineWidth = 1.f;
+	rasterizerCreateInfo.cullMode = description.cullMode;
+	rasterizerCreateInfo.frontFace = description.frontFace;
+	rasterizerCreateInfo.depthBiasEnable = VK_FALSE;
+
+	VkPipelineMultisampleStateCreateInfo multisamplingCreateInfo{};
+	multisamplingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisamplingCreateInfo.sampleShadingEnable = VK_FALSE;
+	multisamplingCreateInfo.rasterizationSamples = description.attachments.sampleCount;
+
+	//Equal depth passes, so flat geometry keeps drawing in submission order.
+	VkPipelineDepthStencilStateCreateInfo depthStencilCreateInfo{};
+	depthStencilCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencilCreateInfo.depthTestEnable = description.depthTest ? VK_TRUE : VK_FALSE;
+	depthStencilCreateInfo.depthWriteEnable = description.depthWrite ? VK_TRUE : VK_FALSE;
+	depthStencilCreateInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable = description.blendMode == BlendMode::Opaque ? VK_FALSE : VK_TRUE;
+	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+	if (description.blendMode == BlendMode::Alpha)
+	{
+		colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+		colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+		colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	}
+	else if (description.blendMode == BlendMode::Additive)
+	{
+		colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+		colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+		colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	}
+
+	VkPipelineColorBlendStateCreateInfo colorBlending{};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.logicOpEnable = VK_FALSE;
+	colorBlending.logicOp = VK_LOGIC_OP_COPY;
+	//Every color attachment blends the same way.
+	std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments(description.attachments.colorFormats.size(), colorBlendAttachment);
+	colorBlending.attachmentCount = static_cast<uint32_t>(colorBlendAttachments.size());
+	colorBlending.pAttachments = colorBlendAttachments.data();
+	colorBlending.blendConstants[0] = 0.0f;
+	colorBlending.blendConstants[1] = 0.0f;
+	colorBlending.blendConstants[2] = 0.0f;
+	colorBlending.blendConstants[3] = 0.0f;
+
+	VkPipelineRenderingCreateInfo renderingCreateInfo{};
+	renderingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+	renderingCreateInfo.colorAttachmentCount = static_cast<uint32_t>(description.attachments.colorFormats.size());
+	renderingCreateInfo.pColorAttachmentFormats = description.attachments.colorFormats.data();
+	renderingCreateInfo.depthAttachmentFormat = description.attachments.depthFormat;
+
+	//Whether the pipeline came out of the cache. Older drivers require one stage feedback per shader stage.
+	VkPipelineCreationFeedback feedback{};
+	VkPipelineCreationFeedback stageFeedback[2]{};
+	VkPipelineCreationFeedbackCreateInfo feedbackCreateInfo{};
+	feedbackCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO;
+	feedbackCreateInfo.pNext = &renderingCreateInfo;
+	feedbackCreateInfo.pPipelineCreationFeedback = &feedback;
+	feedbackCreateInfo.pipelineStageCreationFeedbackCount = 2;
+	feedbackCreateInfo.pPipelineStageCreationFeedbacks = stageFeedback;
+
+	VkGraphicsPipelineCreateInfo pipelineCreateInfo{};
+	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineCreateInfo.pNext = &feedbackCreateInfo;
+	pipelineCreateInfo.stageCount = 2;
+	pipelineCreateInfo.pStages = shaderStages;
+
+	pipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;
+	pipelineCreateInfo.pInputAssemblyState = &inputAssemblyCreateInfo;
+	pipelineCreateInfo.pViewportState = &viewportState;
+	pipelineCreateInfo.pRasterizationState = &rasterizerCreateInfo;
+	pipelineCreateInfo.pMultisampleState = &multisamplingCreateInfo;
+	pipelineCreateInfo.pDepthStencilState = description.attachments.depthFormat != VK_FORMAT_UNDEFINED ? &depthStencilCreateInfo : nullptr;
+	pipelineCreateInfo.pColorBlendState = &colorBlending;
+	pipelineCreateInfo.pDynamicState = &dynamicStateCreateInfo;
+
+	pipelineCreateInfo.layout = description.layout != VK_NULL_HANDLE ? description.layout : layoutCache->GetPipelineLayout(reflected);
+
+	pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+	auto start = std::chrono::steady_clock::now();
+
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkResult result = vkCreateGraphicsPipelines(device, pipelineCache->Get(), 1, &pipelineCreateInfo, hostAllocator->Get(VK_OBJECT_TYPE_PIPELINE), &pipeline);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not create graphics pipeline.\n");
+	}
+
+	pipelineCache->RecordCreation(feedback, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+	return pipeline;
+}
+
+VkPipeline PipelineBuilder::Build(const ComputePipelineDescription& description)
+{
+	const CompiledShader& shader = GetShader(description.computeShader, VK_SHADER_STAGE_COMPUTE_BIT, description.defines);
+
+	std::vector<VkSpecializationMapEntry> specializationEntries(description.specializationConstants.size());
+	for (uint32_t i = 0; i < specializationEntries.size(); i++)
+	{
+		specializationEntries[i].constantID = i;
+		specializationEntries[i].offset = i * sizeof(uint32_t);
+		specializationEntries[i].size = sizeof(uint32_t);
+	}
+
+	VkSpecializationInfo specializationInfo{};
+	specializationInfo.mapEntryCount = static_cast<uint32_t>(specializationEntries.size());
+	specializationInfo.pMapEntries = specializationEntries.data();
+	specializationInfo.dataSize = description.specializationConstants.size() * sizeof(uint32_t);
+	specializationInfo.pData = description.specializationConstants.data();
+
+	VkPipelineCreationFeedback feedback{};
+	VkPipelineCreationFeedback stageFeedback{};
+	VkPipelineCreationFeedbackCreateInfo feedbackCreateInfo{};
+	feedbackCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO;
+	feedbackCreateInfo.pPipelineCreationFeedback = &feedback;
+	feedbackCreateInfo.pipelineStageCreationFeedbackCount = 1;
+	feedbackCreateInfo.pPipelineStageCreationFeedbacks = &stageFeedback;
+
+	VkComputePipelineCreateInfo pipelineCreateInfo{};
+	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineCreateInfo.pNext = &feedbackCreateInfo;
+	pipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineCreateInfo.stage.module = shader.shaderModule;
+	pipelineCreateInfo.stage.pName = "main";
+	pipelineCreateInfo.stage.pSpecializationInfo = specializationEntries.empty() ? nullptr : &specializationInfo;
+	pipelineCreateInfo.layout = description.layout != VK_NULL_HANDLE ? description.layout : layoutCache->GetPipelineLayout(shader.layout);
+
+	auto start = std::chrono::steady_clock::now();
+
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	if (vkCreateComputePipelines(device, pipelineCache->Get(), 1, &pipelineCreateInfo, hostAllocator->Get(VK_OBJECT_TYPE_PIPELINE), &pipeline) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not create compute pipeline.\n");
+	}
+
+	pipelineCache->RecordCreation(feedback, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+	return pipeline;
+}
+
+const PipelineBuilder::CompiledShader& PipelineBuilder::GetShader(const std::string& filename, VkShaderStageFlagBits stage, const std::vector<ShaderDefine>& defines)
+{
+	uint64_t key = HashString(filename);
+	for (auto& define : defines)
+	{
+		key = HashString(define.name, key);
+		key = HashString(define.value, key);
+	}
+
+	//First caller to ask for a shader builds it, the others wait on the same future.
+	std::promise<CompiledShader> promise;
+	std::shared_future<CompiledShader> shader;
+	bool owner = false;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto found = shaders.find(key);
+		if (found != shaders.end())
+		{
+			shader = found->second;
+		}
+		else
+		{
+			shader = promise.get_future().share();
+			shaders[key] = shader;
+			owner = true;
+		}
+	}
+
+	if (!owner)
+	{
+		//Map entries are never erased before Destroy, so the reference stays valid.
+		return shader.get();
+	}
+
+	try
+	{
+		std::vector<uint32_t> code = shaderManager->Load(filename, defines);
+
+		CompiledShader compiled{};
+		ShaderReflection::Reflect(stage, code, compiled.layout);
+
+		VkShaderModuleCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		info.codeSize = code.size() * sizeof(uint32_t);
+		info.pCode = code.data();
+
+		if (vkCreateShaderModule(device, &info, hostAllocator->Get(VK_OBJECT_TYPE_SHADER_MODULE), &compiled.shaderModule) != VK_SUCCESS)
+		{
+			throw std::runtime_error("ERROR: Could not create shader module.\n");
+		}
+
+		promise.set_value(compiled);
+	}
+	catch (...)
+	{
+		promise.set_exception(std::current_exception());
+	}
+
+	return shader.get();
+}
@@ -0,0 +1,274 @@
+#include "PipelineCache.h"
+#include "Hash.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+
+namespace
+{
+	//Wraps the driver blob so truncated or corrupt files are caught before they reach the driver.
+	struct FileHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t dataSize;
+		uint64_t dataHash;
+	};
+
+	const char fileMagic[4] = { 'V', 'K', 'P', 'C' };
+	const uint32_t fileVersion = 1u;
+}
+
+PipelineCache::PipelineCache() :
+	device(VK_NULL_HANDLE),
+	hostAllocator(nullptr),
+	cache(VK_NULL_HANDLE),
+	deviceProperties(),
+	filename(""),
+	warm(false),
+	createdPipelines(0u),
+	creationTime(0.0),
+	cacheHits(0u),
+	hitTime(0.0),
+	cacheMisses(0u),
+	missTime(0.0)
+{
+}
+
+PipelineCache::~PipelineCache()
+{
+}
+
+void PipelineCache::Create(VkDevice device, HostAllocator* hostAllocator, VkPhysicalDevice physicalDevice, const std::string& filename)
+{
+	this->device = device;
+	this->hostAllocator = hostAllocator;
+	this->filename = filename;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+	std::vector<char> data = Load();
+	warm = !data.empty();
+
+	VkPipelineCacheCreateInfo info{};
+	info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	info.initialDataSize = data.size();
+	info.pInitialData = data.empty() ? nullptr : data.data();
+
+	VkResult result = vkCreatePipelineCache(device, &info, hostAllocator->Get(VK_OBJECT_TYPE_PIPELINE_CACHE), &cache);
+	if (result != VK_SUCCESS && warm)
+	{
+		//Driver rejected the blob despite a valid header, start from an empty cache instead.
+		std::cout << "WARNING: Driver rejected pipeline cache " << filename << ", discarding it.\n";
+		warm = false;
+		info.initialDataSize = 0;
+		info.pInitialData = nullptr;
+		result = vkCreatePipelineCache(device, &info, hostAllocator->Get(VK_OBJECT_TYPE_PIPELINE_CACHE), &cache);
+	}
+
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not create pipeline cache.\n");
+	}
+
+	if (!filename.empty())
+	{
+		std::cout << "INFO: Pipeline cache " << (warm ? "loaded from " + filename : "is empty") << ".\n";
+	}
+}
+
+void PipelineCache::Destroy()
+{
+	if (cache == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	if (createdPipelines != 0u)
+	{
+		std::cout << "INFO: Created " << createdPipelines << " pipeline(s) in " << creationTime << " ms (" << (warm ? "warm" : "cold") << " start).\n";
+		std::cout << "INFO: Pipeline cache hits: " << cacheHits << ", " << (cacheHits != 0u ? hitTime / cacheHits : 0.0) << " ms per pipeline. Misses: "
+			<< cacheMisses << ", " << (cacheMisses != 0u ? missTime / cacheMisses : 0.0) << " ms per pipeline.\n";
+
+		//Drivers may leave the feedback invalid, those pipelines count towards neither side.
+		uint32_t unknown = createdPipelines - cacheHits - cacheMisses;
+		if (unknown != 0u)
+		{
+			std::cout << "INFO: " << unknown << " pipeline(s) without creation feedback.\n";
+		}
+	}
+
+	Save();
+
+	vkDestroyPipelineCache(device, cache, hostAllocator->Get(VK_OBJECT_TYPE_PIPELINE_CACHE));
+	cache = VK_NULL_HANDLE;
+}
+
+VkPipelineCache PipelineCache::Get() const
+{
+	return cache;
+}
+
+bool PipelineCache::IsWarm() const
+{
+	return warm;
+}
+
+void PipelineCache::RecordCreation(const VkPipelineCreationFeedback& feedback, double milliseconds)
+{
+	std::lock_guard<std::mutex> lock(statisticsMutex);
+	createdPipelines++;
+	creationTime += milliseconds;
+
+	if ((feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT) == 0u)
+	{
+		return;
+	}
+
+	if (feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT)
+	{
+		cacheHits++;
+		hitTime += milliseconds;
+	}
+	else
+	{
+		cacheMisses++;
+		missTime += milliseconds;
+	}
+}
+
+std::vector<char> PipelineCache::Load()
+{
+	//No file name means an in-memory cache that is never persisted.
+	if (filename.empty())
+	{
+		return {};
+	}
+
+	std::ifstream file(filename, std::ios::ate | std::ios::binary);
+	if (!file.is_open())
+	{
+		return {};
+	}
+
+	size_t fileSize = static_cast<size_t>(file.tellg());
+	if (fileSize < sizeof(FileHeader))
+	{
+		std::cout << "WARNING: Pipeline cache " << filename << " is truncated, discarding it.\n";
+		return {};
+	}
+
+	FileHeader header{};
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+	if (std::memcmp(header.magic, fileMagic, sizeof(fileMagic)) != 0 || header.version != fileVersion || header.dataSize != fileSize - sizeof(FileHeader))
+	{
+		std::cout << "WARNING: Pipeline cache " << filename << " is corrupt, discarding it.\n";
+		return {};
+	}
+
+	std::vector<char> data(static_cast<size_t>(header.dataSize));
+	file.read(data.data(), data.size());
+
+	if (!file || HashBytes(data.data(), data.size()) != header.dataHash)
+	{
+		std::cout << "WARNING: Pipeline cache " << filename << " is corrupt, discarding it.\n";
+		return {};
+	}
+
+	if (!Validate(data))
+	{
+		std::cout << "INFO: Pipeline cache " << filename << " was created by another device or driver, discarding it.\n";
+		return {};
+	}
+
+	return data;
+}
+
+bool PipelineCache::Validate(const std::vector<char>& data)
+{
+	if (data.size() < sizeof(VkPipelineCacheHeaderVersionOne))
+	{
+		return false;
+	}
+
+	VkPipelineCacheHeaderVersionOne header{};
+	std::memcpy(&header, data.data(), sizeof(header));
+
+	return header.headerSize >= sizeof(VkPipelineCacheHeaderVersionOne) &&
+		header.headerSize <= data.size() &&
+		header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+		header.vendorID == deviceProperties.vendorID &&
+		header.deviceID == deviceProperties.deviceID &&
+		std::memcmp(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void PipelineCache::Save()
+{
+	if (filename.empty())
+	{
+		return;
+	}
+
+	size_t size = 0;
+	if (vkGetPipelineCacheData(device, cache, &size, nullptr) != VK_SUCCESS || size == 0)
+	{
+		return;
+	}
+
+	std::vector<char> data(size);
+	if (vkGetPipelineCacheData(device, cache, &size, data.data()) != VK_SUCCESS)
+	{
+		std::cout << "WARNING: Could not read pipeline cache data.\n";
+		return;
+	}
+	data.resize(size);
+
+	FileHeader header{};
+	std::memcpy(header.magic, fileMagic, sizeof(fileMagic));
+	header.version = fileVersion;
+	header.dataSize = data.size();
+	header.dataHash = HashBytes(data.data(), data.size());
+
+	//Write next to the destination and rename over it, a crash mid-write never leaves a half written cache behind.
+	std::filesystem::path path(filename);
+	std::filesystem::path temporary = path;
+	temporary += ".tmp";
+
+	std::error_code error;
+	if (path.has_parent_path())
+	{
+		std::filesystem::create_directories(path.parent_path(), error);
+	}
+
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::cout << "WARNING: Could not write pipeline cache " << filename << ".\n";
+			return;
+		}
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(data.data(), data.size());
+		file.flush();
+
+		if (!file)
+		{
+			std::cout << "WARNING: Could not write pipeline cache " << filename << ".\n";
+			file.close();
+			std::filesystem::remove(temporary, error);
+			return;
+		}
+	}
+
+	std::filesystem::rename(temporary, path, error);
+	if (error)
+	{
+		std::cout << "WARNING: Could not replace pipeline cache " << filename << ": " << error.message() << "\n";
+		std::filesystem::remove(temporary, error);
+	}
+}
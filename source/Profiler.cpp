@@ -0,0 +1,448 @@
+#include "Profiler.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+Profiler::CpuScope::CpuScope(Profiler& profiler, const char* name) :
+	profiler(profiler),
+	name(name),
+	start(Profiler::GetCpuTime())
+{
+}
+
+Profiler::CpuScope::~CpuScope()
+{
+	profiler.RecordCpuScope(name, start, Profiler::GetCpuTime());
+}
+
+Profiler::Profiler() :
+	physicalDevice(VK_NULL_HANDLE),
+	device(VK_NULL_HANDLE),
+	hostAllocator(nullptr),
+	queue(VK_NULL_HANDLE),
+	queueFamilyIndex(0u),
+	traceFilename(""),
+	supported(false),
+	timestampPeriod(1.0),
+	timestampMask(UINT64_MAX),
+	getCalibratedTimestamps(nullptr),
+	hostTimeDomain(VK_TIME_DOMAIN_DEVICE_EXT),
+	calibrationTimestamp(0u),
+	calibrationTime(0),
+	startTime(0),
+	frameSlot(0u),
+	frames({}),
+	openScopes({}),
+	statistics({}),
+	trace({}),
+	threads({}),
+	traceFull(false)
+{
+}
+
+Profiler::~Profiler()
+{
+}
+
+void Profiler::Create(VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice device, HostAllocator* hostAllocator, VkQueue queue, uint32_t queueFamilyIndex, uint32_t framesInFlight, bool calibratedTimestamps, const std::string& traceFilename)
+{
+	this->physicalDevice = physicalDevice;
+	this->device = device;
+	this->hostAllocator = hostAllocator;
+	this->queue = queue;
+	this->queueFamilyIndex = queueFamilyIndex;
+	this->traceFilename = traceFilename;
+	startTime = GetCpuTime();
+
+	uint32_t familyCount = 0u;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+
+	uint32_t validBits = families[queueFamilyIndex].timestampValidBits;
+	supported = validBits != 0u;
+	if (!supported)
+	{
+		std::cout << "WARNING: Queue family " << queueFamilyIndex << " does not support timestamps, only CPU scopes are profiled.\n";
+		return;
+	}
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	timestampPeriod = properties.limits.timestampPeriod;
+	timestampMask = validBits >= 64u ? UINT64_MAX : (1ull << validBits) - 1u;
+
+	frames.resize(framesInFlight);
+	for (auto& frame : frames)
+	{
+		VkQueryPoolCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		info.queryCount = queriesPerFrame;
+
+		if (vkCreateQueryPool(device, &info, hostAllocator->Get(VK_OBJECT_TYPE_QUERY_POOL), &frame.queryPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("ERROR: Could not create profiler query pool.\n");
+		}
+		vkResetQueryPool(device, frame.queryPool, 0, queriesPerFrame);
+	}
+
+	//Calibrated timestamps need a host time domain that matches the steady clock.
+#ifdef _WIN32
+	const VkTimeDomainEXT wantedDomain = VK_TIME_DOMAIN_QUERY_PERFORMANCE_COUNTER_EXT;
+#else
+	const VkTimeDomainEXT wantedDomain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+#endif
+
+	if (calibratedTimestamps)
+	{
+		auto getTimeDomains = reinterpret_cast<PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT"));
+		getCalibratedTimestamps = reinterpret_cast<PFN_vkGetCalibratedTimestampsEXT>(vkGetDeviceProcAddr(device, "vkGetCalibratedTimestampsEXT"));
+
+		std::vector<VkTimeDomainEXT> domains;
+		if (getTimeDomains != nullptr)
+		{
+			uint32_t domainCount = 0u;
+			getTimeDomains(physicalDevice, &domainCount, nullptr);
+			domains.resize(domainCount);
+			getTimeDomains(physicalDevice, &domainCount, domains.data());
+		}
+
+		bool hasDevice = std::find(domains.begin(), domains.end(), VK_TIME_DOMAIN_DEVICE_EXT) != domains.end();
+		bool hasHost = std::find(domains.begin(), domains.end(), wantedDomain) != domains.end();
+		if (getCalibratedTimestamps == nullptr || !hasDevice || !hasHost)
+		{
+			getCalibratedTimestamps = nullptr;
+		}
+		hostTimeDomain = wantedDomain;
+	}
+
+	if (getCalibratedTimestamps != nullptr)
+	{
+		Calibrate();
+	}
+	else
+	{
+		CalibrateWithQueue();
+	}
+
+	std::cout << "INFO: Profiler correlates GPU and CPU time with " << (getCalibratedTimestamps != nullptr ? "calibrated timestamps" : "a startup measurement") << ".\n";
+}
+
+void Profiler::Destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	//Caller has waited for the GPU, every slot still holding queries can be resolved.
+	for (uint32_t i = 1; i <= static_cast<uint32_t>(frames.size()); i++)
+	{
+		BeginFrame((frameSlot + i) % static_cast<uint32_t>(frames.size()));
+	}
+
+	PrintStatistics();
+	WriteTrace();
+
+	for (auto& frame : frames)
+	{
+		vkDestroyQueryPool(device, frame.queryPool, hostAllocator->Get(VK_OBJECT_TYPE_QUERY_POOL));
+	}
+	frames.clear();
+
+	device = VK_NULL_HANDLE;
+}
+
+void Profiler::BeginFrame(uint32_t frameSlot)
+{
+	this->frameSlot = frameSlot;
+	openScopes.clear();
+
+	if (!supported)
+	{
+		return;
+	}
+
+	FrameQueries& frame = frames[frameSlot];
+	if (frame.queryCount != 0u)
+	{
+		//Calibration drifts, refresh it once per resolved frame.
+		if (getCalibratedTimestamps != nullptr)
+		{
+			Calibrate();
+		}
+
+		std::vector<uint64_t> timestamps(frame.queryCount);
+		VkResult result = vkGetQueryPoolResults(device, frame.queryPool, 0, frame.queryCount, timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+		if (result == VK_SUCCESS)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (auto& scope : frame.scopes)
+			{
+				if (scope.endQuery == UINT32_MAX)
+				{
+					continue;
+				}
+
+				int64_t start = GpuToCpuTime(timestamps[scope.beginQuery]);
+				int64_t end = start + static_cast<int64_t>(((timestamps[scope.endQuery] - timestamps[scope.beginQuery]) & timestampMask) * timestampPeriod);
+				AddSample(std::string("GPU ") + scope.name, 0u, start, end);
+			}
+		}
+
+		vkResetQueryPool(device, frame.queryPool, 0, frame.queryCount);
+	}
+
+	frame.queryCount = 0u;
+	frame.scopes.clear();
+}
+
+void Profiler::BeginGpuScope(VkCommandBuffer commandBuffer, const char* name)
+{
+	if (!supported)
+	{
+		return;
+	}
+
+	FrameQueries& frame = frames[frameSlot];
+	//Leave room for the end query of every open scope.
+	if (frame.queryCount + 1u + static_cast<uint32_t>(openScopes.size()) >= queriesPerFrame)
+	{
+		openScopes.push_back(UINT32_MAX);
+		return;
+	}
+
+	frame.scopes.push_back(GpuScope{ name, frame.queryCount, UINT32_MAX });
+	openScopes.push_back(static_cast<uint32_t>(frame.scopes.size() - 1u));
+	vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, frame.queryPool, frame.queryCount++);
+}
+
+void Profiler::EndGpuScope(VkCommandBuffer commandBuffer)
+{
+	if (!supported || openScopes.empty())
+	{
+		return;
+	}
+
+	uint32_t scope = openScopes.back();
+	openScopes.pop_back();
+	if (scope == UINT32_MAX)
+	{
+		return;
+	}
+
+	FrameQueries& frame = frames[frameSlot];
+	frame.scopes[scope].endQuery = frame.queryCount;
+	vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, frame.queryPool, frame.queryCount++);
+}
+
+void Profiler::RecordCpuScope(const char* name, int64_t start, int64_t end)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	AddSample(std::string("CPU ") + name, GetThreadIndex(std::this_thread::get_id()), start, end);
+}
+
+int64_t Profiler::GetCpuTime()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::PrintStatistics()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (auto& [name, scope] : statistics)
+	{
+		std::vector<double> samples = scope.samples;
+		auto percentile = [&samples](double p)
+		{
+			size_t index = std::min(samples.size() - 1u, static_cast<size_t>(p * samples.size()));
+			std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+			return samples[index];
+		};
+
+		std::cout << "INFO: " << name << ": p50 " << percentile(0.5) << " ms, p95 " << percentile(0.95) << " ms, p99 " << percentile(0.99)
+			<< " ms over the last " << samples.size() << " of " << scope.count << " sample(s).\n";
+	}
+}
+
+void Profiler::Calibrate()
+{
+	VkCalibratedTimestampInfoEXT infos[2] = {};
+	infos[0].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+	infos[0].timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+	infos[1].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+	infos[1].timeDomain = hostTimeDomain;
+
+	uint64_t timestamps[2] = {};
+	uint64_t maxDeviation = 0u;
+	if (getCalibratedTimestamps(device, 2, infos, timestamps, &maxDeviation) != VK_SUCCESS)
+	{
+		return;
+	}
+
+	calibrationTimestamp = timestamps[0];
+#ifdef _WIN32
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	calibrationTime = static_cast<int64_t>(static_cast<double>(timestamps[1]) * 1e9 / static_cast<double>(frequency.QuadPart));
+#else
+	calibrationTime = static_cast<int64_t>(timestamps[1]);
+#endif
+}
+
+void Profiler::CalibrateWithQueue()
+{
+	//Without calibrated timestamps: write one timestamp and take the middle of the CPU time around the submission.
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = queueFamilyIndex;
+
+	VkCommandPool pool = VK_NULL_HANDLE;
+	if (vkCreateCommandPool(device, &poolInfo, hostAllocator->Get(VK_OBJECT_TYPE_COMMAND_POOL), &pool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not create profiler command pool.\n");
+	}
+
+	VkCommandBufferAllocateInfo allocateInfo{};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocateInfo.commandPool = pool;
+	allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocateInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	vkAllocateCommandBuffers(device, &allocateInfo, &commandBuffer);
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, frames[0].queryPool, 0);
+	vkEndCommandBuffer(commandBuffer);
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+
+	int64_t before = GetCpuTime();
+	vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+	vkQueueWaitIdle(queue);
+	int64_t after = GetCpuTime();
+
+	uint64_t timestamp = 0u;
+	vkGetQueryPoolResults(device, frames[0].queryPool, 0, 1, sizeof(timestamp), &timestamp, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+	vkResetQueryPool(device, frames[0].queryPool, 0, 1);
+
+	calibrationTimestamp = timestamp;
+	calibrationTime = before + (after - before) / 2;
+
+	vkDestroyCommandPool(device, pool, hostAllocator->Get(VK_OBJECT_TYPE_COMMAND_POOL));
+}
+
+int64_t Profiler::GpuToCpuTime(uint64_t timestamp) const
+{
+	//Signed difference, timestamps may precede the calibration point.
+	int64_t ticks = static_cast<int64_t>(timestamp - calibrationTimestamp);
+	return calibrationTime + static_cast<int64_t>(static_cast<double>(ticks) * timestampPeriod);
+}
+
+void Profiler::AddSample(const std::string& name, uint32_t thread, int64_t start, int64_t end)
+{
+	ScopeStatistics& scope = statistics[name];
+	double milliseconds = static_cast<double>(end - start) * 1e-6;
+	if (scope.samples.size() < statisticsWindow)
+	{
+		scope.samples.push_back(milliseconds);
+	}
+	else
+	{
+		scope.samples[scope.next] = milliseconds;
+	}
+	scope.next = (scope.next + 1u) % statisticsWindow;
+	scope.count++;
+
+	if (traceFilename.empty())
+	{
+		return;
+	}
+
+	if (trace.size() >= maxTraceEvents)
+	{
+		if (!traceFull)
+		{
+			std::cout << "WARNING: Profiler trace is full, later events are not recorded.\n";
+			traceFull = true;
+		}
+		return;
+	}
+
+	trace.push_back(TraceEvent{ name.substr(4), thread, start, end - start });
+}
+
+uint32_t Profiler::GetThreadIndex(std::thread::id id)
+{
+	auto found = threads.find(id);
+	if (found != threads.end())
+	{
+		return found->second;
+	}
+
+	uint32_t index = static_cast<uint32_t>(threads.size()) + 1u;
+	threads[id] = index;
+	return index;
+}
+
+void Profiler::WriteTrace()
+{
+	if (traceFilename.empty())
+	{
+		return;
+	}
+
+	std::filesystem::path path(traceFilename);
+	std::error_code error;
+	if (path.has_parent_path())
+	{
+		std::filesystem::create_directories(path.parent_path(), error);
+	}
+
+	std::ofstream file(path, std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cout << "WARNING: Could not write profiler trace " << traceFilename << ".\n";
+		return;
+	}
+
+	//Chrome trace event format, complete events in microseconds relative to profiler creation.
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"GPU\"}}";
+	for (auto& [id, index] : threads)
+	{
+		file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << index << ",\"args\":{\"name\":\"CPU " << index << "\"}}";
+	}
+
+	file.setf(std::ios::fixed);
+	file.precision(3);
+	for (auto& event : trace)
+	{
+		file << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"" << (event.thread == 0u ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+			<< ",\"ts\":" << static_cast<double>(event.start - startTime) * 1e-3 << ",\"dur\":" << static_cast<double>(event.duration) * 1e-3 << "}";
+	}
+	file << "\n]}\n";
+
+	std::cout << "INFO: Wrote " << trace.size() << " profiler event(s) to " << traceFilename << ".\n";
+}
@@ -0,0 +1,824 @@
+#include "RenderGraph.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <algorithm>
+#include <string>
+
+namespace
+{
+	struct UsageInfo
+	{
+		VkPipelineStageFlags2 stages;
+		VkAccessFlags2 readAccess;
+		VkAccessFlags2 writeAccess;
+		//Undefined for usages that only apply to buffers.
+		VkImageLayout layout;
+		VkImageUsageFlags imageUsage;
+	};
+
+	UsageInfo GetUsageInfo(RenderGraphUsage usage)
+	{
+		switch (usage)
+		{
+		case RenderGraphUsage::ColorAttachment:
+			return { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT };
+		case RenderGraphUsage::DepthAttachment:
+			return { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+				VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT };
+		case RenderGraphUsage::SampledFragment:
+			return { VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_ACCESS_2_NONE,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT };
+		case RenderGraphUsage::SampledCompute:
+			return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_ACCESS_2_NONE,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT };
+		case RenderGraphUsage::StorageCompute:
+			return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+				VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT };
+		case RenderGraphUsage::StorageVertex:
+			return { VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_ACCESS_2_NONE,
+				VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT };
+		case RenderGraphUsage::IndirectArgument:
+			return { VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT, VK_ACCESS_2_NONE,
+				VK_IMAGE_LAYOUT_UNDEFINED, 0u };
+		case RenderGraphUsage::TransferSource:
+			return { VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_ACCESS_2_NONE,
+				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT };
+		case RenderGraphUsage::TransferDestination:
+			return { VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_NONE, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT };
+		}
+		throw std::runtime_error("ERROR: Unknown render graph usage.\n");
+	}
+
+	const VkAccessFlags2 writeAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT;
+
+	bool IsAttachment(RenderGraphUsage usage)
+	{
+		return usage == RenderGraphUsage::ColorAttachment || usage == RenderGraphUsage::DepthAttachment;
+	}
+}
+
+RenderGraph::RenderGraph() :
+	device(VK_NULL_HANDLE),
+	hostAllocator(nullptr),
+	memoryAllocator(nullptr),
+	deletionQueue(nullptr),
+	profiler(nullptr),
+	resources(),
+	passes(),
+	finalBarriers(),
+	slots(),
+	compiled(false)
+{
+}
+
+RenderGraph::~RenderGraph()
+{
+}
+
+void RenderGraph::Create(VkDevice device, HostAllocator* hostAllocator, MemoryAllocator* memoryAllocator, DeletionQueue* deletionQueue, Profiler* profiler)
+{
+	this->device = device;
+	this->hostAllocator = hostAllocator;
+	this->memoryAllocator = memoryAllocator;
+	this->deletionQueue = deletionQueue;
+	this->profiler = profiler;
+}
+
+void RenderGraph::Destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	DestroyTransientImages();
+	resources.clear();
+	passes.clear();
+	finalBarriers.clear();
+	compiled = false;
+	device = VK_NULL_HANDLE;
+}
+
+void RenderGraph::Reset(uint64_t retireValue)
+{
+	//Frames up to retireValue may still render into the transient images.
+	std::vector<VkImage> images;
+	std::vector<VkImageView> views;
+	for (auto& resource : resources)
+	{
+		if (!resource.imported && resource.imageHandle != VK_NULL_HANDLE)
+		{
+			images.push_back(resource.imageHandle);
+			views.push_back(resource.view);
+		}
+	}
+
+	VkDevice device = this->device;
+	HostAllocator* hostAllocator = this->hostAllocator;
+	MemoryAllocator* memoryAllocator = this->memoryAllocator;
+	std::vector<Allocation> oldSlots;
+	oldSlots.swap(slots);
+	deletionQueue->Push(retireValue, [device, hostAllocator, memoryAllocator, images, views, oldSlots]() mutable
+	{
+		for (size_t i = 0; i < images.size(); i++)
+		{
+			vkDestroyImageView(device, views[i], hostAllocator->Get(VK_OBJECT_TYPE_IMAGE_VIEW));
+			vkDestroyImage(device, images[i], hostAllocator->Get(VK_OBJECT_TYPE_IMAGE));
+		}
+		for (auto& slot : oldSlots)
+		{
+			memoryAllocator->Free(slot);
+		}
+	});
+
+	resources.clear();
+	passes.clear();
+	finalBarriers.clear();
+	compiled = false;
+}
+
+uint32_t RenderGraph::ImportImage(const char* name, VkFormat format, VkExtent2D extent, const RenderGraphState& initial, const RenderGraphState& final)
+{
+	Resource resource{};
+	resource.name = name;
+	resource.imported = true;
+	resource.image = true;
+	resource.format = format;
+	resource.extent = extent;
+	resource.sampleCount = VK_SAMPLE_COUNT_1_BIT;
+	resource.initial = initial;
+	resource.final = final;
+	resource.slot = UINT32_MAX;
+	resources.push_back(resource);
+	return static_cast<uint32_t>(resources.size() - 1u);
+}
+
+uint32_t RenderGraph::ImportBuffer(const char* name, VkBuffer buffer)
+{
+	Resource resource{};
+	resource.name = name;
+	resource.imported = true;
+	resource.image = false;
+	resource.buffer = buffer;
+	resource.slot = UINT32_MAX;
+	resources.push_back(resource);
+	return static_cast<uint32_t>(resources.size() - 1u);
+}
+
+uint32_t RenderGraph::CreateImage(const char* name, const RenderGraphImageDescription& description)
+{
+	Resource resource{};
+	resource.name = name;
+	resource.imported = false;
+	resource.image = true;
+	resource.format = description.format;
+	resource.extent = description.extent;
+	resource.sampleCount = description.sampleCount;
+	resource.usage = description.extraUsage;
+	resource.slot = UINT32_MAX;
+	resources.push_back(resource);
+	return static_cast<uint32_t>(resources.size() - 1u);
+}
+
+uint32_t RenderGraph::AddPass(const char* name, RecordFunction record)
+{
+	Pass pass{};
+	pass.name = name;
+	pass.record = std::move(record);
+	passes.push_back(std::move(pass));
+	return static_cast<uint32_t>(passes.size() - 1u);
+}
+
+void RenderGraph::Read(uint32_t pass, uint32_t resource, RenderGraphUsage usage)
+{
+	UsageInfo info = GetUsageInfo(usage);
+	//Depth that is tested but not written can stay in a read only layout.
+	VkImageLayout layout = usage == RenderGraphUsage::DepthAttachment ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : info.layout;
+
+	Pass& target = passes[pass];
+	AddAccess(target, Access{ resource, info.stages, info.readAccess, resources[resource].image ? layout : VK_IMAGE_LAYOUT_UNDEFINED, false });
+
+	resources[resource].usage |= info.imageUsage;
+	if (IsAttachment(usage))
+	{
+		Bind(target, resource, usage == RenderGraphUsage::DepthAttachment);
+	}
+}
+
+void RenderGraph::Write(uint32_t pass, uint32_t resource, RenderGraphUsage usage)
+{
+	UsageInfo info = GetUsageInfo(usage);
+	if (info.writeAccess == VK_ACCESS_2_NONE)
+	{
+		throw std::runtime_error(std::string("ERROR: ") + resources[resource].name + " cannot be written through a read only usage.\n");
+	}
+
+	Pass& target = passes[pass];
+	AddAccess(target, Access{ resource, info.stages, info.readAccess | info.writeAccess, resources[resource].image ? info.layout : VK_IMAGE_LAYOUT_UNDEFINED, true });
+
+	resources[resource].usage |= info.imageUsage;
+	if (IsAttachment(usage))
+	{
+		Bind(target, resource, usage == RenderGraphUsage::DepthAttachment);
+	}
+}
+
+void RenderGraph::Resolve(uint32_t pass, uint32_t source, uint32_t destination)
+{
+	Pass& target = passes[pass];
+	auto attachment = std::find_if(target.attachments.begin(), target.attachments.end(), [source](const Attachment& attachment) { return attachment.resource == source && !attachment.depth; });
+	if (attachment == target.attachments.end())
+	{
+		throw std::runtime_error(std::string("ERROR: Pass ") + target.name + " resolves " + resources[source].name + " which is not one of its color attachments.\n");
+	}
+
+	//Resolves write in the color attachment output stage, as color attachment writes.
+	AddAccess(target, Access{ destination, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true });
+	resources[destination].usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	attachment->resolve = destination;
+}
+
+void RenderGraph::AddAccess(Pass& pass, const Access& access)
+{
+	//Several usages of one resource within a pass become a single access, they must agree on the layout.
+	auto existing = std::find_if(pass.accesses.begin(), pass.accesses.end(), [&access](const Access& other) { return other.resource == access.resource; });
+	if (existing == pass.accesses.end())
+	{
+		pass.accesses.push_back(access);
+	}
+	else if (existing->layout != access.layout)
+	{
+		throw std::runtime_error(std::string("ERROR: Pass ") + pass.name + " uses " + resources[access.resource].name + " in two layouts.\n");
+	}
+	else
+	{
+		existing->stages |= access.stages;
+		existing->access |= access.access;
+		existing->write = existing->write || access.write;
+	}
+}
+
+void RenderGraph::Bind(Pass& pass, uint32_t resource, bool depth)
+{
+	bool bound = std::any_of(pass.attachments.begin(), pass.attachments.end(), [resource](const Attachment& attachment) { return attachment.resource == resource; });
+	if (bound)
+	{
+		return;
+	}
+
+	if (depth && std::any_of(pass.attachments.begin(), pass.attachments.end(), [](const Attachment& attachment) { return attachment.depth; }))
+	{
+		throw std::runtime_error(std::string("ERROR: Pass ") + pass.name + " has more than one depth attachment.\n");
+	}
+
+	pass.attachments.push_back(Attachment{ resource, depth, false, {}, VK_ATTACHMENT_LOAD_OP_LOAD, VK_ATTACHMENT_STORE_OP_STORE, UINT32_MAX });
+	if (!depth)
+	{
+		pass.colorFormats.push_back(resources[resource].format);
+	}
+}
+
+void RenderGraph::Clear(uint32_t pass, uint32_t resource, const VkClearValue& value)
+{
+	Pass& target = passes[pass];
+	auto attachment = std::find_if(target.attachments.begin(), target.attachments.end(), [resource](const Attachment& attachment) { return attachment.resource == resource; });
+	if (attachment == target.attachments.end())
+	{
+		throw std::runtime_error(std::string("ERROR: Pass ") + target.name + " clears " + resources[resource].name + " without writing it as an attachment.\n");
+	}
+
+	attachment->clear = true;
+	attachment->clearValue = value;
+}
+
+void RenderGraph::SetSideEffects(uint32_t pass)
+{
+	passes[pass].sideEffects = true;
+}
+
+void RenderGraph::SetSecondaryCommandBuffers(uint32_t pass)
+{
+	passes[pass].secondaryCommandBuffers = true;
+}
+
+void RenderGraph::Compile()
+{
+	Cull();
+
+	//Lifetimes span the first to the last pass that survived culling.
+	for (auto& resource : resources)
+	{
+		resource.firstPass = UINT32_MAX;
+		resource.lastPass = 0u;
+	}
+	for (uint32_t i = 0; i < passes.size(); i++)
+	{
+		if (passes[i].culled)
+		{
+			continue;
+		}
+		for (auto& access : passes[i].accesses)
+		{
+			Resource& resource = resources[access.resource];
+			resource.firstPass = std::min(resource.firstPass, i);
+			resource.lastPass = std::max(resource.lastPass, i);
+		}
+	}
+
+	CreateTransientImages();
+	DeriveBarriers();
+	compiled = true;
+}
+
+void RenderGraph::SetImportedImage(uint32_t resource, VkImage image, VkImageView view)
+{
+	resources[resource].imageHandle = image;
+	resources[resource].view = view;
+}
+
+VkImageView RenderGraph::GetImageView(uint32_t resource) const
+{
+	return resources[resource].view;
+}
+
+VkCommandBufferInheritanceRenderingInfo RenderGraph::GetInheritanceRenderingInfo(uint32_t pass) const
+{
+	const Pass& source = passes[pass];
+
+	VkCommandBufferInheritanceRenderingInfo info{};
+	info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+	info.colorAttachmentCount = static_cast<uint32_t>(source.colorFormats.size());
+	info.pColorAttachmentFormats = source.colorFormats.data();
+	info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	for (auto& attachment : source.attachments)
+	{
+		const Resource& resource = resources[attachment.resource];
+		info.rasterizationSamples = resource.sampleCount;
+		if (attachment.depth)
+		{
+			info.depthAttachmentFormat = resource.format;
+			if (GetAspect(resource.format) & VK_IMAGE_ASPECT_STENCIL_BIT)
+			{
+				info.stencilAttachmentFormat = resource.format;
+			}
+		}
+	}
+	return info;
+}
+
+void RenderGraph::Execute(VkCommandBuffer commandBuffer)
+{
+	if (!compiled)
+	{
+		throw std::runtime_error("ERROR: Render graph is executed before it is compiled.\n");
+	}
+
+	for (auto& pass : passes)
+	{
+		if (pass.culled)
+		{
+			continue;
+		}
+
+		RecordBarriers(commandBuffer, pass.barriers);
+
+		if (profiler != nullptr)
+		{
+			profiler->BeginGpuScope(commandBuffer, pass.name);
+		}
+
+		if (pass.attachments.empty())
+		{
+			pass.record(commandBuffer);
+		}
+		else
+		{
+			std::vector<VkRenderingAttachmentInfo> colorAttachments;
+			VkRenderingAttachmentInfo depthAttachment{};
+			bool hasDepth = false;
+			VkExtent2D extent = resources[pass.attachments.front().resource].extent;
+
+			for (auto& attachment : pass.attachments)
+			{
+				const Resource& resource = resources[attachment.resource];
+				auto access = std::find_if(pass.accesses.begin(), pass.accesses.end(), [&attachment](const Access& access) { return access.resource == attachment.resource; });
+
+				VkRenderingAttachmentInfo info{};
+				info.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+				info.imageView = resource.view;
+				info.imageLayout = access->layout;
+				info.loadOp = attachment.loadOp;
+				info.storeOp = attachment.storeOp;
+				info.clearValue = attachment.clearValue;
+
+				if (attachment.resolve != UINT32_MAX)
+				{
+					info.resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT;
+					info.resolveImageView = resources[attachment.resolve].view;
+					info.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+				}
+
+				if (attachment.depth)
+				{
+					depthAttachment = info;
+					hasDepth = true;
+				}
+				else
+				{
+					colorAttachments.push_back(info);
+				}
+			}
+
+			VkRenderingInfo renderingInfo{};
+			renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+			renderingInfo.flags = pass.secondaryCommandBuffers ? static_cast<VkRenderingFlags>(VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT) : 0u;
+			renderingInfo.renderArea.extent = extent;
+			renderingInfo.layerCount = 1;
+			renderingInfo.colorAttachmentCount = static_cast<uint32_t>(colorAttachments.size());
+			renderingInfo.pColorAttachments = colorAttachments.data();
+			renderingInfo.pDepthAttachment = hasDepth ? &depthAttachment : nullptr;
+
+			const Resource& depthResource = resources[hasDepth ? std::find_if(pass.attachments.begin(), pass.attachments.end(), [](const Attachment& attachment) { return attachment.depth; })->resource : 0u];
+			renderingInfo.pStencilAttachment = hasDepth && (GetAspect(depthResource.format) & VK_IMAGE_ASPECT_STENCIL_BIT) ? &depthAttachment : nullptr;
+
+			vkCmdBeginRendering(commandBuffer, &renderingInfo);
+			pass.record(commandBuffer);
+			vkCmdEndRendering(commandBuffer);
+		}
+
+		if (profiler != nullptr)
+		{
+			profiler->EndGpuScope(commandBuffer);
+		}
+	}
+
+	RecordBarriers(commandBuffer, finalBarriers);
+}
+
+void RenderGraph::Cull()
+{
+	//Walk backwards from what leaves the frame: imported resources and passes with side effects. A pass survives when
+	//it writes something a surviving pass or the outside still needs.
+	std::vector<bool> needed(resources.size(), false);
+	for (size_t i = 0; i < resources.size(); i++)
+	{
+		needed[i] = resources[i].imported;
+	}
+
+	for (size_t i = passes.size(); i-- > 0;)
+	{
+		Pass& pass = passes[i];
+		bool live = pass.sideEffects || std::any_of(pass.accesses.begin(), pass.accesses.end(), [&needed](const Access& access) { return access.write && needed[access.resource]; });
+		pass.culled = !live;
+		if (!live)
+		{
+			continue;
+		}
+
+		for (auto& access : pass.accesses)
+		{
+			//Cleared attachments do not depend on what was written before, anything else may.
+			bool cleared = std::any_of(pass.attachments.begin(), pass.attachments.end(), [&access](const Attachment& attachment) { return attachment.resource == access.resource && attachment.clear; });
+			if (!cleared)
+			{
+				needed[access.resource] = true;
+			}
+		}
+	}
+}
+
+void RenderGraph::CreateTransientImages()
+{
+	struct Slot
+	{
+		VkMemoryRequirements requirements;
+		//Lazily allocated memory can only back images created with the transient usage.
+		bool transient;
+		std::vector<uint32_t> occupants;
+	};
+
+	std::vector<uint32_t> transientImages;
+	std::vector<VkMemoryRequirements> requirements(resources.size());
+	for (uint32_t i = 0; i < resources.size(); i++)
+	{
+		Resource& resource = resources[i];
+		if (resource.imported || resource.firstPass == UINT32_MAX)
+		{
+			continue;
+		}
+
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = resource.format;
+		imageInfo.extent = { resource.extent.width, resource.extent.height, 1u };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = resource.sampleCount;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = resource.usage;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		if (vkCreateImage(device, &imageInfo, hostAllocator->Get(VK_OBJECT_TYPE_IMAGE), &resource.imageHandle) != VK_SUCCESS)
+		{
+			throw std::runtime_error(std::string("ERROR: Could not create render graph image ") + resource.name + ".\n");
+		}
+
+		vkGetImageMemoryRequirements(device, resource.imageHandle, &requirements[i]);
+		transientImages.push_back(i);
+	}
+
+	//Largest first, so that smaller images fill the memory of larger ones whose lifetimes they do not overlap.
+	std::sort(transientImages.begin(), transientImages.end(), [&requirements](uint32_t a, uint32_t b) { return requirements[a].size > requirements[b].size; });
+
+	std::vector<Slot> placed;
+	VkDeviceSize unaliasedBytes = 0u;
+	for (uint32_t index : transientImages)
+	{
+		Resource& resource = resources[index];
+		const VkMemoryRequirements& required = requirements[index];
+		bool transient = (resource.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) != 0u;
+		unaliasedBytes += required.size;
+
+		auto fits = [&](const Slot& slot)
+		{
+			if (slot.transient != transient || (slot.requirements.memoryTypeBits & required.memoryTypeBits) == 0u)
+			{
+				return false;
+			}
+			return std::none_of(slot.occupants.begin(), slot.occupants.end(), [&](uint32_t occupant)
+			{
+				return resources[occupant].firstPass <= resource.lastPass && resource.firstPass <= resources[occupant].lastPass;
+			});
+		};
+
+		auto slot = std::find_if(placed.begin(), placed.end(), fits);
+		if (slot == placed.end())
+		{
+			placed.push_back(Slot{ required, transient, {} });
+			slot = placed.end() - 1;
+		}
+
+		slot->requirements.size = std::max(slot->requirements.size, required.size);
+		slot->requirements.alignment = std::max(slot->requirements.alignment, required.alignment);
+		slot->requirements.memoryTypeBits &= required.memoryTypeBits;
+		slot->occupants.push_back(index);
+		resource.slot = static_cast<uint32_t>(slot - placed.begin());
+	}
+
+	VkDeviceSize aliasedBytes = 0u;
+	slots.resize(placed.size());
+	for (size_t i = 0; i < placed.size(); i++)
+	{
+		slots[i] = memoryAllocator->Allocate(placed[i].requirements, placed[i].transient ? MemoryUsage::Transient : MemoryUsage::GpuOnly, false);
+		aliasedBytes += placed[i].requirements.size;
+
+		for (uint32_t index : placed[i].occupants)
+		{
+			Resource& resource = resources[index];
+			if (vkBindImageMemory(device, resource.imageHandle, slots[i].memory, slots[i].offset) != VK_SUCCESS)
+			{
+				throw std::runtime_error(std::string("ERROR: Could not bind memory of render graph image ") + resource.name + ".\n");
+			}
+
+			VkImageViewCreateInfo viewInfo{};
+			viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			viewInfo.image = resource.imageHandle;
+			viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			viewInfo.format = resource.format;
+			viewInfo.subresourceRange = { GetAspect(resource.format), 0u, 1u, 0u, 1u };
+
+			if (vkCreateImageView(device, &viewInfo, hostAllocator->Get(VK_OBJECT_TYPE_IMAGE_VIEW), &resource.view) != VK_SUCCESS)
+			{
+				throw std::runtime_error(std::string("ERROR: Could not create view of render graph image ") + resource.name + ".\n");
+			}
+		}
+	}
+
+	uint32_t culledCount = static_cast<uint32_t>(std::count_if(passes.begin(), passes.end(), [](const Pass& pass) { return pass.culled; }));
+	std::cout << "INFO: Render graph runs " << passes.size() - culledCount << " of " << passes.size() << " passes, " << transientImages.size()
+		<< " transient image(s) in " << (aliasedBytes >> 10) << " KiB instead of " << (unaliasedBytes >> 10) << " KiB.\n";
+}
+
+void RenderGraph::DestroyTransientImages()
+{
+	for (auto& resource : resources)
+	{
+		if (resource.imported || resource.imageHandle == VK_NULL_HANDLE)
+		{
+			continue;
+		}
+
+		vkDestroyImageView(device, resource.view, hostAllocator->Get(VK_OBJECT_TYPE_IMAGE_VIEW));
+		vkDestroyImage(device, resource.imageHandle, hostAllocator->Get(VK_OBJECT_TYPE_IMAGE));
+		resource.imageHandle = VK_NULL_HANDLE;
+		resource.view = VK_NULL_HANDLE;
+	}
+
+	for (auto& slot : slots)
+	{
+		memoryAllocator->Free(slot);
+	}
+	slots.clear();
+}
+
+void RenderGraph::DeriveBarriers()
+{
+	std::vector<Tracking> tracking(resources.size());
+	std::vector<Tracking> slotTracking(slots.size());
+	std::vector<bool> used(resources.size());
+	std::vector<Barrier> discarded;
+
+	//The first run only finds the state resources leave the frame in. Imported buffers and the memory of transient
+	//images enter the next frame in that state, so the second run can derive the barriers against the previous frame.
+	for (uint32_t run = 0; run < 2u; run++)
+	{
+		bool record = run == 1u;
+		std::fill(used.begin(), used.end(), false);
+
+		for (size_t i = 0; i < resources.size(); i++)
+		{
+			const Resource& resource = resources[i];
+			if (resource.imported && resource.image)
+			{
+				tracking[i] = Tracking{ resource.initial.stages, resource.initial.access, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, resource.initial.layout };
+			}
+		}
+
+		for (uint32_t i = 0; i < passes.size(); i++)
+		{
+			Pass& pass = passes[i];
+			if (pass.culled)
+			{
+				continue;
+			}
+
+			pass.barriers.clear();
+			for (auto& access : pass.accesses)
+			{
+				Resource& resource = resources[access.resource];
+				Tracking& state = tracking[access.resource];
+
+				//Transient images start undefined and only wait for whatever used their memory before.
+				if (!resource.imported && !used[access.resource])
+				{
+					if (!access.write)
+					{
+						throw std::runtime_error(std::string("ERROR: Pass ") + pass.name + " reads " + resource.name + " before any pass writes it.\n");
+					}
+
+					const Tracking& slot = slotTracking[resource.slot];
+					state = Tracking{ slot.writeStages | slot.readStages, slot.writeAccess, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED };
+				}
+
+				auto attachment = std::find_if(pass.attachments.begin(), pass.attachments.end(), [&access](const Attachment& attachment) { return attachment.resource == access.resource; });
+				if (attachment != pass.attachments.end())
+				{
+					bool hasContents = used[access.resource] || (resource.imported && resource.initial.layout != VK_IMAGE_LAYOUT_UNDEFINED);
+					attachment->loadOp = attachment->clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : (hasContents ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_DONT_CARE);
+					//Contents nobody looks at again never leave tile memory.
+					bool usedLater = resource.imported || resource.lastPass > i;
+					attachment->storeOp = usedLater && access.write ? VK_ATTACHMENT_STORE_OP_STORE : (access.write ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_NONE);
+				}
+
+				Synchronize(record ? pass.barriers : discarded, access.resource, state, access.stages, access.access, access.layout, access.write);
+				used[access.resource] = true;
+
+				if (!resource.imported)
+				{
+					slotTracking[resource.slot] = state;
+				}
+			}
+		}
+
+		finalBarriers.clear();
+		for (size_t i = 0; i < resources.size(); i++)
+		{
+			const Resource& resource = resources[i];
+			if (resource.imported && resource.image)
+			{
+				Synchronize(record ? finalBarriers : discarded, static_cast<uint32_t>(i), tracking[i], resource.final.stages, resource.final.access, resource.final.layout, false);
+			}
+		}
+	}
+}
+
+void RenderGraph::Synchronize(std::vector<Barrier>& barriers, uint32_t resource, Tracking& tracking, VkPipelineStageFlags2 stages, VkAccessFlags2 access, VkImageLayout layout, bool write)
+{
+	bool transition = resources[resource].image && tracking.layout != layout;
+
+	if (!write && !transition)
+	{
+		//Reads after reads need nothing once the last write is visible to their stages.
+		if ((stages & ~tracking.readStages) == 0u && (access & ~tracking.readAccess) == 0u)
+		{
+			return;
+		}
+
+		if (tracking.writeStages != VK_PIPELINE_STAGE_2_NONE)
+		{
+			barriers.push_back(Barrier{ resource, tracking.writeStages, tracking.writeAccess, stages, access, tracking.layout, layout });
+		}
+		tracking.readStages |= stages;
+		tracking.readAccess |= access;
+		return;
+	}
+
+	//Writes and layout transitions wait for every earlier access, reads only need an execution dependency.
+	VkPipelineStageFlags2 srcStages = tracking.writeStages | tracking.readStages;
+	if (srcStages != VK_PIPELINE_STAGE_2_NONE || transition)
+	{
+		barriers.push_back(Barrier{ resource, srcStages, tracking.writeAccess, stages, access, tracking.layout, layout });
+	}
+
+	//A transition counts as a write that the stages of this access have already seen.
+	tracking.writeStages = stages;
+	tracking.writeAccess = access & writeAccessMask;
+	tracking.readStages = write ? VK_PIPELINE_STAGE_2_NONE : stages;
+	tracking.readAccess = write ? VK_ACCESS_2_NONE : access;
+	tracking.layout = layout;
+}
+
+void RenderGraph::RecordBarriers(VkCommandBuffer commandBuffer, const std::vector<Barrier>& barriers)
+{
+	if (barriers.empty())
+	{
+		return;
+	}
+
+	std::vector<VkImageMemoryBarrier2> imageBarriers;
+	std::vector<VkBufferMemoryBarrier2> bufferBarriers;
+	for (auto& barrier : barriers)
+	{
+		const Resource& resource = resources[barrier.resource];
+		if (resource.image)
+		{
+			if (resource.imageHandle == VK_NULL_HANDLE)
+			{
+				throw std::runtime_error(std::string("ERROR: Render graph image ") + resource.name + " is not set.\n");
+			}
+
+			VkImageMemoryBarrier2 imageBarrier{};
+			imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+			imageBarrier.srcStageMask = barrier.srcStages;
+			imageBarrier.srcAccessMask = barrier.srcAccess;
+			imageBarrier.dstStageMask = barrier.dstStages;
+			imageBarrier.dstAccessMask = barrier.dstAccess;
+			imageBarrier.oldLayout = barrier.oldLayout;
+			imageBarrier.newLayout = barrier.newLayout;
+			imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			imageBarrier.image = resource.imageHandle;
+			imageBarrier.subresourceRange = { GetAspect(resource.format), 0u, 1u, 0u, 1u };
+			imageBarriers.push_back(imageBarrier);
+		}
+		else
+		{
+			VkBufferMemoryBarrier2 bufferBarrier{};
+			bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+			bufferBarrier.srcStageMask = barrier.srcStages;
+			bufferBarrier.srcAccessMask = barrier.srcAccess;
+			bufferBarrier.dstStageMask = barrier.dstStages;
+			bufferBarrier.dstAccessMask = barrier.dstAccess;
+			bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			bufferBarrier.buffer = resource.buffer;
+			bufferBarrier.offset = 0u;
+			bufferBarrier.size = VK_WHOLE_SIZE;
+			bufferBarriers.push_back(bufferBarrier);
+		}
+	}
+
+	VkDependencyInfo dependency{};
+	dependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependency.imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size());
+	dependency.pImageMemoryBarriers = imageBarriers.data();
+	dependency.bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size());
+	dependency.pBufferMemoryBarriers = bufferBarriers.data();
+	vkCmdPipelineBarrier2(commandBuffer, &dependency);
+}
+
+VkImageAspectFlags RenderGraph::GetAspect(VkFormat format) const
+{
+	switch (format)
+	{
+	case VK_FORMAT_D16_UNORM:
+	case VK_FORMAT_X8_D24_UNORM_PACK32:
+	case VK_FORMAT_D32_SFLOAT:
+		return VK_IMAGE_ASPECT_DEPTH_BIT;
+	case VK_FORMAT_D16_UNORM_S8_UINT:
+	case VK_FORMAT_D24_UNORM_S8_UINT:
+	case VK_FORMAT_D32_SFLOAT_S8_UINT:
+		return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+	case VK_FORMAT_S8_UINT:
+		return VK_IMAGE_ASPECT_STENCIL_BIT;
+	default:
+		return VK_IMAGE_ASPECT_COLOR_BIT;
+	}
+}
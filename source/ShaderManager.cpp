@@ -0,0 +1,385 @@
+#include "ShaderManager.h"
+#include "Hash.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <set>
+#include <memory>
+#include <thread>
+#include <iomanip>
+
+#include <shaderc/shaderc.hpp>
+
+namespace
+{
+	//Bump when anything that affects compiled output changes outside of the hashed inputs. Compiler upgrades that keep
+	//both the generator version and the output of probeSource unchanged also need a bump.
+	const uint64_t cacheFormatVersion = 1u;
+	const uint32_t spirvMagic = 0x07230203u;
+
+	//Compiled at startup, its SPIR-V identifies the compiler. The header carries the glslang generator version and the
+	//body changes with most front end and optimizer changes.
+	const char* probeSource =
+		"#version 460\n"
+		"layout(local_size_x = 64) in;\n"
+		"layout(std430, binding = 0) buffer Data { vec4 values[]; };\n"
+		"void main() {\n"
+		"    vec4 value = values[gl_GlobalInvocationID.x];\n"
+		"    for (int i = 0; i < 4; i++) { value = normalize(value * mat4(value, value.yzwx, value.zwxy, value.wxyz)); }\n"
+		"    values[gl_GlobalInvocationID.x] = value;\n"
+		"}\n";
+
+	bool ReadText(const std::string& filename, std::string& text)
+	{
+		std::ifstream file(filename, std::ios::binary);
+		if (!file.is_open())
+		{
+			return false;
+		}
+
+		std::stringstream stream;
+		stream << file.rdbuf();
+		text = stream.str();
+		return true;
+	}
+
+	//Maps an #include request onto a file. Returns an empty string when nothing matches.
+	std::string ResolveInclude(const std::string& requested, bool relative, const std::string& requestingFile, const std::vector<std::string>& includeDirectories)
+	{
+		std::vector<std::filesystem::path> candidates;
+		if (relative)
+		{
+			candidates.push_back(std::filesystem::path(requestingFile).parent_path() / requested);
+		}
+		for (auto& directory : includeDirectories)
+		{
+			candidates.push_back(std::filesystem::path(directory) / requested);
+		}
+
+		for (auto& candidate : candidates)
+		{
+			std::error_code error;
+			if (std::filesystem::is_regular_file(candidate, error))
+			{
+				return candidate.lexically_normal().generic_string();
+			}
+		}
+
+		return "";
+	}
+
+	//Walks #include directives and mixes every reachable file into the hash without running the preprocessor.
+	uint64_t HashIncludes(const std::string& filename, const std::string& source, const std::vector<std::string>& includeDirectories, std::set<std::string>& visited, uint64_t hash)
+	{
+		std::istringstream lines(source);
+		std::string line;
+		while (std::getline(lines, line))
+		{
+			size_t position = line.find_first_not_of(" \t");
+			if (position == std::string::npos || line.compare(position, 1, "#") != 0)
+			{
+				continue;
+			}
+
+			position = line.find_first_not_of(" \t", position + 1);
+			if (position == std::string::npos || line.compare(position, 7, "include") != 0)
+			{
+				continue;
+			}
+
+			size_t open = line.find_first_of("\"<", position + 7);
+			if (open == std::string::npos)
+			{
+				continue;
+			}
+			bool relative = line[open] == '"';
+			size_t close = line.find(relative ? '"' : '>', open + 1);
+			if (close == std::string::npos)
+			{
+				continue;
+			}
+
+			std::string requested = line.substr(open + 1, close - open - 1);
+			std::string resolved = ResolveInclude(requested, relative, filename, includeDirectories);
+
+			//Unresolved includes still change the key, compilation reports the actual error.
+			hash = HashString(requested, hash);
+			hash = HashString(resolved, hash);
+
+			if (resolved.empty() || !visited.insert(resolved).second)
+			{
+				continue;
+			}
+
+			std::string content;
+			if (ReadText(resolved, content))
+			{
+				hash = HashString(content, hash);
+				hash = HashIncludes(resolved, content, includeDirectories, visited, hash);
+			}
+		}
+
+		return hash;
+	}
+
+	class Includer : public shaderc::CompileOptions::IncluderInterface
+	{
+	public:
+		Includer(const std::vector<std::string>& includeDirectories) :
+			includeDirectories(includeDirectories)
+		{
+		}
+
+		shaderc_include_result* GetInclude(const char* requestedSource, shaderc_include_type type, const char* requestingSource, size_t includeDepth) override
+		{
+			IncludeData* data = new IncludeData();
+
+			data->name = ResolveInclude(requestedSource, type == shaderc_include_type_relative, requestingSource, includeDirectories);
+			if (data->name.empty() || !ReadText(data->name, data->content))
+			{
+				//Empty name marks a failed include, content carries the message.
+				data->name.clear();
+				data->content = "Could not find include file: " + std::string(requestedSource);
+			}
+
+			data->result.source_name = data->name.c_str();
+			data->result.source_name_length = data->name.size();
+			data->result.content = data->content.c_str();
+			data->result.content_length = data->content.size();
+			data->result.user_data = data;
+			return &data->result;
+		}
+
+		void ReleaseInclude(shaderc_include_result* result) override
+		{
+			delete static_cast<IncludeData*>(result->user_data);
+		}
+	private:
+		struct IncludeData
+		{
+			std::string name;
+			std::string content;
+			shaderc_include_result result;
+		};
+
+		std::vector<std::string> includeDirectories;
+	};
+
+	std::filesystem::path GetCachePath(const std::string& cacheDirectory, uint64_t key)
+	{
+		std::ostringstream name;
+		name << std::hex << std::setw(16) << std::setfill('0') << key << ".spv";
+		return std::filesystem::path(cacheDirectory) / name.str();
+	}
+
+	shaderc_shader_kind GetShaderKind(const std::string& filename)
+	{
+		std::string extension = std::filesystem::path(filename).extension().string();
+
+		if (extension == ".vert") return shaderc_glsl_vertex_shader;
+		if (extension == ".frag") return shaderc_glsl_fragment_shader;
+		if (extension == ".comp") return shaderc_glsl_compute_shader;
+		if (extension == ".geom") return shaderc_glsl_geometry_shader;
+		if (extension == ".tesc") return shaderc_glsl_tess_control_shader;
+		if (extension == ".tese") return shaderc_glsl_tess_evaluation_shader;
+
+		throw std::runtime_error("ERROR: Unknown shader stage for file: " + filename + "\n");
+	}
+
+	void SetCompileOptions(shaderc::CompileOptions& options, uint32_t apiVersion, bool debug)
+	{
+		options.SetTargetEnvironment(shaderc_target_env_vulkan, apiVersion);
+
+		if (debug)
+		{
+			options.SetOptimizationLevel(shaderc_optimization_level_zero);
+			options.SetGenerateDebugInfo();
+		}
+		else
+		{
+			options.SetOptimizationLevel(shaderc_optimization_level_performance);
+		}
+	}
+}
+
+ShaderManager::ShaderManager() :
+	cacheDirectory(""),
+	includeDirectories({}),
+	apiVersion(0u),
+	debug(false),
+	compilerIdentity(0u),
+	loaded({})
+{
+}
+
+ShaderManager::~ShaderManager()
+{
+}
+
+void ShaderManager::Create(const std::string& cacheDirectory, uint32_t apiVersion, bool debug)
+{
+	this->cacheDirectory = cacheDirectory;
+	//Patch version has no effect on code generation.
+	this->apiVersion = apiVersion & ~0xFFFu;
+	this->debug = debug;
+
+	shaderc::Compiler compiler;
+	shaderc::CompileOptions options;
+	SetCompileOptions(options, this->apiVersion, debug);
+
+	shaderc::SpvCompilationResult probe = compiler.CompileGlslToSpv(probeSource, shaderc_glsl_compute_shader, "probe.comp", options);
+	if (probe.GetCompilationStatus() != shaderc_compilation_status_success)
+	{
+		throw std::runtime_error("ERROR: Could not compile the shader compiler probe:\n" + probe.GetErrorMessage());
+	}
+	std::vector<uint32_t> probeSpirv(probe.cbegin(), probe.cend());
+	compilerIdentity = HashBytes(probeSpirv.data(), probeSpirv.size() * sizeof(uint32_t));
+
+	std::error_code error;
+	std::filesystem::create_directories(cacheDirectory, error);
+	if (error)
+	{
+		std::cout << "WARNING: Could not create shader cache directory " << cacheDirectory << ", shaders will not be cached.\n";
+	}
+}
+
+void ShaderManager::AddIncludeDirectory(const std::string& directory)
+{
+	includeDirectories.push_back(directory);
+}
+
+std::vector<uint32_t> ShaderManager::Load(const std::string& filename, const std::vector<ShaderDefine>& defines)
+{
+	std::string source;
+	if (!ReadText(filename, source))
+	{
+		throw std::runtime_error("ERROR: Failed to open shader file: " + filename + "\n");
+	}
+
+	uint64_t key = ComputeKey(filename, source, defines);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto found = loaded.find(key);
+		if (found != loaded.end())
+		{
+			return found->second;
+		}
+	}
+
+	std::vector<uint32_t> spirv = ReadCache(key);
+	if (spirv.empty())
+	{
+		spirv = Compile(filename, source, defines);
+		WriteCache(key, spirv);
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	loaded[key] = spirv;
+	return spirv;
+}
+
+uint64_t ShaderManager::ComputeKey(const std::string& filename, const std::string& source, const std::vector<ShaderDefine>& defines)
+{
+	uint64_t hash = HashBytes(&cacheFormatVersion, sizeof(cacheFormatVersion));
+	hash = HashBytes(&apiVersion, sizeof(apiVersion), hash);
+	hash = HashBytes(&debug, sizeof(debug), hash);
+	//SPIR-V of an older compiler must not be reused after an upgrade.
+	hash = HashBytes(&compilerIdentity, sizeof(compilerIdentity), hash);
+	hash = HashString(std::filesystem::path(filename).lexically_normal().generic_string(), hash);
+	hash = HashString(source, hash);
+
+	for (auto& define : defines)
+	{
+		hash = HashString(define.name, hash);
+		hash = HashString(define.value, hash);
+	}
+
+	std::set<std::string> visited;
+	return HashIncludes(filename, source, includeDirectories, visited, hash);
+}
+
+std::vector<uint32_t> ShaderManager::Compile(const std::string& filename, const std::string& source, const std::vector<ShaderDefine>& defines)
+{
+	shaderc::Compiler compiler;
+	shaderc::CompileOptions options;
+
+	SetCompileOptions(options, apiVersion, debug);
+	options.SetIncluder(std::make_unique<Includer>(includeDirectories));
+
+	for (auto& define : defines)
+	{
+		options.AddMacroDefinition(define.name, define.value);
+	}
+
+	shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(source, GetShaderKind(filename), filename.c_str(), options);
+	if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+	{
+		throw std::runtime_error("ERROR: Could not compile shader " + filename + ":\n" + result.GetErrorMessage());
+	}
+
+	std::cout << "INFO: Compiled shader " << filename << ".\n";
+	return std::vector<uint32_t>(result.cbegin(), result.cend());
+}
+
+std::vector<uint32_t> ShaderManager::ReadCache(uint64_t key)
+{
+	std::ifstream file(GetCachePath(cacheDirectory, key), std::ios::ate | std::ios::binary);
+	if (!file.is_open())
+	{
+		return {};
+	}
+
+	size_t fileSize = static_cast<size_t>(file.tellg());
+	if (fileSize == 0 || fileSize % sizeof(uint32_t) != 0)
+	{
+		return {};
+	}
+
+	std::vector<uint32_t> spirv(fileSize / sizeof(uint32_t));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(spirv.data()), fileSize);
+
+	//Anything that does not look like SPIR-V is recompiled and overwritten.
+	if (!file || spirv[0] != spirvMagic)
+	{
+		return {};
+	}
+
+	return spirv;
+}
+
+void ShaderManager::WriteCache(uint64_t key, const std::vector<uint32_t>& spirv)
+{
+	std::filesystem::path path = GetCachePath(cacheDirectory, key);
+	std::filesystem::path temporary = path;
+	//Several threads may compile the same shader, each writes its own temporary.
+	temporary += "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			return;
+		}
+
+		file.write(reinterpret_cast<const char*>(spirv.data()), spirv.size() * sizeof(uint32_t));
+		if (!file)
+		{
+			file.close();
+			std::error_code error;
+			std::filesystem::remove(temporary, error);
+			return;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporary, path, error);
+	if (error)
+	{
+		std::filesystem::remove(temporary, error);
+	}
+}
@@ -0,0 +1,205 @@
+#include "ShaderReflection.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <string>
+
+#include <spirv_cross/spirv_cross.hpp>
+
+void ShaderReflection::Reflect(VkShaderStageFlagBits stage, const std::vector<uint32_t>& spirv, ReflectedLayout& layout)
+{
+	spirv_cross::Compiler compiler(spirv);
+	spirv_cross::ShaderResources resources = compiler.get_shader_resources();
+
+	auto addResources = [&](const spirv_cross::SmallVector<spirv_cross::Resource>& list, VkDescriptorType type)
+	{
+		for (auto& resource : list)
+		{
+			const spirv_cross::SPIRType& resourceType = compiler.get_type(resource.type_id);
+
+			VkDescriptorType descriptorType = type;
+			if (resourceType.image.dim == spv::DimBuffer)
+			{
+				//Buffer dimension turns images into texel buffers.
+				if (type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE)
+				{
+					descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+				}
+				else if (type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
+				{
+					descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER;
+				}
+			}
+
+			uint32_t count = 1u;
+			for (size_t i = 0; i < resourceType.array.size(); i++)
+			{
+				if (!resourceType.array_size_literal[i])
+				{
+					throw std::runtime_error("ERROR: Specialised descriptor array " + resource.name + " can not be reflected.\n");
+				}
+				//Runtime arrays reflect as zero descriptors, their size belongs to whoever owns the set (BindlessTable).
+				count *= resourceType.array[i];
+			}
+
+			VkDescriptorSetLayoutBinding binding{};
+			binding.binding = compiler.get_decoration(resource.id, spv::DecorationBinding);
+			binding.descriptorType = descriptorType;
+			binding.descriptorCount = count;
+			binding.stageFlags = stage;
+
+			AddBinding(layout, compiler.get_decoration(resource.id, spv::DecorationDescriptorSet), binding);
+		}
+	};
+
+	addResources(resources.uniform_buffers, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+	addResources(resources.storage_buffers, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+	addResources(resources.sampled_images, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+	addResources(resources.separate_images, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE);
+	addResources(resources.separate_samplers, VK_DESCRIPTOR_TYPE_SAMPLER);
+	addResources(resources.storage_images, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+	addResources(resources.subpass_inputs, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT);
+	addResources(resources.acceleration_structures, VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR);
+
+	//Push constant range covers only the members this stage actually reads.
+	for (auto& resource : resources.push_constant_buffers)
+	{
+		spirv_cross::SmallVector<spirv_cross::BufferRange> ranges = compiler.get_active_buffer_ranges(resource.id);
+		if (ranges.empty())
+		{
+			continue;
+		}
+
+		size_t begin = ranges[0].offset;
+		size_t end = 0;
+		for (auto& range : ranges)
+		{
+			begin = std::min(begin, range.offset);
+			end = std::max(end, range.offset + range.range);
+		}
+
+		VkPushConstantRange pushConstant{};
+		pushConstant.stageFlags = stage;
+		//Offsets and sizes must be multiples of four.
+		pushConstant.offset = static_cast<uint32_t>(begin & ~size_t(3));
+		pushConstant.size = static_cast<uint32_t>(((end + 3) & ~size_t(3)) - pushConstant.offset);
+		layout.pushConstants.push_back(pushConstant);
+	}
+
+	if (stage != VK_SHADER_STAGE_VERTEX_BIT || resources.stage_inputs.empty())
+	{
+		return;
+	}
+
+	//Vertex inputs, one location per matrix column.
+	struct Input
+	{
+		uint32_t location;
+		VkFormat format;
+		uint32_t size;
+	};
+	std::vector<Input> inputs;
+
+	for (auto& resource : resources.stage_inputs)
+	{
+		const spirv_cross::SPIRType& inputType = compiler.get_type(resource.type_id);
+		if (inputType.width != 32u)
+		{
+			throw std::runtime_error("ERROR: Vertex input " + resource.name + " is not 32 bit wide.\n");
+		}
+
+		uint32_t location = compiler.get_decoration(resource.id, spv::DecorationLocation);
+		for (uint32_t column = 0; column < inputType.columns; column++)
+		{
+			inputs.push_back({ location + column, GetVertexFormat(inputType.basetype, inputType.vecsize), inputType.vecsize * 4u });
+		}
+	}
+
+	std::sort(inputs.begin(), inputs.end(), [](const Input& a, const Input& b) { return a.location < b.location; });
+
+	uint32_t offset = 0u;
+	layout.vertexAttributes.clear();
+	for (auto& input : inputs)
+	{
+		VkVertexInputAttributeDescription attribute{};
+		attribute.location = input.location;
+		attribute.binding = 0u;
+		attribute.format = input.format;
+		attribute.offset = offset;
+		layout.vertexAttributes.push_back(attribute);
+		offset += input.size;
+	}
+
+	VkVertexInputBindingDescription binding{};
+	binding.binding = 0u;
+	binding.stride = offset;
+	binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	layout.vertexBindings = { binding };
+}
+
+void ShaderReflection::Merge(const ReflectedLayout& stageLayout, ReflectedLayout& layout)
+{
+	for (auto& set : stageLayout.sets)
+	{
+		for (auto& binding : set.second)
+		{
+			AddBinding(layout, set.first, binding);
+		}
+	}
+
+	layout.pushConstants.insert(layout.pushConstants.end(), stageLayout.pushConstants.begin(), stageLayout.pushConstants.end());
+
+	if (!stageLayout.vertexAttributes.empty())
+	{
+		layout.vertexBindings = stageLayout.vertexBindings;
+		layout.vertexAttributes = stageLayout.vertexAttributes;
+	}
+}
+
+void ShaderReflection::AddBinding(ReflectedLayout& layout, uint32_t set, VkDescriptorSetLayoutBinding binding)
+{
+	std::vector<VkDescriptorSetLayoutBinding>& bindings = layout.sets[set];
+
+	for (auto& existing : bindings)
+	{
+		if (existing.binding != binding.binding)
+		{
+			continue;
+		}
+
+		if (existing.descriptorType != binding.descriptorType || existing.descriptorCount != binding.descriptorCount)
+		{
+			throw std::runtime_error("ERROR: Shader stages disagree on set " + std::to_string(set) + " binding " + std::to_string(binding.binding) + ".\n");
+		}
+
+		existing.stageFlags |= binding.stageFlags;
+		return;
+	}
+
+	auto position = std::lower_bound(bindings.begin(), bindings.end(), binding, [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) { return a.binding < b.binding; });
+	bindings.insert(position, binding);
+}
+
+VkFormat ShaderReflection::GetVertexFormat(uint32_t baseType, uint32_t vectorSize)
+{
+	const VkFormat floatFormats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+	const VkFormat intFormats[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+	const VkFormat uintFormats[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+
+	if (vectorSize < 1u || vectorSize > 4u)
+	{
+		throw std::runtime_error("ERROR: Unsupported vertex input vector size.\n");
+	}
+
+	switch (baseType)
+	{
+	case spirv_cross::SPIRType::Float:
+		return floatFormats[vectorSize - 1];
+	case spirv_cross::SPIRType::Int:
+		return intFormats[vectorSize - 1];
+	case spirv_cross::SPIRType::UInt:
+		return uintFormats[vectorSize - 1];
+	default:
+		throw std::runtime_error("ERROR: Unsupported vertex input type.\n");
+	}
+}
@@ -0,0 +1,187 @@
+#include "StartupGraph.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <algorithm>
+
+StartupGraph::StartupGraph() :
+	nodes({}),
+	threadPool(nullptr),
+	mainThreadQueue({}),
+	remainingCount(0u),
+	runningCount(0u),
+	failure(nullptr),
+	start(),
+	elapsedMs(0.0)
+{
+}
+
+StartupGraph::~StartupGraph()
+{
+}
+
+uint32_t StartupGraph::Add(const std::string& name, Step step, const std::vector<uint32_t>& dependencies, bool mainThread)
+{
+	uint32_t index = static_cast<uint32_t>(nodes.size());
+	for (uint32_t dependency : dependencies)
+	{
+		if (dependency >= index)
+		{
+			throw std::runtime_error("ERROR: Startup step " + name + " depends on a step that was not added before it.\n");
+		}
+		nodes[dependency].dependents.push_back(index);
+	}
+
+	Node node{};
+	node.name = name;
+	node.step = std::move(step);
+	node.dependencies = dependencies;
+	node.mainThread = mainThread;
+	node.pendingCount = static_cast<uint32_t>(dependencies.size());
+	nodes.push_back(std::move(node));
+	return index;
+}
+
+void StartupGraph::Run(uint32_t threadCount)
+{
+	start = std::chrono::steady_clock::now();
+	threadPool = std::make_unique<ThreadPool>(threadCount);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	remainingCount = static_cast<uint32_t>(nodes.size());
+	for (uint32_t i = 0; i < nodes.size(); i++)
+	{
+		if (nodes[i].pendingCount == 0u)
+		{
+			Schedule(i);
+		}
+	}
+
+	//Main thread steps are run here in between waiting for the workers.
+	while (runningCount != 0u || (!mainThreadQueue.empty() && !failure))
+	{
+		if (!mainThreadQueue.empty() && !failure)
+		{
+			uint32_t node = mainThreadQueue.back();
+			mainThreadQueue.pop_back();
+			lock.unlock();
+			Execute(node);
+			lock.lock();
+			continue;
+		}
+
+		condition.wait(lock);
+	}
+	lock.unlock();
+
+	threadPool.reset();
+	elapsedMs = GetMilliseconds();
+
+	if (failure)
+	{
+		std::rethrow_exception(failure);
+	}
+}
+
+void StartupGraph::PrintTimings()
+{
+	std::vector<uint32_t> order(nodes.size());
+	for (uint32_t i = 0; i < order.size(); i++)
+	{
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return nodes[a].startMs < nodes[b].startMs; });
+
+	double stepMs = 0.0;
+	for (uint32_t i : order)
+	{
+		const Node& node = nodes[i];
+		stepMs += node.endMs - node.startMs;
+		std::cout << "INFO: Startup step " << node.name << " took " << (node.endMs - node.startMs) << " ms, from " << node.startMs << " to " << node.endMs << " ms"
+			<< (node.mainThread ? " on the main thread.\n" : ".\n");
+	}
+
+	//Walk back from the last step to finish, always through the dependency that finished last.
+	std::vector<uint32_t> path;
+	if (!nodes.empty())
+	{
+		uint32_t node = *std::max_element(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return nodes[a].endMs < nodes[b].endMs; });
+		path.push_back(node);
+		while (!nodes[node].dependencies.empty())
+		{
+			const std::vector<uint32_t>& dependencies = nodes[node].dependencies;
+			node = *std::max_element(dependencies.begin(), dependencies.end(), [this](uint32_t a, uint32_t b) { return nodes[a].endMs < nodes[b].endMs; });
+			path.push_back(node);
+		}
+		std::reverse(path.begin(), path.end());
+	}
+
+	std::cout << "INFO: Startup took " << elapsedMs << " ms for " << stepMs << " ms of steps. Critical path:";
+	for (size_t i = 0; i < path.size(); i++)
+	{
+		std::cout << (i == 0u ? " " : " > ") << nodes[path[i]].name;
+	}
+	std::cout << ".\n";
+}
+
+void StartupGraph::Schedule(uint32_t node)
+{
+	if (nodes[node].mainThread)
+	{
+		mainThreadQueue.push_back(node);
+		condition.notify_all();
+		return;
+	}
+
+	runningCount++;
+	threadPool->Submit([this, node]() { Execute(node); });
+}
+
+void StartupGraph::Execute(uint32_t node)
+{
+	//Main thread steps are not counted as running until here, the workers' are from the moment they are submitted.
+	if (nodes[node].mainThread)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		runningCount++;
+	}
+
+	nodes[node].startMs = GetMilliseconds();
+	std::exception_ptr exception = nullptr;
+	try
+	{
+		nodes[node].step();
+	}
+	catch (...)
+	{
+		exception = std::current_exception();
+	}
+	nodes[node].endMs = GetMilliseconds();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	runningCount--;
+	remainingCount--;
+
+	if (exception && !failure)
+	{
+		failure = exception;
+	}
+
+	if (!failure)
+	{
+		for (uint32_t dependent : nodes[node].dependents)
+		{
+			if (--nodes[dependent].pendingCount == 0u)
+			{
+				Schedule(dependent);
+			}
+		}
+	}
+
+	condition.notify_all();
+}
+
+double StartupGraph::GetMilliseconds() const
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,686 @@
+#include "TextureStreamer.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	const VkFormat textureFormat = VK_FORMAT_R8G8B8A8_SRGB;
+
+	uint32_t GetLevelCount(uint32_t width, uint32_t height)
+	{
+		uint32_t levels = 1u;
+		for (uint32_t size = std::max(width, height); size > 1u; size /= 2u)
+		{
+			levels++;
+		}
+		return levels;
+	}
+
+	uint32_t GetLevelExtent(uint32_t size, uint32_t level)
+	{
+		return std::max(1u, size >> level);
+	}
+}
+
+TextureStreamer::TextureStreamer() :
+	device(VK_NULL_HANDLE),
+	hostAllocator(nullptr),
+	memoryAllocator(nullptr),
+	uploadManager(nullptr),
+	bindlessTable(nullptr),
+	deletionQueue(nullptr),
+	budget(0u),
+	residentBytes(0u),
+	loadingBytes(0u),
+	frame(1u),
+	textures({}),
+	pendingCopies({}),
+	ioPool(nullptr),
+	completed({}),
+	uploaded(false),
+	fallbackImage(VK_NULL_HANDLE),
+	fallbackAllocation(),
+	fallbackView(VK_NULL_HANDLE),
+	fallbackHandle(BindlessTable::invalidHandle),
+	streamedLevels(0u),
+	evictedLevels(0u)
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+}
+
+void TextureStreamer::Create(VkDevice device, HostAllocator* hostAllocator, MemoryAllocator* memoryAllocator, UploadManager* uploadManager, BindlessTable* bindlessTable, DeletionQueue* deletionQueue, VkDeviceSize budget, uint32_t ioThreads)
+{
+	this->device = device;
+	this->hostAllocator = hostAllocator;
+	this->memoryAllocator = memoryAllocator;
+	this->uploadManager = uploadManager;
+	this->bindlessTable = bindlessTable;
+	this->deletionQueue = deletionQueue;
+	this->budget = budget;
+	ioPool = std::make_unique<ThreadPool>(ioThreads);
+
+	CreateFallback();
+}
+
+void TextureStreamer::Destroy()
+{
+	if (!ioPool)
+	{
+		return;
+	}
+
+	//Pool drains its queue before the workers exit, results nobody applies are dropped.
+	ioPool.reset();
+	completed.clear();
+	pendingCopies.clear();
+
+	PrintStatistics();
+
+	for (auto& texture : textures)
+	{
+		if (texture.image != VK_NULL_HANDLE)
+		{
+			bindlessTable->FreeImage(texture.handle);
+			vkDestroyImageView(device, texture.imageView, hostAllocator->Get(VK_OBJECT_TYPE_IMAGE_VIEW));
+			memoryAllocator->DestroyImage(texture.image, texture.allocation);
+		}
+	}
+	textures.clear();
+
+	bindlessTable->FreeImage(fallbackHandle);
+	vkDestroyImageView(device, fallbackView, hostAllocator->Get(VK_OBJECT_TYPE_IMAGE_VIEW));
+	memoryAllocator->DestroyImage(fallbackImage, fallbackAllocation);
+	fallbackHandle = BindlessTable::invalidHandle;
+}
+
+uint32_t TextureStreamer::Load(const std::string& filename)
+{
+	uint32_t id = static_cast<uint32_t>(textures.size());
+
+	Texture texture{};
+	texture.filename = filename;
+	textures.push_back(texture);
+
+	StartLoad(id, tailRequest);
+	return id;
+}
+
+void TextureStreamer::RequestSize(uint32_t texture, float pixels)
+{
+	Texture& entry = textures[texture];
+	if (entry.lastUsedFrame != frame)
+	{
+		entry.lastUsedFrame = frame;
+		entry.requestedPixels = pixels;
+	}
+	else
+	{
+		entry.requestedPixels = std::max(entry.requestedPixels, pixels);
+	}
+}
+
+uint32_t TextureStreamer::GetHandle(uint32_t texture) const
+{
+	const Texture& entry = textures[texture];
+	return entry.image != VK_NULL_HANDLE ? entry.handle : fallbackHandle;
+}
+
+void TextureStreamer::Update(uint64_t retireValue)
+{
+	std::vector<LoadResult> results;
+	{
+		std::lock_guard<std::mutex> lock(completedMutex);
+		results.swap(completed);
+	}
+
+	for (auto& result : results)
+	{
+		ApplyLoad(result, retireValue);
+	}
+
+	//Level whose texels map about one to one onto the reported screen size, never above the tail.
+	std::vector<uint32_t> candidates;
+	for (uint32_t i = 0; i < textures.size(); i++)
+	{
+		Texture& texture = textures[i];
+		if (texture.image == VK_NULL_HANDLE)
+		{
+			continue;
+		}
+
+		if (texture.lastUsedFrame == frame)
+		{
+			float ratio = static_cast<float>(std::max(texture.width, texture.height)) / std::max(texture.requestedPixels, 1.f);
+			uint32_t level = static_cast<uint32_t>(std::max(0.f, std::floor(std::log2(ratio))));
+			texture.desiredLevel = std::min(level, texture.tailLevel);
+
+			//A file that failed to load once is not read again, the texture keeps the levels it has.
+			if (texture.failed)
+			{
+				texture.desiredLevel = std::max(texture.desiredLevel, texture.residentLevel);
+				continue;
+			}
+
+			if (!texture.loading && texture.desiredLevel < texture.residentLevel)
+			{
+				candidates.push_back(i);
+			}
+		}
+	}
+
+	//Budget may have been lowered below what is resident, or tails alone may exceed it.
+	EvictForBudget(0u, UINT64_MAX, retireValue);
+
+	//Largest deficit first, one level per texture and frame.
+	std::sort(candidates.begin(), candidates.end(), [this](uint32_t a, uint32_t b)
+	{
+		return textures[a].residentLevel - textures[a].desiredLevel > textures[b].residentLevel - textures[b].desiredLevel;
+	});
+
+	uint32_t maxLoads = ioPool->GetThreadCount() * 2u;
+	uint32_t loads = 0u;
+	for (auto& texture : textures)
+	{
+		loads += texture.loading ? 1u : 0u;
+	}
+
+	for (auto candidate : candidates)
+	{
+		if (loads >= maxLoads)
+		{
+			break;
+		}
+
+		Texture& texture = textures[candidate];
+		uint32_t level = texture.residentLevel - 1u;
+		VkDeviceSize size = GetLevelSize(texture, level);
+		if (size > uploadManager->GetCapacity())
+		{
+			continue;
+		}
+
+		if (!EvictForBudget(size, texture.lastUsedFrame, retireValue))
+		{
+			break;
+		}
+
+		StartLoad(candidate, level);
+		loads++;
+	}
+
+	if (uploaded)
+	{
+		uploadManager->Flush();
+		uploaded = false;
+	}
+
+	frame++;
+}
+
+void TextureStreamer::RecordCommands(VkCommandBuffer commandBuffer)
+{
+	//Copies run in order with their own barriers, so a version replaced twice in one frame copies from a finished copy.
+	for (auto& copy : pendingCopies)
+	{
+		VkImageMemoryBarrier2 toTransfer[2]{};
+		toTransfer[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+		toTransfer[0].srcStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COPY_BIT;
+		toTransfer[0].srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+		toTransfer[0].dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+		toTransfer[0].dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+		toTransfer[0].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		toTransfer[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		toTransfer[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		toTransfer[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		toTransfer[0].image = copy.source;
+		toTransfer[0].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, copy.sourceLevel, copy.levelCount, 0u, 1u };
+
+		toTransfer[1].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+		toTransfer[1].srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+		toTransfer[1].dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+		toTransfer[1].dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+		toTransfer[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		toTransfer[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		toTransfer[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		toTransfer[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		toTransfer[1].image = copy.destination;
+		toTransfer[1].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, copy.destinationLevel, copy.levelCount, 0u, 1u };
+
+		VkDependencyInfo toTransferDependency{};
+		toTransferDependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+		toTransferDependency.imageMemoryBarrierCount = 2;
+		toTransferDependency.pImageMemoryBarriers = toTransfer;
+		vkCmdPipelineBarrier2(commandBuffer, &toTransferDependency);
+
+		std::vector<VkImageCopy> regions(copy.levelCount);
+		for (uint32_t i = 0; i < copy.levelCount; i++)
+		{
+			regions[i].srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, copy.sourceLevel + i, 0u, 1u };
+			regions[i].dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, copy.destinationLevel + i, 0u, 1u };
+			regions[i].extent = { GetLevelExtent(copy.extent.width, i), GetLevelExtent(copy.extent.height, i), 1u };
+		}
+		vkCmdCopyImage(commandBuffer, copy.source, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, copy.destination, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			static_cast<uint32_t>(regions.size()), regions.data());
+
+		//Source is retired with this frame and stays in transfer layout.
+		VkImageMemoryBarrier2 toShader{};
+		toShader.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+		toShader.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+		toShader.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+		toShader.dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COPY_BIT;
+		toShader.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT | VK_ACCESS_2_TRANSFER_READ_BIT;
+		toShader.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		toShader.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		toShader.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		toShader.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		toShader.image = copy.destination;
+		toShader.subresourceRange = toTransfer[1].subresourceRange;
+
+		VkDependencyInfo toShaderDependency{};
+		toShaderDependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+		toShaderDependency.imageMemoryBarrierCount = 1;
+		toShaderDependency.pImageMemoryBarriers = &toShader;
+		vkCmdPipelineBarrier2(commandBuffer, &toShaderDependency);
+	}
+
+	pendingCopies.clear();
+}
+
+VkDeviceSize TextureStreamer::GetResidentBytes() const
+{
+	return residentBytes;
+}
+
+void TextureStreamer::PrintStatistics() const
+{
+	std::cout << "INFO: Streamed " << streamedLevels << " texture level(s), evicted " << evictedLevels << ", " << (residentBytes >> 20) << " of " << (budget >> 20) << " MiB resident.\n";
+}
+
+TextureStreamer::LoadResult TextureStreamer::LoadLevels(uint32_t texture, const std::string& filename, uint32_t firstLevel)
+{
+	LoadResult result{};
+	result.texture = texture;
+	result.firstLevel = firstLevel;
+
+	try
+	{
+		uint32_t width = 0u;
+		uint32_t height = 0u;
+		std::vector<uint8_t> level = ReadPpm(filename, width, height);
+		result.width = width;
+		result.height = height;
+
+		uint32_t levelCount = GetLevelCount(width, height);
+		uint32_t lastLevel = firstLevel;
+		if (firstLevel == tailRequest)
+		{
+			//Tail starts at the first level that fits in tailSize texels along both sides.
+			result.firstLevel = 0u;
+			while (std::max(GetLevelExtent(width, result.firstLevel), GetLevelExtent(height, result.firstLevel)) > tailSize)
+			{
+				result.firstLevel++;
+			}
+			lastLevel = levelCount - 1u;
+		}
+
+		//Every level is filtered from the one above, so the chain is walked from the top.
+		for (uint32_t i = 0; i <= lastLevel; i++)
+		{
+			if (i >= result.firstLevel)
+			{
+				result.levels.push_back(level);
+			}
+
+			if (i < lastLevel)
+			{
+				level = Downsample(level, GetLevelExtent(width, i), GetLevelExtent(height, i));
+			}
+		}
+	}
+	catch (const std::exception& e)
+	{
+		result.error = e.what();
+	}
+
+	return result;
+}
+
+std::vector<uint8_t> TextureStreamer::ReadPpm(const std::string& filename, uint32_t& width, uint32_t& height)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("ERROR: Could not open texture " + filename + "\n");
+	}
+
+	//Header tokens are separated by whitespace and may be interleaved with comments.
+	auto readToken = [&file]()
+	{
+		std::string token;
+		char c = 0;
+		while (file.get(c))
+		{
+			if (c == '#')
+			{
+				std::string comment;
+				std::getline(file, comment);
+			}
+			else if (std::isspace(static_cast<unsigned char>(c)))
+			{
+				if (!token.empty())
+				{
+					break;
+				}
+			}
+			else
+			{
+				token += c;
+			}
+		}
+		return token;
+	};
+
+	std::string magic = readToken();
+	std::string widthToken = readToken();
+	std::string heightToken = readToken();
+	std::string maxToken = readToken();
+	if (magic != "P6" || widthToken.empty() || heightToken.empty() || maxToken != "255")
+	{
+		throw std::runtime_error("ERROR: Texture " + filename + " is not an 8 bit binary PPM file.\n");
+	}
+
+	width = static_cast<uint32_t>(std::stoul(widthToken));
+	height = static_cast<uint32_t>(std::stoul(heightToken));
+	if (width == 0u || height == 0u)
+	{
+		throw std::runtime_error("ERROR: Texture " + filename + " is empty.\n");
+	}
+
+	std::vector<uint8_t> rgb(static_cast<size_t>(width) * height * 3u);
+	file.read(reinterpret_cast<char*>(rgb.data()), rgb.size());
+	if (!file)
+	{
+		throw std::runtime_error("ERROR: Texture " + filename + " is truncated.\n");
+	}
+
+	std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4u);
+	for (size_t i = 0; i < static_cast<size_t>(width) * height; i++)
+	{
+		rgba[i * 4u + 0u] = rgb[i * 3u + 0u];
+		rgba[i * 4u + 1u] = rgb[i * 3u + 1u];
+		rgba[i * 4u + 2u] = rgb[i * 3u + 2u];
+		rgba[i * 4u + 3u] = 255u;
+	}
+
+	return rgba;
+}
+
+std::vector<uint8_t> TextureStreamer::Downsample(const std::vector<uint8_t>& source, uint32_t width, uint32_t height)
+{
+	//2x2 box filter, the last row or column of odd sizes is reused.
+	uint32_t targetWidth = std::max(1u, width / 2u);
+	uint32_t targetHeight = std::max(1u, height / 2u);
+	std::vector<uint8_t> target(static_cast<size_t>(targetWidth) * targetHeight * 4u);
+
+	for (uint32_t y = 0; y < targetHeight; y++)
+	{
+		uint32_t y0 = std::min(y * 2u, height - 1u);
+		uint32_t y1 = std::min(y * 2u + 1u, height - 1u);
+		for (uint32_t x = 0; x < targetWidth; x++)
+		{
+			uint32_t x0 = std::min(x * 2u, width - 1u);
+			uint32_t x1 = std::min(x * 2u + 1u, width - 1u);
+			for (uint32_t c = 0; c < 4u; c++)
+			{
+				uint32_t sum = source[(static_cast<size_t>(y0) * width + x0) * 4u + c] + source[(static_cast<size_t>(y0) * width + x1) * 4u + c] +
+					source[(static_cast<size_t>(y1) * width + x0) * 4u + c] + source[(static_cast<size_t>(y1) * width + x1) * 4u + c];
+				target[(static_cast<size_t>(y) * targetWidth + x) * 4u + c] = static_cast<uint8_t>((sum + 2u) / 4u);
+			}
+		}
+	}
+
+	return target;
+}
+
+void TextureStreamer::StartLoad(uint32_t texture, uint32_t firstLevel)
+{
+	Texture& entry = textures[texture];
+	entry.loading = true;
+	if (firstLevel != tailRequest)
+	{
+		loadingBytes += GetLevelSize(entry, firstLevel);
+	}
+
+	std::string filename = entry.filename;
+	ioPool->Submit([this, texture, filename, firstLevel]()
+	{
+		LoadResult result = LoadLevels(texture, filename, firstLevel);
+
+		std::lock_guard<std::mutex> lock(completedMutex);
+		completed.push_back(std::move(result));
+	});
+}
+
+void TextureStreamer::ApplyLoad(LoadResult& result, uint64_t retireValue)
+{
+	Texture& texture = textures[result.texture];
+	texture.loading = false;
+
+	bool tail = texture.image == VK_NULL_HANDLE;
+	if (!tail)
+	{
+		loadingBytes -= GetLevelSize(texture, result.firstLevel);
+	}
+
+	if (!result.error.empty())
+	{
+		std::cout << "WARNING: " << result.error.substr(result.error.find(' ') + 1u);
+		texture.failed = true;
+		texture.desiredLevel = std::max(texture.desiredLevel, texture.residentLevel);
+		return;
+	}
+
+	if (tail)
+	{
+		texture.width = result.width;
+		texture.height = result.height;
+		texture.levelCount = GetLevelCount(result.width, result.height);
+		texture.tailLevel = result.firstLevel;
+		texture.residentLevel = texture.levelCount;
+		texture.desiredLevel = texture.tailLevel;
+		ReplaceVersion(texture, result.firstLevel, result.levels, retireValue);
+		return;
+	}
+
+	//Top level was evicted while this one loaded, it no longer sits directly above the resident levels.
+	if (result.firstLevel + 1u != texture.residentLevel)
+	{
+		return;
+	}
+
+	ReplaceVersion(texture, result.firstLevel, result.levels, retireValue);
+	streamedLevels++;
+}
+
+void TextureStreamer::ReplaceVersion(Texture& texture, uint32_t topLevel, const std::vector<std::vector<uint8_t>>& uploads, uint64_t retireValue)
+{
+	uint32_t levelCount = texture.levelCount - topLevel;
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = textureFormat;
+	imageInfo.extent = { GetLevelExtent(texture.width, topLevel), GetLevelExtent(texture.height, topLevel), 1u };
+	imageInfo.mipLevels = levelCount;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	VkImage image = VK_NULL_HANDLE;
+	Allocation allocation{};
+	memoryAllocator->CreateImage(imageInfo, MemoryUsage::GpuOnly, image, allocation);
+
+	for (uint32_t i = 0; i < uploads.size(); i++)
+	{
+		uint32_t level = topLevel + i;
+		VkImageSubresourceLayers subresource{ VK_IMAGE_ASPECT_COLOR_BIT, i, 0u, 1u };
+		VkExtent3D extent{ GetLevelExtent(texture.width, level), GetLevelExtent(texture.height, level), 1u };
+		uploadManager->UploadImage(image, subresource, extent, uploads[i].data(), uploads[i].size(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		uploaded = true;
+	}
+
+	uint32_t firstCopied = topLevel + static_cast<uint32_t>(uploads.size());
+	if (firstCopied < texture.levelCount)
+	{
+		PendingCopy copy{};
+		copy.source = texture.image;
+		copy.destination = image;
+		copy.sourceLevel = firstCopied - texture.residentLevel;
+		copy.destinationLevel = firstCopied - topLevel;
+		copy.levelCount = texture.levelCount - firstCopied;
+		copy.extent = { GetLevelExtent(texture.width, firstCopied), GetLevelExtent(texture.height, firstCopied) };
+		pendingCopies.push_back(copy);
+	}
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = textureFormat;
+	viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0u, levelCount, 0u, 1u };
+
+	VkImageView imageView = VK_NULL_HANDLE;
+	if (vkCreateImageView(device, &viewInfo, hostAllocator->Get(VK_OBJECT_TYPE_IMAGE_VIEW), &imageView) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not create texture image view.\n");
+	}
+
+	if (texture.image != VK_NULL_HANDLE)
+	{
+		residentBytes -= GetVersionSize(texture, texture.residentLevel);
+		RetireVersion(texture, retireValue);
+	}
+
+	texture.image = image;
+	texture.allocation = allocation;
+	texture.imageView = imageView;
+	//A fresh handle, the old one may still be read by frames in flight.
+	texture.handle = bindlessTable->AddImage(imageView);
+	texture.residentLevel = topLevel;
+	residentBytes += GetVersionSize(texture, topLevel);
+}
+
+void TextureStreamer::RetireVersion(Texture& texture, uint64_t retireValue)
+{
+	VkDevice device = this->device;
+	HostAllocator* hostAllocator = this->hostAllocator;
+	MemoryAllocator* memoryAllocator = this->memoryAllocator;
+	BindlessTable* bindlessTable = this->bindlessTable;
+	VkImage image = texture.image;
+	Allocation allocation = texture.allocation;
+	VkImageView imageView = texture.imageView;
+	uint32_t handle = texture.handle;
+
+	deletionQueue->Push(retireValue, [=]() mutable
+	{
+		bindlessTable->FreeImage(handle);
+		vkDestroyImageView(device, imageView, hostAllocator->Get(VK_OBJECT_TYPE_IMAGE_VIEW));
+		memoryAllocator->DestroyImage(image, allocation);
+	});
+}
+
+bool TextureStreamer::EvictForBudget(VkDeviceSize required, uint64_t usedBefore, uint64_t retireValue)
+{
+	while (residentBytes + loadingBytes + required > budget)
+	{
+		//Least recently used texture that still has levels above its tail.
+		Texture* victim = nullptr;
+		for (auto& texture : textures)
+		{
+			if (texture.image == VK_NULL_HANDLE || texture.loading || texture.residentLevel >= texture.tailLevel)
+			{
+				continue;
+			}
+
+			if (texture.lastUsedFrame >= usedBefore && texture.residentLevel >= texture.desiredLevel)
+			{
+				continue;
+			}
+
+			if (victim == nullptr || texture.lastUsedFrame < victim->lastUsedFrame)
+			{
+				victim = &texture;
+			}
+		}
+
+		if (victim == nullptr)
+		{
+			return false;
+		}
+
+		ReplaceVersion(*victim, victim->residentLevel + 1u, {}, retireValue);
+		evictedLevels++;
+	}
+
+	return true;
+}
+
+VkDeviceSize TextureStreamer::GetLevelSize(const Texture& texture, uint32_t level) const
+{
+	return static_cast<VkDeviceSize>(GetLevelExtent(texture.width, level)) * GetLevelExtent(texture.height, level) * 4u;
+}
+
+VkDeviceSize TextureStreamer::GetVersionSize(const Texture& texture, uint32_t topLevel) const
+{
+	VkDeviceSize size = 0u;
+	for (uint32_t level = topLevel; level < texture.levelCount; level++)
+	{
+		size += GetLevelSize(texture, level);
+	}
+	return size;
+}
+
+void TextureStreamer::CreateFallback()
+{
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = textureFormat;
+	imageInfo.extent = { 1u, 1u, 1u };
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	memoryAllocator->CreateImage(imageInfo, MemoryUsage::GpuOnly, fallbackImage, fallbackAllocation);
+
+	const uint8_t white[4] = { 255u, 255u, 255u, 255u };
+	uploadManager->UploadImage(fallbackImage, { VK_IMAGE_ASPECT_COLOR_BIT, 0u, 0u, 1u }, { 1u, 1u, 1u }, white, sizeof(white), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	uploadManager->Flush();
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = fallbackImage;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = textureFormat;
+	viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0u, 1u, 0u, 1u };
+
+	if (vkCreateImageView(device, &viewInfo, hostAllocator->Get(VK_OBJECT_TYPE_IMAGE_VIEW), &fallbackView) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not create texture image view.\n");
+	}
+
+	fallbackHandle = bindlessTable->AddImage(fallbackView);
+}
@@ -0,0 +1,299 @@
+#include "TlsfAllocator.h"
+
+#include <stdexcept>
+#include <bit>
+
+struct TlsfAllocator::Region
+{
+	uint64_t offset;
+	uint64_t size;
+	bool free;
+	//Neighbours in address order.
+	Region* previous;
+	Region* next;
+	//Neighbours in the free list of the same size class.
+	Region* previousFree;
+	Region* nextFree;
+};
+
+TlsfAllocator::TlsfAllocator() :
+	size(0u),
+	usedBytes(0u),
+	allocationCount(0u),
+	first(nullptr),
+	firstLevelBitmap(0u),
+	secondLevelBitmaps({}),
+	freeLists({})
+{
+}
+
+TlsfAllocator::~TlsfAllocator()
+{
+	Destroy();
+}
+
+void TlsfAllocator::Create(uint64_t size)
+{
+	Destroy();
+
+	this->size = size & ~(minimumSize - 1u);
+	if (this->size == 0u)
+	{
+		throw std::runtime_error("ERROR: TLSF range is too small.\n");
+	}
+
+	first = new Region{ 0u, this->size, true, nullptr, nullptr, nullptr, nullptr };
+	InsertFree(first);
+}
+
+void TlsfAllocator::Destroy()
+{
+	Region* region = first;
+	while (region != nullptr)
+	{
+		Region* next = region->next;
+		delete region;
+		region = next;
+	}
+
+	first = nullptr;
+	size = 0u;
+	usedBytes = 0u;
+	allocationCount = 0u;
+	firstLevelBitmap = 0u;
+	secondLevelBitmaps.fill(0u);
+	for (auto& lists : freeLists)
+	{
+		lists.fill(nullptr);
+	}
+}
+
+TlsfAllocator::Region* TlsfAllocator::Allocate(uint64_t size, uint64_t alignment, uint64_t& offset)
+{
+	if (size == 0u || alignment == 0u || (alignment & (alignment - 1u)) != 0u)
+	{
+		return nullptr;
+	}
+
+	size = (size + minimumSize - 1u) & ~(minimumSize - 1u);
+	alignment = alignment < minimumSize ? minimumSize : alignment;
+
+	//Worst case padding is added so any region found can hold the aligned request.
+	Region* region = FindFree(size + alignment - minimumSize);
+	if (region == nullptr)
+	{
+		return nullptr;
+	}
+	RemoveFree(region);
+
+	//Leading padding becomes its own free region. Its left neighbour is allocated, no merge needed.
+	uint64_t alignedOffset = (region->offset + alignment - 1u) & ~(alignment - 1u);
+	uint64_t padding = alignedOffset - region->offset;
+	if (padding != 0u)
+	{
+		Region* paddingRegion = new Region{ region->offset, padding, true, region->previous, region, nullptr, nullptr };
+		if (region->previous != nullptr)
+		{
+			region->previous->next = paddingRegion;
+		}
+		else
+		{
+			first = paddingRegion;
+		}
+		region->previous = paddingRegion;
+		region->offset += padding;
+		region->size -= padding;
+		InsertFree(paddingRegion);
+	}
+
+	//Trailing remainder goes back as a free region. Its right neighbour is allocated as well.
+	if (region->size - size >= minimumSize)
+	{
+		Region* remainder = new Region{ region->offset + size, region->size - size, true, region, region->next, nullptr, nullptr };
+		if (region->next != nullptr)
+		{
+			region->next->previous = remainder;
+		}
+		region->next = remainder;
+		region->size = size;
+		InsertFree(remainder);
+	}
+
+	region->free = false;
+	usedBytes += region->size;
+	allocationCount++;
+
+	offset = region->offset;
+	return region;
+}
+
+void TlsfAllocator::Free(Region* region)
+{
+	if (region == nullptr || region->free)
+	{
+		return;
+	}
+
+	usedBytes -= region->size;
+	allocationCount--;
+	region->free = true;
+
+	if (region->previous != nullptr && region->previous->free)
+	{
+		Region* previous = region->previous;
+		RemoveFree(previous);
+		previous->size += region->size;
+		previous->next = region->next;
+		if (region->next != nullptr)
+		{
+			region->next->previous = previous;
+		}
+		delete region;
+		region = previous;
+	}
+
+	if (region->next != nullptr && region->next->free)
+	{
+		Region* next = region->next;
+		RemoveFree(next);
+		region->size += next->size;
+		region->next = next->next;
+		if (next->next != nullptr)
+		{
+			next->next->previous = region;
+		}
+		delete next;
+	}
+
+	InsertFree(region);
+}
+
+uint64_t TlsfAllocator::GetSize() const
+{
+	return size;
+}
+
+uint64_t TlsfAllocator::GetUsedBytes() const
+{
+	return usedBytes;
+}
+
+uint64_t TlsfAllocator::GetLargestFreeRegion() const
+{
+	if (firstLevelBitmap == 0u)
+	{
+		return 0u;
+	}
+
+	//Regions in the highest populated size class are the only candidates.
+	uint32_t firstLevel = static_cast<uint32_t>(std::bit_width(firstLevelBitmap) - 1);
+	uint32_t secondLevel = static_cast<uint32_t>(std::bit_width(secondLevelBitmaps[firstLevel]) - 1);
+
+	uint64_t largest = 0u;
+	for (Region* region = freeLists[firstLevel][secondLevel]; region != nullptr; region = region->nextFree)
+	{
+		largest = region->size > largest ? region->size : largest;
+	}
+	return largest;
+}
+
+uint32_t TlsfAllocator::GetAllocationCount() const
+{
+	return allocationCount;
+}
+
+bool TlsfAllocator::IsEmpty() const
+{
+	return allocationCount == 0u;
+}
+
+void TlsfAllocator::Mapping(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel)
+{
+	//Sizes are at least minimumSize, so the most significant bit is always at or above secondLevelLog2.
+	uint32_t msb = static_cast<uint32_t>(std::bit_width(size) - 1);
+	firstLevel = msb;
+	secondLevel = static_cast<uint32_t>((size >> (msb - secondLevelLog2)) & (secondLevelCount - 1u));
+}
+
+void TlsfAllocator::InsertFree(Region* region)
+{
+	uint32_t firstLevel, secondLevel;
+	Mapping(region->size, firstLevel, secondLevel);
+
+	region->free = true;
+	region->previousFree = nullptr;
+	region->nextFree = freeLists[firstLevel][secondLevel];
+	if (region->nextFree != nullptr)
+	{
+		region->nextFree->previousFree = region;
+	}
+	freeLists[firstLevel][secondLevel] = region;
+
+	firstLevelBitmap |= 1ull << firstLevel;
+	secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+}
+
+void TlsfAllocator::RemoveFree(Region* region)
+{
+	uint32_t firstLevel, secondLevel;
+	Mapping(region->size, firstLevel, secondLevel);
+
+	if (region->previousFree != nullptr)
+	{
+		region->previousFree->nextFree = region->nextFree;
+	}
+	else
+	{
+		freeLists[firstLevel][secondLevel] = region->nextFree;
+	}
+	if (region->nextFree != nullptr)
+	{
+		region->nextFree->previousFree = region->previousFree;
+	}
+	region->previousFree = nullptr;
+	region->nextFree = nullptr;
+
+	if (freeLists[firstLevel][secondLevel] == nullptr)
+	{
+		secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+		if (secondLevelBitmaps[firstLevel] == 0u)
+		{
+			firstLevelBitmap &= ~(1ull << firstLevel);
+		}
+	}
+}
+
+TlsfAllocator::Region* TlsfAllocator::FindFree(uint64_t size)
+{
+	if (size > this->size)
+	{
+		return nullptr;
+	}
+
+	//Round up to the next size class so every region in the class found is large enough.
+	uint32_t msb = static_cast<uint32_t>(std::bit_width(size) - 1);
+	uint64_t rounded = size + (1ull << (msb - secondLevelLog2)) - 1u;
+
+	uint32_t firstLevel, secondLevel;
+	Mapping(rounded, firstLevel, secondLevel);
+	if (firstLevel >= firstLevelCount)
+	{
+		return nullptr;
+	}
+
+	uint32_t secondLevelMap = secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+	if (secondLevelMap == 0u)
+	{
+		uint64_t firstLevelMap = firstLevel + 1u < firstLevelCount ? firstLevelBitmap & (~0ull << (firstLevel + 1u)) : 0u;
+		if (firstLevelMap == 0u)
+		{
+			return nullptr;
+		}
+
+		firstLevel = static_cast<uint32_t>(std::countr_zero(firstLevelMap));
+		secondLevelMap = secondLevelBitmaps[firstLevel];
+	}
+
+	secondLevel = static_cast<uint32_t>(std::countr_zero(secondLevelMap));
+	return freeLists[firstLevel][secondLevel];
+}
@@ -1,11 +1,16 @@
 #include "TriangleApplication.h"
 
 #include <stdexcept>
-
-const int TriangleApplication::maxFramesInFlight = 2;
-
-TriangleApplication::TriangleApplication() :
-	currentFrame(0)
+#include <iostream>
+#include <chrono>
+
+TriangleApplication::TriangleApplication(const ApplicationSettings& settings) :
+	Application(settings),
+	renderGraph(),
+	lastImageIndex(0u),
+	backbuffer(0u),
+	mainPass(0u),
+	renderGraphExtent()
 {
 	Initialise();
 }
@@ -17,114 +22,256 @@ TriangleApplication::~TriangleApplication()
 
 void TriangleApplication::Run()
 {
-	MainLoop();
+	if (settings.headless)
+	{
+		HeadlessLoop();
+	}
+	else
+	{
+		MainLoop();
+	}
 }
 
 void TriangleApplication::Initialise()
 {
-	CreateCommandBuffers();
+	CreateCommandRecorder();
 	CreateSyncObjects();
+	CreateProfiler();
+	CreateFramePacer();
+	CreateRenderGraph();
+	CreateFrameAllocator();
+	CreateAsyncCompute();
 }
 
 void TriangleApplication::Destroy()
 {
+	DestroyRenderGraph();
+	DestroyAsyncCompute();
+	DestroyFrameAllocator();
+	DestroyFramePacer();
 	DestroySyncObjects();
+	DestroyProfiler();
+	DestroyCommandRecorder();
 }
 
 void TriangleApplication::MainLoop()
 {
 	while (!glfwWindowShouldClose(window))
 	{
+		//Pace before polling, input sampled after the wait is as fresh as possible when the frame is rendered.
+		framePacer.WaitForNextFrame(swapchain);
 		glfwPollEvents();
+		framePacer.MarkInput();
+		DrawFrames();
+	}
+
+	vkDeviceWaitIdle(device);
+}
+
+void TriangleApplication::HeadlessLoop()
+{
+	auto start = std::chrono::steady_clock::now();
+
+	for (uint32_t frame = 0; frame < settings.frameCount; frame++)
+	{
+		framePacer.WaitForNextFrame(VK_NULL_HANDLE);
 		DrawFrames();
-		currentFrame = (currentFrame + 1) % maxFramesInFlight;
 	}
 
 	vkDeviceWaitIdle(device);
+
+	auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "INFO: Rendered " << settings.frameCount << " frames in " << elapsed << " ms (" << (settings.frameCount * 1000.0 / elapsed) << " fps).\n";
+
+	if (!settings.outputPath.empty())
+	{
+		SaveOffscreenImage(lastImageIndex, settings.outputPath);
+	}
 }
 
 void TriangleApplication::DrawFrames()
 {
-	vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
-	vkResetFences(device, 1, &inFlightFences[currentFrame]);
+	uint32_t frameSlot = frameScheduler.BeginFrame();
+	profiler.BeginFrame(frameSlot);
+	deletionQueue.Flush(frameScheduler.GetCompletedValue());
+	frameAllocator.BeginFrame(frameSlot);
+	asyncCompute.AddGraphicsTiming(frameScheduler.GetLastTiming());
 
-	uint32_t imageIndex = 0;
-	vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, imageAvailableSemaphores[currentFrame], nullptr, &imageIndex);
+	Profiler::CpuScope frameScope(profiler, "DrawFrames");
 
-	vkResetCommandBuffer(commandBuffers[currentFrame], 0);
-	RecordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+	//Headless images are cycled round robin, there is nothing to acquire from.
+	uint32_t imageIndex = 0;
+	if (settings.headless)
+	{
+		imageIndex = (lastImageIndex + 1) % static_cast<uint32_t>(swapchainImages.size());
+	}
+	else
+	{
+		//Out of date swapchains drop this frame, suboptimal ones still render and are replaced after present.
+		framePacer.MarkAcquire();
+		VkResult result = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, imageAvailableSemaphores[frameSlot], nullptr, &imageIndex);
+		if (result == VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			RecreateSwapchain(frameScheduler.GetFrameNumber());
+			framePacer.ResetSwapchain();
+			return;
+		}
+		else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+		{
+			throw std::runtime_error("ERROR: Could not acquire swapchain image.\n");
+		}
+	}
+	lastImageIndex = imageIndex;
 
-	VkSubmitInfo submitInfo{};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	
-	VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame] };
-	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT };
+	UpdateFrame(frameSlot);
 
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = waitSemaphores;
-	submitInfo.pWaitDstStageMask = waitStages;
+	VkCommandBuffer commandBuffer = commandRecorder.BeginFrame(frameSlot);
+	std::vector<VkSemaphoreSubmitInfo> waits;
+	std::vector<VkSemaphoreSubmitInfo> signals;
+	{
+		Profiler::CpuScope recordScope(profiler, "RecordCommandBuffer");
+		RecordCommandBuffer(commandBuffer, frameSlot, imageIndex, waits);
+	}
 
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
+	if (!settings.headless)
+	{
+		VkSemaphoreSubmitInfo acquireWait{};
+		acquireWait.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+		acquireWait.semaphore = imageAvailableSemaphores[frameSlot];
+		acquireWait.stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+		waits.push_back(acquireWait);
+
+		VkSemaphoreSubmitInfo presentSignal{};
+		presentSignal.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+		presentSignal.semaphore = renderFinishedSemaphores[frameSlot];
+		presentSignal.stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+		signals.push_back(presentSignal);
+	}
 
-	VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
+	frameScheduler.Submit(gQueue, { commandBuffer }, waits, signals);
 
-	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores = signalSemaphores;
+	if (frameScheduler.GetFrameNumber() == 1u)
+	{
+		auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+		std::cout << "INFO: Time to first frame: " << elapsed << " ms.\n";
+	}
 
-	if (vkQueueSubmit(gQueue,1,&submitInfo,inFlightFences[currentFrame]) != VK_SUCCESS)
+	if (settings.headless)
 	{
-		throw std::runtime_error("ERROR: Could not submit to queue.\n");
+		return;
 	}
 
 	VkPresentInfoKHR presentInfo{};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+	presentInfo.pNext = framePacer.GetPresentNext();
 
 	presentInfo.waitSemaphoreCount = 1;
-	presentInfo.pWaitSemaphores = signalSemaphores;
+	presentInfo.pWaitSemaphores = &renderFinishedSemaphores[frameSlot];
 	
 	VkSwapchainKHR swapChains[] = {swapchain};
 	presentInfo.swapchainCount = 1;
 	presentInfo.pSwapchains = swapChains;
 	presentInfo.pImageIndices = &imageIndex;
 
-	vkQueuePresentKHR(pQueue, &presentInfo);
+	VkResult result = vkQueuePresentKHR(pQueue, &presentInfo);
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized)
+	{
+		RecreateSwapchain(frameScheduler.GetFrameNumber());
+		framePacer.ResetSwapchain();
+	}
+	else if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not present swapchain image.\n");
+	}
+	else
+	{
+		framePacer.Update(swapchain);
+	}
 }
 
-void TriangleApplication::CreateCommandBuffers()
+void TriangleApplication::CreateCommandRecorder()
 {
-	commandBuffers.resize(maxFramesInFlight);
+	commandRecorder.Create(device, &hostAllocator, graphicsFamilyIndex, settings.framesInFlight, settings.recordThreads);
+}
 
-	VkCommandBufferAllocateInfo info{};
-	info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	info.commandBufferCount = (uint32_t)maxFramesInFlight;
-	info.commandPool = commandPool;
-	info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	
-	if (vkAllocateCommandBuffers(device,&info,commandBuffers.data()) != VK_SUCCESS)
-	{
-		throw std::runtime_error("ERROR: Could not allocate command buffers.\n");
-	}
+void TriangleApplication::DestroyCommandRecorder()
+{
+	commandRecorder.Destroy();
+}
+
+void TriangleApplication::CreateProfiler()
+{
+	profiler.Create(instance, physicalDevice, device, &hostAllocator, gQueue, graphicsFamilyIndex, settings.framesInFlight, IsDeviceExtensionEnabled("VK_EXT_calibrated_timestamps"), settings.profileOutputPath);
+}
+
+void TriangleApplication::DestroyProfiler()
+{
+	profiler.Destroy();
+}
+
+void TriangleApplication::CreateFramePacer()
+{
+	bool presentWait = IsDeviceExtensionEnabled("VK_KHR_present_id") && IsDeviceExtensionEnabled("VK_KHR_present_wait");
+	framePacer.Create(device, presentWait, settings.waitForPresent, settings.frameRateLimit, &profiler);
+}
+
+void TriangleApplication::DestroyFramePacer()
+{
+	framePacer.Destroy();
+}
+
+void TriangleApplication::CreateRenderGraph()
+{
+	//Passes are only declared on the first frame, derived scenes are not constructed yet.
+	renderGraph.Create(device, &hostAllocator, &memoryAllocator, &deletionQueue, &profiler);
+}
+
+void TriangleApplication::DestroyRenderGraph()
+{
+	frameScheduler.WaitIdle();
+	renderGraph.Destroy();
+}
+
+void TriangleApplication::CreateFrameAllocator()
+{
+	frameAllocator.Create(physicalDevice, &memoryAllocator, settings.framesInFlight);
+}
+
+void TriangleApplication::CreateAsyncCompute()
+{
+	asyncCompute.Create(physicalDevice, device, &hostAllocator, cQueue, computeFamilyIndex, graphicsFamilyIndex, settings.framesInFlight);
+}
+
+void TriangleApplication::DestroyAsyncCompute()
+{
+	asyncCompute.Destroy();
+}
+
+void TriangleApplication::DestroyFrameAllocator()
+{
+	//DestroyRenderGraph has waited for the GPU already.
+	frameAllocator.Destroy();
 }
 
 void TriangleApplication::CreateSyncObjects()
 {
-	imageAvailableSemaphores.resize((uint32_t)maxFramesInFlight);
-	renderFinishedSemaphores.resize((uint32_t)maxFramesInFlight);
-	inFlightFences.resize((uint32_t)maxFramesInFlight);
+	frameScheduler.Create(physicalDevice, device, &hostAllocator, graphicsFamilyIndex, settings.framesInFlight);
+
+	if (settings.headless)
+	{
+		return;
+	}
+
+	imageAvailableSemaphores.resize(settings.framesInFlight);
+	renderFinishedSemaphores.resize(settings.framesInFlight);
 
 	VkSemaphoreCreateInfo semaphoreInfo{};
 	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	VkFenceCreateInfo fenceInfo{};
-	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-	for (uint32_t i = 0; i < maxFramesInFlight; i++)
+	for (uint32_t i = 0; i < settings.framesInFlight; i++)
 	{
-		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-			vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-			vkCreateFence(device, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS)
+		if (vkCreateSemaphore(device, &semaphoreInfo, hostAllocator.Get(VK_OBJECT_TYPE_SEMAPHORE), &imageAvailableSemaphores[i]) != VK_SUCCESS ||
+			vkCreateSemaphore(device, &semaphoreInfo, hostAllocator.Get(VK_OBJECT_TYPE_SEMAPHORE), &renderFinishedSemaphores[i]) != VK_SUCCESS)
 		{
 			throw std::runtime_error("ERROR: Could not create sync objects.\n");
 		}
@@ -133,39 +280,166 @@ void TriangleApplication::CreateSyncObjects()
 
 void TriangleApplication::DestroySyncObjects()
 {
-	for (uint32_t i = 0; i < maxFramesInFlight; i++)
+	frameScheduler.Destroy();
+
+	for (size_t i = 0; i < imageAvailableSemaphores.size(); i++)
 	{
-		vkDestroyFence(device, inFlightFences[i], nullptr);
-		vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
-		vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
+		vkDestroySemaphore(device, renderFinishedSemaphores[i], hostAllocator.Get(VK_OBJECT_TYPE_SEMAPHORE));
+		vkDestroySemaphore(device, imageAvailableSemaphores[i], hostAllocator.Get(VK_OBJECT_TYPE_SEMAPHORE));
 	}
 }
 
-void TriangleApplication::RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+void TriangleApplication::RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t frameSlot, uint32_t imageIndex, std::vector<VkSemaphoreSubmitInfo>& waits)
 {
 	VkCommandBufferBeginInfo beginInfo{};
 	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
 	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
 	{
 		throw std::runtime_error("ERROR: Could not begin recording command buffer.\n");
 	}
 
-	VkRenderPassBeginInfo renderPassBeginInfo{};
-	renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassBeginInfo.renderPass = renderPass;
-	renderPassBeginInfo.framebuffer = swapchainFramebuffers[imageIndex];
-	renderPassBeginInfo.renderArea.offset = { 0,0 };
-	renderPassBeginInfo.renderArea.extent = swapchainExtent;
+	frameScheduler.RecordFrameStart(commandBuffer);
+	profiler.BeginGpuScope(commandBuffer, "Frame");
+
+	profiler.BeginGpuScope(commandBuffer, "Upload acquire");
+	uint64_t uploadWaitValue = uploadManager.RecordAcquireBarriers(commandBuffer);
+	profiler.EndGpuScope(commandBuffer);
+
+	//Uploads are waited for on the GPU, the CPU never blocks on them here.
+	if (uploadWaitValue != 0u)
+	{
+		VkSemaphoreSubmitInfo uploadWait{};
+		uploadWait.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+		uploadWait.semaphore = uploadManager.GetSemaphore();
+		uploadWait.value = uploadWaitValue;
+		uploadWait.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+		waits.push_back(uploadWait);
+	}
+
+	//Same for compute, only the stages that read its results wait.
+	VkSemaphoreSubmitInfo computeWait = asyncCompute.RecordAcquireBarriers(commandBuffer);
+	if (computeWait.value != 0u)
+	{
+		waits.push_back(computeWait);
+	}
+
+	if (renderGraphExtent.width != swapchainExtent.width || renderGraphExtent.height != swapchainExtent.height)
+	{
+		BuildRenderGraph();
+	}
+
+	renderGraph.SetImportedImage(backbuffer, swapchainImages[imageIndex], swapchainImageViews[imageIndex]);
+	renderGraph.Execute(commandBuffer);
+
+	profiler.EndGpuScope(commandBuffer);
+	frameScheduler.RecordFrameEnd(commandBuffer);
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Failed to record command buffer.\n");
+	}
+}
+
+void TriangleApplication::BuildRenderGraph()
+{
+	//Frames already submitted keep their transient images until the GPU is done with them.
+	renderGraph.Reset(frameScheduler.GetFrameNumber());
+
+	//Acquire wait covers the presentation engine, headless images are read back after the frame instead of presented.
+	//Headless frames start after the transfer stages, which covers the transition and readback of the image's last use.
+	RenderGraphState initial{ VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED };
+	RenderGraphState final{ VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR };
+	if (settings.headless)
+	{
+		initial.stages |= VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+		final = { VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL };
+	}
+
+	backbuffer = renderGraph.ImportImage("Backbuffer", swapchainImageFormat, swapchainExtent, initial, final);
+	AddPasses(backbuffer);
+	renderGraph.Compile();
+	renderGraphExtent = swapchainExtent;
+}
+
+void TriangleApplication::AddPasses(uint32_t backbuffer)
+{
+	AddMainPass(backbuffer);
+}
 
+uint32_t TriangleApplication::AddMainPass(uint32_t backbuffer)
+{
+	mainPass = renderGraph.AddPass("Main pass", [this](VkCommandBuffer commandBuffer) { RecordMainPass(commandBuffer); });
+
+	//Multisampled color and depth never outlive the pass. Nothing stores them, so on tiled GPUs they can stay in tile
+	//memory and their lazily allocated backing is never committed.
 	VkClearValue clearColor = { {{0.f, 0.0f, 0.0f, 1.0f}} };
-	renderPassBeginInfo.clearValueCount = 1;
-	renderPassBeginInfo.pClearValues = &clearColor;
+	if (mainPassFormats.sampleCount == VK_SAMPLE_COUNT_1_BIT)
+	{
+		renderGraph.Write(mainPass, backbuffer, RenderGraphUsage::ColorAttachment);
+		renderGraph.Clear(mainPass, backbuffer, clearColor);
+	}
+	else
+	{
+		RenderGraphImageDescription colorDescription{ mainPassFormats.colorFormats[0], swapchainExtent, mainPassFormats.sampleCount, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT };
+		uint32_t color = renderGraph.CreateImage("Multisampled color", colorDescription);
+		renderGraph.Write(mainPass, color, RenderGraphUsage::ColorAttachment);
+		renderGraph.Clear(mainPass, color, clearColor);
+		renderGraph.Resolve(mainPass, color, backbuffer);
+	}
+
+	RenderGraphImageDescription depthDescription{ mainPassFormats.depthFormat, swapchainExtent, mainPassFormats.sampleCount, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT };
+	uint32_t depth = renderGraph.CreateImage("Depth", depthDescription);
+	renderGraph.Write(mainPass, depth, RenderGraphUsage::DepthAttachment);
+
+	VkClearValue clearDepth{};
+	clearDepth.depthStencil = { 1.f, 0u };
+	renderGraph.Clear(mainPass, depth, clearDepth);
+
+	renderGraph.SetSecondaryCommandBuffers(mainPass);
+	return mainPass;
+}
+
+void TriangleApplication::RecordMainPass(VkCommandBuffer commandBuffer)
+{
+	VkCommandBufferInheritanceRenderingInfo renderingInheritance = renderGraph.GetInheritanceRenderingInfo(mainPass);
+
+	VkCommandBufferInheritanceInfo inheritance{};
+	inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritance.pNext = &renderingInheritance;
+
+	uint32_t frameSlot = frameScheduler.GetFrameSlot();
+	std::vector<VkCommandBuffer> secondaries = commandRecorder.Record(inheritance, GetDrawCount(),
+		[this, frameSlot](VkCommandBuffer secondary, uint32_t begin, uint32_t end) { RecordDraws(secondary, frameSlot, begin, end); });
+	vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+}
+
+void TriangleApplication::UpdateFrame(uint32_t frameSlot)
+{
+}
 
-	vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+uint32_t TriangleApplication::GetDrawCount()
+{
+	return settings.drawCount;
+}
 
+void TriangleApplication::RecordDraws(VkCommandBuffer commandBuffer, uint32_t frameSlot, uint32_t begin, uint32_t end)
+{
+	Profiler::CpuScope scope(profiler, "RecordDraws");
+
+	//State is not inherited from the primary, every secondary binds its own.
 	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+	SetViewportAndScissor(commandBuffer);
+
+	for (uint32_t i = begin; i < end; i++)
+	{
+		vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+	}
+}
 
+void TriangleApplication::SetViewportAndScissor(VkCommandBuffer commandBuffer)
+{
 	VkViewport viewport{};
 	viewport.x = 0.f;
 	viewport.y = 0.f;
@@ -179,13 +453,4 @@ void TriangleApplication::RecordCommandBuffer(VkCommandBuffer commandBuffer, uin
 	scissor.offset = { 0, 0 };
 	scissor.extent = swapchainExtent;
 	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-
-	vkCmdDraw(commandBuffer, 3, 1, 0, 0);
-
-	vkCmdEndRenderPass(commandBuffer);
-
-	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
-	{
-		throw std::runtime_error("ERROR: Failed to record command buffer.\n");
-	}
 }
@@ -0,0 +1,464 @@
+#include "UploadManager.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+UploadManager::UploadManager() :
+	device(VK_NULL_HANDLE),
+	hostAllocator(nullptr),
+	memoryAllocator(nullptr),
+	transferQueue(VK_NULL_HANDLE),
+	transferFamilyIndex(0u),
+	graphicsFamilyIndex(0u),
+	copyAlignment(16u),
+	commandPool(VK_NULL_HANDLE),
+	semaphore(VK_NULL_HANDLE),
+	nextValue(1u),
+	ringBuffer(VK_NULL_HANDLE),
+	ringAllocation(),
+	capacity(0u),
+	head(0u),
+	allocatedBytes(0u),
+	recording(false),
+	current(),
+	pendingValue(0u),
+	totalBatches(0u),
+	totalUploads(0u),
+	totalBytes(0u)
+{
+}
+
+UploadManager::~UploadManager()
+{
+}
+
+void UploadManager::Create(VkPhysicalDevice physicalDevice, VkDevice device, HostAllocator* hostAllocator, MemoryAllocator* memoryAllocator, VkQueue transferQueue, uint32_t transferFamilyIndex, uint32_t graphicsFamilyIndex, VkDeviceSize capacity)
+{
+	this->device = device;
+	this->hostAllocator = hostAllocator;
+	this->memoryAllocator = memoryAllocator;
+	this->transferQueue = transferQueue;
+	this->transferFamilyIndex = transferFamilyIndex;
+	this->graphicsFamilyIndex = graphicsFamilyIndex;
+	this->capacity = capacity;
+
+	//Image copies need offsets aligned to the texel block size, 16 bytes covers every uncompressed and block compressed format.
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	copyAlignment = std::max<VkDeviceSize>(16u, properties.limits.optimalBufferCopyOffsetAlignment);
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = transferFamilyIndex;
+
+	if (vkCreateCommandPool(device, &poolInfo, hostAllocator->Get(VK_OBJECT_TYPE_COMMAND_POOL), &commandPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not create upload command pool.\n");
+	}
+
+	VkSemaphoreTypeCreateInfo typeInfo{};
+	typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	typeInfo.initialValue = 0u;
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreInfo.pNext = &typeInfo;
+
+	if (vkCreateSemaphore(device, &semaphoreInfo, hostAllocator->Get(VK_OBJECT_TYPE_SEMAPHORE), &semaphore) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not create upload semaphore.\n");
+	}
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = capacity;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	memoryAllocator->CreateBuffer(bufferInfo, MemoryUsage::Upload, ringBuffer, ringAllocation);
+
+	if (transferFamilyIndex != graphicsFamilyIndex)
+	{
+		std::cout << "INFO: Uploads use dedicated transfer queue family " << transferFamilyIndex << ".\n";
+	}
+}
+
+void UploadManager::Destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	//Uploads still recorded are submitted so nothing that was promised is silently dropped.
+	Wait(Flush());
+
+	if (totalUploads != 0u)
+	{
+		std::cout << "INFO: Uploaded " << (totalBytes >> 10) << " KiB in " << totalUploads << " upload(s) and " << totalBatches << " batch(es).\n";
+	}
+
+	memoryAllocator->DestroyBuffer(ringBuffer, ringAllocation);
+	vkDestroySemaphore(device, semaphore, hostAllocator->Get(VK_OBJECT_TYPE_SEMAPHORE));
+	vkDestroyCommandPool(device, commandPool, hostAllocator->Get(VK_OBJECT_TYPE_COMMAND_POOL));
+
+	inFlight.clear();
+	freeCommandBuffers.clear();
+	pendingAcquires.clear();
+	device = VK_NULL_HANDLE;
+}
+
+void UploadManager::UploadBuffer(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size, bool concurrent)
+{
+	const char* source = static_cast<const char*>(data);
+	UploadBuffer(buffer, offset, size, [source](void* destination, VkDeviceSize offset, VkDeviceSize size)
+	{
+		std::memcpy(destination, source + offset, static_cast<size_t>(size));
+	}, concurrent);
+}
+
+void UploadManager::UploadBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, const std::function<void(void* destination, VkDeviceSize offset, VkDeviceSize size)>& write, bool concurrent)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	//Large uploads go in chunks so they never need more than half of the ring at once.
+	const VkDeviceSize chunkSize = capacity / 2u;
+
+	for (VkDeviceSize done = 0u; done < size; done += chunkSize)
+	{
+		VkDeviceSize chunk = std::min(chunkSize, size - done);
+		VkDeviceSize ringOffset = Reserve(chunk, 4u);
+		//Written before anything else can reserve, a full ring flushes the batch on the next reservation.
+		write(static_cast<char*>(ringAllocation.mapped) + ringOffset, done, chunk);
+
+		VkBufferCopy region{};
+		region.srcOffset = ringOffset;
+		region.dstOffset = offset + done;
+		region.size = chunk;
+		vkCmdCopyBuffer(current.commandBuffer, ringBuffer, buffer, 1, &region);
+
+		current.uploadedBytes += chunk;
+	}
+
+	if (transferFamilyIndex != graphicsFamilyIndex && !concurrent)
+	{
+		VkBufferMemoryBarrier release{};
+		release.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		release.dstAccessMask = 0u;
+		release.srcQueueFamilyIndex = transferFamilyIndex;
+		release.dstQueueFamilyIndex = graphicsFamilyIndex;
+		release.buffer = buffer;
+		release.offset = offset;
+		release.size = size;
+		current.bufferReleases.push_back(release);
+	}
+
+	totalUploads++;
+}
+
+void UploadManager::UploadImage(VkImage image, const VkImageSubresourceLayers& subresource, VkExtent3D extent, const void* data, VkDeviceSize size, VkImageLayout finalLayout)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (size > capacity)
+	{
+		throw std::runtime_error("ERROR: Image upload is larger than the staging ring.\n");
+	}
+
+	VkDeviceSize ringOffset = Reserve(size, copyAlignment);
+	std::memcpy(static_cast<char*>(ringAllocation.mapped) + ringOffset, data, static_cast<size_t>(size));
+
+	VkImageSubresourceRange range{};
+	range.aspectMask = subresource.aspectMask;
+	range.baseMipLevel = subresource.mipLevel;
+	range.levelCount = 1u;
+	range.baseArrayLayer = subresource.baseArrayLayer;
+	range.layerCount = subresource.layerCount;
+
+	VkImageMemoryBarrier toTransfer{};
+	toTransfer.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	toTransfer.srcAccessMask = 0u;
+	toTransfer.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	toTransfer.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	toTransfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	toTransfer.image = image;
+	toTransfer.subresourceRange = range;
+	vkCmdPipelineBarrier(current.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &toTransfer);
+
+	VkBufferImageCopy region{};
+	region.bufferOffset = ringOffset;
+	region.imageSubresource = subresource;
+	region.imageExtent = extent;
+	vkCmdCopyBufferToImage(current.commandBuffer, ringBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+	//Layout transition happens as part of the release, the matching acquire repeats it.
+	bool transfer = transferFamilyIndex != graphicsFamilyIndex;
+
+	VkImageMemoryBarrier release{};
+	release.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	release.dstAccessMask = 0u;
+	release.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	release.newLayout = finalLayout;
+	release.srcQueueFamilyIndex = transfer ? transferFamilyIndex : VK_QUEUE_FAMILY_IGNORED;
+	release.dstQueueFamilyIndex = transfer ? graphicsFamilyIndex : VK_QUEUE_FAMILY_IGNORED;
+	release.image = image;
+	release.subresourceRange = range;
+	current.imageReleases.push_back(release);
+
+	current.uploadedBytes += size;
+	totalUploads++;
+}
+
+uint64_t UploadManager::Flush()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return FlushBatch();
+}
+
+bool UploadManager::IsComplete(uint64_t token)
+{
+	uint64_t value = 0u;
+	vkGetSemaphoreCounterValue(device, semaphore, &value);
+	return value >= token;
+}
+
+void UploadManager::Wait(uint64_t token)
+{
+	VkSemaphoreWaitInfo waitInfo{};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &semaphore;
+	waitInfo.pValues = &token;
+
+	vkWaitSemaphores(device, &waitInfo, UINT64_MAX);
+}
+
+uint64_t UploadManager::RecordAcquireBarriers(VkCommandBuffer commandBuffer)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::vector<VkBufferMemoryBarrier> bufferAcquires;
+	std::vector<VkImageMemoryBarrier> imageAcquires;
+	for (auto& pending : pendingAcquires)
+	{
+		bufferAcquires.insert(bufferAcquires.end(), pending.bufferAcquires.begin(), pending.bufferAcquires.end());
+		imageAcquires.insert(imageAcquires.end(), pending.imageAcquires.begin(), pending.imageAcquires.end());
+	}
+	pendingAcquires.clear();
+
+	if (!bufferAcquires.empty() || !imageAcquires.empty())
+	{
+		//Semaphore wait in the same submission covers the release, the acquire only has to order against later reads.
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+			0, nullptr, static_cast<uint32_t>(bufferAcquires.size()), bufferAcquires.data(), static_cast<uint32_t>(imageAcquires.size()), imageAcquires.data());
+	}
+
+	uint64_t value = pendingValue;
+	pendingValue = 0u;
+	return value;
+}
+
+VkSemaphore UploadManager::GetSemaphore() const
+{
+	return semaphore;
+}
+
+VkDeviceSize UploadManager::GetCapacity() const
+{
+	return capacity;
+}
+
+VkDeviceSize UploadManager::Reserve(VkDeviceSize size, VkDeviceSize alignment)
+{
+	VkDeviceSize offset = 0u;
+	while (!TryReserve(size, alignment, offset))
+	{
+		//Ring is full: submit what is recorded so far and wait for the oldest batch to free its space.
+		if (recording)
+		{
+			FlushBatch();
+		}
+		else if (!inFlight.empty())
+		{
+			Wait(inFlight.front().value);
+			Reclaim();
+		}
+		else
+		{
+			throw std::runtime_error("ERROR: Upload is larger than the staging ring.\n");
+		}
+	}
+
+	if (!recording)
+	{
+		BeginBatch();
+	}
+	return offset;
+}
+
+bool UploadManager::TryReserve(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset)
+{
+	Reclaim();
+
+	if (allocatedBytes == 0u)
+	{
+		head = 0u;
+	}
+
+	//Used bytes form one contiguous run that ends at head, everything after head up to the run start is free.
+	VkDeviceSize aligned = (head + alignment - 1u) / alignment * alignment;
+	VkDeviceSize consumed = 0u;
+	if (aligned + size <= capacity)
+	{
+		consumed = aligned - head + size;
+		offset = aligned;
+	}
+	else
+	{
+		//Does not fit before the end, skip the tail of the ring and start over at zero.
+		consumed = capacity - head + size;
+		offset = 0u;
+	}
+
+	if (allocatedBytes + consumed > capacity)
+	{
+		return false;
+	}
+
+	//Space reserved while no batch is recording belongs to the batch that BeginBatch starts next.
+	allocatedBytes += consumed;
+	current.ringBytes += consumed;
+	head = offset + size;
+	return true;
+}
+
+void UploadManager::BeginBatch()
+{
+	if (freeCommandBuffers.empty())
+	{
+		VkCommandBufferAllocateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		info.commandPool = commandPool;
+		info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		info.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		if (vkAllocateCommandBuffers(device, &info, &commandBuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("ERROR: Could not allocate upload command buffer.\n");
+		}
+		freeCommandBuffers.push_back(commandBuffer);
+	}
+
+	current.commandBuffer = freeCommandBuffers.back();
+	freeCommandBuffers.pop_back();
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkResetCommandBuffer(current.commandBuffer, 0);
+	if (vkBeginCommandBuffer(current.commandBuffer, &beginInfo) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not begin upload command buffer.\n");
+	}
+
+	recording = true;
+}
+
+uint64_t UploadManager::FlushBatch()
+{
+	if (!recording)
+	{
+		//Nothing new, the last submitted batch is the one to wait for.
+		return nextValue - 1u;
+	}
+
+	if (!current.bufferReleases.empty() || !current.imageReleases.empty())
+	{
+		vkCmdPipelineBarrier(current.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+			0, nullptr, static_cast<uint32_t>(current.bufferReleases.size()), current.bufferReleases.data(), static_cast<uint32_t>(current.imageReleases.size()), current.imageReleases.data());
+	}
+
+	if (vkEndCommandBuffer(current.commandBuffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not record upload command buffer.\n");
+	}
+
+	current.value = nextValue++;
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo{};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = &current.value;
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &current.commandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &semaphore;
+
+	if (vkQueueSubmit(transferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: Could not submit uploads.\n");
+	}
+
+	//Acquire barriers mirror the releases with the destination side filled in.
+	PendingAcquire pending{ current.value, std::move(current.bufferReleases), std::move(current.imageReleases) };
+	for (auto& barrier : pending.bufferAcquires)
+	{
+		barrier.srcAccessMask = 0u;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+	}
+	for (auto& barrier : pending.imageAcquires)
+	{
+		barrier.srcAccessMask = 0u;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+	}
+
+	//Same family means the release already did the layout transition, only the semaphore wait is left.
+	if (transferFamilyIndex == graphicsFamilyIndex)
+	{
+		pending.bufferAcquires.clear();
+		pending.imageAcquires.clear();
+	}
+	pendingAcquires.push_back(std::move(pending));
+	pendingValue = current.value;
+
+	totalBatches++;
+	totalBytes += current.uploadedBytes;
+
+	inFlight.push_back(std::move(current));
+	current = Batch{};
+	recording = false;
+
+	return inFlight.back().value;
+}
+
+void UploadManager::Reclaim()
+{
+	if (inFlight.empty())
+	{
+		return;
+	}
+
+	uint64_t completed = 0u;
+	vkGetSemaphoreCounterValue(device, semaphore, &completed);
+
+	while (!inFlight.empty() && inFlight.front().value <= completed)
+	{
+		allocatedBytes -= inFlight.front().ringBytes;
+		freeCommandBuffers.push_back(inFlight.front().commandBuffer);
+		inFlight.pop_front();
+	}
+}
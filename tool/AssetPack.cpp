@@ -0,0 +1,346 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <stdexcept>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <future>
+
+#include "AssetArchiveFormat.h"
+#include "ThreadPool.h"
+#include "Lz4.h"
+#include "Hash.h"
+
+namespace
+{
+	struct PackSettings
+	{
+		std::string output;
+		std::vector<std::string> inputs;
+		//Entry names are paths relative to this directory.
+		std::string root = ".";
+		bool compress = true;
+		uint32_t chunkSize = 256u << 10;
+		//Files with these extensions are always stored raw so they can be used in place.
+		std::vector<std::string> rawExtensions;
+	};
+
+	struct PackedFile
+	{
+		std::filesystem::path path;
+		std::string name;
+		std::vector<char> contents;
+		ArchiveEntry entry{};
+		std::vector<ArchiveChunk> chunks;
+		//Compressed bytes of every chunk, empty for chunks stored raw.
+		std::vector<std::vector<char>> payloads;
+	};
+
+	PackSettings ParseCommandLine(int argc, char** argv)
+	{
+		PackSettings settings;
+		std::vector<std::string> positional;
+
+		for (int i = 1; i < argc; i++)
+		{
+			std::string argument = argv[i];
+
+			auto next = [&]() -> std::string
+			{
+				if (i + 1 >= argc)
+				{
+					throw std::runtime_error("ERROR: Missing value for command line argument: " + argument + "\n");
+				}
+				return std::string(argv[++i]);
+			};
+
+			if (argument == "--compression")
+			{
+				std::string compression = next();
+				if (compression != "lz4" && compression != "none")
+				{
+					throw std::runtime_error("ERROR: Unknown compression " + compression + ", expected lz4 or none.\n");
+				}
+				settings.compress = compression == "lz4";
+			}
+			else if (argument == "--chunk-size")
+			{
+				uint32_t kibibytes = static_cast<uint32_t>(std::stoul(next()));
+				if (kibibytes == 0u || kibibytes > (1u << 20))
+				{
+					throw std::runtime_error("ERROR: Chunk size must be between 1 KiB and 1 GiB.\n");
+				}
+				settings.chunkSize = kibibytes << 10;
+			}
+			else if (argument == "--root")
+			{
+				settings.root = next();
+			}
+			else if (argument == "--raw")
+			{
+				settings.rawExtensions.push_back(next());
+			}
+			else if (argument.rfind("--", 0) == 0)
+			{
+				throw std::runtime_error("ERROR: Unknown command line argument: " + argument + "\n");
+			}
+			else
+			{
+				positional.push_back(argument);
+			}
+		}
+
+		if (positional.size() < 2u)
+		{
+			throw std::runtime_error("ERROR: Usage: AssetPack output.pak input... [--compression lz4|none] [--chunk-size KiB] [--root directory] [--raw .extension]\n");
+		}
+
+		settings.output = positional[0];
+		settings.inputs.assign(positional.begin() + 1, positional.end());
+		return settings;
+	}
+
+	std::vector<PackedFile> Collect(const PackSettings& settings)
+	{
+		std::vector<std::filesystem::path> paths;
+		for (auto& input : settings.inputs)
+		{
+			if (std::filesystem::is_directory(input))
+			{
+				for (auto& item : std::filesystem::recursive_directory_iterator(input))
+				{
+					if (item.is_regular_file())
+					{
+						paths.push_back(item.path());
+					}
+				}
+			}
+			else if (std::filesystem::is_regular_file(input))
+			{
+				paths.push_back(input);
+			}
+			else
+			{
+				throw std::runtime_error("ERROR: Could not find " + input + "\n");
+			}
+		}
+
+		std::filesystem::path root = std::filesystem::absolute(settings.root).lexically_normal();
+		std::vector<PackedFile> files(paths.size());
+		for (size_t i = 0; i < paths.size(); i++)
+		{
+			std::filesystem::path relative = std::filesystem::absolute(paths[i]).lexically_normal().lexically_relative(root);
+			if (relative.empty() || *relative.begin() == "..")
+			{
+				throw std::runtime_error("ERROR: " + paths[i].string() + " is not inside the archive root " + settings.root + "\n");
+			}
+
+			files[i].path = paths[i];
+			files[i].name = relative.generic_string();
+		}
+
+		std::sort(files.begin(), files.end(), [](const PackedFile& a, const PackedFile& b) { return a.name < b.name; });
+		auto duplicate = std::adjacent_find(files.begin(), files.end(), [](const PackedFile& a, const PackedFile& b) { return a.name == b.name; });
+		if (duplicate != files.end())
+		{
+			throw std::runtime_error("ERROR: " + duplicate->name + " is packed twice.\n");
+		}
+		return files;
+	}
+
+	void Compress(PackedFile& file, const PackSettings& settings)
+	{
+		std::ifstream stream(file.path, std::ios::ate | std::ios::binary);
+		if (!stream.is_open())
+		{
+			throw std::runtime_error("ERROR: Could not open " + file.path.string() + "\n");
+		}
+
+		file.contents.resize(static_cast<size_t>(stream.tellg()));
+		stream.seekg(0);
+		stream.read(file.contents.data(), file.contents.size());
+		if (!stream)
+		{
+			throw std::runtime_error("ERROR: Could not read " + file.path.string() + "\n");
+		}
+
+		bool compress = settings.compress &&
+			std::find(settings.rawExtensions.begin(), settings.rawExtensions.end(), file.path.extension().string()) == settings.rawExtensions.end();
+
+		uint64_t size = file.contents.size();
+		uint32_t chunkCount = static_cast<uint32_t>((size + settings.chunkSize - 1u) / settings.chunkSize);
+		file.chunks.resize(chunkCount);
+		file.payloads.resize(chunkCount);
+
+		bool compressed = false;
+		for (uint32_t i = 0; i < chunkCount; i++)
+		{
+			uint64_t begin = static_cast<uint64_t>(i) * settings.chunkSize;
+			uint32_t length = static_cast<uint32_t>(std::min<uint64_t>(settings.chunkSize, size - begin));
+			file.chunks[i].size = length;
+			file.chunks[i].storedSize = length;
+
+			if (!compress)
+			{
+				continue;
+			}
+
+			//Chunks that do not shrink are stored raw, decoding them would only cost time.
+			std::vector<char> buffer(length);
+			size_t storedSize = Lz4::Compress(file.contents.data() + begin, length, buffer.data(), length - 1u);
+			if (storedSize != 0u)
+			{
+				buffer.resize(storedSize);
+				file.payloads[i] = std::move(buffer);
+				file.chunks[i].storedSize = static_cast<uint32_t>(storedSize);
+				compressed = true;
+			}
+		}
+
+		//Entries where nothing compressed stay uncompressed, which keeps them usable in place.
+		file.entry.nameHash = HashString(file.name);
+		file.entry.nameLength = static_cast<uint32_t>(file.name.size());
+		file.entry.compression = compressed ? ArchiveCompression::Lz4 : ArchiveCompression::None;
+		file.entry.size = size;
+		file.entry.chunkCount = chunkCount;
+		file.entry.chunkSize = settings.chunkSize;
+	}
+
+	void Pad(std::ofstream& file, uint64_t alignment)
+	{
+		static const char zeros[archivePayloadAlignment] = {};
+		uint64_t position = static_cast<uint64_t>(file.tellp());
+		file.write(zeros, static_cast<std::streamsize>((alignment - position % alignment) % alignment));
+	}
+
+	uint64_t Write(const std::string& filename, std::vector<PackedFile>& files)
+	{
+		//Same write and rename as the pipeline cache, an interrupted pack never leaves a half written archive.
+		std::filesystem::path path(filename);
+		std::filesystem::path temporary = path;
+		temporary += ".tmp";
+
+		uint64_t archiveSize = 0u;
+		{
+			std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+			{
+				throw std::runtime_error("ERROR: Could not write " + filename + "\n");
+			}
+
+			ArchiveHeader header{};
+			std::copy(std::begin(archiveMagic), std::end(archiveMagic), header.magic);
+			header.version = archiveVersion;
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+			std::vector<ArchiveChunk> chunks;
+			std::string names;
+			for (auto& packed : files)
+			{
+				packed.entry.firstChunk = static_cast<uint32_t>(chunks.size());
+				packed.entry.nameOffset = names.size();
+				names += packed.name;
+
+				for (size_t i = 0; i < packed.chunks.size(); i++)
+				{
+					//Raw chunks of an entry are contiguous in the source, so an uncompressed entry ends up as one aligned run.
+					if (packed.entry.compression == ArchiveCompression::Lz4 || i == 0u)
+					{
+						Pad(file, archivePayloadAlignment);
+					}
+
+					packed.chunks[i].offset = static_cast<uint64_t>(file.tellp());
+					if (packed.payloads[i].empty())
+					{
+						file.write(packed.contents.data() + i * packed.entry.chunkSize, packed.chunks[i].size);
+					}
+					else
+					{
+						file.write(packed.payloads[i].data(), packed.payloads[i].size());
+					}
+				}
+				chunks.insert(chunks.end(), packed.chunks.begin(), packed.chunks.end());
+			}
+
+			std::vector<ArchiveEntry> entries;
+			for (auto& packed : files)
+			{
+				entries.push_back(packed.entry);
+			}
+			std::stable_sort(entries.begin(), entries.end(), [](const ArchiveEntry& a, const ArchiveEntry& b) { return a.nameHash < b.nameHash; });
+
+			Pad(file, alignof(ArchiveChunk));
+			header.chunkOffset = static_cast<uint64_t>(file.tellp());
+			header.chunkCount = static_cast<uint32_t>(chunks.size());
+			file.write(reinterpret_cast<const char*>(chunks.data()), chunks.size() * sizeof(ArchiveChunk));
+
+			Pad(file, alignof(ArchiveEntry));
+			header.entryOffset = static_cast<uint64_t>(file.tellp());
+			header.entryCount = static_cast<uint32_t>(entries.size());
+			file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(ArchiveEntry));
+
+			header.nameOffset = static_cast<uint64_t>(file.tellp());
+			header.nameSize = names.size();
+			file.write(names.data(), names.size());
+
+			archiveSize = static_cast<uint64_t>(file.tellp());
+			file.seekp(0);
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+			if (!file)
+			{
+				throw std::runtime_error("ERROR: Could not write " + filename + "\n");
+			}
+		}
+
+		std::filesystem::rename(temporary, path);
+		return archiveSize;
+	}
+}
+
+//Packs files and directory trees into one archive that AssetArchive memory maps. Chunks are compressed with LZ4 on
+//every hardware thread, entries that do not compress are stored raw and aligned so they can be used in place.
+int main(int argc, char** argv)
+{
+	try
+	{
+		PackSettings settings = ParseCommandLine(argc, argv);
+		auto start = std::chrono::steady_clock::now();
+
+		std::vector<PackedFile> files = Collect(settings);
+
+		{
+			ThreadPool threadPool;
+			std::vector<std::future<void>> pending;
+			for (auto& file : files)
+			{
+				pending.push_back(threadPool.Submit([&file, &settings]() { Compress(file, settings); }));
+			}
+			for (auto& future : pending)
+			{
+				future.get();
+			}
+		}
+
+		uint64_t inputSize = 0u;
+		uint32_t compressedCount = 0u;
+		for (auto& file : files)
+		{
+			inputSize += file.entry.size;
+			compressedCount += file.entry.compression == ArchiveCompression::Lz4 ? 1u : 0u;
+		}
+
+		uint64_t archiveSize = Write(settings.output, files);
+
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		std::cout << "INFO: Wrote " << settings.output << " with " << files.size() << " files (" << compressedCount << " compressed), "
+			<< archiveSize << " bytes from " << inputSize << ", in " << milliseconds << " ms.\n";
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+}
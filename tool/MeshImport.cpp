@@ -0,0 +1,173 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <stdexcept>
+#include <chrono>
+
+#include "MeshImporter.h"
+#include "MeshOptimizer.h"
+#include "MeshFormat.h"
+
+namespace
+{
+	//Cache size the statistics are reported for, a common FIFO size on current hardware.
+	const uint32_t reportCacheSize = 16u;
+
+	struct ImportSettings
+	{
+		std::string input;
+		std::string output;
+		bool vertexCache = true;
+		bool overdraw = true;
+		bool vertexFetch = true;
+		float overdrawThreshold = 1.05f;
+	};
+
+	ImportSettings ParseCommandLine(int argc, char** argv)
+	{
+		ImportSettings settings;
+		std::vector<std::string> positional;
+
+		for (int i = 1; i < argc; i++)
+		{
+			std::string argument = argv[i];
+
+			auto next = [&]() -> std::string
+			{
+				if (i + 1 >= argc)
+				{
+					throw std::runtime_error("ERROR: Missing value for command line argument: " + argument + "\n");
+				}
+				return std::string(argv[++i]);
+			};
+
+			if (argument == "--no-vertex-cache")
+			{
+				settings.vertexCache = false;
+			}
+			else if (argument == "--no-overdraw")
+			{
+				settings.overdraw = false;
+			}
+			else if (argument == "--no-vertex-fetch")
+			{
+				settings.vertexFetch = false;
+			}
+			else if (argument == "--overdraw-threshold")
+			{
+				settings.overdrawThreshold = std::stof(next());
+			}
+			else if (argument.rfind("--", 0) == 0)
+			{
+				throw std::runtime_error("ERROR: Unknown command line argument: " + argument + "\n");
+			}
+			else
+			{
+				positional.push_back(argument);
+			}
+		}
+
+		if (positional.size() != 2u)
+		{
+			throw std::runtime_error("ERROR: Usage: MeshImport input.obj|input.gltf|input.glb output.mesh [--no-vertex-cache] [--no-overdraw] [--no-vertex-fetch] [--overdraw-threshold N]\n");
+		}
+
+		settings.input = positional[0];
+		settings.output = positional[1];
+		return settings;
+	}
+
+	void PrintStatistics(const char* stage, const ImportedMesh& mesh, uint32_t vertexSize)
+	{
+		uint32_t vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+		std::cout << "INFO: " << stage << ": ACMR " << MeshOptimizer::GetAverageCacheMissRatio(mesh.indices, vertexCount, reportCacheSize)
+			<< ", ATVR " << MeshOptimizer::GetAverageCacheMissRatio(mesh.indices, vertexCount, reportCacheSize) * static_cast<float>(mesh.indices.size() / 3u) / static_cast<float>(vertexCount)
+			<< ", overfetch " << MeshOptimizer::GetOverfetchRatio(mesh.indices, vertexCount, vertexSize) << ".\n";
+	}
+
+	void Write(const std::string& filename, const MeshFileHeader& header, const std::vector<PackedVertex>& vertices, const std::vector<uint32_t>& indices)
+	{
+		//Same write and rename as the pipeline cache, an interrupted import never leaves a half written mesh.
+		std::filesystem::path path(filename);
+		std::filesystem::path temporary = path;
+		temporary += ".tmp";
+
+		{
+			std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+			{
+				throw std::runtime_error("ERROR: Could not write " + filename + "\n");
+			}
+
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char*>(vertices.data()), vertices.size() * sizeof(PackedVertex));
+
+			if (UsesShortIndices(header.vertexCount))
+			{
+				std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+				file.write(reinterpret_cast<const char*>(shortIndices.data()), shortIndices.size() * sizeof(uint16_t));
+			}
+			else
+			{
+				file.write(reinterpret_cast<const char*>(indices.data()), indices.size() * sizeof(uint32_t));
+			}
+
+			if (!file)
+			{
+				throw std::runtime_error("ERROR: Could not write " + filename + "\n");
+			}
+		}
+
+		std::filesystem::rename(temporary, path);
+	}
+}
+
+//Offline step between source meshes and the renderer: imports OBJ or glTF, optimises index and vertex order and
+//quantises vertices into the format Mesh loads. Runs on the CPU only, no Vulkan device is needed.
+int main(int argc, char** argv)
+{
+	try
+	{
+		ImportSettings settings = ParseCommandLine(argc, argv);
+		auto start = std::chrono::steady_clock::now();
+
+		ImportedMesh mesh = MeshImporter::Load(settings.input);
+		uint32_t vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+		std::cout << "INFO: Imported " << vertexCount << " vertices and " << mesh.indices.size() / 3u << " triangles from " << settings.input << ".\n";
+		PrintStatistics("Input", mesh, sizeof(ImportedVertex));
+
+		if (settings.vertexCache)
+		{
+			mesh.indices = MeshOptimizer::OptimizeVertexCache(mesh.indices, vertexCount);
+			PrintStatistics("Vertex cache", mesh, sizeof(ImportedVertex));
+		}
+
+		if (settings.overdraw)
+		{
+			mesh.indices = MeshOptimizer::OptimizeOverdraw(mesh.indices, mesh.vertices, settings.overdrawThreshold);
+			PrintStatistics("Overdraw", mesh, sizeof(ImportedVertex));
+		}
+
+		if (settings.vertexFetch)
+		{
+			MeshOptimizer::OptimizeVertexFetch(mesh);
+			PrintStatistics("Vertex fetch", mesh, sizeof(PackedVertex));
+		}
+
+		MeshFileHeader header{};
+		std::vector<PackedVertex> vertices;
+		MeshOptimizer::Quantize(mesh, header, vertices);
+		Write(settings.output, header, vertices, mesh.indices);
+
+		size_t indexSize = UsesShortIndices(header.vertexCount) ? sizeof(uint16_t) : sizeof(uint32_t);
+		size_t packedSize = sizeof(header) + vertices.size() * sizeof(PackedVertex) + mesh.indices.size() * indexSize;
+		size_t floatSize = mesh.vertices.size() * sizeof(ImportedVertex) + mesh.indices.size() * sizeof(uint32_t);
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		std::cout << "INFO: Wrote " << settings.output << ", " << packedSize << " bytes instead of " << floatSize << " unquantised, in " << milliseconds << " ms.\n";
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+}